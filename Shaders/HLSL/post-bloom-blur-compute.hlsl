@@ -0,0 +1,75 @@
+/// ------------------ POST BLOOM BLUR COMPUTE SHADER ------------------
+/// Separable gaussian of PostProcessStack, dispatched once per direction.
+/// A group loads its line segment and the apron on both sides into shared memory once, then every tap reads shared memory.
+
+#define GROUP_SIZE  64 // BLUR_GROUP_SIZE of PostProcessStack
+#define BLUR_RADIUS 8
+#define BLUR_SIGMA  4.0f
+
+struct PushConstantBloomBlur
+{
+	uint  direction; // 0 : horizontal, 1 : vertical
+	uint3 padding;
+};
+
+[[vk::push_constant]]
+PushConstantBloomBlur pc;
+
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+Texture2D inTexture : register(t0);
+
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+SamplerState inSampler : register(s0);
+
+[[vk::binding(1, 0)]]
+RWTexture2D<float4> outImage : register(u1);
+
+groupshared float3 cachedTexels[GROUP_SIZE + 2 * BLUR_RADIUS];
+
+// group x walks along the blur direction, group y selects the row (or column)
+int2 GetPixel(int along, int across)
+{
+	return (pc.direction == 0) ? int2(along, across) : int2(across, along);
+}
+
+float3 LoadClamped(int along, int across, int2 size)
+{
+	int2 pixel = clamp(GetPixel(along, across), int2(0, 0), size - 1);
+	return inTexture.Load(int3(pixel, 0)).rgb;
+}
+
+[numthreads(GROUP_SIZE, 1, 1)]
+void main(uint3 groupID : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+	uint width, height;
+	outImage.GetDimensions(width, height);
+	int2 size = int2(width, height);
+
+	int along  = int(groupID.x * GROUP_SIZE + groupIndex);
+	int across = int(groupID.y);
+
+	// every thread loads its own texel, the first BLUR_RADIUS threads load both aprons
+	cachedTexels[groupIndex + BLUR_RADIUS] = LoadClamped(along, across, size);
+	if (groupIndex < BLUR_RADIUS)
+	{
+		cachedTexels[groupIndex]                            = LoadClamped(along - BLUR_RADIUS, across, size);
+		cachedTexels[groupIndex + GROUP_SIZE + BLUR_RADIUS] = LoadClamped(along + GROUP_SIZE, across, size);
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	int2 pixel = GetPixel(along, across);
+	if (pixel.x >= size.x || pixel.y >= size.y)
+		return;
+
+	float3 color       = 0.0f;
+	float  totalWeight = 0.0f;
+	[unroll]
+	for (int offset = -BLUR_RADIUS; offset <= BLUR_RADIUS; offset++)
+	{
+		float weight = exp(-float(offset * offset) / (2.0f * BLUR_SIGMA * BLUR_SIGMA));
+		color       += cachedTexels[int(groupIndex) + BLUR_RADIUS + offset] * weight;
+		totalWeight += weight;
+	}
+
+	outImage[pixel] = float4(color / totalWeight, 1.0f);
+}
@@ -0,0 +1,68 @@
+/// ------------------ POST BLOOM PREFILTER COMPUTE SHADER ------------------
+/// Half resolution bright pass of PostProcessStack, the 2x2 downsample and a soft knee threshold in one dispatch.
+
+struct PushConstantBloomPrefilter
+{
+	float  exposure;
+	float  threshold;
+	float  knee;
+	uint   isAutoExposure; // multiply by the adapted exposure
+	float2 sceneUVScale;   // rendered region of scene color (dynamic resolution)
+	float2 sceneUVMax;
+};
+
+struct ExposureState
+{
+	float exposure;
+	float adaptedLuminance;
+};
+
+[[vk::push_constant]]
+PushConstantBloomPrefilter pc;
+
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+Texture2D sceneTexture : register(t0); // hdr offscreen color, full resolution
+
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+SamplerState sceneSampler : register(s0);
+
+[[vk::binding(1, 0)]]
+RWTexture2D<float4> outImage : register(u1);
+
+[[vk::binding(2, 0)]]
+StructuredBuffer<ExposureState> exposureState : register(t2); // written by the exposure adaptation dispatch
+
+float3 SoftThreshold(float3 color)
+{
+	// quadratic curve between (threshold - knee) and (threshold + knee), linear above
+	float brightness = max(color.r, max(color.g, color.b));
+	float soft       = clamp(brightness - pc.threshold + pc.knee, 0.0f, 2.0f * pc.knee);
+	soft             = soft * soft / (4.0f * pc.knee + 1e-4f);
+	float weight     = max(soft, brightness - pc.threshold) / max(brightness, 1e-4f);
+	return color * weight;
+}
+
+[numthreads(8, 8, 1)] // GROUP_SIZE of PostProcessStack
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+	uint width, height;
+	outImage.GetDimensions(width, height);
+	if (dispatchThreadID.x >= width || dispatchThreadID.y >= height)
+		return;
+
+	// four bilinear taps cover a 4x4 block of source texels, which reduces flickering of small highlights
+	uint sceneWidth, sceneHeight;
+	sceneTexture.GetDimensions(sceneWidth, sceneHeight);
+	float2 sceneTexelSize = 1.0f / float2(sceneWidth, sceneHeight);
+	float2 uv = (float2(dispatchThreadID.xy) + 0.5f) / float2(width, height) * pc.sceneUVScale;
+
+	float3 color = 0.0f;
+	color += sceneTexture.SampleLevel(sceneSampler, min(uv + float2(-1.0f, -1.0f) * sceneTexelSize, pc.sceneUVMax), 0).rgb;
+	color += sceneTexture.SampleLevel(sceneSampler, min(uv + float2( 1.0f, -1.0f) * sceneTexelSize, pc.sceneUVMax), 0).rgb;
+	color += sceneTexture.SampleLevel(sceneSampler, min(uv + float2(-1.0f,  1.0f) * sceneTexelSize, pc.sceneUVMax), 0).rgb;
+	color += sceneTexture.SampleLevel(sceneSampler, min(uv + float2( 1.0f,  1.0f) * sceneTexelSize, pc.sceneUVMax), 0).rgb;
+	float exposure = pc.isAutoExposure ? pc.exposure * exposureState[0].exposure : pc.exposure;
+	color *= 0.25f * exposure;
+
+	outImage[dispatchThreadID.xy] = float4(SoftThreshold(color), 1.0f);
+}
@@ -0,0 +1,120 @@
+/// ------------------ POST COMPOSITE COMPUTE SHADER ------------------
+/// Fused per pixel post effects of PostProcessStack : exposure (manual and auto) -> bloom composite -> ACES tone mapping -> sRGB encode -> color grading LUT.
+/// Storage images are written without sRGB encoding, so the output (swapchain or fxaa input) is a UNORM image encoded here.
+
+#define POST_EFFECT_EXPOSURE      (1u << 0)
+#define POST_EFFECT_TONE_MAPPING  (1u << 1)
+#define POST_EFFECT_COLOR_GRADING (1u << 2)
+#define POST_EFFECT_BLOOM         (1u << 3)
+#define POST_EFFECT_AUTO_EXPOSURE (1u << 5)
+
+#define LUT_SIZE 32.0f
+
+struct PushConstantComposite
+{
+	float  exposure;
+	float  bloomIntensity;
+	uint   effectFlags;  // bits of EPostEffect
+	uint   isLumaOutput; // write luma to alpha for fxaa
+	float2 sceneUVScale; // rendered region of scene color (dynamic resolution)
+	float2 sceneUVMax;
+};
+
+struct ExposureState
+{
+	float exposure;
+	float adaptedLuminance;
+};
+
+[[vk::push_constant]]
+PushConstantComposite pc;
+
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+Texture2D sceneTexture : register(t0); // hdr offscreen color
+
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+SamplerState sceneSampler : register(s0);
+
+[[vk::combinedImageSampler]][[vk::binding(1, 0)]]
+Texture2D bloomTexture : register(t1); // half resolution, blurred
+
+[[vk::combinedImageSampler]][[vk::binding(1, 0)]]
+SamplerState bloomSampler : register(s1);
+
+[[vk::combinedImageSampler]][[vk::binding(2, 0)]]
+Texture2D lutTexture : register(t2); // 32^3 LUT as a 1024 x 32 strip of blue slices
+
+[[vk::combinedImageSampler]][[vk::binding(2, 0)]]
+SamplerState lutSampler : register(s2);
+
+[[vk::binding(3, 0)]]
+RWTexture2D<float4> outImage : register(u3);
+
+[[vk::binding(4, 0)]]
+StructuredBuffer<ExposureState> exposureState : register(t4); // written by the exposure adaptation dispatch
+
+float3 LinearToSRGB(float3 color)
+{
+	float3 lowColor  = color * 12.92f;
+	float3 highColor = 1.055f * pow(color, 1.0f / 2.4f) - 0.055f;
+	return lerp(highColor, lowColor, step(color, 0.0031308f));
+}
+
+// Krzysztof Narkowicz's fit of the ACES filmic curve
+float3 ToneMapACES(float3 color)
+{
+	const float a = 2.51f;
+	const float b = 0.03f;
+	const float c = 2.43f;
+	const float d = 0.59f;
+	const float e = 0.14f;
+	return saturate((color * (a * color + b)) / (color * (c * color + d) + e));
+}
+
+float3 ApplyColorGradingLUT(float3 color)
+{
+	// red and green are filtered by the sampler, blue is blended between two slices
+	float  blue       = color.b * (LUT_SIZE - 1.0f);
+	float  lowerSlice = floor(blue);
+	float  upperSlice = min(lowerSlice + 1.0f, LUT_SIZE - 1.0f);
+	float2 texelSize  = 1.0f / float2(LUT_SIZE * LUT_SIZE, LUT_SIZE);
+
+	float2 uv = float2(color.r * (LUT_SIZE - 1.0f) + 0.5f, color.g * (LUT_SIZE - 1.0f) + 0.5f) * texelSize;
+	float3 lowerColor = lutTexture.SampleLevel(lutSampler, uv + float2(lowerSlice * LUT_SIZE * texelSize.x, 0.0f), 0).rgb;
+	float3 upperColor = lutTexture.SampleLevel(lutSampler, uv + float2(upperSlice * LUT_SIZE * texelSize.x, 0.0f), 0).rgb;
+	return lerp(lowerColor, upperColor, blue - lowerSlice);
+}
+
+[numthreads(8, 8, 1)] // GROUP_SIZE of PostProcessStack
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+	uint width, height;
+	outImage.GetDimensions(width, height);
+	if (dispatchThreadID.x >= width || dispatchThreadID.y >= height)
+		return;
+
+	float2 uv = (float2(dispatchThreadID.xy) + 0.5f) / float2(width, height);
+	float3 color = sceneTexture.SampleLevel(sceneSampler, min(uv * pc.sceneUVScale, pc.sceneUVMax), 0).rgb; // upscaled to the output
+
+	// manual exposure works as compensation on top of auto exposure
+	float exposure = (pc.effectFlags & POST_EFFECT_EXPOSURE) ? pc.exposure : 1.0f;
+	if (pc.effectFlags & POST_EFFECT_AUTO_EXPOSURE)
+		exposure *= exposureState[0].exposure;
+	color *= exposure;
+
+	// bloom was prefiltered from the exposed color already
+	if (pc.effectFlags & POST_EFFECT_BLOOM)
+		color += bloomTexture.SampleLevel(bloomSampler, uv, 0).rgb * pc.bloomIntensity;
+
+	if (pc.effectFlags & POST_EFFECT_TONE_MAPPING)
+		color = ToneMapACES(color);
+
+	color = LinearToSRGB(saturate(color));
+
+	if (pc.effectFlags & POST_EFFECT_COLOR_GRADING)
+		color = ApplyColorGradingLUT(color);
+
+	// fxaa works on perceptual luma, computed once here instead of per tap
+	float alpha = pc.isLumaOutput ? dot(color, float3(0.299f, 0.587f, 0.114f)) : 1.0f;
+	outImage[dispatchThreadID.xy] = float4(color, alpha);
+}
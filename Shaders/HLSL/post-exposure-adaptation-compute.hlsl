@@ -0,0 +1,67 @@
+/// ------------------ POST EXPOSURE ADAPTATION COMPUTE SHADER ------------------
+/// Second half of auto exposure in PostProcessStack : a single group reduces the luminance histogram to its average,
+/// blends the adapted luminance toward it and writes the exposure read by bloom prefilter and composite.
+/// The histogram is cleared here for the next frame, so nothing has to be reset on the host.
+
+#define HISTOGRAM_BIN_COUNT 256 // HISTOGRAM_BIN_COUNT of PostProcessStack
+#define EXPOSURE_KEY        0.18f // middle gray the average luminance is mapped to
+
+struct PushConstantExposureAdaptation
+{
+	float minLogLuminance;
+	float logLuminanceRange;
+	float adaptationFactor;
+	uint  pixelCount;
+};
+
+struct ExposureState
+{
+	float exposure;
+	float adaptedLuminance; // 0 until the first frame is measured
+};
+
+[[vk::push_constant]]
+PushConstantExposureAdaptation pc;
+
+[[vk::binding(0, 0)]]
+RWStructuredBuffer<uint> histogram : register(u0);
+
+[[vk::binding(1, 0)]]
+RWStructuredBuffer<ExposureState> exposureState : register(u1);
+
+groupshared float sharedWeightedCount[HISTOGRAM_BIN_COUNT];
+
+[numthreads(HISTOGRAM_BIN_COUNT, 1, 1)]
+void main(uint groupIndex : SV_GroupIndex)
+{
+	uint binCount = histogram[groupIndex];
+	histogram[groupIndex] = 0;
+
+	// sum of (bin * count) in log2(HISTOGRAM_BIN_COUNT) steps
+	sharedWeightedCount[groupIndex] = float(binCount) * float(groupIndex);
+	GroupMemoryBarrierWithGroupSync();
+
+	[unroll]
+	for (uint stride = HISTOGRAM_BIN_COUNT / 2; stride > 0; stride >>= 1)
+	{
+		if (groupIndex < stride)
+			sharedWeightedCount[groupIndex] += sharedWeightedCount[groupIndex + stride];
+		GroupMemoryBarrierWithGroupSync();
+	}
+
+	if (groupIndex != 0)
+		return;
+
+	// thread 0 holds the count of bin 0, black pixels are left out of the average
+	float litPixelCount = max(float(pc.pixelCount) - float(binCount), 1.0f);
+	float averageBin    = sharedWeightedCount[0] / litPixelCount - 1.0f;
+	float averageLuminance = exp2(saturate(averageBin / 254.0f) * pc.logLuminanceRange + pc.minLogLuminance);
+
+	float previousLuminance = exposureState[0].adaptedLuminance;
+	float adaptedLuminance  = (previousLuminance > 0.0f) ? lerp(previousLuminance, averageLuminance, pc.adaptationFactor) : averageLuminance;
+
+	ExposureState state;
+	state.exposure         = EXPOSURE_KEY / max(adaptedLuminance, 1e-4f);
+	state.adaptedLuminance = adaptedLuminance;
+	exposureState[0] = state;
+}
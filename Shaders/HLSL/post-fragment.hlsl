@@ -9,9 +9,18 @@ Texture2D inTexture : register(t0); // bindding point 0
 [[vk::combinedImageSampler]]
 SamplerState samplerState : register(s0); // binding point 0
 
+struct PushConstantPost
+{
+	float2 uvScale; // rendered region of the offscreen color (dynamic resolution)
+	float2 uvMax;
+};
+
+[[vk::push_constant]]
+PushConstantPost pc;
+
 float4 main(PSInput input) : SV_Target
 {
-	float2 uv = input.UV;
+	float2 uv = min(input.UV * pc.uvScale, pc.uvMax);
 	// gamma correction
 	/*float gamma = 1.0f / 2.2f;
 	float4 outColor = pow(inTexture.Sample(samplerState, uv).rgba, float4(gamma, gamma, gamma, gamma)); */
@@ -0,0 +1,72 @@
+/// ------------------ POST FXAA COMPUTE SHADER ------------------
+/// FXAA 3.11 console variant of PostProcessStack, reads the graded image with luma in alpha and writes the swapchain.
+
+#define FXAA_EDGE_THRESHOLD     0.125f
+#define FXAA_EDGE_THRESHOLD_MIN 0.05f
+#define FXAA_EDGE_SHARPNESS     8.0f
+
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+Texture2D inTexture : register(t0); // ldr color, luma in alpha
+
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+SamplerState inSampler : register(s0);
+
+[[vk::binding(1, 0)]]
+RWTexture2D<float4> outImage : register(u1); // swapchain image
+
+[numthreads(8, 8, 1)] // GROUP_SIZE of PostProcessStack
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+	uint width, height;
+	outImage.GetDimensions(width, height);
+	if (dispatchThreadID.x >= width || dispatchThreadID.y >= height)
+		return;
+
+	float2 texelSize = 1.0f / float2(width, height);
+	float2 uv = (float2(dispatchThreadID.xy) + 0.5f) / float2(width, height);
+
+	// luma of the four diagonal corners, each bilinear tap averages a 2x2 block
+	float lumaNW = inTexture.SampleLevel(inSampler, uv + float2(-0.5f, -0.5f) * texelSize, 0).a;
+	float lumaNE = inTexture.SampleLevel(inSampler, uv + float2( 0.5f, -0.5f) * texelSize, 0).a;
+	float lumaSW = inTexture.SampleLevel(inSampler, uv + float2(-0.5f,  0.5f) * texelSize, 0).a;
+	float lumaSE = inTexture.SampleLevel(inSampler, uv + float2( 0.5f,  0.5f) * texelSize, 0).a;
+	float4 center = inTexture.SampleLevel(inSampler, uv, 0);
+
+	float lumaMax = max(max(lumaNW, lumaNE), max(lumaSW, lumaSE));
+	float lumaMin = min(min(lumaNW, lumaNE), min(lumaSW, lumaSE));
+	float lumaMaxCenter = max(lumaMax, center.a);
+	float lumaMinCenter = min(lumaMin, center.a);
+
+	// early out on flat areas
+	if (lumaMaxCenter - lumaMinCenter < max(FXAA_EDGE_THRESHOLD_MIN, lumaMaxCenter * FXAA_EDGE_THRESHOLD))
+	{
+		outImage[dispatchThreadID.xy] = float4(center.rgb, 1.0f);
+		return;
+	}
+
+	// edge direction is perpendicular to the luma gradient
+	lumaNE += 1.0f / 384.0f;
+	float2 direction;
+	direction.x = (lumaSW + lumaSE) - (lumaNW + lumaNE);
+	direction.y = (lumaNW + lumaSW) - (lumaNE + lumaSE);
+	direction = normalize(direction + 1e-6f);
+
+	float2 direction1 = direction * texelSize * 0.5f;
+	float3 rgbN1 = inTexture.SampleLevel(inSampler, uv - direction1, 0).rgb;
+	float3 rgbP1 = inTexture.SampleLevel(inSampler, uv + direction1, 0).rgb;
+
+	// stretch the second pair along the edge, limited by sharpness
+	float  directionAbsMinTimesSharpness = min(abs(direction.x), abs(direction.y)) * FXAA_EDGE_SHARPNESS;
+	float2 direction2 = clamp(direction / directionAbsMinTimesSharpness, -2.0f, 2.0f) * texelSize * 2.0f;
+	float3 rgbN2 = inTexture.SampleLevel(inSampler, uv - direction2, 0).rgb;
+	float3 rgbP2 = inTexture.SampleLevel(inSampler, uv + direction2, 0).rgb;
+
+	float3 rgbA = rgbN1 + rgbP1;
+	float3 rgbB = (rgbN2 + rgbP2) * 0.25f + rgbA * 0.25f;
+
+	// the wide taps crossed another edge, fall back to the two near taps
+	float lumaB = dot(rgbB, float3(0.299f, 0.587f, 0.114f));
+	float3 result = (lumaB < lumaMin || lumaB > lumaMax) ? rgbA * 0.5f : rgbB;
+
+	outImage[dispatchThreadID.xy] = float4(result, 1.0f);
+}
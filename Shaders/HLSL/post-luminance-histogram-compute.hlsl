@@ -0,0 +1,58 @@
+/// ------------------ POST LUMINANCE HISTOGRAM COMPUTE SHADER ------------------
+/// First half of auto exposure in PostProcessStack : bins the log luminance of every scene pixel.
+/// A group bins its tile into shared memory first, so the global histogram only gets one atomic per bin and group.
+
+#define HISTOGRAM_BIN_COUNT 256 // a thread per bin, HISTOGRAM_GROUP_SIZE^2 of PostProcessStack
+
+struct PushConstantLuminanceHistogram
+{
+	float minLogLuminance;
+	float inverseLogLuminanceRange;
+	uint2 sceneRenderExtent; // rendered region of scene color (dynamic resolution)
+};
+
+[[vk::push_constant]]
+PushConstantLuminanceHistogram pc;
+
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+Texture2D sceneTexture : register(t0); // hdr offscreen color
+
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+SamplerState sceneSampler : register(s0);
+
+[[vk::binding(1, 0)]]
+RWStructuredBuffer<uint> histogram : register(u1);
+
+groupshared uint sharedHistogram[HISTOGRAM_BIN_COUNT];
+
+// bin 0 keeps black pixels out of the average, bins 1 ~ 255 cover [minLogLuminance, maxLogLuminance]
+uint GetHistogramBin(float luminance)
+{
+	if (luminance < 1e-5f)
+		return 0;
+
+	float logLuminance = saturate((log2(luminance) - pc.minLogLuminance) * pc.inverseLogLuminanceRange);
+	return uint(logLuminance * 254.0f + 1.0f);
+}
+
+[numthreads(16, 16, 1)] // HISTOGRAM_GROUP_SIZE of PostProcessStack
+void main(uint3 dispatchThreadID : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex)
+{
+	sharedHistogram[groupIndex] = 0;
+	GroupMemoryBarrierWithGroupSync();
+
+	uint width, height;
+	sceneTexture.GetDimensions(width, height);
+	if (all(dispatchThreadID.xy < pc.sceneRenderExtent))
+	{
+		// texel center, so the linear sampler returns the texel itself
+		float2 uv = (float2(dispatchThreadID.xy) + 0.5f) / float2(width, height);
+		float3 color = sceneTexture.SampleLevel(sceneSampler, uv, 0).rgb;
+		InterlockedAdd(sharedHistogram[GetHistogramBin(dot(color, float3(0.2126f, 0.7152f, 0.0722f)))], 1);
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	uint binCount = sharedHistogram[groupIndex];
+	if (binCount > 0)
+		InterlockedAdd(histogram[groupIndex], binCount);
+}
@@ -0,0 +1,117 @@
+/// ------------------ POST TEMPORAL RESOLVE COMPUTE SHADER ------------------
+/// Temporal anti-aliasing and upscaling of PostProcessStack : the jittered offscreen color of this frame is blended into the history
+/// of previous frames, which is reprojected with motion vectors and clipped to the color distribution of the current neighborhood.
+/// Runs at output resolution, so a rendered region smaller than the output is upscaled here. Jitter moves the bilinear taps
+/// between render texels every frame, and the history accumulates them into output pixels.
+
+#define VARIANCE_CLIP_GAMMA 1.0f // width of the neighborhood box in standard deviations, lower rejects more history
+#define MOTION_VECTOR_SCALE 32767.0f // fixed point of motion vectors, must match fragment.hlsl
+
+struct PushConstantTemporalResolve
+{
+	float2 renderUVScale; // output uv -> rendered region of offscreen color
+	float2 renderUVMax;
+	float2 jitterUV;      // jitter of this frame in offscreen uv, sampling at +jitter undoes it
+	float2 texelSize;     // of offscreen color, neighborhood taps
+	float  currentWeight; // 1 without valid history
+	uint3  padding;
+};
+
+[[vk::push_constant]]
+PushConstantTemporalResolve pc;
+
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+Texture2D offscreenTexture : register(t0); // jittered hdr color
+
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+SamplerState offscreenSampler : register(s0);
+
+[[vk::binding(1, 0)]]
+Texture2D<int2> motionTexture : register(t1); // fixed point uv offset to the previous frame, fetched since integers can't be filtered
+
+[[vk::combinedImageSampler]][[vk::binding(2, 0)]]
+Texture2D historyTexture : register(t2); // resolved color of the previous frame, output resolution
+
+[[vk::combinedImageSampler]][[vk::binding(2, 0)]]
+SamplerState historySampler : register(s2);
+
+[[vk::binding(3, 0)]]
+RWTexture2D<float4> outImage : register(u3); // history of the next frame
+
+float3 RGBToYCoCg(float3 color)
+{
+	return float3(
+		dot(color, float3( 0.25f, 0.5f,  0.25f)),
+		dot(color, float3( 0.5f,  0.0f, -0.5f)),
+		dot(color, float3(-0.25f, 0.5f, -0.25f))
+	);
+}
+
+float3 YCoCgToRGB(float3 color)
+{
+	return float3(color.x + color.y - color.z, color.x + color.z, color.x - color.y - color.z);
+}
+
+float Luma(float3 color)
+{
+	return dot(color, float3(0.2126f, 0.7152f, 0.0722f));
+}
+
+// moves the history toward the box center until it is inside, unlike a per channel clamp it keeps the hue
+float3 ClipToBox(float3 history, float3 boxMin, float3 boxMax)
+{
+	float3 center  = 0.5f * (boxMax + boxMin);
+	float3 extents = 0.5f * (boxMax - boxMin) + 1e-5f;
+	float3 offset  = history - center;
+	float3 ratio   = abs(offset / extents);
+	float  maxRatio = max(ratio.x, max(ratio.y, ratio.z));
+	return (maxRatio > 1.0f) ? center + offset / maxRatio : history;
+}
+
+[numthreads(8, 8, 1)] // GROUP_SIZE of PostProcessStack
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+	uint width, height;
+	outImage.GetDimensions(width, height);
+	if (dispatchThreadID.x >= width || dispatchThreadID.y >= height)
+		return;
+
+	float2 uv       = (float2(dispatchThreadID.xy) + 0.5f) / float2(width, height);
+	float2 renderUV = min(uv * pc.renderUVScale + pc.jitterUV, pc.renderUVMax);
+	float3 current  = offscreenTexture.SampleLevel(offscreenSampler, renderUV, 0).rgb;
+
+	// mean and standard deviation of the 3x3 render texels around the sample, in YCoCg where luma and chroma separate
+	float3 moment1 = 0.0f;
+	float3 moment2 = 0.0f;
+	[unroll]
+	for (int y = -1; y <= 1; y++)
+	{
+		[unroll]
+		for (int x = -1; x <= 1; x++)
+		{
+			float2 tapUV = clamp(renderUV + float2(x, y) * pc.texelSize, 0.0f, pc.renderUVMax);
+			float3 tap   = RGBToYCoCg(offscreenTexture.SampleLevel(offscreenSampler, tapUV, 0).rgb);
+			moment1 += tap;
+			moment2 += tap * tap;
+		}
+	}
+	float3 mean   = moment1 / 9.0f;
+	float3 sigma  = sqrt(max(moment2 / 9.0f - mean * mean, 0.0f));
+	float3 boxMin = mean - VARIANCE_CLIP_GAMMA * sigma;
+	float3 boxMax = mean + VARIANCE_CLIP_GAMMA * sigma;
+
+	// surfaces coming from outside the previous view have no history
+	float2 motion        = float2(motionTexture.Load(int3(renderUV / pc.texelSize, 0))) / MOTION_VECTOR_SCALE;
+	float2 historyUV     = uv + motion;
+	float  currentWeight = any(historyUV != saturate(historyUV)) ? 1.0f : pc.currentWeight;
+
+	float3 history = historyTexture.SampleLevel(historySampler, historyUV, 0).rgb;
+	history = YCoCgToRGB(ClipToBox(RGBToYCoCg(history), boxMin, boxMax));
+
+	// inverse luma weights keep a single bright hdr sample from dominating the blend and flickering
+	float currentLumaWeight = currentWeight / (1.0f + Luma(current));
+	float historyLumaWeight = (1.0f - currentWeight) / (1.0f + Luma(history));
+	float3 resolved = (current * currentLumaWeight + history * historyLumaWeight) / max(currentLumaWeight + historyLumaWeight, 1e-5f);
+
+	outImage[dispatchThreadID.xy] = float4(resolved, 1.0f);
+}
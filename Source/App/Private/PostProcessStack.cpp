@@ -0,0 +1,904 @@
+#include "PostProcessStack.h"
+
+namespace
+{
+	/* push constant blocks, mirrored in post shaders */
+	struct PushConstantTemporalResolve
+	{
+		glm::vec2 renderUVScale; // output uv -> rendered region of offscreen color
+		glm::vec2 renderUVMax;
+		glm::vec2 jitterUV;      // jitter of this frame in offscreen uv, sampling at +jitter undoes it
+		glm::vec2 texelSize;     // of offscreen color, neighborhood taps
+		float     currentWeight; // 1 without valid history
+		uint32    padding[3];
+	};
+
+	struct PushConstantLuminanceHistogram
+	{
+		float  minLogLuminance;
+		float  inverseLogLuminanceRange;
+		uint32 sceneRenderExtent[2]; // only rendered pixels are binned
+	};
+
+	struct PushConstantExposureAdaptation
+	{
+		float  minLogLuminance;
+		float  logLuminanceRange;
+		float  adaptationFactor; // blend toward the luminance of this frame, derived from delta time
+		uint32 pixelCount;
+	};
+
+	struct PushConstantBloomPrefilter
+	{
+		float     exposure;
+		float     threshold;
+		float     knee;
+		uint32    isAutoExposure; // multiply by the adapted exposure
+		glm::vec2 sceneUVScale;
+		glm::vec2 sceneUVMax;
+	};
+
+	struct PushConstantBloomBlur
+	{
+		uint32 direction; // 0 : horizontal, 1 : vertical
+		uint32 padding[3];
+	};
+
+	struct PushConstantComposite
+	{
+		float     exposure;
+		float     bloomIntensity;
+		uint32    effectFlags;  // bits of EPostEffect
+		uint32    isLumaOutput; // fxaa reads luma from alpha
+		glm::vec2 sceneUVScale;
+		glm::vec2 sceneUVMax;
+	};
+
+	/* descriptor update template data, members in binding order */
+	struct TemporalResolveDescriptor
+	{
+		VkDescriptorImageInfo offscreenColor;
+		VkDescriptorImageInfo motionVector;
+		VkDescriptorImageInfo historyColor;
+		VkDescriptorImageInfo resolvedColor; // storage image, history of the next frame
+	};
+
+	struct LuminanceHistogramDescriptor
+	{
+		VkDescriptorImageInfo  sceneColor;
+		VkDescriptorBufferInfo histogram;
+	};
+
+	struct ExposureAdaptationDescriptor
+	{
+		VkDescriptorBufferInfo histogram;
+		VkDescriptorBufferInfo exposure;
+	};
+
+	struct BloomPrefilterDescriptor
+	{
+		VkDescriptorImageInfo  sceneColor;
+		VkDescriptorImageInfo  bloomColor; // storage image
+		VkDescriptorBufferInfo exposure;
+	};
+
+	struct BloomBlurDescriptor
+	{
+		VkDescriptorImageInfo inputColor;
+		VkDescriptorImageInfo outputColor; // storage image
+	};
+
+	struct CompositeDescriptor
+	{
+		VkDescriptorImageInfo  sceneColor;
+		VkDescriptorImageInfo  bloomColor;
+		VkDescriptorImageInfo  colorGradingLUT;
+		VkDescriptorImageInfo  outputColor; // storage image
+		VkDescriptorBufferInfo exposure;
+	};
+
+	struct FXAADescriptor
+	{
+		VkDescriptorImageInfo ldrColor;
+		VkDescriptorImageInfo swapchainColor; // storage image
+	};
+
+	VkDescriptorUpdateTemplateEntry GetTemplateEntry(uint32 binding, VkDescriptorType descriptorType, size_t offset)
+	{
+		bool isBuffer = (descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER || descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+
+		VkDescriptorUpdateTemplateEntry entry{};
+		entry.dstBinding      = binding;
+		entry.dstArrayElement = 0;
+		entry.descriptorCount = 1;
+		entry.descriptorType  = descriptorType;
+		entry.offset          = offset;
+		entry.stride          = isBuffer ? sizeof(VkDescriptorBufferInfo) : sizeof(VkDescriptorImageInfo);
+		return entry;
+	}
+
+	// radical inverse of index in the given base, low discrepancy in [0, 1)
+	float GetHalton(uint32 index, uint32 base)
+	{
+		float result   = 0.0f;
+		float fraction = 1.0f / static_cast<float>(base);
+		for (; index > 0; index /= base, fraction /= static_cast<float>(base))
+			result += fraction * static_cast<float>(index % base);
+		return result;
+	}
+}
+
+/*
+-----------	PUBLIC ------------
+*/
+PostProcessStack::PostProcessStack(MKDevice& mkDeviceRef)
+	:
+	_mkBloomPrefilterPipeline(mkDeviceRef),
+	_mkBloomBlurPipeline(mkDeviceRef),
+	_mkCompositePipeline(mkDeviceRef),
+	_mkFXAAPipeline(mkDeviceRef),
+	_mkLuminanceHistogramPipeline(mkDeviceRef),
+	_mkExposureAdaptationPipeline(mkDeviceRef),
+	_mkTemporalResolvePipeline(mkDeviceRef),
+	_mkDeviceRef(mkDeviceRef)
+{
+}
+
+PostProcessStack::~PostProcessStack() {}
+
+void PostProcessStack::SetEffectEnabled(EPostEffect effect, bool enable)
+{
+	if (IsEffectEnabled(effect) == enable)
+		return;
+
+	if (enable)
+		_enabledEffects |= (1u << effect);
+	else
+		_enabledEffects &= ~(1u << effect);
+
+	// the other effects are push constant flags of the composite dispatch
+	if (effect == POST_EFFECT_BLOOM || effect == POST_EFFECT_FXAA || effect == POST_EFFECT_AUTO_EXPOSURE)
+		_isTopologyDirty = true;
+}
+
+void PostProcessStack::Initialize(const VkPhysicalDeviceProperties& deviceProperties)
+{
+	CreatePipelines();
+	CreateDescriptorTemplates();
+	CreateColorGradingLUT();
+	CreateAutoExposureBuffers();
+
+	// bloom taps and LUT lookups must not wrap around the edges
+	VkSamplerCreateInfo samplerInfo = mk::vkinfo::GetDefaultSamplerCreateInfo(deviceProperties.limits.maxSamplerAnisotropy);
+	samplerInfo.addressModeU     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.anisotropyEnable = VK_FALSE;
+	MK_CHECK(vkCreateSampler(_mkDeviceRef.GetDevice(), &samplerInfo, nullptr, &_vkLinearClampSampler));
+
+	// two timestamps (begin, end) per timer and frame slot
+	_timestampPeriod = deviceProperties.limits.timestampPeriod;
+	if (deviceProperties.limits.timestampComputeAndGraphics)
+	{
+		VkQueryPoolCreateInfo queryPoolInfo{};
+		queryPoolInfo.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = MAX_FRAMES_IN_FLIGHT * TIMER_COUNT * 2;
+		MK_CHECK(vkCreateQueryPool(_mkDeviceRef.GetDevice(), &queryPoolInfo, nullptr, &_vkTimestampQueryPool));
+	}
+}
+
+void PostProcessStack::Destroy()
+{
+	vkDestroySampler(_mkDeviceRef.GetDevice(), _vkLinearClampSampler, nullptr);
+	vkDestroyImageView(_mkDeviceRef.GetDevice(), _vkColorGradingLUTView, nullptr);
+	vkDestroyQueryPool(_mkDeviceRef.GetDevice(), _vkTimestampQueryPool, nullptr);
+	if (_vkColorGradingLUT.image != VK_NULL_HANDLE)
+		GAllocator->DestroyImage(_vkColorGradingLUT);
+	GAllocator->DestroyBuffer(_vkLuminanceHistogramBuffer);
+	GAllocator->DestroyBuffer(_vkExposureBuffer);
+	DestroyHistoryImages();
+
+	_vkLinearClampSampler  = VK_NULL_HANDLE;
+	_vkColorGradingLUTView = VK_NULL_HANDLE;
+	_vkTimestampQueryPool  = VK_NULL_HANDLE;
+}
+
+void PostProcessStack::SetSceneRenderExtent(VkExtent2D extent)
+{
+	// temporal resolve upscales the rendered region to the whole output, so effects after it read every texel
+	_offscreenRenderExtent = extent;
+	_sceneRenderExtent     = _isTemporalAAEnabled ? _sceneExtent : extent;
+}
+
+void PostProcessStack::AddPasses(MKRenderGraph& graph, const SceneTargets& scene, MKRenderGraph::ResourceHandle swapchainColor, VkExtent2D extent)
+{
+	_renderGraph           = &graph;
+	_offscreenColorHandle  = scene.color;
+	_motionVectorHandle    = scene.motionVector;
+	_offscreenExtent       = scene.extent;
+	_offscreenRenderExtent = scene.extent;
+	_outputExtent          = extent;
+	_swapchainColorHandle  = swapchainColor;
+	_sceneColorHandle      = scene.color;
+	_sceneExtent           = scene.extent;
+	_sceneRenderExtent     = scene.extent;
+
+	/**
+	* temporal anti-aliasing and upscaling
+	* - the jittered offscreen color is accumulated into a history at output resolution. The previous history is reprojected
+	*   with motion vectors and clamped to the neighborhood of the current sample, so disoccluded texels don't ghost.
+	* - both history images are imported : the one written last frame is read, the other one is written and handed over
+	*   to later effects as scene color. Images are swapped in BeginFrame().
+	*/
+	if (_isTemporalAAEnabled)
+	{
+		if (_historyExtent.width != extent.width || _historyExtent.height != extent.height)
+			CreateHistoryImages(extent);
+
+		// the next frame reads the history on the same queue without a semaphore, so the write image is handed over to compute sampling
+		// and both are imported from that stage, which chains their first barrier after the final barrier of the previous frame
+		RenderGraphImportState historyState{ VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE };
+		RenderGraphImportState historyFinalState{ VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT };
+		_historyReadHandle  = graph.ImportImage({ "history read image", extent.width, extent.height, HISTORY_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT }, historyState);
+		_historyWriteHandle = graph.ImportImage({ "history write image", extent.width, extent.height, HISTORY_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT }, historyState, historyFinalState);
+
+		graph.AddPass("temporal resolve", [=, this](VkCommandBuffer commandBuffer) {
+			BeginTimer(commandBuffer, TIMER_TEMPORAL_RESOLVE);
+			DispatchTemporalResolve(commandBuffer, extent);
+			EndTimer(commandBuffer, TIMER_TEMPORAL_RESOLVE);
+		})
+			.Read(scene.color, ERenderGraphUsage::SAMPLED_COMPUTE)
+			.Read(scene.motionVector, ERenderGraphUsage::SAMPLED_COMPUTE)
+			.Read(_historyReadHandle, ERenderGraphUsage::SAMPLED_COMPUTE)
+			.Write(_historyWriteHandle, ERenderGraphUsage::STORAGE_WRITE_COMPUTE);
+
+		_sceneColorHandle  = _historyWriteHandle;
+		_sceneExtent       = extent;
+		_sceneRenderExtent = extent;
+	}
+	auto sceneColor = _sceneColorHandle;
+
+	bool isBloomEnabled = IsEffectEnabled(POST_EFFECT_BLOOM);
+	bool isFXAAEnabled  = IsEffectEnabled(POST_EFFECT_FXAA);
+
+	/**
+	* auto exposure
+	* - histogram : log luminance of every scene pixel binned with shared memory atomics, merged into a 256 bin buffer per group
+	* - adaptation : a single group reduces the histogram to an average luminance and blends the exposure buffer toward it
+	* Both only touch buffers outside the graph, so they are kept as side effects and synchronize those buffers themselves.
+	*/
+	if (IsEffectEnabled(POST_EFFECT_AUTO_EXPOSURE))
+	{
+		graph.AddPass("luminance histogram", [=, this](VkCommandBuffer commandBuffer) {
+			BeginTimer(commandBuffer, TIMER_AUTO_EXPOSURE);
+			DispatchLuminanceHistogram(commandBuffer, extent);
+		})
+			.Read(sceneColor, ERenderGraphUsage::SAMPLED_COMPUTE)
+			.SetSideEffect();
+
+		graph.AddPass("exposure adaptation", [=, this](VkCommandBuffer commandBuffer) {
+			DispatchExposureAdaptation(commandBuffer, extent);
+			EndTimer(commandBuffer, TIMER_AUTO_EXPOSURE);
+		})
+			.SetSideEffect();
+	}
+
+	/**
+	* bloom at half resolution
+	* - prefilter : exposed scene color -> bright part, 2x2 downsampled
+	* - blur      : separable gaussian, horizontal and vertical dispatches
+	* blur y doesn't overlap prefilter, so the graph aliases their memory.
+	*/
+	if (isBloomEnabled)
+	{
+		VkExtent2D bloomExtent = { std::max(extent.width / 2, 1u), std::max(extent.height / 2, 1u) };
+		_bloomPrefilterHandle = graph.CreateImage({ "bloom prefilter image", bloomExtent.width, bloomExtent.height, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT });
+		_bloomBlurXHandle     = graph.CreateImage({ "bloom blur x image", bloomExtent.width, bloomExtent.height, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT });
+		_bloomBlurYHandle     = graph.CreateImage({ "bloom blur y image", bloomExtent.width, bloomExtent.height, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT });
+
+		graph.AddPass("bloom prefilter", [=, this](VkCommandBuffer commandBuffer) {
+			BeginTimer(commandBuffer, TIMER_BLOOM);
+			DispatchBloomPrefilter(commandBuffer, bloomExtent);
+		})
+			.Read(sceneColor, ERenderGraphUsage::SAMPLED_COMPUTE)
+			.Write(_bloomPrefilterHandle, ERenderGraphUsage::STORAGE_WRITE_COMPUTE);
+
+		graph.AddPass("bloom blur x", [=, this](VkCommandBuffer commandBuffer) {
+			DispatchBloomBlur(commandBuffer, bloomExtent, 0);
+		})
+			.Read(_bloomPrefilterHandle, ERenderGraphUsage::SAMPLED_COMPUTE)
+			.Write(_bloomBlurXHandle, ERenderGraphUsage::STORAGE_WRITE_COMPUTE);
+
+		graph.AddPass("bloom blur y", [=, this](VkCommandBuffer commandBuffer) {
+			DispatchBloomBlur(commandBuffer, bloomExtent, 1);
+			EndTimer(commandBuffer, TIMER_BLOOM);
+		})
+			.Read(_bloomBlurXHandle, ERenderGraphUsage::SAMPLED_COMPUTE)
+			.Write(_bloomBlurYHandle, ERenderGraphUsage::STORAGE_WRITE_COMPUTE);
+	}
+
+	// fxaa needs the graded image as input, otherwise the composite writes the swapchain directly
+	_compositeTargetHandle = swapchainColor;
+	if (isFXAAEnabled)
+	{
+		_ldrColorHandle        = graph.CreateImage({ "ldr color image", extent.width, extent.height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT });
+		_compositeTargetHandle = _ldrColorHandle;
+	}
+
+	// exposure, bloom composite, tone mapping, color grading and sRGB encode in one dispatch
+	auto compositePass = graph.AddPass("post composite", [=, this](VkCommandBuffer commandBuffer) {
+		BeginTimer(commandBuffer, TIMER_COMPOSITE);
+		DispatchComposite(commandBuffer, extent);
+		EndTimer(commandBuffer, TIMER_COMPOSITE);
+	});
+	compositePass
+		.Read(sceneColor, ERenderGraphUsage::SAMPLED_COMPUTE)
+		.Write(_compositeTargetHandle, ERenderGraphUsage::STORAGE_WRITE_COMPUTE);
+	if (isBloomEnabled)
+		compositePass.Read(_bloomBlurYHandle, ERenderGraphUsage::SAMPLED_COMPUTE);
+
+	if (isFXAAEnabled)
+	{
+		graph.AddPass("fxaa", [=, this](VkCommandBuffer commandBuffer) {
+			BeginTimer(commandBuffer, TIMER_FXAA);
+			DispatchFXAA(commandBuffer, extent);
+			EndTimer(commandBuffer, TIMER_FXAA);
+		})
+			.Read(_ldrColorHandle, ERenderGraphUsage::SAMPLED_COMPUTE)
+			.Write(swapchainColor, ERenderGraphUsage::STORAGE_WRITE_COMPUTE);
+	}
+
+	_isTopologyDirty = false;
+}
+
+glm::vec2 PostProcessStack::AdvanceJitter(VkExtent2D renderExtent)
+{
+	// an upscaled output pixel covers fewer render pixels, so it needs more phases to see the same number of samples
+	float  pixelRatio = (static_cast<float>(_outputExtent.width) * static_cast<float>(_outputExtent.height)) / (static_cast<float>(renderExtent.width) * static_cast<float>(renderExtent.height));
+	uint32 phaseCount = std::clamp(static_cast<uint32>(static_cast<float>(JITTER_PHASE_COUNT) * pixelRatio + 0.5f), JITTER_PHASE_COUNT, MAX_JITTER_PHASE_COUNT);
+
+	// halton index 0 is the pixel center, so the sequence starts at 1
+	_jitterIndex = (_jitterIndex % phaseCount) + 1;
+	glm::vec2 pixelOffset(GetHalton(_jitterIndex, 2) - 0.5f, GetHalton(_jitterIndex, 3) - 0.5f);
+
+	// a pixel is 2 / extent wide in NDC
+	_jitter = pixelOffset * 2.0f / glm::vec2(renderExtent.width, renderExtent.height);
+	return _jitter;
+}
+
+void PostProcessStack::BeginFrame(VkCommandBuffer commandBuffer, uint32 frameIndex, float deltaTime)
+{
+	_currentFrameIndex = frameIndex;
+	_deltaTime         = deltaTime;
+	_writtenTimerMasks[frameIndex] = 0;
+
+	// the resolve of this frame reads what the previous one wrote
+	if (_isTemporalAAEnabled)
+	{
+		_historyIndex ^= 1;
+		_renderGraph->SetImportedImage(_historyReadHandle, _vkHistoryImages[_historyIndex ^ 1].image, _vkHistoryImageViews[_historyIndex ^ 1]);
+		_renderGraph->SetImportedImage(_historyWriteHandle, _vkHistoryImages[_historyIndex].image, _vkHistoryImageViews[_historyIndex]);
+	}
+
+	if (_vkTimestampQueryPool != VK_NULL_HANDLE)
+		vkCmdResetQueryPool(commandBuffer, _vkTimestampQueryPool, frameIndex * TIMER_COUNT * 2, TIMER_COUNT * 2);
+}
+
+void PostProcessStack::ReadTimestamps(uint32 frameIndex)
+{
+	if (_vkTimestampQueryPool == VK_NULL_HANDLE)
+		return;
+
+	// the frame of this slot is complete, only timers of executed passes were written
+	for (uint32 timer = 0; timer < TIMER_COUNT; timer++)
+	{
+		if ((_writtenTimerMasks[frameIndex] & (1u << timer)) == 0)
+			continue;
+
+		std::array<uint64, 2> timestamps{};
+		VkResult result = vkGetQueryPoolResults(
+			_mkDeviceRef.GetDevice(),
+			_vkTimestampQueryPool,
+			(frameIndex * TIMER_COUNT + timer) * 2, 2,
+			sizeof(timestamps), timestamps.data(), sizeof(uint64),
+			VK_QUERY_RESULT_64_BIT
+		);
+		if (result != VK_SUCCESS)
+			continue;
+
+		_timerStatistics[timer].accumulatedTime += static_cast<double>(timestamps[1] - timestamps[0]) * static_cast<double>(_timestampPeriod) / 1e6; // in milliseconds
+		_timerStatistics[timer].sampleCount++;
+	}
+	_writtenTimerMasks[frameIndex] = 0;
+}
+
+bool PostProcessStack::RefreshShaderModules()
+{
+	bool isChanged = false;
+	isChanged |= _mkBloomPrefilterPipeline.RefreshShaderModule();
+	isChanged |= _mkBloomBlurPipeline.RefreshShaderModule();
+	isChanged |= _mkCompositePipeline.RefreshShaderModule();
+	isChanged |= _mkFXAAPipeline.RefreshShaderModule();
+	isChanged |= _mkLuminanceHistogramPipeline.RefreshShaderModule();
+	isChanged |= _mkExposureAdaptationPipeline.RefreshShaderModule();
+	isChanged |= _mkTemporalResolvePipeline.RefreshShaderModule();
+
+	// reloaded shaders are reflected again, so templates follow their set layouts (cached ones are returned when unchanged)
+	if (isChanged)
+		CreateDescriptorTemplates();
+	return isChanged;
+}
+
+void PostProcessStack::LogStatistics() const
+{
+	static const char* timerNames[TIMER_COUNT] = { "temporal resolve", "auto exposure", "bloom", "composite (exposure, tone mapping, color grading)", "fxaa" };
+	for (uint32 timer = 0; timer < TIMER_COUNT; timer++)
+	{
+		const auto& statistics = _timerStatistics[timer];
+		if (statistics.sampleCount == 0)
+			continue;
+
+		MK_LOG(fmt::format(
+			"post {} : average gpu time {:.3f} ms over {} frames",
+			timerNames[timer],
+			statistics.accumulatedTime / static_cast<double>(statistics.sampleCount),
+			statistics.sampleCount
+		));
+	}
+
+	// history is the persistent memory temporal aa costs on top of the graph
+	if (_historyExtent.width > 0)
+	{
+		VkDeviceSize historyMemorySize = _vkHistoryImages[0].allocationInfo.size + _vkHistoryImages[1].allocationInfo.size;
+		MK_LOG(fmt::format(
+			"post temporal history : {} x {}, {:.2f} MiB",
+			_historyExtent.width,
+			_historyExtent.height,
+			static_cast<double>(historyMemorySize) / (1024.0 * 1024.0)
+		));
+	}
+}
+
+/*
+-----------	PRIVATE ------------
+*/
+void PostProcessStack::CreatePipelines()
+{
+	_mkBloomPrefilterPipeline.SetShader("../../../shaders/output/spir-v/post-bloom-prefilter-compute.spv", "main");
+	_mkBloomPrefilterPipeline.InitializePipelineLayout();
+
+	_mkBloomBlurPipeline.SetShader("../../../shaders/output/spir-v/post-bloom-blur-compute.spv", "main");
+	_mkBloomBlurPipeline.InitializePipelineLayout();
+
+	_mkCompositePipeline.SetShader("../../../shaders/output/spir-v/post-composite-compute.spv", "main");
+	_mkCompositePipeline.InitializePipelineLayout();
+
+	_mkFXAAPipeline.SetShader("../../../shaders/output/spir-v/post-fxaa-compute.spv", "main");
+	_mkFXAAPipeline.InitializePipelineLayout();
+
+	_mkLuminanceHistogramPipeline.SetShader("../../../shaders/output/spir-v/post-luminance-histogram-compute.spv", "main");
+	_mkLuminanceHistogramPipeline.InitializePipelineLayout();
+
+	_mkExposureAdaptationPipeline.SetShader("../../../shaders/output/spir-v/post-exposure-adaptation-compute.spv", "main");
+	_mkExposureAdaptationPipeline.InitializePipelineLayout();
+
+	_mkTemporalResolvePipeline.SetShader("../../../shaders/output/spir-v/post-temporal-resolve-compute.spv", "main");
+	_mkTemporalResolvePipeline.InitializePipelineLayout();
+
+	// compile up front, so that toggling an effect doesn't hitch
+	_mkBloomPrefilterPipeline.GetPipeline();
+	_mkBloomBlurPipeline.GetPipeline();
+	_mkCompositePipeline.GetPipeline();
+	_mkFXAAPipeline.GetPipeline();
+	_mkLuminanceHistogramPipeline.GetPipeline();
+	_mkExposureAdaptationPipeline.GetPipeline();
+	_mkTemporalResolvePipeline.GetPipeline();
+}
+
+void PostProcessStack::CreateDescriptorTemplates()
+{
+	// every post shader uses set 0 only, bindings follow the member order of its descriptor struct
+	_temporalResolveTemplate = GDescriptorManager->AcquireDescriptorUpdateTemplate(_mkTemporalResolvePipeline.GetDescriptorSetLayout(0), {
+		GetTemplateEntry(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offsetof(TemporalResolveDescriptor, offscreenColor)),
+		GetTemplateEntry(1, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, offsetof(TemporalResolveDescriptor, motionVector)), // integer, fetched without sampler
+		GetTemplateEntry(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offsetof(TemporalResolveDescriptor, historyColor)),
+		GetTemplateEntry(3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(TemporalResolveDescriptor, resolvedColor))
+	});
+	_luminanceHistogramTemplate = GDescriptorManager->AcquireDescriptorUpdateTemplate(_mkLuminanceHistogramPipeline.GetDescriptorSetLayout(0), {
+		GetTemplateEntry(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offsetof(LuminanceHistogramDescriptor, sceneColor)),
+		GetTemplateEntry(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, offsetof(LuminanceHistogramDescriptor, histogram))
+	});
+	_exposureAdaptationTemplate = GDescriptorManager->AcquireDescriptorUpdateTemplate(_mkExposureAdaptationPipeline.GetDescriptorSetLayout(0), {
+		GetTemplateEntry(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, offsetof(ExposureAdaptationDescriptor, histogram)),
+		GetTemplateEntry(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, offsetof(ExposureAdaptationDescriptor, exposure))
+	});
+	_bloomPrefilterTemplate = GDescriptorManager->AcquireDescriptorUpdateTemplate(_mkBloomPrefilterPipeline.GetDescriptorSetLayout(0), {
+		GetTemplateEntry(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offsetof(BloomPrefilterDescriptor, sceneColor)),
+		GetTemplateEntry(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(BloomPrefilterDescriptor, bloomColor)),
+		GetTemplateEntry(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, offsetof(BloomPrefilterDescriptor, exposure))
+	});
+	_bloomBlurTemplate = GDescriptorManager->AcquireDescriptorUpdateTemplate(_mkBloomBlurPipeline.GetDescriptorSetLayout(0), {
+		GetTemplateEntry(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offsetof(BloomBlurDescriptor, inputColor)),
+		GetTemplateEntry(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(BloomBlurDescriptor, outputColor))
+	});
+	_compositeTemplate = GDescriptorManager->AcquireDescriptorUpdateTemplate(_mkCompositePipeline.GetDescriptorSetLayout(0), {
+		GetTemplateEntry(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offsetof(CompositeDescriptor, sceneColor)),
+		GetTemplateEntry(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offsetof(CompositeDescriptor, bloomColor)),
+		GetTemplateEntry(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offsetof(CompositeDescriptor, colorGradingLUT)),
+		GetTemplateEntry(3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(CompositeDescriptor, outputColor)),
+		GetTemplateEntry(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, offsetof(CompositeDescriptor, exposure))
+	});
+	_fxaaTemplate = GDescriptorManager->AcquireDescriptorUpdateTemplate(_mkFXAAPipeline.GetDescriptorSetLayout(0), {
+		GetTemplateEntry(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offsetof(FXAADescriptor, ldrColor)),
+		GetTemplateEntry(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(FXAADescriptor, swapchainColor))
+	});
+}
+
+void PostProcessStack::CreateColorGradingLUT()
+{
+	/**
+	* bake color grading into a 32^3 LUT
+	* - indexed by sRGB encoded color, so the LUT resolution is spent where the eye can tell the difference.
+	* - blue slices are laid out side by side, red along each slice and green along the height.
+	*/
+	const uint32 width  = LUT_SIZE * LUT_SIZE;
+	const uint32 height = LUT_SIZE;
+	std::vector<uint8> pixels(width * height * 4);
+
+	const glm::vec3 lumaWeights(0.2126f, 0.7152f, 0.0722f);
+	for (uint32 green = 0; green < LUT_SIZE; green++)
+	{
+		for (uint32 blue = 0; blue < LUT_SIZE; blue++)
+		{
+			for (uint32 red = 0; red < LUT_SIZE; red++)
+			{
+				glm::vec3 color = glm::vec3(red, green, blue) / static_cast<float>(LUT_SIZE - 1);
+
+				float luma = glm::dot(color, lumaWeights);
+				color = glm::vec3(luma) + (color - glm::vec3(luma)) * _colorGradingSettings.saturation;
+				color = (color - glm::vec3(0.5f)) * _colorGradingSettings.contrast + glm::vec3(0.5f);
+				color = glm::clamp(color, glm::vec3(0.0f), glm::vec3(1.0f));
+
+				uint32 pixelIndex = (green * width + blue * LUT_SIZE + red) * 4;
+				pixels[pixelIndex + 0] = static_cast<uint8>(color.r * 255.0f + 0.5f);
+				pixels[pixelIndex + 1] = static_cast<uint8>(color.g * 255.0f + 0.5f);
+				pixels[pixelIndex + 2] = static_cast<uint8>(color.b * 255.0f + 0.5f);
+				pixels[pixelIndex + 3] = 255;
+			}
+		}
+	}
+
+	VkBufferAllocated stagingBuffer;
+	GAllocator->CreateBuffer(
+		&stagingBuffer,
+		pixels.size(),
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VMA_MEMORY_USAGE_AUTO,
+		VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+		"staging buffer(color grading LUT)"
+	);
+	memcpy(stagingBuffer.allocationInfo.pMappedData, pixels.data(), pixels.size());
+
+	GAllocator->CreateImage(
+		&_vkColorGradingLUT,
+		width,
+		height,
+		VK_FORMAT_R8G8B8A8_UNORM, // already sRGB encoded, must not be decoded by the sampler
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VMA_MEMORY_USAGE_AUTO,
+		0,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		"color grading LUT"
+	);
+
+	VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	GCommandService->ExecuteSingleTimeCommands([&](VkCommandBuffer commandBuffer) {
+		BarrierBatch barrierBatch;
+		barrierBatch.AddImageTransition(_vkColorGradingLUT.image, subresourceRange, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		barrierBatch.Flush(commandBuffer);
+
+		mk::vk::CopyBufferToImage(commandBuffer, stagingBuffer.buffer, _vkColorGradingLUT.image, width, height);
+
+		barrierBatch.AddImageTransition(_vkColorGradingLUT.image, subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		barrierBatch.Flush(commandBuffer);
+	});
+	GAllocator->DestroyBuffer(stagingBuffer);
+
+	mk::vk::CreateImageView(
+		_mkDeviceRef.GetDevice(),
+		_vkColorGradingLUT.image,
+		_vkColorGradingLUTView,
+		VK_IMAGE_VIEW_TYPE_2D,
+		VK_FORMAT_R8G8B8A8_UNORM,
+		VK_IMAGE_ASPECT_COLOR_BIT,
+		1
+	);
+}
+
+void PostProcessStack::CreateAutoExposureBuffers()
+{
+	GAllocator->CreateBuffer(
+		&_vkLuminanceHistogramBuffer,
+		HISTOGRAM_BUFFER_SIZE,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, // descriptor buffer references it by address
+		VMA_MEMORY_USAGE_AUTO,
+		0,
+		"luminance histogram buffer"
+	);
+	GAllocator->CreateBuffer(
+		&_vkExposureBuffer,
+		EXPOSURE_BUFFER_SIZE,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		VMA_MEMORY_USAGE_AUTO,
+		0,
+		"exposure buffer"
+	);
+
+	// zero adapted luminance tells the adaptation dispatch to start at the first measured luminance
+	GCommandService->ExecuteSingleTimeCommands([&](VkCommandBuffer commandBuffer) {
+		vkCmdFillBuffer(commandBuffer, _vkLuminanceHistogramBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+		vkCmdFillBuffer(commandBuffer, _vkExposureBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+	});
+}
+
+void PostProcessStack::CreateHistoryImages(VkExtent2D extent)
+{
+	// previous images are no longer used, the graph is rebuilt after the device is idle
+	DestroyHistoryImages();
+
+	for (uint32 it = 0; it < 2; it++)
+	{
+		GAllocator->CreateImage(
+			&_vkHistoryImages[it],
+			extent.width,
+			extent.height,
+			HISTORY_FORMAT,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+			VMA_MEMORY_USAGE_AUTO,
+			0,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			"temporal history image(" + std::to_string(it) + ")"
+		);
+		mk::vk::CreateImageView(
+			_mkDeviceRef.GetDevice(),
+			_vkHistoryImages[it].image,
+			_vkHistoryImageViews[it],
+			VK_IMAGE_VIEW_TYPE_2D,
+			HISTORY_FORMAT,
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			1
+		);
+	}
+
+	// every frame expects both histories in shader read layout, the contents are ignored until the first resolve
+	VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	GCommandService->ExecuteSingleTimeCommands([&](VkCommandBuffer commandBuffer) {
+		BarrierBatch barrierBatch;
+		for (const auto& historyImage : _vkHistoryImages)
+			barrierBatch.AddImageTransition(historyImage.image, subresourceRange, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		barrierBatch.Flush(commandBuffer);
+	});
+
+	_historyExtent  = extent;
+	_isHistoryValid = false;
+}
+
+void PostProcessStack::DestroyHistoryImages()
+{
+	for (uint32 it = 0; it < 2; it++)
+	{
+		if (_vkHistoryImages[it].image == VK_NULL_HANDLE)
+			continue;
+
+		vkDestroyImageView(_mkDeviceRef.GetDevice(), _vkHistoryImageViews[it], nullptr);
+		GAllocator->DestroyImage(_vkHistoryImages[it]);
+		_vkHistoryImages[it].image = VK_NULL_HANDLE;
+		_vkHistoryImageViews[it]   = VK_NULL_HANDLE;
+	}
+	_historyExtent = { 0, 0 };
+}
+
+void PostProcessStack::DispatchTemporalResolve(VkCommandBuffer commandBuffer, VkExtent2D extent)
+{
+	TemporalResolveDescriptor descriptor{
+		GetSampledImageInfo(_offscreenColorHandle),
+		GetSampledImageInfo(_motionVectorHandle),
+		GetSampledImageInfo(_historyReadHandle),
+		GetStorageImageInfo(_historyWriteHandle)
+	};
+	BindDescriptors(commandBuffer, _mkTemporalResolvePipeline, _temporalResolveTemplate, &descriptor);
+
+	// jitter is in NDC of the rendered region, which maps to its part of offscreen uv with half the scale
+	glm::vec2 offscreenExtent(_offscreenExtent.width, _offscreenExtent.height);
+	glm::vec2 renderExtent(_offscreenRenderExtent.width, _offscreenRenderExtent.height);
+
+	PushConstantTemporalResolve pushConstant{};
+	pushConstant.renderUVScale = renderExtent / offscreenExtent;
+	pushConstant.renderUVMax   = (renderExtent - 0.5f) / offscreenExtent;
+	pushConstant.jitterUV      = _jitter * 0.5f * pushConstant.renderUVScale;
+	pushConstant.texelSize     = 1.0f / offscreenExtent;
+	pushConstant.currentWeight = _isHistoryValid ? _settings.temporalBlendFactor : 1.0f;
+	vkCmdPushConstants(commandBuffer, _mkTemporalResolvePipeline.GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstant), &pushConstant);
+
+	vkCmdDispatch(commandBuffer, MKComputePipeline::GetGroupCount(extent.width, GROUP_SIZE), MKComputePipeline::GetGroupCount(extent.height, GROUP_SIZE), 1);
+	_isHistoryValid = true;
+}
+
+void PostProcessStack::DispatchLuminanceHistogram(VkCommandBuffer commandBuffer, VkExtent2D extent)
+{
+	// histogram was cleared by the adaptation dispatch of the previous frame
+	_barrierBatch.AddBufferBarrier(
+		_vkLuminanceHistogramBuffer.buffer,
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+	);
+	_barrierBatch.Flush(commandBuffer);
+
+	LuminanceHistogramDescriptor descriptor{ GetSampledImageInfo(_sceneColorHandle), GetBufferInfo(_vkLuminanceHistogramBuffer, HISTOGRAM_BUFFER_SIZE) };
+	BindDescriptors(commandBuffer, _mkLuminanceHistogramPipeline, _luminanceHistogramTemplate, &descriptor);
+
+	PushConstantLuminanceHistogram pushConstant{};
+	pushConstant.minLogLuminance          = _settings.minLogLuminance;
+	pushConstant.inverseLogLuminanceRange = 1.0f / (_settings.maxLogLuminance - _settings.minLogLuminance);
+	pushConstant.sceneRenderExtent[0]     = _sceneRenderExtent.width;
+	pushConstant.sceneRenderExtent[1]     = _sceneRenderExtent.height;
+	vkCmdPushConstants(commandBuffer, _mkLuminanceHistogramPipeline.GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstant), &pushConstant);
+
+	vkCmdDispatch(commandBuffer, MKComputePipeline::GetGroupCount(_sceneRenderExtent.width, HISTOGRAM_GROUP_SIZE), MKComputePipeline::GetGroupCount(_sceneRenderExtent.height, HISTOGRAM_GROUP_SIZE), 1);
+}
+
+void PostProcessStack::DispatchExposureAdaptation(VkCommandBuffer commandBuffer, VkExtent2D extent)
+{
+	// histogram atomics of this frame -> reduction, exposure reads of the previous frame -> overwrite
+	_barrierBatch.AddBufferBarrier(
+		_vkLuminanceHistogramBuffer.buffer,
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+	);
+	_barrierBatch.AddBufferBarrier(
+		_vkExposureBuffer.buffer,
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+	);
+	_barrierBatch.Flush(commandBuffer);
+
+	ExposureAdaptationDescriptor descriptor{ GetBufferInfo(_vkLuminanceHistogramBuffer, HISTOGRAM_BUFFER_SIZE), GetBufferInfo(_vkExposureBuffer, EXPOSURE_BUFFER_SIZE) };
+	BindDescriptors(commandBuffer, _mkExposureAdaptationPipeline, _exposureAdaptationTemplate, &descriptor);
+
+	// exponential smoothing independent of frame rate
+	PushConstantExposureAdaptation pushConstant{};
+	pushConstant.minLogLuminance   = _settings.minLogLuminance;
+	pushConstant.logLuminanceRange = _settings.maxLogLuminance - _settings.minLogLuminance;
+	pushConstant.adaptationFactor  = 1.0f - std::exp(-_deltaTime * _settings.adaptationRate);
+	pushConstant.pixelCount        = _sceneRenderExtent.width * _sceneRenderExtent.height;
+	vkCmdPushConstants(commandBuffer, _mkExposureAdaptationPipeline.GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstant), &pushConstant);
+
+	vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+	// adapted exposure is read by bloom prefilter and composite
+	_barrierBatch.AddBufferBarrier(
+		_vkExposureBuffer.buffer,
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+	);
+	_barrierBatch.Flush(commandBuffer);
+}
+
+void PostProcessStack::DispatchBloomPrefilter(VkCommandBuffer commandBuffer, VkExtent2D extent)
+{
+	BloomPrefilterDescriptor descriptor{ GetSampledImageInfo(_sceneColorHandle), GetStorageImageInfo(_bloomPrefilterHandle), GetBufferInfo(_vkExposureBuffer, EXPOSURE_BUFFER_SIZE) };
+	BindDescriptors(commandBuffer, _mkBloomPrefilterPipeline, _bloomPrefilterTemplate, &descriptor);
+
+	// threshold is applied to the exposed color, so that bloom follows exposure changes
+	PushConstantBloomPrefilter pushConstant{};
+	pushConstant.exposure       = IsEffectEnabled(POST_EFFECT_EXPOSURE) ? _settings.exposure : 1.0f;
+	pushConstant.threshold      = _settings.bloomThreshold;
+	pushConstant.knee           = _settings.bloomKnee;
+	pushConstant.isAutoExposure = IsEffectEnabled(POST_EFFECT_AUTO_EXPOSURE) ? 1 : 0;
+	pushConstant.sceneUVScale   = GetSceneUVScale();
+	pushConstant.sceneUVMax     = GetSceneUVMax();
+	vkCmdPushConstants(commandBuffer, _mkBloomPrefilterPipeline.GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstant), &pushConstant);
+
+	vkCmdDispatch(commandBuffer, MKComputePipeline::GetGroupCount(extent.width, GROUP_SIZE), MKComputePipeline::GetGroupCount(extent.height, GROUP_SIZE), 1);
+}
+
+void PostProcessStack::DispatchBloomBlur(VkCommandBuffer commandBuffer, VkExtent2D extent, uint32 direction)
+{
+	auto input  = (direction == 0) ? _bloomPrefilterHandle : _bloomBlurXHandle;
+	auto output = (direction == 0) ? _bloomBlurXHandle : _bloomBlurYHandle;
+	BloomBlurDescriptor descriptor{ GetSampledImageInfo(input), GetStorageImageInfo(output) };
+	BindDescriptors(commandBuffer, _mkBloomBlurPipeline, _bloomBlurTemplate, &descriptor);
+
+	PushConstantBloomBlur pushConstant{};
+	pushConstant.direction = direction;
+	vkCmdPushConstants(commandBuffer, _mkBloomBlurPipeline.GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstant), &pushConstant);
+
+	// a group covers a line segment along the blur direction, groups in y walk across the other axis
+	uint32 lengthAlong  = (direction == 0) ? extent.width : extent.height;
+	uint32 lengthAcross = (direction == 0) ? extent.height : extent.width;
+	vkCmdDispatch(commandBuffer, MKComputePipeline::GetGroupCount(lengthAlong, BLUR_GROUP_SIZE), lengthAcross, 1);
+}
+
+void PostProcessStack::DispatchComposite(VkCommandBuffer commandBuffer, VkExtent2D extent)
+{
+	// without bloom the scene color is bound in its place, the shader skips it by flag
+	bool isBloomEnabled = IsEffectEnabled(POST_EFFECT_BLOOM);
+	CompositeDescriptor descriptor{
+		GetSampledImageInfo(_sceneColorHandle),
+		GetSampledImageInfo(isBloomEnabled ? _bloomBlurYHandle : _sceneColorHandle),
+		VkDescriptorImageInfo{ _vkLinearClampSampler, _vkColorGradingLUTView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+		GetStorageImageInfo(_compositeTargetHandle),
+		GetBufferInfo(_vkExposureBuffer, EXPOSURE_BUFFER_SIZE)
+	};
+	BindDescriptors(commandBuffer, _mkCompositePipeline, _compositeTemplate, &descriptor);
+
+	PushConstantComposite pushConstant{};
+	pushConstant.exposure       = _settings.exposure;
+	pushConstant.bloomIntensity = _settings.bloomIntensity;
+	pushConstant.effectFlags    = _enabledEffects;
+	pushConstant.isLumaOutput   = IsEffectEnabled(POST_EFFECT_FXAA) ? 1 : 0;
+	pushConstant.sceneUVScale   = GetSceneUVScale();
+	pushConstant.sceneUVMax     = GetSceneUVMax();
+	vkCmdPushConstants(commandBuffer, _mkCompositePipeline.GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstant), &pushConstant);
+
+	vkCmdDispatch(commandBuffer, MKComputePipeline::GetGroupCount(extent.width, GROUP_SIZE), MKComputePipeline::GetGroupCount(extent.height, GROUP_SIZE), 1);
+}
+
+void PostProcessStack::DispatchFXAA(VkCommandBuffer commandBuffer, VkExtent2D extent)
+{
+	FXAADescriptor descriptor{ GetSampledImageInfo(_ldrColorHandle), GetStorageImageInfo(_swapchainColorHandle) };
+	BindDescriptors(commandBuffer, _mkFXAAPipeline, _fxaaTemplate, &descriptor);
+
+	vkCmdDispatch(commandBuffer, MKComputePipeline::GetGroupCount(extent.width, GROUP_SIZE), MKComputePipeline::GetGroupCount(extent.height, GROUP_SIZE), 1);
+}
+
+void PostProcessStack::BindDescriptors(VkCommandBuffer commandBuffer, MKComputePipeline& pipeline, const MKDescriptorManager::DescriptorUpdateTemplate* updateTemplate, const void* pData)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.GetPipeline());
+
+	// transient set, released when this frame slot's fence is waited again
+	auto descriptorSet = GDescriptorManager->AllocateTransientDescriptorSet(_currentFrameIndex, pipeline.GetDescriptorSetLayout(0));
+	GDescriptorManager->UpdateDescriptorSetWithTemplate(descriptorSet, updateTemplate, pData);
+	GDescriptorManager->BindDescriptorSet(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.GetPipelineLayout(), 0, descriptorSet);
+}
+
+void PostProcessStack::BeginTimer(VkCommandBuffer commandBuffer, ETimer timer)
+{
+	if (_vkTimestampQueryPool == VK_NULL_HANDLE)
+		return;
+
+	// written once the dispatches before this pass are done, the barrier flushed before it included
+	vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, _vkTimestampQueryPool, (_currentFrameIndex * TIMER_COUNT + timer) * 2);
+}
+
+void PostProcessStack::EndTimer(VkCommandBuffer commandBuffer, ETimer timer)
+{
+	if (_vkTimestampQueryPool == VK_NULL_HANDLE)
+		return;
+
+	vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, _vkTimestampQueryPool, (_currentFrameIndex * TIMER_COUNT + timer) * 2 + 1);
+	_writtenTimerMasks[_currentFrameIndex] |= (1u << timer);
+}
+
+VkDescriptorImageInfo PostProcessStack::GetSampledImageInfo(MKRenderGraph::ResourceHandle resource) const
+{
+	return { _vkLinearClampSampler, _renderGraph->GetImageView(resource), MKRenderGraph::GetUsageLayout(ERenderGraphUsage::SAMPLED_COMPUTE) };
+}
+
+VkDescriptorImageInfo PostProcessStack::GetStorageImageInfo(MKRenderGraph::ResourceHandle resource) const
+{
+	return { VK_NULL_HANDLE, _renderGraph->GetImageView(resource), MKRenderGraph::GetUsageLayout(ERenderGraphUsage::STORAGE_WRITE_COMPUTE) };
+}
+
+glm::vec2 PostProcessStack::GetSceneUVScale() const
+{
+	return glm::vec2(_sceneRenderExtent.width, _sceneRenderExtent.height) / glm::vec2(_sceneExtent.width, _sceneExtent.height);
+}
+
+glm::vec2 PostProcessStack::GetSceneUVMax() const
+{
+	return (glm::vec2(_sceneRenderExtent.width, _sceneRenderExtent.height) - 0.5f) / glm::vec2(_sceneExtent.width, _sceneExtent.height);
+}
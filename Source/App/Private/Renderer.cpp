@@ -9,9 +9,12 @@ Renderer::Renderer()
 	_mkGraphicsPipeline(_mkDevice),
 	_mkPostPipeline(_mkDevice),
 	_objModel(_mkDevice),
+	_renderGraph(_mkDevice),
+	_postProcessStack(_mkDevice),
 	_camera(_mkDevice, _mkSwapchain),
 	_inputController(_mkWindow.GetWindow(), _camera)
 {
+	GJobSystem->InitJobSystem(); // workers are shared by asset loading and command recording
 	GAllocator->InitVMAAllocator(_mkInstance.GetVkInstance(), _mkDevice.GetPhysicalDevice(), _mkDevice.GetDevice());
 	
 	// get device physical properties for later use
@@ -27,16 +30,21 @@ Renderer::~Renderer()
 	for(auto& uniformBuffer : _vkUniformBuffers)
 		GAllocator->DestroyBuffer(uniformBuffer);
 
+	if (_isBindlessEnabled)
+		GAllocator->DestroyBuffer(_vkMaterialBuffer);
+
 	// destroy image sampler
 	vkDestroySampler(_mkDevice.GetDevice(), _vkLinearSampler, nullptr);
 
+	// destroy gpu timestamp queries
+	vkDestroyQueryPool(_mkDevice.GetDevice(), _vkTimestampQueryPool, nullptr);
+
 	// destroy model and texture resources
 	_objModel.DestroyModel();
 
-	// destroy descriptor set layout
-	vkDestroyDescriptorSetLayout(_mkDevice.GetDevice(), _vkBaseDescriptorSetLayout, nullptr);
-	vkDestroyDescriptorSetLayout(_mkDevice.GetDevice(), _vkSamplerDescriptorSetLayout, nullptr);
-	vkDestroyDescriptorSetLayout(_mkDevice.GetDevice(), _vkPostDescriptorSetLayout, nullptr);
+	// destroy post process resources (LUT is allocated by GAllocator)
+	if (_isComputePostEnabled)
+		_postProcessStack.Destroy();
 
 	if (_mkDevice.enableDynamicRendering)
 	{
@@ -58,9 +66,12 @@ Renderer::~Renderer()
 
 	// destroy allocator instance
 	delete GAllocator;
-#ifndef NDEBUG
-	MK_LOG("descriptor set layout destroyed");
-#endif
+
+	// optimize-link runs as background jobs, finish them while workers are still alive
+	GPipelineRegistry->WaitForBackgroundCompiles();
+
+	// stop worker threads
+	delete GJobSystem;
 }
 
 /**
@@ -69,9 +80,93 @@ Renderer::~Renderer()
 
 void Renderer::Setup()
 {
-	// query required color & depth attachment formats
+	// compute post writes the swapchain image as a storage image whose format is only known at runtime, the device enables that feature when supported
+	bool isStorageSwapchainRequested = _isComputePostRequested && _mkDevice.enableDynamicRendering && _mkDevice.IsStorageImageWriteWithoutFormatEnabled();
+
+	// low latency mode picks another present mode and compute post another format, so replace the swapchain created with the default one
+	if (_isLowLatencyEnabled || isStorageSwapchainRequested)
+	{
+		_mkSwapchain.SetLowLatencyMode(_isLowLatencyEnabled);
+		_mkSwapchain.RequestStorageImage(isStorageSwapchainRequested);
+		_mkSwapchain.DestroySwapchainResources();
+		_mkSwapchain.CreateSwapchain();
+		_mkSwapchain.CreateSwapchainImageViews();
+
+#ifndef NDEBUG
+		if (_isLowLatencyEnabled)
+			MK_LOG(fmt::format("low latency mode : {} present mode, present wait {}", string_VkPresentModeKHR(_mkSwapchain.GetPresentMode()), _mkDevice.GetPresentWaitSupport().isSupported ? "enabled" : "unsupported"));
+#endif
+	}
+	_isComputePostEnabled = isStorageSwapchainRequested && _mkSwapchain.IsStorageImageEnabled();
+#ifndef NDEBUG
+	if (_isComputePostRequested)
+		MK_LOG(fmt::format("compute post processing : {}", _isComputePostEnabled ? "enabled" : "unsupported, fullscreen triangle is used"));
+#endif
+
+	// temporal resolve is a compute pass of the post stack, and a render scale is only upscaled by it
+	_isTemporalAAEnabled = _isTemporalAARequested && _isComputePostEnabled;
+	_renderScale         = _isTemporalAAEnabled ? std::clamp(_renderScale, 0.5f, 1.0f) : 1.0f;
+	_postProcessStack.EnableTemporalAA(_isTemporalAAEnabled);
+#ifndef NDEBUG
+	if (_isTemporalAARequested)
+		MK_LOG(fmt::format("temporal anti-aliasing : {}", _isTemporalAAEnabled ? fmt::format("enabled, render scale {:.2f}", _renderScale) : "unsupported without compute post"));
+#endif
+
+	// query required color attachment format, post pass draws a fullscreen triangle without depth
 	VkFormat swapchainImageFormat = _mkSwapchain.GetSwapchainImageFormat(); // color attachment format
-	VkFormat swapchinDepthFormat = mk::vk::FindDepthFormat(_mkDevice.GetPhysicalDevice()); // depth attachment format
+
+	/**
+	* query offscreen hdr color format
+	* - offscreen color image is rendered by offscreen pass and linearly sampled by post pass.
+	* - if the preferred format can't do both, fall back to higher precision format.
+	*/
+	_vkOffscreenColorFormat = mk::vk::FindHDRColorFormat(
+		_mkDevice.GetPhysicalDevice(),
+		_hdrColorFormat,
+		VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT
+	);
+#ifndef NDEBUG
+	MK_LOG(fmt::format("offscreen color format : {}", string_VkFormat(_vkOffscreenColorFormat)));
+#endif
+	_vkOffscreenColorFormats = { _vkOffscreenColorFormat, _vkMotionVectorFormat }; // motion vector is only bound with temporal aa
+
+	/**
+	* resolve msaa sample count (dynamic rendering only)
+	* - offscreen color, motion vector and depth are rendered with the same count, so it has to be supported by all of them.
+	* - framebuffer limits are a device wide upper bound, the counts of each format with the usage of its multisampled image narrow them down.
+	* - the highest supported count not above the requested one is used.
+	*/
+	_vkMsaaSampleCount = VK_SAMPLE_COUNT_1_BIT;
+	if (_mkDevice.enableDynamicRendering)
+	{
+		// multisampled images only live in the offscreen pass, so the render graph creates them as transient attachments
+		auto getFormatSampleCounts = [this](VkFormat format, VkImageUsageFlags usage) -> VkSampleCountFlags {
+			VkImageFormatProperties formatProperties{};
+			VkResult result = vkGetPhysicalDeviceImageFormatProperties(
+				_mkDevice.GetPhysicalDevice(), format, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_OPTIMAL,
+				usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, 0, &formatProperties
+			);
+			return (result == VK_SUCCESS) ? formatProperties.sampleCounts : VK_SAMPLE_COUNT_1_BIT;
+		};
+
+		VkSampleCountFlags supportedCounts = _vkDeviceProperties.limits.framebufferColorSampleCounts & _vkDeviceProperties.limits.framebufferDepthSampleCounts;
+		supportedCounts &= getFormatSampleCounts(_vkOffscreenColorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+		supportedCounts &= getFormatSampleCounts(_vkOffscreenDepthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+		if (_isTemporalAAEnabled)
+			supportedCounts &= getFormatSampleCounts(_vkMotionVectorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+		for (uint32 count = _msaaSampleCountRequested; count > VK_SAMPLE_COUNT_1_BIT; count >>= 1)
+		{
+			if (supportedCounts & count)
+			{
+				_vkMsaaSampleCount = static_cast<VkSampleCountFlagBits>(count);
+				break;
+			}
+		}
+	}
+#ifndef NDEBUG
+	if (_msaaSampleCountRequested != VK_SAMPLE_COUNT_1_BIT)
+		MK_LOG(fmt::format("msaa : {} samples requested, {} samples used", static_cast<uint32>(_msaaSampleCountRequested), static_cast<uint32>(_vkMsaaSampleCount)));
+#endif
 	
 	if (_mkDevice.enableDynamicRendering)
 	{
@@ -83,7 +178,7 @@ void Renderer::Setup()
 	else
 	{
 		// create render pass
-		mk::vk::CreateDefaultRenderPass(_mkDevice.GetDevice(), swapchainImageFormat, swapchinDepthFormat, &_vkRenderPass);
+		mk::vk::CreateDefaultRenderPass(_mkDevice.GetDevice(), swapchainImageFormat, VK_FORMAT_UNDEFINED, &_vkRenderPass);
 		// request creation of frame buffers
 		CreateFrameBuffers();
 		// create offscreen render pass
@@ -128,6 +223,45 @@ void Renderer::Setup()
 
 	// create uniform buffers
 	CreateUniformBuffers();
+	CreateTimestampQueryPool();
+
+	// dynamic resolution is driven by measured gpu time and only shrinks render area inside graph images
+	_dynamicResolution.isEnabled = _isDynamicResolutionRequested && _mkDevice.enableDynamicRendering && _vkTimestampQueryPool != VK_NULL_HANDLE;
+#ifndef NDEBUG
+	if (_isDynamicResolutionRequested)
+		MK_LOG(fmt::format("dynamic resolution : {}", _dynamicResolution.isEnabled ? fmt::format("enabled, target gpu time {:.2f} ms", _dynamicResolution.targetGpuTime) : "unsupported"));
+#endif
+
+	// register textures and materials to the global bindless table if descriptor indexing is available
+	_isBindlessEnabled = _isBindlessRequested && _mkDevice.GetDescriptorIndexingSupport().isSupported;
+	if (_isBindlessEnabled)
+		CreateBindlessResources();
+
+	/**
+	* configure pipeline layouts
+	* - descriptor set layouts and push constant range are reflected from SPIR-V, so pipelines are configured before descriptor sets.
+	* - texture array size is only known on host side, bindless table layout is owned by the table.
+	*/
+	_mkGraphicsPipeline.AddShader("../../../shaders/output/spir-v/vertex.spv", "main", VK_SHADER_STAGE_VERTEX_BIT);
+	if (_isBindlessEnabled)
+	{
+		_mkGraphicsPipeline.AddShader("../../../shaders/output/spir-v/bindless-fragment.spv", "main", VK_SHADER_STAGE_FRAGMENT_BIT);
+		_mkGraphicsPipeline.SetDescriptorSetLayout(2, _mkBindlessTable.GetDescriptorSetLayout());
+	}
+	else
+	{
+		_mkGraphicsPipeline.AddShader("../../../shaders/output/spir-v/fragment.spv", "main", VK_SHADER_STAGE_FRAGMENT_BIT);
+		_mkGraphicsPipeline.SetDescriptorCount(0, EFragmentShaderBinding::TEXTURE, static_cast<uint32>(_objModel.textures.size()));
+	}
+	_mkGraphicsPipeline.InitializePipelineLayout();
+
+	_mkPostPipeline.AddShader("../../../shaders/output/spir-v/post-vertex.spv", "main", VK_SHADER_STAGE_VERTEX_BIT);
+	_mkPostPipeline.AddShader("../../../shaders/output/spir-v/post-fragment.spv", "main", VK_SHADER_STAGE_FRAGMENT_BIT);
+	_mkPostPipeline.InitializePipelineLayout();
+
+	// compute post stack (pipelines, descriptor templates, color grading LUT and its timestamp queries)
+	if (_isComputePostEnabled)
+		_postProcessStack.Initialize(_vkDeviceProperties);
 
 	// create descriptor sets for graphics pipeline
 	CreateBaseDescriptorSet();
@@ -136,44 +270,50 @@ void Renderer::Setup()
 	WriteSamplerDescriptor(); // update sampler descriptor set
 
 	// create descriptor set for post processing pipeline
-	CreatePostDescriptorSet();
-	WritePostDescriptor(); // update post descriptor set
+	CreatePostDescriptorTemplate(); // post descriptor set is transient, written every frame
+
+	// command pools of recording threads
+	if (_isParallelRecordingEnabled)
+		GCommandService->InitRecordingThreads();
 
 
 	// determine stencil format for two pipelines
 	auto offscreenStencilFormat = (!IsDepthOnlyFormat(_vkOffscreenDepthFormat)) ? _vkOffscreenDepthFormat : VK_FORMAT_UNDEFINED;
-	auto swapchainStencilFormat = (!IsDepthOnlyFormat(swapchinDepthFormat)) ? swapchinDepthFormat : VK_FORMAT_UNDEFINED;
 	
 	// configure base pipeline
-	std::vector<VkDescriptorSetLayout> descriptorLayouts = { _vkBaseDescriptorSetLayout, _vkSamplerDescriptorSetLayout };
-	_mkGraphicsPipeline.AddShader("../../../shaders/output/spir-v/vertex.spv", "main", VK_SHADER_STAGE_VERTEX_BIT);
-	_mkGraphicsPipeline.AddShader("../../../shaders/output/spir-v/fragment.spv", "main", VK_SHADER_STAGE_FRAGMENT_BIT);
-	_mkGraphicsPipeline.AddDescriptorSetLayouts(descriptorLayouts);
-	_mkGraphicsPipeline.AddPushConstantRanges(_vkPushConstantRanges);
-	_mkGraphicsPipeline.InitializePipelineLayout();
+	_mkGraphicsPipeline.EnableExtendedDynamicState(); // cull, depth and blend states are set while recording
+	if (_vkMsaaSampleCount != VK_SAMPLE_COUNT_1_BIT)
+		_mkGraphicsPipeline.EnableMultiSampling(_vkMsaaSampleCount);
 
 	// configure post pipeline
-	std::vector<VkDescriptorSetLayout> postDescriptorLayouts = { _vkPostDescriptorSetLayout };
-	_mkPostPipeline.AddShader("../../../shaders/output/spir-v/post-vertex.spv", "main", VK_SHADER_STAGE_VERTEX_BIT);
-	_mkPostPipeline.AddShader("../../../shaders/output/spir-v/post-fragment.spv", "main", VK_SHADER_STAGE_FRAGMENT_BIT);
-	_mkPostPipeline.AddDescriptorSetLayouts(postDescriptorLayouts);
-	_mkPostPipeline.InitializePipelineLayout();
 	_mkPostPipeline.SetCullMode(VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE); // disable culling
 	_mkPostPipeline.RemoveVertexInput();
 
 	if (_mkDevice.enableDynamicRendering)
 	{
-		_mkGraphicsPipeline.SetRenderingInfo(1, &_vkOffscreenColorFormat, _vkOffscreenDepthFormat, offscreenStencilFormat);
-		_mkPostPipeline.SetRenderingInfo(1, &swapchainImageFormat, swapchinDepthFormat, swapchainStencilFormat);
+		_mkGraphicsPipeline.SetRenderingInfo(GetOffscreenColorAttachmentCount(), _vkOffscreenColorFormats.data(), _vkOffscreenDepthFormat, offscreenStencilFormat);
+		_mkPostPipeline.SetRenderingInfo(1, &swapchainImageFormat, VK_FORMAT_UNDEFINED, VK_FORMAT_UNDEFINED);
 
-		_mkGraphicsPipeline.BuildPipeline();
-		_mkPostPipeline.BuildPipeline();
+		_mkPipelineBuildService.RequestBuild(_mkGraphicsPipeline);
+		_mkPipelineBuildService.RequestBuild(_mkPostPipeline);
 	}
 	else
 	{
-		_mkGraphicsPipeline.BuildPipeline(&_vkOffscreenRednerPass);
-		_mkPostPipeline.BuildPipeline(&_vkRenderPass);
+		// formats of the render passes, pipelines are keyed by them instead of the render pass handles
+		_mkGraphicsPipeline.SetRenderingInfo(1, _vkOffscreenColorFormats.data(), _vkOffscreenDepthFormat, offscreenStencilFormat);
+		_mkPostPipeline.SetRenderingInfo(1, &swapchainImageFormat, VK_FORMAT_UNDEFINED, VK_FORMAT_UNDEFINED);
+
+		_mkPipelineBuildService.RequestBuild(_mkGraphicsPipeline, &_vkOffscreenRednerPass);
+		_mkPipelineBuildService.RequestBuild(_mkPostPipeline, &_vkRenderPass);
 	}
+
+	// compile every requested pipeline concurrently into the shared pipeline cache
+	_mkPipelineBuildService.BuildAll();
+
+#ifndef NDEBUG
+	// recompile edited hlsl files in background, pipelines are rebuilt in Update()
+	_shaderHotReloader.Start("../../../shaders/HLSL", "../../../shaders/output/spir-v");
+#endif
 }
 
 void Renderer::CreateVertexBuffer(std::vector<Vertex> vertices)
@@ -259,6 +399,49 @@ void Renderer::CreateIndexBuffer(std::vector<uint32> indices)
 	GAllocator->DestroyBuffer(stagingBuffer);
 }
 
+void Renderer::CreateBindlessResources()
+{
+	_mkBindlessTable.InitBindlessTable(&_mkDevice);
+
+	// textures of the model are loaded in diffuse, specular, normal order
+	MaterialData material{};
+	material.diffuseTexture  = _mkBindlessTable.RegisterTexture(_objModel.textures[0]->imageView);
+	material.specularTexture = _mkBindlessTable.RegisterTexture(_objModel.textures[1]->imageView);
+	material.normalTexture   = _mkBindlessTable.RegisterTexture(_objModel.textures[2]->imageView);
+
+	// upload material records to device local storage buffer
+	std::vector<MaterialData> materials = { material };
+	VkDeviceSize bufferSize = sizeof(MaterialData) * materials.size();
+
+	VkBufferAllocated stagingBuffer;
+	GAllocator->CreateBuffer(
+		&stagingBuffer,
+		bufferSize,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VMA_MEMORY_USAGE_AUTO,
+		VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+		"material staging buffer"
+	);
+
+	memcpy(stagingBuffer.allocationInfo.pMappedData, materials.data(), (size_t)(bufferSize));
+
+	GAllocator->CreateBuffer(
+		&_vkMaterialBuffer,
+		bufferSize,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, // descriptor buffer references it by address
+		VMA_MEMORY_USAGE_GPU_ONLY,
+		VMA_ALLOCATION_CREATE_MAPPED_BIT,
+		"material buffer"
+	);
+
+	CopyBufferToBuffer(stagingBuffer, _vkMaterialBuffer, bufferSize);
+	GAllocator->DestroyBuffer(stagingBuffer);
+
+	// draws select their material with push constant
+	_vkPushConstantRaster.materialBufferIndex = _mkBindlessTable.RegisterStorageBuffer(_vkMaterialBuffer.buffer, bufferSize);
+	_vkPushConstantRaster.materialIndex       = 0;
+}
+
 void Renderer::CreateFrameBuffers()
 {
 	auto imageViewCount = _mkSwapchain.GetImageViewCount();
@@ -267,9 +450,8 @@ void Renderer::CreateFrameBuffers()
 	// create frame buffer as much as the number of image views
 	for (size_t it = 0; it < imageViewCount; it++) {
 		
-		std::array<VkImageView, 2> attachments = {
-			_mkSwapchain.GetSwapchainImageView(it), // only color image views are different for each frame buffer
-			_mkSwapchain.GetDepthImageView(),
+		std::array<VkImageView, 1> attachments = {
+			_mkSwapchain.GetSwapchainImageView(it), // post pass draws a fullscreen triangle, so it has no depth attachment
 		};
 
 		VkFramebufferCreateInfo framebufferInfo = mk::vkinfo::GetFramebufferCreateInfo(_vkRenderPass, attachments, _mkSwapchain.GetSwapchainExtent());
@@ -279,176 +461,253 @@ void Renderer::CreateFrameBuffers()
 
 void Renderer::CreateBaseDescriptorSet()
 {
-	// single uniform buffer descriptor
-	GDescriptorManager->AddDescriptorSetLayoutBinding(
-		VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-		VK_SHADER_STAGE_VERTEX_BIT,
-		EVertexShaderBinding::UNIFORM_BUFFER,
-		1
-	);
-	// three texture image descriptors
-	GDescriptorManager->AddDescriptorSetLayoutBinding(
-		VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-		VK_SHADER_STAGE_FRAGMENT_BIT,
-		EFragmentShaderBinding::TEXTURE,
-		static_cast<uint32>(_objModel.textures.size())
-	);
-
-	// create base descriptor set layout based on waiting bindings
-	GDescriptorManager->CreateDescriptorSetLayout(_vkBaseDescriptorSetLayout);
+	// uniform buffer and texture array descriptors (set 0, reflected from vertex and fragment shaders)
+	_vkBaseDescriptorSetLayout = _mkGraphicsPipeline.GetDescriptorSetLayout(0);
 
 	// allocate base descriptor set
 	GDescriptorManager->AllocateDescriptorSet(_vkBaseDescriptorSets, _vkBaseDescriptorSetLayout);
 }
 
-void Renderer::CreatePostDescriptorSet()
+void Renderer::CreatePostDescriptorTemplate()
 {
-	GDescriptorManager->AddDescriptorSetLayoutBinding(
-		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-		VK_SHADER_STAGE_FRAGMENT_BIT,
-		0, // binding point
-		1  // count
-	);
-
-	GDescriptorManager->CreateDescriptorSetLayout(_vkPostDescriptorSetLayout);
-	GDescriptorManager->AllocateDescriptorSet(_vkPostDescriptorSets, _vkPostDescriptorSetLayout);
+	// combined image sampler of offscreen color (set 0, reflected from post fragment shader)
+	_vkPostDescriptorSetLayout = _mkPostPipeline.GetDescriptorSetLayout(0);
+
+	// update template matching post set layout (image info at offset 0)
+	VkDescriptorUpdateTemplateEntry entry{};
+	entry.dstBinding      = 0;
+	entry.dstArrayElement = 0;
+	entry.descriptorCount = 1;
+	entry.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	entry.offset          = 0;
+	entry.stride          = sizeof(VkDescriptorImageInfo);
+	_postDescriptorTemplate = GDescriptorManager->AcquireDescriptorUpdateTemplate(_vkPostDescriptorSetLayout, { entry });
 }
 
 void Renderer::CreateOffscreenRenderResource(VkExtent2D extent)
 {
-	if (_vkOffscreenColorImage.image != VK_NULL_HANDLE)
+	// release graph of previous extent (transient images, their views and shared memory blocks)
+	_renderGraph.Reset();
+
+	// create offscreen color sampler
+	if (_vkOffscreenColorSampler == VK_NULL_HANDLE)
 	{
-		GAllocator->DestroyImage(_vkOffscreenColorImage);
-		vkDestroyImageView(_mkDevice.GetDevice(), _vkOffscreenColorImageView, nullptr);
-		vkDestroySampler(_mkDevice.GetDevice(), _vkOffscreenColorSampler, nullptr);
+		mk::vk::CreateSampler(_mkDevice.GetDevice(), &_vkOffscreenColorSampler, _vkDeviceProperties);
 	}
 
-	if (_vkOffscreenDepthImage.image != VK_NULL_HANDLE)
+	auto vkCmdBeginRenderingKHR = (PFN_vkCmdBeginRenderingKHR)vkGetInstanceProcAddr(_mkInstance.GetVkInstance(), "vkCmdBeginRenderingKHR");
+	auto vkCmdEndRenderingKHR = (PFN_vkCmdEndRenderingKHR)vkGetInstanceProcAddr(_mkInstance.GetVkInstance(), "vkCmdEndRenderingKHR");
+	if (!vkCmdBeginRenderingKHR || !vkCmdEndRenderingKHR)
 	{
-		GAllocator->DestroyImage(_vkOffscreenDepthImage);
-		vkDestroyImageView(_mkDevice.GetDevice(), _vkOffscreenDepthImageView, nullptr);
+		throw std::runtime_error("Unable to dynamically load vkCmdBeginRenderingKHR and vkCmdEndRenderingKHR");
 	}
 
 	/**
-	* specify color image usage
-	* - transfer source : for copying image to other image
-	* - transfer destination : for copying image from other image
-	* - color attachment : framebuffer resolver
-	* - sampled image : make image view suitable for texture sampling
-	* - storage image : make image view suitable for storage image
+	* declare graph resources
+	* - offscreen color : written by offscreen pass, sampled by post pass
+	* - motion vector   : written by offscreen pass with temporal aa, sampled by temporal resolve
+	* - offscreen depth : only alive in offscreen pass, so it gets lazily allocated memory when the device exposes it
+	* - msaa color / motion vector : with msaa, multisampled attachments resolved into the images above at the end of offscreen pass.
+	*                     They are never stored, so they are lazily allocated like depth and stay in tile memory on tilers.
+	* - swapchain color : imported every frame, handed over to present. Post pass only covers it with a fullscreen triangle,
+	*                     so it has no depth attachment and doesn't load the previous contents.
+	* Usages, layouts and barriers are derived from pass declarations. Offscreen color and depth overlap in offscreen pass,
+	* so they never share memory. Images of post passes (bloom, ldr color) share blocks with images that are dead by then,
+	* e.g. bloom blur y reuses the memory of bloom prefilter.
 	*/
-	bool isTransferRequired = false;
-	VkImageUsageFlags transferUsages = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-	VkImageUsageFlags colorImageUsages = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
-	VkImageUsageFlags depthImageUsages = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-	if (isTransferRequired)
+	VkImageUsageFlags colorExtraUsages = 0;
+	if (mk::vk::IsFormatFeatureSupported(_mkDevice.GetPhysicalDevice(), _vkOffscreenColorFormat, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT))
 	{
-		colorImageUsages |= transferUsages;
-		depthImageUsages |= transferUsages;
+		colorExtraUsages |= VK_IMAGE_USAGE_STORAGE_BIT; // packed formats(e.g. B10G11R11) may not support storage image
 	}
+	VkImageAspectFlags depthAspectFlags = (_vkOffscreenDepthFormat >= VK_FORMAT_D16_UNORM_S8_UINT) ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
 
-	// create color image
-	GAllocator->CreateImage(
-		&_vkOffscreenColorImage,
-		extent.width, extent.height,
-		_vkOffscreenColorFormat,
-		VK_IMAGE_TILING_OPTIMAL,
-		colorImageUsages, // for storage image, sampler and framebuffer resolver
-		VMA_MEMORY_USAGE_GPU_ONLY,
-		VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		"offscreen color image"
-	);
+	// offscreen images are smaller than the swapchain with a render scale
+	auto sceneExtent    = GetSceneExtent();
+	auto offscreenColor = _renderGraph.CreateImage({ "offscreen color image", sceneExtent.width, sceneExtent.height, _vkOffscreenColorFormat, VK_IMAGE_ASPECT_COLOR_BIT, colorExtraUsages });
+	auto offscreenDepth = _renderGraph.CreateImage({ "offscreen depth image", sceneExtent.width, sceneExtent.height, _vkOffscreenDepthFormat, depthAspectFlags, 0, _vkMsaaSampleCount });
+	MKRenderGraph::ResourceHandle motionVector = 0;
+	if (_isTemporalAAEnabled)
+		motionVector = _renderGraph.CreateImage({ "motion vector image", sceneExtent.width, sceneExtent.height, _vkMotionVectorFormat, VK_IMAGE_ASPECT_COLOR_BIT });
+
+	bool isMultisampled = _vkMsaaSampleCount != VK_SAMPLE_COUNT_1_BIT;
+	MKRenderGraph::ResourceHandle msaaColor        = 0;
+	MKRenderGraph::ResourceHandle msaaMotionVector = 0;
+	if (isMultisampled)
+	{
+		msaaColor = _renderGraph.CreateImage({ "msaa color image", sceneExtent.width, sceneExtent.height, _vkOffscreenColorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 0, _vkMsaaSampleCount });
+		if (_isTemporalAAEnabled)
+			msaaMotionVector = _renderGraph.CreateImage({ "msaa motion vector image", sceneExtent.width, sceneExtent.height, _vkMotionVectorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 0, _vkMsaaSampleCount });
+	}
 
-	// create color image view
-	mk::vk::CreateImageView(
-		_mkDevice.GetDevice(),
-		_vkOffscreenColorImage.image,
-		_vkOffscreenColorImageView,
-		VK_IMAGE_VIEW_TYPE_2D,
-		_vkOffscreenColorFormat,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		VK_REMAINING_MIP_LEVELS
+	// acquire semaphore is waited at the first stage writing the swapchain, so the first write of swapchain color chains after it
+	_vkSwapchainAcquireStage = _isComputePostEnabled ? VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+	_swapchainColorHandle = _renderGraph.ImportImage(
+		{ "swapchain color image", extent.width, extent.height, _mkSwapchain.GetSwapchainImageFormat(), VK_IMAGE_ASPECT_COLOR_BIT },
+		{ VK_IMAGE_LAYOUT_UNDEFINED, _vkSwapchainAcquireStage, VK_ACCESS_2_NONE },
+		{ VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE } // present waits on the render finished semaphore
 	);
 
-	// create offscreen color sampler
-	mk::vk::CreateSampler(_mkDevice.GetDevice(), &_vkOffscreenColorSampler, _vkDeviceProperties);
+	const auto clearColor = glm::vec4(0.01f, 0.01f, 0.01f, 1.f); // settings for VK_ATTACHMENT_LOAD_OP_CLEAR in color attachment
+	VkClearValue colorClearValue = { {clearColor[0], clearColor[1], clearColor[2], clearColor[3]} };
+	VkClearValue depthClearValue = { 1.0f, 0 };
 
-	// create offscreen color sampler
-	if (_vkOffscreenColorSampler == VK_NULL_HANDLE)
-	{
-		mk::vk::CreateSampler(_mkDevice.GetDevice(), &_vkOffscreenColorSampler, _vkDeviceProperties);
-	}
+	// ----------- offscreen rendering ------------
+	auto offscreenPass = _renderGraph.AddPass("offscreen", [=, this](VkCommandBuffer commandBuffer) {
+		auto renderExtent = GetRenderExtent(); // top left region of the offscreen images with dynamic resolution
 
-	// create depth image
-	GAllocator->CreateImage(
-		&_vkOffscreenDepthImage,
-		extent.width, extent.height,
-		_vkOffscreenDepthFormat,
-		VK_IMAGE_TILING_OPTIMAL,
-		depthImageUsages,
-		VMA_MEMORY_USAGE_GPU_ONLY,
-		VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		"offscreen depth image"
-	);
+		/**
+		* color attachments
+		* - without msaa, the single sample image is rendered and stored.
+		* - with msaa, the multisampled image is rendered and resolved into the single sample image when rendering ends.
+		*   Its samples are discarded instead of stored, so the resolve doesn't need a separate pass reading them back.
+		* - color is averaged. Motion vectors take sample zero, since the average of two surfaces' motions belongs to neither of them.
+		*/
+		auto getColorAttachmentInfo = [&](MKRenderGraph::ResourceHandle target, MKRenderGraph::ResourceHandle multisampled, VkClearValue clearValue, VkResolveModeFlagBits resolveMode) {
+			VkRenderingAttachmentInfoKHR attachmentInfo = mk::vkinfo::GetRenderingAttachmentInfoKHR();
+			attachmentInfo.imageLayout = MKRenderGraph::GetUsageLayout(ERenderGraphUsage::COLOR_ATTACHMENT);
+			attachmentInfo.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachmentInfo.clearValue  = clearValue;
+			if (isMultisampled)
+			{
+				attachmentInfo.imageView          = _renderGraph.GetImageView(multisampled);
+				attachmentInfo.resolveMode        = resolveMode;
+				attachmentInfo.resolveImageView   = _renderGraph.GetImageView(target);
+				attachmentInfo.resolveImageLayout = MKRenderGraph::GetUsageLayout(ERenderGraphUsage::COLOR_ATTACHMENT);
+				attachmentInfo.storeOp            = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			}
+			else
+			{
+				attachmentInfo.imageView   = _renderGraph.GetImageView(target);
+				attachmentInfo.resolveMode = VK_RESOLVE_MODE_NONE;
+				attachmentInfo.storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
+			}
+			return attachmentInfo;
+		};
 
-	// create depth image view
-	VkImageAspectFlags depthAspectFlags = (_vkOffscreenDepthFormat >= VK_FORMAT_D16_UNORM_S8_UINT) ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+		std::array<VkRenderingAttachmentInfoKHR, 2> colorAttachmentInfos;
+		colorAttachmentInfos[0] = getColorAttachmentInfo(offscreenColor, msaaColor, colorClearValue, VK_RESOLVE_MODE_AVERAGE_BIT);
 
-	mk::vk::CreateImageView(
-		_mkDevice.GetDevice(),
-		_vkOffscreenDepthImage.image,
-		_vkOffscreenDepthImageView,
-		VK_IMAGE_VIEW_TYPE_2D,
-		_vkOffscreenDepthFormat,
-		depthAspectFlags,
-		1, // mip levels
-		1  // layer count
-	);
+		// background has no motion, so the clear value reprojects it onto itself. Integer format resolves with sample zero only
+		if (_isTemporalAAEnabled)
+		{
+			VkClearValue motionClearValue{};
+			motionClearValue.color.int32[0] = 0;
+			motionClearValue.color.int32[1] = 0;
+			colorAttachmentInfos[1] = getColorAttachmentInfo(motionVector, msaaMotionVector, motionClearValue, VK_RESOLVE_MODE_SAMPLE_ZERO_BIT);
+		}
 
-	// record transition image layout commands
-	VkCommandPool cmdPool;
-	GCommandService->CreateCommandPool(&cmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
-	VkCommandBuffer commandBufferfer;
-	GCommandService->BeginSingleTimeCommands(commandBufferfer, cmdPool);
+		VkRenderingAttachmentInfoKHR depthAttachmentInfo = mk::vkinfo::GetRenderingAttachmentInfoKHR();
+		depthAttachmentInfo.imageView   = _renderGraph.GetImageView(offscreenDepth);
+		depthAttachmentInfo.imageLayout = MKRenderGraph::GetUsageLayout(ERenderGraphUsage::DEPTH_ATTACHMENT);
+		depthAttachmentInfo.resolveMode = VK_RESOLVE_MODE_NONE;
+		depthAttachmentInfo.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depthAttachmentInfo.storeOp     = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depthAttachmentInfo.clearValue  = depthClearValue;
 
-	mk::vk::TransitionImageLayout(
-		commandBufferfer,
-		_vkOffscreenColorImage.image,
-		_vkOffscreenColorFormat,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_GENERAL,
-		{ VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS }
-	);
+		auto renderArea = VkRect2D{ VkOffset2D{}, renderExtent };
+		auto renderInfo = mk::vkinfo::GetRenderingInfoKHR(renderArea, GetOffscreenColorAttachmentCount(), colorAttachmentInfos.data());
+		renderInfo.layerCount = 1;
+		renderInfo.pDepthAttachment = &depthAttachmentInfo;
+		if (!IsDepthOnlyFormat(_vkOffscreenDepthFormat))
+		{
+			renderInfo.pStencilAttachment = &depthAttachmentInfo; // if the depth format includes stencil, then use it as stencil attachment
+		}
 
-	mk::vk::TransitionImageLayout(
-		commandBufferfer,
-		_vkOffscreenDepthImage.image,
-		_vkOffscreenDepthFormat,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-		{ depthAspectFlags, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS }
-	);
+		// large scenes are split across recording threads and merged with vkCmdExecuteCommands
+		uint32 rasterTaskCount = GetRasterTaskCount();
+		if (rasterTaskCount > 1)
+		{
+			renderInfo.flags |= VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR;
+			vkCmdBeginRenderingKHR(commandBuffer, &renderInfo);
+			RasterizeParallel(commandBuffer, renderExtent, rasterTaskCount);
+		}
+		else
+		{
+			vkCmdBeginRenderingKHR(commandBuffer, &renderInfo);
+			Rasterize(commandBuffer, renderExtent);
+		}
+		vkCmdEndRenderingKHR(commandBuffer);
+
+		WriteFrameTimestamp(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, SCENE_END);
+		WriteFrameTimestamp(commandBuffer, _vkSwapchainAcquireStage, OUTPUT_BEGIN);
+	});
+	offscreenPass
+		.Write(offscreenColor, ERenderGraphUsage::COLOR_ATTACHMENT)
+		.Write(offscreenDepth, ERenderGraphUsage::DEPTH_ATTACHMENT);
+	if (_isTemporalAAEnabled)
+		offscreenPass.Write(motionVector, ERenderGraphUsage::COLOR_ATTACHMENT);
+
+	// resolve writes happen in color attachment output stage, so the single sample images above are declared as color attachments
+	// and the multisampled ones are written without readers (they live and die in this pass)
+	if (isMultisampled)
+		offscreenPass.Write(msaaColor, ERenderGraphUsage::COLOR_ATTACHMENT);
+	if (isMultisampled && _isTemporalAAEnabled)
+		offscreenPass.Write(msaaMotionVector, ERenderGraphUsage::COLOR_ATTACHMENT);
+
+	// ----------- post pipeline rendering ------------
+	if (_isComputePostEnabled)
+	{
+		// post stack dispatches write the swapchain image directly, no attachment is loaded, cleared or stored
+		_postProcessStack.AddPasses(_renderGraph, { offscreenColor, motionVector, sceneExtent }, _swapchainColorHandle, extent);
+	}
+	else
+	{
+		_renderGraph.AddPass("post", [=, this](VkCommandBuffer commandBuffer) {
+			auto swapchainExtent = _mkSwapchain.GetSwapchainExtent();
+
+			// fullscreen triangle overwrites every pixel, so the previous contents are neither loaded nor cleared
+			VkRenderingAttachmentInfo swapchainColorAttachmentInfo = mk::vkinfo::GetRenderingAttachmentInfoKHR();
+			swapchainColorAttachmentInfo.imageView   = _renderGraph.GetImageView(_swapchainColorHandle);
+			swapchainColorAttachmentInfo.imageLayout = MKRenderGraph::GetUsageLayout(ERenderGraphUsage::COLOR_ATTACHMENT);
+			swapchainColorAttachmentInfo.resolveMode = VK_RESOLVE_MODE_NONE;
+			swapchainColorAttachmentInfo.loadOp      = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			swapchainColorAttachmentInfo.storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
+
+			auto postRenderArea = VkRect2D{ VkOffset2D{}, swapchainExtent };
+			auto postRenderInfo = mk::vkinfo::GetRenderingInfoKHR(postRenderArea, 1, &swapchainColorAttachmentInfo);
+			postRenderInfo.layerCount = 1;
+
+			vkCmdBeginRenderingKHR(commandBuffer, &postRenderInfo);
+			DrawPostProcess(commandBuffer, swapchainExtent);
+			vkCmdEndRenderingKHR(commandBuffer);
+		})
+			.Read(offscreenColor, ERenderGraphUsage::SAMPLED_FRAGMENT)
+			.Write(_swapchainColorHandle, ERenderGraphUsage::COLOR_ATTACHMENT);
+	}
+
+	// cull passes, place transient images on memory blocks and derive barriers
+	_renderGraph.Compile();
+
+	_vkOffscreenColorImage.image  = _renderGraph.GetImage(offscreenColor);
+	_vkOffscreenColorImage.format = _vkOffscreenColorFormat;
+	_vkOffscreenColorImageView    = _renderGraph.GetImageView(offscreenColor);
+	_vkOffscreenDepthImage.image  = _renderGraph.GetImage(offscreenDepth);
+	_vkOffscreenDepthImage.format = _vkOffscreenDepthFormat;
+	_vkOffscreenDepthImageView    = _renderGraph.GetImageView(offscreenDepth);
 
-	GCommandService->EndSingleTimeCommands(commandBufferfer, cmdPool);
+	// post pass samples offscreen color in the layout the graph transitions it to
+	_vkOffscreenColorDescriptorInfo.sampler     = _vkOffscreenColorSampler;
+	_vkOffscreenColorDescriptorInfo.imageView   = _vkOffscreenColorImageView;
+	_vkOffscreenColorDescriptorInfo.imageLayout = MKRenderGraph::GetUsageLayout(ERenderGraphUsage::SAMPLED_FRAGMENT);
 }
 
 void Renderer::CreateOffscreenRenderPass(VkExtent2D extent)
 {
 	if (_vkOffscreenColorImage.image != VK_NULL_HANDLE)
 	{
-		GAllocator->DestroyImage(_vkOffscreenColorImage);
 		vkDestroyImageView(_mkDevice.GetDevice(), _vkOffscreenColorImageView, nullptr);
 		vkDestroySampler(_mkDevice.GetDevice(), _vkOffscreenColorSampler, nullptr);
 	}
 
 	if (_vkOffscreenDepthImage.image != VK_NULL_HANDLE)
 	{
-		GAllocator->DestroyImage(_vkOffscreenDepthImage);
 		vkDestroyImageView(_mkDevice.GetDevice(), _vkOffscreenDepthImageView, nullptr);
 	}
 
+	// release offscreen attachments of previous extent (images and their shared memory blocks)
+	_transientAllocator.Reset();
+
 	/**
 	* specify color image usage
 	* - transfer source : for copying image to other image
@@ -458,21 +717,38 @@ void Renderer::CreateOffscreenRenderPass(VkExtent2D extent)
 	* - storage image : make image view suitable for storage image
 	*/
 	auto transferUsages = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-	auto colorImageUsages = transferUsages | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+	auto colorImageUsages = transferUsages | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 	auto depthImageUsages = transferUsages | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	if (mk::vk::IsFormatFeatureSupported(_mkDevice.GetPhysicalDevice(), _vkOffscreenColorFormat, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT))
+	{
+		colorImageUsages |= VK_IMAGE_USAGE_STORAGE_BIT;
+	}
 
-	// create color image
-	GAllocator->CreateImage(
-		&_vkOffscreenColorImage,
+	/**
+	* request offscreen attachments to transient allocator
+	* - both are alive in offscreen pass, so each gets its own block. Nothing in this path has a disjoint lifetime to alias with.
+	* - depth is created with transfer usages, which rule out transient attachment usage and lazily allocated memory.
+	*/
+	uint32 colorImageHandle = _transientAllocator.RequestImage({
 		extent.width, extent.height,
-		_vkOffscreenColorFormat, 
-		VK_IMAGE_TILING_OPTIMAL, 
+		_vkOffscreenColorFormat,
 		colorImageUsages, // for storage image, sampler and framebuffer resolver
-		VMA_MEMORY_USAGE_GPU_ONLY,
-		VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
-		VK_IMAGE_LAYOUT_UNDEFINED,
+		ERenderPassIndex::OFFSCREEN_PASS,
+		ERenderPassIndex::POST_PASS,
 		"offscreen color image"
-	);
+	});
+	uint32 depthImageHandle = _transientAllocator.RequestImage({
+		extent.width, extent.height,
+		_vkOffscreenDepthFormat,
+		depthImageUsages,
+		ERenderPassIndex::OFFSCREEN_PASS,
+		ERenderPassIndex::OFFSCREEN_PASS,
+		"offscreen depth image"
+	});
+
+	_transientAllocator.Build();
+	_vkOffscreenColorImage = _transientAllocator.GetImage(colorImageHandle);
+	_vkOffscreenDepthImage = _transientAllocator.GetImage(depthImageHandle);
 	
 	// create color image view
 	mk::vk::CreateImageView(
@@ -491,20 +767,7 @@ void Renderer::CreateOffscreenRenderPass(VkExtent2D extent)
 		mk::vk::CreateSampler(_mkDevice.GetDevice(), &_vkOffscreenColorSampler, _vkDeviceProperties);
 	}
 	
-	// create depth image
-	GAllocator->CreateImage(
-		&_vkOffscreenDepthImage,
-		extent.width, extent.height,
-		_vkOffscreenDepthFormat,
-		VK_IMAGE_TILING_OPTIMAL,
-		depthImageUsages,
-		VMA_MEMORY_USAGE_GPU_ONLY,
-		VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		"offscreen depth image"
-	);
-
-	// create color image view
+	// create depth image view
 	mk::vk::CreateImageView(
 		_mkDevice.GetDevice(),
 		_vkOffscreenDepthImage.image,
@@ -516,31 +779,28 @@ void Renderer::CreateOffscreenRenderPass(VkExtent2D extent)
 		1  // layer count
 	);
 
-	// record transition image layout commands
-	VkCommandPool cmdPool;
-	GCommandService->CreateCommandPool(&cmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
-	VkCommandBuffer commandBufferfer;
-	GCommandService->BeginSingleTimeCommands(commandBufferfer, cmdPool);
-
-	mk::vk::TransitionImageLayout(
-		commandBufferfer,
-		_vkOffscreenColorImage.image,
-		_vkOffscreenColorFormat,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_GENERAL,
-		{ VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS }
-	);
-
-	mk::vk::TransitionImageLayout(
-		commandBufferfer,
-		_vkOffscreenDepthImage.image,
-		_vkOffscreenDepthFormat,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-		{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS }
-	);
+	// transition both attachments with one barrier call
+	GCommandService->ExecuteSingleTimeCommands([&](VkCommandBuffer commandBuffer) {
+		BarrierBatch barrierBatch;
+		barrierBatch.AddImageTransition(
+			_vkOffscreenColorImage.image,
+			{ VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS },
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_GENERAL
+		);
+		barrierBatch.AddImageTransition(
+			_vkOffscreenDepthImage.image,
+			{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS },
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+		);
+		barrierBatch.Flush(commandBuffer);
+	});
 
-	GCommandService->EndSingleTimeCommands(commandBufferfer, cmdPool);
+	// offscreen render pass keeps color in general layout
+	_vkOffscreenColorDescriptorInfo.sampler     = _vkOffscreenColorSampler;
+	_vkOffscreenColorDescriptorInfo.imageView   = _vkOffscreenColorImageView;
+	_vkOffscreenColorDescriptorInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 
 	// create offscreen render pass
 	if (_vkOffscreenRednerPass == VK_NULL_HANDLE)
@@ -569,18 +829,28 @@ void Renderer::CreateOffscreenRenderPass(VkExtent2D extent)
 	MK_CHECK(vkCreateFramebuffer(_mkDevice.GetDevice(), &framebufferInfo, nullptr, &_vkOffscreenFramebuffer));
 }
 
-void Renderer::CreateSamplerDescriptorSet()
+void Renderer::CreateTimestampQueryPool()
 {
-	// single sampler descriptor
-	GDescriptorManager->AddDescriptorSetLayoutBinding(
-		VK_DESCRIPTOR_TYPE_SAMPLER,
-		VK_SHADER_STAGE_FRAGMENT_BIT,
-		EFragmentShaderBinding::SAMPLER,
-		1
-	);
+	// scene and output segments (begin, end) per frame slot
+	if (!_vkDeviceProperties.limits.timestampComputeAndGraphics)
+	{
+#ifndef NDEBUG
+		MK_LOG("timestamp queries are not supported on graphics queue, gpu frame time is not measured");
+#endif
+		return;
+	}
 
-	// create sampler descriptor set layout based on waiting bindings
-	GDescriptorManager->CreateDescriptorSetLayout(_vkSamplerDescriptorSetLayout);
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	queryPoolInfo.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = MAX_FRAMES_IN_FLIGHT * FRAME_TIMESTAMP_COUNT;
+	MK_CHECK(vkCreateQueryPool(_mkDevice.GetDevice(), &queryPoolInfo, nullptr, &_vkTimestampQueryPool));
+}
+
+void Renderer::CreateSamplerDescriptorSet()
+{
+	// single sampler descriptor (set 1, reflected from fragment shader)
+	_vkSamplerDescriptorSetLayout = _mkGraphicsPipeline.GetDescriptorSetLayout(1);
 
 	// allocate sampler descriptor set
 	GDescriptorManager->AllocateDescriptorSet(_vkSamplerDescriptorSets, _vkSamplerDescriptorSetLayout);
@@ -596,7 +866,7 @@ void Renderer::CreateUniformBuffers()
 		GAllocator->CreateBuffer(
 			&_vkUniformBuffers[it],
 			perUniformBufferSize,
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, // descriptor buffer references it by address
 			VMA_MEMORY_USAGE_CPU_TO_GPU,
 			VMA_ALLOCATION_CREATE_MAPPED_BIT,
 			"uniform buffer(" + std::to_string(it) + ")"
@@ -616,14 +886,10 @@ void Renderer::CreatePushConstantRaster()
 #endif
 	_vkPushConstantRaster.lightIntensity = 1.0f;
 	_vkPushConstantRaster.lightType = LightType::POINT_LIGHT;
+	_vkPushConstantRaster.materialBufferIndex = 0; // assigned by bindless table if it is enabled
+	_vkPushConstantRaster.materialIndex = 0;
 
-	// create push constant range and insert it into ranges
-	VkPushConstantRange pushConstantRange{};
-	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-	pushConstantRange.offset = 0;
-	pushConstantRange.size = sizeof(VkPushConstantRaster);
-
-	_vkPushConstantRanges.push_back(pushConstantRange);
+	// push constant range is reflected by graphics pipeline
 }
 
 /**
@@ -631,20 +897,24 @@ void Renderer::CreatePushConstantRaster()
 */
 void Renderer::DestroyOffscreenRenderingResources()
 {
-	// destroy offscreen color image
-	GAllocator->DestroyImage(_vkOffscreenColorImage);
-
-	// destroy offscreen color image view
-	vkDestroyImageView(_mkDevice.GetDevice(), _vkOffscreenColorImageView, nullptr);
-
 	// destroy offscreen color sampler
 	vkDestroySampler(_mkDevice.GetDevice(), _vkOffscreenColorSampler, nullptr);
 
-	// destroy offscreen depth image
-	GAllocator->DestroyImage(_vkOffscreenDepthImage);
+	if (_mkDevice.enableDynamicRendering)
+	{
+		// offscreen color and depth images with their views are owned by the render graph
+		_renderGraph.Reset();
+		return;
+	}
+
+	// destroy offscreen color image view
+	vkDestroyImageView(_mkDevice.GetDevice(), _vkOffscreenColorImageView, nullptr);
 
 	// destroy offscreen depth image view
 	vkDestroyImageView(_mkDevice.GetDevice(), _vkOffscreenDepthImageView, nullptr);
+
+	// destroy offscreen color and depth images with their memory blocks
+	_transientAllocator.Reset();
 }
 
 void Renderer::DestroyOffscreenRenderPassResources()
@@ -671,6 +941,13 @@ void Renderer::UpdateUniformBuffer()
 	UniformBufferObject ubo{};
 
 #ifdef USE_HLSL
+	// sub-pixel jitter of this frame, the temporal resolve accumulates the shifted samples
+	if (_isTemporalAAEnabled)
+	{
+		auto jitter = _postProcessStack.AdvanceJitter(GetRenderExtent());
+		_camera.SetProjectionJitter(jitter.x, jitter.y);
+	}
+
 	auto projViewMat = _camera.GetProjectionMatrix() * _camera.GetViewMatrix();
 
 	// initialize model transformation
@@ -678,6 +955,11 @@ void Renderer::UpdateUniformBuffer()
 
 	// Because SIMD operation is supported, i did multiplication in application side, not in shader side.
 	ubo.mvpMat = projViewMat * modelMat;
+
+	// motion vectors compare unjittered positions, otherwise the jitter itself would be reprojected
+	ubo.currentMvpMat  = _camera.GetUnjitteredProjectionMatrix() * _camera.GetViewMatrix() * modelMat;
+	ubo.previousMvpMat = _timer.frameCount > 0 ? _previousMvpMat : ubo.currentMvpMat;
+	_previousMvpMat    = ubo.currentMvpMat;
 #else
 	// fill out uniform buffer object members
 	ubo.modelMat = _objModel.GetModelMatrix();
@@ -703,28 +985,34 @@ void Renderer::WriteBaseDescriptor()
 			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER     // descriptor type
 		);
 
-		// texture image descriptor
-		// - store a set of image infos to write at once
-		std::vector<VkDescriptorImageInfo> imageInfos; 
-		for (size_t tex_it = 0; tex_it < _objModel.textures.size(); tex_it++) 
+		// texture image descriptor (textures live in bindless table when it is enabled)
+		if (!_isBindlessEnabled)
 		{
-			VkDescriptorImageInfo imageInfo{};
-			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			imageInfo.imageView   = _objModel.textures[tex_it]->imageView;
-			imageInfo.sampler     = nullptr;
-			imageInfos.push_back(imageInfo);
+			// - store a set of image infos to write at once
+			std::vector<VkDescriptorImageInfo> imageInfos; 
+			for (size_t tex_it = 0; tex_it < _objModel.textures.size(); tex_it++) 
+			{
+				VkDescriptorImageInfo imageInfo{};
+				imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+				imageInfo.imageView   = _objModel.textures[tex_it]->imageView;
+				imageInfo.sampler     = nullptr;
+				imageInfos.push_back(imageInfo);
+			}
+			// - call image array write api 
+			GDescriptorManager->WriteImageArrayToDescriptorSet(
+				imageInfos.data(),
+				static_cast<uint32>(imageInfos.size()),
+				EFragmentShaderBinding::TEXTURE,
+				VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE
+			);
 		}
-		// - call image array write api 
-		GDescriptorManager->WriteImageArrayToDescriptorSet(
-			imageInfos.data(),
-			static_cast<uint32>(imageInfos.size()),
-			EFragmentShaderBinding::TEXTURE,
-			VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE
-		);
 
-		// update base descriptor set per frame
-		GDescriptorManager->UpdateDescriptorSet(_vkBaseDescriptorSets[it]);
+		// stage base descriptor set per frame
+		GDescriptorManager->StageDescriptorSet(_vkBaseDescriptorSets[it]);
 	}
+
+	// update every frame's set at once
+	GDescriptorManager->FlushDescriptorWrites();
 }
 
 void Renderer::WriteSamplerDescriptor()
@@ -738,24 +1026,11 @@ void Renderer::WriteSamplerDescriptor()
 			VK_DESCRIPTOR_TYPE_SAMPLER
 		);
 
-		// update sampler descriptor set
-		GDescriptorManager->UpdateDescriptorSet(_vkSamplerDescriptorSets[it]);
+		// stage sampler descriptor set
+		GDescriptorManager->StageDescriptorSet(_vkSamplerDescriptorSets[it]);
 	}
-}
-
-void Renderer::WritePostDescriptor()
-{
-	for (size_t it = 0; it < MAX_FRAMES_IN_FLIGHT; it++)
-	{
-		GDescriptorManager->WriteCombinedImageSamplerToDescriptorSet(
-			_vkOffscreenColorImageView,
-			_vkOffscreenColorSampler,
-			VK_IMAGE_LAYOUT_GENERAL,
-			0
-		);
 
-		GDescriptorManager->UpdateDescriptorSet(_vkPostDescriptorSets[it]);
-	}
+	GDescriptorManager->FlushDescriptorWrites();
 }
 
 void Renderer::Update()
@@ -764,13 +1039,39 @@ void Renderer::Update()
 	_timer.Update();
 
 	// update input states
+	_frameInputTime = std::chrono::steady_clock::now();
 	_inputController.Update(_timer.deltaTime);
 
 	// update camera
 	_camera.UpdateViewTarget();
 
-	// update uniform buffer object
-	UpdateUniformBuffer();
+	// rebuild pipelines whose shaders were recompiled
+	ReloadChangedShaders();
+}
+
+void Renderer::ReloadChangedShaders()
+{
+	bool isReloaded = false;
+	for (const auto& spirvPath : _shaderHotReloader.ConsumeReloadedShaders())
+	{
+		try
+		{
+			isReloaded |= GPipelineRegistry->ReloadShaderModule(spirvPath);
+		}
+		catch (const std::exception& e)
+		{
+			MK_LOG(fmt::format("failed to reload {} : {}", spirvPath, e.what()));
+		}
+	}
+
+	if (!isReloaded)
+		return;
+
+	// pipelines keep drawing with previous shaders until their rebuild is done
+	_mkGraphicsPipeline.RefreshShaderModules();
+	_mkPostPipeline.RefreshShaderModules();
+	if (_isComputePostEnabled)
+		_postProcessStack.RefreshShaderModules();
 }
 
 void Renderer::OnResizeWindow()
@@ -794,7 +1095,6 @@ void Renderer::OnResizeWindow()
 	// recreate swapchain
 	_mkSwapchain.CreateSwapchain();
 	_mkSwapchain.CreateSwapchainImageViews();
-	_mkSwapchain.CreateDepthResources();
 
 	// recreate swapchain frame buffer
 	CreateFrameBuffers();
@@ -809,8 +1109,37 @@ void Renderer::OnResizeWindow()
 	{ // DEPRECATED
 		CreateOffscreenRenderPass(extent);
 	}
-	// update post descriptor set because combined image sampler is dependent on offscreen color image view
-	WritePostDescriptor();
+	// post descriptor set picks up the new offscreen color image view on the next frame (transient set)
+
+	// present ids are counted per swapchain
+	_presentId = 0;
+	_latencyStatistics.pendingPresentId = 0;
+}
+
+void Renderer::WaitForLastPresent()
+{
+	const MKDevice::PresentWaitSupport& presentWait = _mkDevice.GetPresentWaitSupport();
+	if (!presentWait.isSupported || _presentId == 0)
+		return;
+
+	// block until the previous frame is on screen, so that no more than one frame waits for the display.
+	// a timeout keeps minimized or occluded windows from stalling forever.
+	constexpr uint64 presentWaitTimeout = 100'000'000; // 100 ms in nanoseconds
+	VkResult result = presentWait.pfnWaitForPresent(_mkDevice.GetDevice(), _mkSwapchain.GetSwapchain(), _presentId, presentWaitTimeout);
+	if (result == VK_TIMEOUT || result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+		return; // swapchain recreation is handled by acquire and present
+	else if (result != VK_SUCCESS)
+		MK_THROW(fmt::format("failed to wait for present : {}", string_VkResult(result)));
+
+	// returning right after the present is an upper bound of the time the image reached the screen
+	if (_latencyStatistics.pendingPresentId == _presentId)
+	{
+		auto presentTime = std::chrono::steady_clock::now();
+		_latencyStatistics.lastLatency         = std::chrono::duration<double, std::chrono::milliseconds::period>(presentTime - _latencyStatistics.pendingInputTime).count();
+		_latencyStatistics.accumulatedLatency += _latencyStatistics.lastLatency;
+		_latencyStatistics.sampleCount++;
+		_latencyStatistics.pendingPresentId    = 0;
+	}
 }
 
 void Renderer::CopyBufferToBuffer(VkBufferAllocated src, VkBufferAllocated dst, VkDeviceSize sz)
@@ -827,6 +1156,78 @@ void Renderer::CopyBufferToBuffer(VkBufferAllocated src, VkBufferAllocated dst,
 ----------------- Draw -----------------
 */
 void Renderer::Rasterize(const VkCommandBuffer& commandBuffer, VkExtent2D extent)
+{
+	RecordRasterCommands(commandBuffer, extent, _mkGraphicsPipeline.GetPipeline(), 0, static_cast<uint32>(_objModel.indices.size()));
+}
+
+void Renderer::RasterizeParallel(const VkCommandBuffer& commandBuffer, VkExtent2D extent, uint32 taskCount)
+{
+	// resolve pipeline on this thread, GetPipeline() may swap in a rebuilt pipeline
+	VkPipeline pipeline = _mkGraphicsPipeline.GetPipeline();
+
+	// triangle aligned index ranges, the last task takes the remainder
+	uint32 indexCount     = static_cast<uint32>(_objModel.indices.size());
+	uint32 indicesPerTask = (indexCount / taskCount) / 3 * 3;
+
+	// secondaries inherit attachment formats of offscreen rendering
+	VkCommandBufferInheritanceRenderingInfoKHR renderingInheritance{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR };
+	renderingInheritance.colorAttachmentCount    = GetOffscreenColorAttachmentCount();
+	renderingInheritance.pColorAttachmentFormats = _vkOffscreenColorFormats.data();
+	renderingInheritance.depthAttachmentFormat   = _vkOffscreenDepthFormat;
+	renderingInheritance.stencilAttachmentFormat = IsDepthOnlyFormat(_vkOffscreenDepthFormat) ? VK_FORMAT_UNDEFINED : _vkOffscreenDepthFormat;
+	renderingInheritance.rasterizationSamples    = _vkMsaaSampleCount;
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+	inheritanceInfo.pNext = &renderingInheritance;
+
+	GCommandService->RecordSecondaryCommandBuffers(
+		_currentFrameIndex,
+		inheritanceInfo,
+		taskCount,
+		[&](VkCommandBuffer secondaryCommandBuffer, uint32 taskIndex) {
+			uint32 firstIndex = taskIndex * indicesPerTask;
+			uint32 count      = (taskIndex == taskCount - 1) ? indexCount - firstIndex : indicesPerTask;
+
+			GDescriptorManager->BindDescriptorBuffers(secondaryCommandBuffer); // descriptor buffer bindings are not inherited
+			RecordRasterCommands(secondaryCommandBuffer, extent, pipeline, firstIndex, count);
+		},
+		_vkSecondaryCommandBuffers
+	);
+
+	vkCmdExecuteCommands(commandBuffer, static_cast<uint32>(_vkSecondaryCommandBuffers.size()), _vkSecondaryCommandBuffers.data());
+}
+
+VkExtent2D Renderer::GetSceneExtent() const
+{
+	auto swapchainExtent = _mkSwapchain.GetSwapchainExtent();
+	return {
+		std::max(static_cast<uint32>(static_cast<float>(swapchainExtent.width) * _renderScale), 1u),
+		std::max(static_cast<uint32>(static_cast<float>(swapchainExtent.height) * _renderScale), 1u)
+	};
+}
+
+VkExtent2D Renderer::GetRenderExtent() const
+{
+	auto sceneExtent = GetSceneExtent();
+	if (!_dynamicResolution.isEnabled)
+		return sceneExtent;
+
+	return {
+		std::max(static_cast<uint32>(static_cast<float>(sceneExtent.width) * _dynamicResolution.scale), 1u),
+		std::max(static_cast<uint32>(static_cast<float>(sceneExtent.height) * _dynamicResolution.scale), 1u)
+	};
+}
+
+uint32 Renderer::GetRasterTaskCount() const
+{
+	if (!_isParallelRecordingEnabled || !_mkDevice.enableDynamicRendering)
+		return 1;
+
+	uint32 indexCount = static_cast<uint32>(_objModel.indices.size());
+	return std::clamp(indexCount / _minIndicesPerRecordTask, 1u, GCommandService->GetRecordingThreadCount());
+}
+
+void Renderer::RecordRasterCommands(const VkCommandBuffer& commandBuffer, VkExtent2D extent, VkPipeline pipeline, uint32 firstIndex, uint32 indexCount)
 {
 	// set viewport and scissor
 	VkViewport viewport{};
@@ -844,32 +1245,39 @@ void Renderer::Rasterize(const VkCommandBuffer& commandBuffer, VkExtent2D extent
 	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
 	// bind graphics pipeline
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _mkGraphicsPipeline.GetPipeline()); // bind graphics pipeline
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline); // bind graphics pipeline
+	_mkGraphicsPipeline.ApplyDynamicStates(commandBuffer);                      // set states which are not baked into the pipeline
 
 	// bind base descriptor sets
-	vkCmdBindDescriptorSets(
+	GDescriptorManager->BindDescriptorSet(
 		commandBuffer,
 		VK_PIPELINE_BIND_POINT_GRAPHICS,
 		_mkGraphicsPipeline.GetPipelineLayout(),
-		0,                                          // set index 0
-		1,
-		&_vkBaseDescriptorSets[_currentFrameIndex], // number of descriptor sets should fit into MAX_FRAMES_IN_FLIGHT
-		0,
-		nullptr
+		0,                                         // set index 0
+		_vkBaseDescriptorSets[_currentFrameIndex]  // number of descriptor sets should fit into MAX_FRAMES_IN_FLIGHT
 	);
 
 	// bind sampler descriptor set
-	vkCmdBindDescriptorSets(
+	GDescriptorManager->BindDescriptorSet(
 		commandBuffer,
 		VK_PIPELINE_BIND_POINT_GRAPHICS,
 		_mkGraphicsPipeline.GetPipelineLayout(),
-		1,                                             // set index 1
-		1,
-		&_vkSamplerDescriptorSets[_currentFrameIndex], // number of descriptor sets should fit into MAX_FRAMES_IN_FLIGHT
-		0,
-		nullptr
+		1,                                            // set index 1
+		_vkSamplerDescriptorSets[_currentFrameIndex]  // number of descriptor sets should fit into MAX_FRAMES_IN_FLIGHT
 	);
 
+	// bind global bindless table, every material of the frame is reachable through it
+	if (_isBindlessEnabled)
+	{
+		GDescriptorManager->BindDescriptorSet(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			_mkGraphicsPipeline.GetPipelineLayout(),
+			2,                                  // set index 2
+			_mkBindlessTable.GetDescriptorSet() // single set shared by every frame in flight
+		);
+	}
+
 	// bind push constants
 	uint32 pushConstantOffset = 0;
 	uint32 pushConstantSize = sizeof(VkPushConstantRaster);
@@ -889,7 +1297,7 @@ void Renderer::Rasterize(const VkCommandBuffer& commandBuffer, VkExtent2D extent
 	vkCmdBindIndexBuffer(commandBuffer, _vkIndexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32); // bind index buffer
 
 	// record draw command
-	vkCmdDrawIndexed(commandBuffer, _objModel.indices.size(), 1, 0, 0, 0);
+	vkCmdDrawIndexed(commandBuffer, indexCount, 1, firstIndex, 0, 0);
 }
 
 void Renderer::DrawPostProcess(const VkCommandBuffer& commandBuffer, VkExtent2D extent)
@@ -917,16 +1325,25 @@ void Renderer::DrawPostProcess(const VkCommandBuffer& commandBuffer, VkExtent2D
 		_mkPostPipeline.GetPipeline()
 	);
 
-	vkCmdBindDescriptorSets(
+	// transient set, released when this frame slot's fence is waited again
+	auto postDescriptorSet = GDescriptorManager->AllocateTransientDescriptorSet(_currentFrameIndex, _vkPostDescriptorSetLayout);
+	GDescriptorManager->UpdateDescriptorSetWithTemplate(postDescriptorSet, _postDescriptorTemplate, &_vkOffscreenColorDescriptorInfo);
+
+	GDescriptorManager->BindDescriptorSet(
 		commandBuffer,
 		VK_PIPELINE_BIND_POINT_GRAPHICS,
 		_mkPostPipeline.GetPipelineLayout(),
 		0,
-		1,
-		&_vkPostDescriptorSets[_currentFrameIndex],
-		0,
-		nullptr
+		postDescriptorSet
 	);
+
+	// offscreen images have the swapchain extent, only the rendered region is upscaled to it
+	auto renderExtent = GetRenderExtent();
+	VkPushConstantPost pushConstantPost{};
+	pushConstantPost.uvScale = glm::vec2(renderExtent.width, renderExtent.height) / glm::vec2(extent.width, extent.height);
+	pushConstantPost.uvMax   = (glm::vec2(renderExtent.width, renderExtent.height) - 0.5f) / glm::vec2(extent.width, extent.height);
+	vkCmdPushConstants(commandBuffer, _mkPostPipeline.GetPipelineLayout(), VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(VkPushConstantPost), &pushConstantPost);
+
 	vkCmdDraw(commandBuffer, 3, 1, 0, 0); // draw full quad
 }
 
@@ -943,6 +1360,13 @@ void Renderer::RecordFrameBufferCommands(uint32 swapchainImageIndex)
 
 	auto commandBuffer = *(GCommandService->GetCommandBuffer(_currentFrameIndex));
 	MK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+	GDescriptorManager->BindDescriptorBuffers(commandBuffer); // no-op on descriptor pool backend
+
+	// gpu time of this frame is read back once the slot is waited again
+	// the scene is held by the acquire wait too when both of them wait at color output, so it begins after the wait there
+	if (_vkTimestampQueryPool != VK_NULL_HANDLE)
+		vkCmdResetQueryPool(commandBuffer, _vkTimestampQueryPool, _currentFrameIndex * FRAME_TIMESTAMP_COUNT, FRAME_TIMESTAMP_COUNT);
+	WriteFrameTimestamp(commandBuffer, (_vkSwapchainAcquireStage == VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT) ? _vkSwapchainAcquireStage : VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, SCENE_BEGIN);
 
 	// 4. prepare render pass begin info
 	auto swapchainExtent = _mkSwapchain.GetSwapchainExtent(); // store swapchain extent for common usage.
@@ -950,109 +1374,18 @@ void Renderer::RecordFrameBufferCommands(uint32 swapchainImageIndex)
 	const auto clearColor = glm::vec4(0.01f, 0.01f, 0.01f, 1.f); // settings for VK_ATTACHMENT_LOAD_OP_CLEAR in color attachment
 	std::array<VkClearValue, 2> clearValues{};
 	clearValues[0] = { {clearColor[0], clearColor[1], clearColor[2], clearColor[3]} };   // clear values for color
-	clearValues[1] = { 1.0f, 0 };                                                        // clear value for depth and stencil attachment
+	clearValues[1] = { 1.0f, 0 };                                                        // clear value for depth and stencil attachment of offscreen pass
 
 	if (_mkDevice.enableDynamicRendering)
 	{
-		auto vkCmdBeginRenderingKHR = (PFN_vkCmdBeginRenderingKHR)vkGetInstanceProcAddr(_mkInstance.GetVkInstance(), "vkCmdBeginRenderingKHR");
-		auto vkCmdEndRenderingKHR = (PFN_vkCmdEndRenderingKHR)vkGetInstanceProcAddr(_mkInstance.GetVkInstance(), "vkCmdEndRenderingKHR");
-		if (!vkCmdBeginRenderingKHR || !vkCmdEndRenderingKHR)
-		{
-			throw std::runtime_error("Unable to dynamically load vkCmdBeginRenderingKHR and vkCmdEndRenderingKHR");
-		}
-
-		// ----------- offscreen rendering ------------
-		VkImageSubresourceRange colorRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
-		VkImageSubresourceRange depthRange = colorRange;
-		depthRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-
-		VkRenderingAttachmentInfoKHR colorAttachmentInfo = mk::vkinfo::GetRenderingAttachmentInfoKHR();
-		colorAttachmentInfo.imageView   = _vkOffscreenColorImageView;
-		colorAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-		colorAttachmentInfo.resolveMode = VK_RESOLVE_MODE_NONE;
-		colorAttachmentInfo.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		colorAttachmentInfo.storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
-		colorAttachmentInfo.clearValue = clearValues[0];
-
-		VkRenderingAttachmentInfoKHR depthAttachmentInfo = mk::vkinfo::GetRenderingAttachmentInfoKHR();
-		depthAttachmentInfo.imageView   = _vkOffscreenDepthImageView;
-		depthAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
-		depthAttachmentInfo.resolveMode = VK_RESOLVE_MODE_NONE;
-		depthAttachmentInfo.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		depthAttachmentInfo.storeOp     = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		depthAttachmentInfo.clearValue  = clearValues[1];
-
-		auto renderArea = VkRect2D{ VkOffset2D{}, swapchainExtent };
-		auto renderInfo = mk::vkinfo::GetRenderingInfoKHR(renderArea, 1, &colorAttachmentInfo);
-		renderInfo.layerCount = 1;
-		renderInfo.pDepthAttachment = &depthAttachmentInfo;
-		if (!IsDepthOnlyFormat(_vkOffscreenDepthFormat))
+		// offscreen and post passes with barriers derived by the render graph
+		_renderGraph.SetImportedImage(_swapchainColorHandle, _mkSwapchain.GetSwapchainImage(swapchainImageIndex), _mkSwapchain.GetSwapchainImageView(swapchainImageIndex));
+		if (_isComputePostEnabled)
 		{
-			renderInfo.pStencilAttachment = &depthAttachmentInfo; // if the depth format includes stencil, then use it as stencil attachment
+			_postProcessStack.SetSceneRenderExtent(GetRenderExtent());
+			_postProcessStack.BeginFrame(commandBuffer, _currentFrameIndex, _timer.deltaTime); // post timers of this slot are reset before the graph writes them
 		}
-
-		vkCmdBeginRenderingKHR(commandBuffer, &renderInfo);
-		Rasterize(commandBuffer, swapchainExtent);
-		vkCmdEndRenderingKHR(commandBuffer);
-
-		// ----------- post pipeline rendering ------------
-		mk::vk::TransitionImageLayout(
-			commandBuffer,
-			_mkSwapchain.GetSwapchainImage(swapchainImageIndex),
-			_mkSwapchain.GetSwapchainImageFormat(),
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			colorRange
-		);
-		mk::vk::TransitionImageLayout(
-			commandBuffer,
-			_mkSwapchain.GetDepthImage(),
-			_mkSwapchain.GetDepthFormat(),
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-			depthRange
-		);
-
-		VkRenderingAttachmentInfo swapchainColorAttachmentInfo = mk::vkinfo::GetRenderingAttachmentInfoKHR();
-		swapchainColorAttachmentInfo.imageView   = _mkSwapchain.GetSwapchainImageView(swapchainImageIndex);	
-		swapchainColorAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		swapchainColorAttachmentInfo.resolveMode = VK_RESOLVE_MODE_NONE;
-		swapchainColorAttachmentInfo.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		swapchainColorAttachmentInfo.storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
-		swapchainColorAttachmentInfo.clearValue  = clearValues[0];
-
-		VkRenderingAttachmentInfoKHR swapchainDepthAttachmentInfo = mk::vkinfo::GetRenderingAttachmentInfoKHR();
-		swapchainDepthAttachmentInfo.imageView   = _mkSwapchain.GetDepthImageView();
-		swapchainDepthAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
-		swapchainDepthAttachmentInfo.resolveMode = VK_RESOLVE_MODE_NONE;
-		swapchainDepthAttachmentInfo.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		swapchainDepthAttachmentInfo.storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
-		swapchainDepthAttachmentInfo.clearValue  = clearValues[1];
-
-		auto postRenderArea = VkRect2D{ VkOffset2D{}, swapchainExtent };
-		auto postRenderInfo = mk::vkinfo::GetRenderingInfoKHR(postRenderArea, 1, &swapchainColorAttachmentInfo);
-		postRenderInfo.layerCount = 1;
-		postRenderInfo.pDepthAttachment = &swapchainDepthAttachmentInfo;
-		if (!IsDepthOnlyFormat(_vkOffscreenDepthFormat))
-		{
-			postRenderInfo.pStencilAttachment = &swapchainDepthAttachmentInfo; // if the depth format includes stencil, then use it as stencil attachment
-		}
-
-		// begin post rendering
-		vkCmdBeginRenderingKHR(commandBuffer, &postRenderInfo);
-		// draw post process
-		DrawPostProcess(commandBuffer, swapchainExtent);
-		// end post rendering
-		vkCmdEndRenderingKHR(commandBuffer);
-
-		mk::vk::TransitionImageLayout(
-			commandBuffer,
-			_mkSwapchain.GetSwapchainImage(swapchainImageIndex),
-			_mkSwapchain.GetSwapchainImageFormat(),
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-			colorRange
-		);
+		_renderGraph.Execute(commandBuffer);
 	}
 	else
 	{
@@ -1077,6 +1410,9 @@ void Renderer::RecordFrameBufferCommands(uint32 swapchainImageIndex)
 
 		vkCmdEndRenderPass(commandBuffer);
 
+		WriteFrameTimestamp(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, SCENE_END);
+		WriteFrameTimestamp(commandBuffer, _vkSwapchainAcquireStage, OUTPUT_BEGIN);
+
 		// 2. begin post pipeline render pass
 		VkRenderPassBeginInfo postRenderBeginInfo{};
 		postRenderBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -1084,7 +1420,7 @@ void Renderer::RecordFrameBufferCommands(uint32 swapchainImageIndex)
 		postRenderBeginInfo.framebuffer = _vkFramebuffers[swapchainImageIndex];
 		postRenderBeginInfo.renderArea.offset = { 0, 0 };
 		postRenderBeginInfo.renderArea.extent = swapchainExtent;
-		postRenderBeginInfo.clearValueCount = static_cast<uint32>(clearValues.size());
+		postRenderBeginInfo.clearValueCount = 1; // color only
 		postRenderBeginInfo.pClearValues = clearValues.data();
 
 		// begin post render pass
@@ -1094,20 +1430,44 @@ void Renderer::RecordFrameBufferCommands(uint32 swapchainImageIndex)
 		// end post render pass
 		vkCmdEndRenderPass(commandBuffer);
 	}
-	
 
+	WriteFrameTimestamp(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, OUTPUT_END);
+	_isTimestampWritten[_currentFrameIndex] = _vkTimestampQueryPool != VK_NULL_HANDLE;
 
 	MK_CHECK(vkEndCommandBuffer(commandBuffer));
 }
 
 void Renderer::DrawFrame()
 {
-	// update every states
-	Update();
+	// update every states, overlapped with the gpu working on previous frames
+	if (!_isLowLatencyEnabled)
+		Update();
 
-	// 1. wait for the previous frame to be finished
+	// 1. wait until the gpu is done with the frame that used this slot before
 	MKPipeline::RenderingResource& renderingResource = _mkGraphicsPipeline.GetRenderingResource(_currentFrameIndex);
-	vkWaitForFences(_mkDevice.GetDevice(), 1, &renderingResource.inFlightFence, VK_TRUE, UINT64_MAX);
+	GCommandService->WaitForFrame(_currentFrameIndex);
+	GPipelineRegistry->DestroyRetiredPipelines(); // fast-linked pipelines replaced by optimized ones
+	ReadFrameTimestamps(_currentFrameIndex);
+	if (_isComputePostEnabled)
+		_postProcessStack.ReadTimestamps(_currentFrameIndex);
+
+	// 1.1 low latency mode paces the cpu to the display and samples input as late as possible
+	if (_isLowLatencyEnabled)
+	{
+		WaitForLastPresent();
+		_mkWindow.PollEvents();
+		Update();
+	}
+
+	// 1.2 uniform buffer of this slot is no longer read by the gpu
+	UpdateUniformBuffer();
+
+	// 1.3 toggled post effects add or remove graph passes, transient images of frames in flight are released with the old graph
+	if (_isComputePostEnabled && _postProcessStack.IsTopologyDirty())
+	{
+		vkDeviceWaitIdle(_mkDevice.GetDevice());
+		CreateOffscreenRenderResource(_mkSwapchain.GetSwapchainExtent());
+	}
 
 	// 2. get available image from swapchain
 	uint32 imageIndex;
@@ -1129,43 +1489,51 @@ void Renderer::DrawFrame()
 		MK_THROW("Failed to acquire swap chain image!.")
 	}
 
-	// 3. reset fence if and only if application is submitting commands
-	vkResetFences(_mkDevice.GetDevice(), 1, &renderingResource.inFlightFence); // make current fence unsignaled
-
-	// 4. reset frame buffer command buffer
+	// 3. reset frame buffer command buffer and transient descriptor sets of this frame
 	GCommandService->ResetCommandBuffer(_currentFrameIndex);
+	GDescriptorManager->ResetFrameDescriptorPools(_currentFrameIndex);
 
-	// 5. record frame buffer commands (offscreen rendering -> tone mapper -> UI)
+	// 4. record frame buffer commands (offscreen rendering -> tone mapper -> UI)
 	RecordFrameBufferCommands(imageIndex);
 
-	// 6. copy rendering resources and submit recorded command buffer to graphics queue
-	VkSemaphore          waitSemaphores[]   = { renderingResource.imageAvailableSema };
-	VkPipelineStageFlags waitStages[]       = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	VkSemaphore          signalSemaphores[] = { renderingResource.renderFinishedSema };
-
+	// 5. submit recorded command buffer to graphics queue, the frame timeline is signaled along with the binary semaphore for present
 	GCommandService->SubmitCommandBufferToQueue(
 		_currentFrameIndex,
-		waitSemaphores,
-		waitStages,
-		signalSemaphores,
-		_mkDevice.GetGraphicsQueue(),
-		renderingResource.inFlightFence
+		{ mk::vkinfo::GetSemaphoreSubmitInfo(renderingResource.imageAvailableSema, _vkSwapchainAcquireStage) },
+		{ mk::vkinfo::GetSemaphoreSubmitInfo(renderingResource.renderFinishedSema, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT) },
+		_mkDevice.GetGraphicsQueue()
 	);
 
-	// 7. present image to swapchain
+	// 6. present image to swapchain
 	VkPresentInfoKHR presentInfo{};
 	VkSwapchainKHR swapChains[] = { _mkSwapchain.GetSwapchain() };
 
 	presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores    = signalSemaphores; // use same signal semaphore to wait on command buffer to finish execution
+	presentInfo.pWaitSemaphores    = &renderingResource.renderFinishedSema; // use same signal semaphore to wait on command buffer to finish execution
 	presentInfo.swapchainCount  = 1;
 	presentInfo.pSwapchains     = swapChains;
 	presentInfo.pImageIndices   = &imageIndex;
 	presentInfo.pResults        = nullptr;
 
+	// tag the present so that WaitForLastPresent() can wait for it
+	uint64         presentId = _presentId + 1;
+	VkPresentIdKHR presentIdInfo{ VK_STRUCTURE_TYPE_PRESENT_ID_KHR };
+	if (_mkDevice.GetPresentWaitSupport().isSupported)
+	{
+		presentIdInfo.swapchainCount = 1;
+		presentIdInfo.pPresentIds    = &presentId;
+		presentInfo.pNext            = &presentIdInfo;
+	}
+
 	result = vkQueuePresentKHR(_mkDevice.GetPresentQueue(), &presentInfo);
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) // 7.1 error by out of date or suboptimal -> recreate swapchain
+	if (presentInfo.pNext && (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR))
+	{
+		_presentId = presentId;
+		_latencyStatistics.pendingPresentId = presentId;
+		_latencyStatistics.pendingInputTime = _frameInputTime;
+	}
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) // 6.1 error by out of date or suboptimal -> recreate swapchain
 	{
 		_mkDevice.SetFrameBufferResized(false);
 		OnResizeWindow();
@@ -1173,12 +1541,14 @@ void Renderer::DrawFrame()
 	else if (result != VK_SUCCESS)
 		MK_THROW("failed to present swap chain image!");
 
-	// 8. update current frame index
-	_currentFrameIndex = (_currentFrameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
+	// 7. update current frame index
+	_currentFrameIndex = GCommandService->GetNextFrameIndex(_currentFrameIndex);
 }
 
 void Renderer::Render()
 {
+	_timer.Start();
+
 	while (!_mkWindow.ShouldClose()) 
 	{
 		_mkWindow.PollEvents();
@@ -1186,4 +1556,133 @@ void Renderer::Render()
 	}
 
 	_mkDevice.WaitUntilDeviceIdle();
+
+	LogFrameStatistics();
+}
+
+/**
+* ----------------- Statistics -----------------
+*/
+void Renderer::LogFrameStatistics()
+{
+	if (_timer.frameCount == 0)
+		return;
+
+	// report per-format numbers to compare offscreen color formats
+	double averageFrameTime = _timer.accumulatedFrameTime / static_cast<double>(_timer.frameCount);
+	VkDeviceSize offscreenMemorySize = _mkDevice.enableDynamicRendering ? _renderGraph.GetTransientMemorySize() : _transientAllocator.GetCommittedMemorySize();
+	MK_LOG(fmt::format(
+		"offscreen format {} | msaa {}x | offscreen memory {:.2f} MiB | average frame time {:.3f} ms over {} frames",
+		string_VkFormat(_vkOffscreenColorFormat),
+		static_cast<uint32>(_vkMsaaSampleCount),
+		static_cast<double>(offscreenMemorySize) / (1024.0 * 1024.0),
+		averageFrameTime,
+		_timer.frameCount
+	));
+
+	if (_latencyStatistics.sampleCount > 0)
+		MK_LOG(fmt::format(
+			"average input to present latency {:.3f} ms over {} frames",
+			_latencyStatistics.accumulatedLatency / static_cast<double>(_latencyStatistics.sampleCount),
+			_latencyStatistics.sampleCount
+		));
+
+	// gpu frame time shows the idle time removed by batched barriers with precise stages
+	if (_gpuTimeStatistics.sampleCount > 0)
+	{
+		const auto& barrierStatistics = _renderGraph.GetBarrierStatistics();
+		double frameCount = static_cast<double>(_timer.frameCount);
+		MK_LOG(fmt::format(
+			"average gpu frame time {:.3f} ms over {} frames | {:.1f} barrier calls, {:.1f} image barriers, {:.1f} folded barriers per frame",
+			_gpuTimeStatistics.accumulatedGpuTime / static_cast<double>(_gpuTimeStatistics.sampleCount),
+			_gpuTimeStatistics.sampleCount,
+			static_cast<double>(barrierStatistics.flushCount) / frameCount,
+			static_cast<double>(barrierStatistics.imageBarrierCount) / frameCount,
+			static_cast<double>(barrierStatistics.foldedBarrierCount) / frameCount
+		));
+	}
+
+	if (_dynamicResolution.isEnabled)
+	{
+		auto renderExtent = GetRenderExtent();
+		MK_LOG(fmt::format(
+			"dynamic resolution scale {:.2f} ({} x {}) | filtered gpu time {:.3f} ms, target {:.3f} ms | {} scale changes",
+			_dynamicResolution.scale,
+			renderExtent.width,
+			renderExtent.height,
+			_dynamicResolution.filteredGpuTime,
+			_dynamicResolution.targetGpuTime,
+			_dynamicResolution.changeCount
+		));
+	}
+
+	// render scale of the performance mode, its cost is in the temporal resolve timer of the post stack
+	if (_isTemporalAAEnabled)
+	{
+		auto sceneExtent     = GetSceneExtent();
+		auto swapchainExtent = _mkSwapchain.GetSwapchainExtent();
+		MK_LOG(fmt::format(
+			"temporal aa render scale {:.2f} | {} x {} upscaled to {} x {}",
+			_renderScale,
+			sceneExtent.width,
+			sceneExtent.height,
+			swapchainExtent.width,
+			swapchainExtent.height
+		));
+	}
+
+	// cost of each post effect group, to decide which effects are worth their time
+	if (_isComputePostEnabled)
+		_postProcessStack.LogStatistics();
+}
+
+void Renderer::ReadFrameTimestamps(uint32 frameIndex)
+{
+	if (_vkTimestampQueryPool == VK_NULL_HANDLE || !_isTimestampWritten[frameIndex])
+		return;
+
+	// the frame of this slot is complete, so results are available without waiting
+	std::array<uint64, FRAME_TIMESTAMP_COUNT> timestamps{};
+	VkResult result = vkGetQueryPoolResults(
+		_mkDevice.GetDevice(),
+		_vkTimestampQueryPool,
+		frameIndex * FRAME_TIMESTAMP_COUNT, FRAME_TIMESTAMP_COUNT,
+		sizeof(timestamps), timestamps.data(), sizeof(uint64),
+		VK_QUERY_RESULT_64_BIT
+	);
+	_isTimestampWritten[frameIndex] = false;
+	if (result != VK_SUCCESS)
+		return;
+
+	// the acquire wait between scene end and output begin is vsync throttling, not gpu work
+	uint64 gpuTicks = (timestamps[SCENE_END] - timestamps[SCENE_BEGIN]) + (timestamps[OUTPUT_END] - timestamps[OUTPUT_BEGIN]);
+	double gpuTime  = static_cast<double>(gpuTicks) * static_cast<double>(_vkDeviceProperties.limits.timestampPeriod) / 1e6; // in milliseconds
+	_gpuTimeStatistics.accumulatedGpuTime += gpuTime;
+	_gpuTimeStatistics.sampleCount++;
+
+	if (_dynamicResolution.isEnabled)
+		UpdateResolutionScale(gpuTime);
+}
+
+void Renderer::WriteFrameTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 stage, EFrameTimestamp timestamp)
+{
+	if (_vkTimestampQueryPool != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp2(commandBuffer, stage, _vkTimestampQueryPool, _currentFrameIndex * FRAME_TIMESTAMP_COUNT + timestamp);
+}
+
+void Renderer::UpdateResolutionScale(double gpuTime)
+{
+	auto& state = _dynamicResolution;
+	state.filteredGpuTime = (state.filteredGpuTime > 0.0) ? state.filteredGpuTime + (gpuTime - state.filteredGpuTime) * 0.1 : gpuTime;
+
+	// aim slightly below the budget, so that a scene getting heavier doesn't miss a frame before the scale follows
+	double targetGpuTime = state.targetGpuTime * 0.9;
+	float  desiredScale  = std::clamp(state.scale * static_cast<float>(std::sqrt(targetGpuTime / state.filteredGpuTime)), state.minScale, state.maxScale);
+
+	// changes below a few percent are noise, half steps keep the controller from overshooting on delayed measurements
+	if (std::abs(desiredScale - state.scale) < 0.02f)
+		return;
+
+	state.scale += (desiredScale - state.scale) * 0.5f;
+	state.changeCount++;
 }
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <array>
+
+// internal
+#include "Utilities.h"
+#include "Global.h"
+#include "CommandService.h"
+#include "Allocator.h"
+
+// RHI
+#include "Device.h"
+#include "DescriptorManager.h"
+#include "ComputePipeline.h"
+#include "RenderGraph.h"
+
+// post effects of the compute post stack, each one can be toggled with SetEffectEnabled()
+enum EPostEffect
+{
+	POST_EFFECT_EXPOSURE = 0, // scene color scaled by exposure
+	POST_EFFECT_TONE_MAPPING, // ACES filmic curve
+	POST_EFFECT_COLOR_GRADING,// 32^3 LUT baked from ColorGradingSettings
+	POST_EFFECT_BLOOM,        // half resolution bright pass blurred with a separable gaussian
+	POST_EFFECT_FXAA,         // FXAA 3.11 console on the graded image
+	POST_EFFECT_AUTO_EXPOSURE,// exposure adapted to the luminance histogram of the scene, on top of manual exposure
+	POST_EFFECT_COUNT,
+};
+
+/**
+* [PostProcessStack class]
+* - Responsibility :
+*    - turn the hdr offscreen color into the swapchain image with compute dispatches declared on the render graph.
+*    - resolve the jittered offscreen color with a reprojected history (temporal anti-aliasing), upscaled to the output.
+*    - fuse effects working on the same pixel (exposure, bloom composite, tone mapping, color grading, sRGB encode) into one dispatch.
+*    - measure every dispatch group with gpu timestamps.
+* - Note :
+*    - dispatches : temporal resolve -> luminance histogram -> exposure adaptation -> bloom prefilter -> bloom blur (horizontal, vertical) -> composite -> fxaa.
+*      Without fxaa the composite writes the swapchain.
+*    - temporal resolve is decided at setup, the renderer has to jitter the projection with AdvanceJitter() and render motion vectors.
+*      Effects after it read the resolved history at output resolution instead of the offscreen color.
+*    - auto exposure stays on the gpu : the histogram is reduced into an exposure buffer read by later dispatches, nothing is read back.
+*    - bloom blur caches a row (or column) of texels with its apron in shared memory, so each texel is fetched once per direction.
+*    - exposure, tone mapping and color grading are push constant flags of the composite, they share its timer.
+*    - scene color may be rendered to a smaller top left region (dynamic resolution), passes reading it upscale that region.
+*    - toggling bloom or fxaa changes the graph topology, the renderer recompiles the graph when IsTopologyDirty() is set.
+*/
+class PostProcessStack
+{
+public:
+	struct Settings
+	{
+		float exposure        = 1.0f;  // manual exposure, compensation on top of auto exposure
+		float bloomThreshold  = 1.0f;  // scene luminance where bloom starts
+		float bloomKnee       = 0.5f;  // soft transition below the threshold
+		float bloomIntensity  = 0.08f;
+		float minLogLuminance = -8.0f; // log2 luminance range covered by the histogram
+		float maxLogLuminance = 4.0f;
+		float adaptationRate  = 1.5f;  // per second, higher adapts faster
+		float temporalBlendFactor = 0.1f; // weight of the current frame in the temporal resolve, lower converges smoother but ghosts longer
+	};
+
+	// targets of the offscreen pass read by the stack
+	struct SceneTargets
+	{
+		MKRenderGraph::ResourceHandle color        = 0;
+		MKRenderGraph::ResourceHandle motionVector = 0;      // uv offset to the previous frame, read by temporal resolve only
+		VkExtent2D                    extent{ 0, 0 };        // image extent, smaller than the output with a render scale
+	};
+
+	struct ColorGradingSettings
+	{
+		float contrast   = 1.05f; // around mid gray in sRGB space
+		float saturation = 1.1f;
+	};
+
+	// dispatch groups measured with gpu timestamps
+	enum ETimer
+	{
+		TIMER_TEMPORAL_RESOLVE = 0,
+		TIMER_AUTO_EXPOSURE,
+		TIMER_BLOOM,
+		TIMER_COMPOSITE,
+		TIMER_FXAA,
+		TIMER_COUNT,
+	};
+
+public:
+	PostProcessStack(MKDevice& mkDeviceRef);
+	~PostProcessStack();
+
+	/* getters */
+	bool            IsEffectEnabled(EPostEffect effect) const { return (_enabledEffects & (1u << effect)) != 0; }
+	bool            IsTopologyDirty()                   const { return _isTopologyDirty; }
+	bool            IsTemporalAAEnabled()               const { return _isTemporalAAEnabled; }
+	const Settings& GetSettings()                       const { return _settings; }
+
+	/* settings */
+	void SetEffectEnabled(EPostEffect effect, bool enable);
+	void SetSettings(const Settings& settings) { _settings = settings; }
+	void SetColorGradingSettings(const ColorGradingSettings& settings) { _colorGradingSettings = settings; } // baked in Initialize()
+	void SetSceneRenderExtent(VkExtent2D extent);                       // rendered top left region of scene color (dynamic resolution), every frame
+	void EnableTemporalAA(bool enable) { _isTemporalAAEnabled = enable; } // before AddPasses, scene targets have to include motion vectors
+
+	/* api */
+	void Initialize(const VkPhysicalDeviceProperties& deviceProperties);                               // pipelines, descriptor templates, LUT, exposure buffers and timestamp queries
+	void Destroy();                                                                                    // before the allocator is destroyed
+	void AddPasses(MKRenderGraph& graph, const SceneTargets& scene, MKRenderGraph::ResourceHandle swapchainColor, VkExtent2D extent);
+	glm::vec2 AdvanceJitter(VkExtent2D renderExtent);                                                  // sub-pixel jitter of the next frame in NDC, applied to the projection before the scene is rendered
+	void BeginFrame(VkCommandBuffer commandBuffer, uint32 frameIndex, float deltaTime);                // before the graph is executed, delta time in seconds
+	void ReadTimestamps(uint32 frameIndex);                                                            // after the frame of this slot is waited
+	bool RefreshShaderModules();
+	void LogStatistics() const;
+
+private:
+	struct TimerStatistics
+	{
+		double accumulatedTime = 0.0; // in milliseconds
+		uint64 sampleCount     = 0;
+	};
+
+	/* initialization */
+	void CreatePipelines();
+	void CreateDescriptorTemplates();
+	void CreateColorGradingLUT();
+	void CreateAutoExposureBuffers();
+	void CreateHistoryImages(VkExtent2D extent);
+	void DestroyHistoryImages();
+
+	/* dispatches */
+	void DispatchTemporalResolve(VkCommandBuffer commandBuffer, VkExtent2D extent);
+	void DispatchLuminanceHistogram(VkCommandBuffer commandBuffer, VkExtent2D extent);
+	void DispatchExposureAdaptation(VkCommandBuffer commandBuffer, VkExtent2D extent);
+	void DispatchBloomPrefilter(VkCommandBuffer commandBuffer, VkExtent2D extent);
+	void DispatchBloomBlur(VkCommandBuffer commandBuffer, VkExtent2D extent, uint32 direction);
+	void DispatchComposite(VkCommandBuffer commandBuffer, VkExtent2D extent);
+	void DispatchFXAA(VkCommandBuffer commandBuffer, VkExtent2D extent);
+	void BindDescriptors(VkCommandBuffer commandBuffer, MKComputePipeline& pipeline, const MKDescriptorManager::DescriptorUpdateTemplate* updateTemplate, const void* pData);
+
+	/* gpu timestamps */
+	void BeginTimer(VkCommandBuffer commandBuffer, ETimer timer);
+	void EndTimer(VkCommandBuffer commandBuffer, ETimer timer);
+
+	VkDescriptorImageInfo  GetSampledImageInfo(MKRenderGraph::ResourceHandle resource) const;
+	VkDescriptorImageInfo  GetStorageImageInfo(MKRenderGraph::ResourceHandle resource) const;
+	VkDescriptorBufferInfo GetBufferInfo(const VkBufferAllocated& buffer, VkDeviceSize range) const { return { buffer.buffer, 0, range }; } // descriptor buffer backend can't take VK_WHOLE_SIZE
+	glm::vec2              GetSceneUVScale()                                           const; // output uv -> scene uv
+	glm::vec2              GetSceneUVMax()                                             const; // half a texel inside the rendered region
+
+private:
+	static constexpr uint32 GROUP_SIZE           = 8;   // [numthreads(8, 8, 1)] of 2D post shaders
+	static constexpr uint32 BLUR_GROUP_SIZE      = 64;  // [numthreads(64, 1, 1)] of post-bloom-blur-compute.hlsl
+	static constexpr uint32 LUT_SIZE             = 32;  // 32^3 LUT laid out as a 1024 x 32 strip of blue slices
+	static constexpr uint32 HISTOGRAM_BIN_COUNT  = 256; // [numthreads(256, 1, 1)] of post-exposure-adaptation-compute.hlsl
+	static constexpr uint32 HISTOGRAM_GROUP_SIZE = 16;  // [numthreads(16, 16, 1)] of post-luminance-histogram-compute.hlsl, a thread per bin
+	static constexpr VkDeviceSize HISTOGRAM_BUFFER_SIZE = HISTOGRAM_BIN_COUNT * sizeof(uint32);
+	static constexpr VkDeviceSize EXPOSURE_BUFFER_SIZE  = 2 * sizeof(float); // adapted luminance, exposure
+	static constexpr uint32 JITTER_PHASE_COUNT     = 8;  // halton (2, 3) samples per output pixel
+	static constexpr uint32 MAX_JITTER_PHASE_COUNT = 32; // longer sequences converge slower than the history forgets them
+	static constexpr VkFormat HISTORY_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT; // storage support is mandatory
+
+	/* pipelines */
+	MKComputePipeline _mkBloomPrefilterPipeline;
+	MKComputePipeline _mkBloomBlurPipeline;
+	MKComputePipeline _mkCompositePipeline;
+	MKComputePipeline _mkFXAAPipeline;
+	MKComputePipeline _mkLuminanceHistogramPipeline;
+	MKComputePipeline _mkExposureAdaptationPipeline;
+	MKComputePipeline _mkTemporalResolvePipeline;
+
+	/* descriptor update templates (owned by GDescriptorManager) */
+	const MKDescriptorManager::DescriptorUpdateTemplate* _bloomPrefilterTemplate     = nullptr;
+	const MKDescriptorManager::DescriptorUpdateTemplate* _bloomBlurTemplate          = nullptr;
+	const MKDescriptorManager::DescriptorUpdateTemplate* _compositeTemplate          = nullptr;
+	const MKDescriptorManager::DescriptorUpdateTemplate* _fxaaTemplate               = nullptr;
+	const MKDescriptorManager::DescriptorUpdateTemplate* _luminanceHistogramTemplate = nullptr;
+	const MKDescriptorManager::DescriptorUpdateTemplate* _exposureAdaptationTemplate = nullptr;
+	const MKDescriptorManager::DescriptorUpdateTemplate* _temporalResolveTemplate    = nullptr;
+
+	/* resources */
+	VkSampler        _vkLinearClampSampler{ VK_NULL_HANDLE };
+	VkImageAllocated _vkColorGradingLUT;
+	VkImageView      _vkColorGradingLUTView{ VK_NULL_HANDLE };
+
+	/* auto exposure (persistent across frames, ordered by buffer barriers inside the passes) */
+	VkBufferAllocated _vkLuminanceHistogramBuffer; // HISTOGRAM_BIN_COUNT pixel counts, cleared by the adaptation dispatch
+	VkBufferAllocated _vkExposureBuffer;           // exposure and adapted luminance
+	BarrierBatch      _barrierBatch;
+	float             _deltaTime = 0.0f;
+
+	/**
+	* temporal anti-aliasing (persistent across frames)
+	* - two history images at output resolution swap roles every frame, both are imported into the graph.
+	* - a frame starts and ends with both in shader read layout, the resolve writes one of them as storage image.
+	*/
+	bool                            _isTemporalAAEnabled = false;
+	std::array<VkImageAllocated, 2> _vkHistoryImages;
+	std::array<VkImageView, 2>      _vkHistoryImageViews{ VK_NULL_HANDLE, VK_NULL_HANDLE };
+	VkExtent2D                      _historyExtent{ 0, 0 };
+	uint32                          _historyIndex   = 0;     // image written this frame
+	bool                            _isHistoryValid = false; // false until the first resolve after (re)creation
+	uint32                          _jitterIndex    = 0;
+	glm::vec2                       _jitter{ 0.0f, 0.0f };   // NDC offset of the frame being recorded
+
+	/* graph resources of the current topology */
+	MKRenderGraph*                _renderGraph = nullptr;
+	MKRenderGraph::ResourceHandle _offscreenColorHandle = 0; // jittered input of temporal resolve
+	MKRenderGraph::ResourceHandle _motionVectorHandle   = 0;
+	MKRenderGraph::ResourceHandle _historyReadHandle    = 0;
+	MKRenderGraph::ResourceHandle _historyWriteHandle   = 0; // resolved color read by later effects
+	MKRenderGraph::ResourceHandle _sceneColorHandle     = 0; // offscreen color, or resolved color with temporal aa
+	MKRenderGraph::ResourceHandle _swapchainColorHandle = 0;
+	MKRenderGraph::ResourceHandle _bloomPrefilterHandle = 0;
+	MKRenderGraph::ResourceHandle _bloomBlurXHandle     = 0;
+	MKRenderGraph::ResourceHandle _bloomBlurYHandle     = 0;
+	MKRenderGraph::ResourceHandle _ldrColorHandle       = 0; // fxaa input
+	MKRenderGraph::ResourceHandle _compositeTargetHandle = 0; // ldr color with fxaa, swapchain color without it
+	VkExtent2D                    _sceneExtent{ 0, 0 };       // extent of scene color image
+	VkExtent2D                    _sceneRenderExtent{ 0, 0 }; // rendered region of scene color
+	VkExtent2D                    _offscreenExtent{ 0, 0 };
+	VkExtent2D                    _offscreenRenderExtent{ 0, 0 };
+	VkExtent2D                    _outputExtent{ 0, 0 };      // extent of post outputs
+
+	/* settings */
+	uint32               _enabledEffects  = (1u << POST_EFFECT_COUNT) - 1;
+	bool                 _isTopologyDirty = false;
+	Settings             _settings;
+	ColorGradingSettings _colorGradingSettings;
+
+	/* gpu timestamps, TIMER_COUNT * 2 queries per frame slot */
+	VkQueryPool                                _vkTimestampQueryPool{ VK_NULL_HANDLE };
+	float                                      _timestampPeriod = 1.0f;
+	uint32                                     _currentFrameIndex = 0;
+	std::array<uint32, MAX_FRAMES_IN_FLIGHT>   _writtenTimerMasks{}; // timers recorded in each slot
+	std::array<TimerStatistics, TIMER_COUNT>   _timerStatistics;
+
+	MKDevice& _mkDeviceRef;
+};
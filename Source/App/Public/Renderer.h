@@ -10,9 +10,16 @@
 #include "Device.h"
 #include "Swapchain.h"
 #include "Pipeline.h"
+#include "PipelineBuildService.h"
+#include "BindlessTable.h"
 #include "CommandService.h"
 #include "Allocator.h"
+#include "JobSystem.h"
 #include "RenderPassUtil.h"
+#include "TransientAllocator.h"
+#include "PostProcessStack.h"
+#include "RenderGraph.h"
+#include "ShaderHotReloader.h"
 
 class Renderer
 {
@@ -23,9 +30,14 @@ class Renderer
 		float elapsedTime = 0.0f;
 		float deltaTime = 0.0f;
 
+		/* frame statistics */
+		uint64 frameCount = 0;
+		double accumulatedFrameTime = 0.0; // in milliseconds
+
 		void Start()
 		{
 			startTime = std::chrono::high_resolution_clock::now();
+			lastTime = startTime; // exclude setup time from the first frame
 		}
 
 		void Update()
@@ -37,46 +49,99 @@ class Renderer
 
 			// update delta time
 			deltaTime = std::chrono::duration<float, std::chrono::milliseconds::period>(currentTime - lastTime).count();
+			accumulatedFrameTime += deltaTime;
+			frameCount++;
+
 			deltaTime /= 1000.0f;
 			lastTime = currentTime;
 		}
 	};
 
+	/**
+	* timestamps of a frame slot
+	* - the post work waits for the swapchain image, which is held back by vsync. Scene and output are timed apart,
+	*   and the output begins once the acquire wait is over, so the time in between is not counted as gpu work.
+	*/
+	enum EFrameTimestamp : uint32
+	{
+		SCENE_BEGIN,
+		SCENE_END,
+		OUTPUT_BEGIN,
+		OUTPUT_END,
+		FRAME_TIMESTAMP_COUNT
+	};
+
 public:
 	Renderer();
 	~Renderer();
 	void Setup();
 	void Render();
 
+	/* settings (should be called before Setup) */
+	void SetHDRColorFormat(EHDRColorFormat format) { _hdrColorFormat = format; }
+	void EnableBindless(bool enable) { _isBindlessRequested = enable; } // falls back to per-model descriptor sets without descriptor indexing
+	void EnableParallelRecording(bool enable) { _isParallelRecordingEnabled = enable; } // split scene draws into secondary command buffers recorded on worker threads
+	void EnableLowLatencyMode(bool enable) { _isLowLatencyEnabled = enable; } // sample input after frame pacing waits and pace the cpu to the display with present wait
+	void EnableDynamicResolution(bool enable) { _isDynamicResolutionRequested = enable; } // scale the offscreen render extent to keep gpu frame time in budget (dynamic rendering with timestamps only)
+	void EnableComputePost(bool enable) { _isComputePostRequested = enable; } // post process with the compute post stack, falls back to the fullscreen triangle without storage swapchain images
+	void EnableTemporalAA(bool enable) { _isTemporalAARequested = enable; } // jittered scene resolved with a reprojected history, requires compute post
+	void SetRenderScale(float scale) { _renderScale = scale; } // offscreen images below the swapchain extent upscaled by the temporal resolve (performance mode, 0.5 ~ 1)
+	void SetMSAASampleCount(VkSampleCountFlagBits samples) { _msaaSampleCountRequested = samples; } // multisampled offscreen pass resolved when rendering ends (dynamic rendering only)
+
+	/* runtime settings */
+	void SetFramesInFlight(uint32 count) { GCommandService->SetFramesInFlight(count); } // fewer frames lower latency, more frames hide cpu spikes (1 ~ MAX_FRAMES_IN_FLIGHT)
+	void SetPostEffectEnabled(EPostEffect effect, bool enable) { _postProcessStack.SetEffectEnabled(effect, enable); } // compute post only, the graph is rebuilt before the next frame if needed
+	void SetPostProcessSettings(const PostProcessStack::Settings& settings) { _postProcessStack.SetSettings(settings); }
+	void SetTargetGpuTime(double milliseconds) { _dynamicResolution.targetGpuTime = milliseconds; } // budget followed by dynamic resolution
+
+	/* statistics */
+	double GetInputToPresentLatency() const { return _latencyStatistics.lastLatency; } // milliseconds, measured in low latency mode when present wait is supported
+	float  GetResolutionScale()       const { return _dynamicResolution.scale; }
+
 private: 
 	/* initialization */
 	void CreateVertexBuffer(std::vector<Vertex> vertices);
 	void CreateIndexBuffer(std::vector<uint32> indices);
 	void CreateUniformBuffers();
+	void CreateBindlessResources();
 	void CreateOffscreenRenderResource(VkExtent2D extent);
 	void CreateOffscreenRenderPass(VkExtent2D extent);
 	void CreateBaseDescriptorSet();
 	void CreateSamplerDescriptorSet();
-	void CreatePostDescriptorSet();
+	void CreatePostDescriptorTemplate();
 	void CreatePushConstantRaster();
 	void CreateFrameBuffers();
+	void CreateTimestampQueryPool();
 
 	/* destroyer */
 	void DestroyOffscreenRenderingResources();
 	void DestroyOffscreenRenderPassResources();
 	void DestroyFrameBuffers();
 
+	/* statistics */
+	void LogFrameStatistics();
+	void ReadFrameTimestamps(uint32 frameIndex);
+	void WriteFrameTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 stage, EFrameTimestamp timestamp);
+	void UpdateResolutionScale(double gpuTime);
+
 	/* update */
 	void UpdateUniformBuffer();
 	void WriteBaseDescriptor();
 	void WriteSamplerDescriptor();
-	void WritePostDescriptor();
 	void Update();
+	void ReloadChangedShaders();
 	void OnResizeWindow();
+	void WaitForLastPresent();
 
 	/* draw */
 	void RecordFrameBufferCommands(uint32 swapchainImageIndex);
 	void Rasterize(const VkCommandBuffer& commandBuffer, VkExtent2D extent);
+	void RasterizeParallel(const VkCommandBuffer& commandBuffer, VkExtent2D extent, uint32 taskCount); // inside rendering begun with secondary command buffer contents
+	void RecordRasterCommands(const VkCommandBuffer& commandBuffer, VkExtent2D extent, VkPipeline pipeline, uint32 firstIndex, uint32 indexCount);
+	uint32 GetRasterTaskCount() const;
+	VkExtent2D GetSceneExtent() const;  // extent of offscreen images, swapchain extent scaled by the render scale
+	VkExtent2D GetRenderExtent() const; // offscreen extent rendered this frame, scaled inside the offscreen images
+	uint32 GetOffscreenColorAttachmentCount() const { return _isTemporalAAEnabled ? 2 : 1; } // hdr color and motion vector
 	void DrawPostProcess(const VkCommandBuffer& commandBuffer, VkExtent2D extent);
 	void DrawFrame();
 
@@ -99,6 +164,15 @@ private:
 	MKPipeline	_mkGraphicsPipeline;
 	MKPipeline  _mkPostPipeline;
 
+	/* pipeline compilation */
+	MKPipelineBuildService _mkPipelineBuildService;
+
+	/* bindless resources (descriptor set 2 of graphics pipeline) */
+	MKBindlessTable     _mkBindlessTable;
+	bool                _isBindlessRequested = true;
+	bool                _isBindlessEnabled   = false; // resolved in Setup()
+	VkBufferAllocated   _vkMaterialBuffer;
+
 	/* device properties */
 	VkPhysicalDeviceProperties _vkDeviceProperties;
 
@@ -106,7 +180,12 @@ private:
 	OBJModel _objModel;
 
 	/* offscreen render pass */
-	VkFormat              _vkOffscreenColorFormat{ VK_FORMAT_R32G32B32A32_SFLOAT };
+	EHDRColorFormat       _hdrColorFormat{ HDR_R16G16B16A16_SFLOAT };
+	VkFormat              _vkOffscreenColorFormat{ VK_FORMAT_UNDEFINED }; // resolved from _hdrColorFormat in Setup()
+	VkFormat              _vkMotionVectorFormat{ VK_FORMAT_R16G16_SINT }; // fixed point, so msaa may resolve it with sample zero instead of averaging
+	std::array<VkFormat, 2> _vkOffscreenColorFormats{};                   // color attachment formats of offscreen rendering, referenced by pipeline rendering info
+	VkSampleCountFlagBits _msaaSampleCountRequested = VK_SAMPLE_COUNT_1_BIT;
+	VkSampleCountFlagBits _vkMsaaSampleCount        = VK_SAMPLE_COUNT_1_BIT; // resolved in Setup(), the highest supported count up to the requested one
 	VkFormat              _vkOffscreenDepthFormat{ VK_FORMAT_X8_D24_UNORM_PACK32 };
 	VkImageAllocated      _vkOffscreenColorImage;
 	VkImageView           _vkOffscreenColorImageView;
@@ -114,6 +193,25 @@ private:
 	VkImageAllocated      _vkOffscreenDepthImage;
 	VkImageView           _vkOffscreenDepthImageView;
 	VkDescriptorImageInfo _vkOffscreenColorDescriptorInfo;
+	TransientAllocator    _transientAllocator; // render pass path only, dynamic rendering places offscreen images with the render graph
+
+	/* render graph (dynamic rendering only, rebuilt with the swapchain extent) */
+	MKRenderGraph                 _renderGraph;
+	MKRenderGraph::ResourceHandle _swapchainColorHandle = 0; // imported every frame
+	VkPipelineStageFlags2         _vkSwapchainAcquireStage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT; // first stage writing the swapchain image, waits for acquire
+
+	/* compute post processing (dynamic rendering only) */
+	PostProcessStack _postProcessStack;
+	bool             _isComputePostRequested = false;
+	bool             _isComputePostEnabled   = false; // resolved in Setup()
+
+	/* temporal anti-aliasing and upscaling (compute post only) */
+	bool             _isTemporalAARequested = false;
+	bool             _isTemporalAAEnabled   = false; // resolved in Setup()
+	float            _renderScale           = 1.0f;  // clamped in Setup(), 1 without temporal aa
+#ifdef USE_HLSL
+	XMMATRIX         _previousMvpMat = XMMatrixIdentity(); // unjittered, motion vectors of the next frame
+#endif
 	
 	/* render pass resources */
 	VkRenderPass _vkOffscreenRednerPass{ VK_NULL_HANDLE };
@@ -129,20 +227,19 @@ private:
 	/* uniform buffer objects */
 	std::vector<VkBufferAllocated>  _vkUniformBuffers;
 
-	/* descriptor */
+	/* descriptor (set layouts are reflected by pipelines and owned by GDescriptorManager) */
 	VkDescriptorSetLayout _vkBaseDescriptorSetLayout;
 	VkDescriptorSetLayout _vkSamplerDescriptorSetLayout;
 	VkDescriptorSetLayout _vkPostDescriptorSetLayout;
-	std::vector<VkDescriptorSet>  _vkBaseDescriptorSets;
-	std::vector<VkDescriptorSet>  _vkSamplerDescriptorSets;
-	std::vector<VkDescriptorSet>  _vkPostDescriptorSets;
+	std::vector<MKDescriptorManager::DescriptorSetHandle> _vkBaseDescriptorSets;
+	std::vector<MKDescriptorManager::DescriptorSetHandle> _vkSamplerDescriptorSets;
+	const MKDescriptorManager::DescriptorUpdateTemplate*  _postDescriptorTemplate = nullptr; // owned by GDescriptorManager
 
 	/* image sampler */
 	VkSampler _vkLinearSampler;
 
 	/* push constants */
-	VkPushConstantRaster             _vkPushConstantRaster;
-	std::vector<VkPushConstantRange> _vkPushConstantRanges;
+	VkPushConstantRaster _vkPushConstantRaster;
 
 	/* camera */
 	FreeCamera _camera;
@@ -153,6 +250,59 @@ private:
 	/* timer */
 	Timer _timer{};
 
+	/* shader hot reload (debug build only) */
+	ShaderHotReloader _shaderHotReloader;
+
+	/* multi-threaded recording (dynamic rendering only) */
+	bool                         _isParallelRecordingEnabled = true;
+	uint32                       _minIndicesPerRecordTask    = 3 * 16384;   // smaller scenes are recorded inline, thread overhead would dominate
+	std::vector<VkCommandBuffer> _vkSecondaryCommandBuffers;                // recorded secondaries of current frame
+
+	/* low latency mode */
+	struct LatencyStatistics
+	{
+		uint64                                pendingPresentId   = 0;   // present whose latency is not measured yet
+		std::chrono::steady_clock::time_point pendingInputTime;         // input sampling time of that present
+		double                                lastLatency        = 0.0; // in milliseconds
+		double                                accumulatedLatency = 0.0;
+		uint64                                sampleCount        = 0;
+	};
+
+	bool                                  _isLowLatencyEnabled = false;
+	uint64                                _presentId           = 0; // id of the last tagged present of current swapchain
+	std::chrono::steady_clock::time_point _frameInputTime;          // input sampling time of current frame
+	LatencyStatistics                     _latencyStatistics;
+
+	/* gpu frame timing */
+	struct GpuTimeStatistics
+	{
+		double accumulatedGpuTime = 0.0; // in milliseconds
+		uint64 sampleCount        = 0;
+	};
+
+	VkQueryPool                             _vkTimestampQueryPool{ VK_NULL_HANDLE }; // null when the graphics queue can't write timestamps
+	std::array<bool, MAX_FRAMES_IN_FLIGHT>  _isTimestampWritten{};                   // slot has timestamps to read back
+	GpuTimeStatistics                       _gpuTimeStatistics;
+
+	/**
+	* dynamic resolution (dynamic rendering only)
+	* - offscreen targets keep the swapchain extent, a scale change only shrinks render area, viewport and scissor.
+	* - gpu time is roughly proportional to the pixel count, so the scale follows sqrt(target / measured) per axis.
+	*/
+	struct DynamicResolution
+	{
+		bool   isEnabled       = false; // resolved in Setup()
+		double targetGpuTime   = 16.0;  // in milliseconds
+		double filteredGpuTime = 0.0;   // moving average, a single spike doesn't change the scale
+		float  scale           = 1.0f;
+		float  minScale        = 0.5f;
+		float  maxScale        = 1.0f;
+		uint64 changeCount     = 0;     // for statistics
+	};
+
+	bool              _isDynamicResolutionRequested = false;
+	DynamicResolution _dynamicResolution;
+
 private:
 	/* per frame member */
 	uint32 _currentFrameIndex = 0;
@@ -114,7 +114,7 @@ namespace mk
 			return swapchainCreateInfo;
 		}
 
-		VkFramebufferCreateInfo GetFramebufferCreateInfo(VkRenderPass renderPass, const std::array<VkImageView, 2>& attachments, VkExtent2D extent)
+		VkFramebufferCreateInfo GetFramebufferCreateInfo(VkRenderPass renderPass, std::span<const VkImageView> attachments, VkExtent2D extent)
 		{
 			VkFramebufferCreateInfo framebufferInfo{};
 			framebufferInfo.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -447,5 +447,17 @@ namespace mk
 
 			return bufferInfo;
 		}
+
+		VkSemaphoreSubmitInfo GetSemaphoreSubmitInfo(VkSemaphore semaphore, VkPipelineStageFlags2 stageMask, uint64 value)
+		{
+			VkSemaphoreSubmitInfo submitInfo{};
+			submitInfo.sType       = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+			submitInfo.semaphore   = semaphore;
+			submitInfo.value       = value;     // ignored for binary semaphores
+			submitInfo.stageMask   = stageMask; // stages that wait on or signal the semaphore
+			submitInfo.deviceIndex = 0;
+
+			return submitInfo;
+		}
 	}
 }
\ No newline at end of file
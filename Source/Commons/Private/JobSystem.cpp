@@ -0,0 +1,266 @@
+#include <assert.h>
+
+#include "JobSystem.h"
+#include "Utilities.h"
+
+namespace
+{
+	// index of the deque owned by this thread, threads outside the pool keep 0
+	thread_local uint32 tThreadIndex = 0;
+}
+
+JobSystem::JobSystem()
+{
+	_ownerThreadId = std::this_thread::get_id();
+
+	// deque of external threads exists from the start, so jobs can be scheduled (and run by Wait) before initialization
+	_queues.push_back(std::make_unique<WorkQueue>());
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(_wakeMutex);
+		_isStopping = true;
+	}
+	_wakeCondition.notify_all();
+
+	for (auto& worker : _workers)
+		worker.join();
+
+#ifndef NDEBUG
+	MK_LOG("job system destroyed");
+#endif
+}
+
+void JobSystem::InitJobSystem(uint32 workerCount)
+{
+	assert(_workers.empty());
+
+	uint32 hardwareCount = std::max(2u, std::thread::hardware_concurrency());
+	workerCount = workerCount != 0 ? workerCount : hardwareCount - 1;
+
+	for (uint32 it = 0; it < workerCount; it++)
+		_queues.push_back(std::make_unique<WorkQueue>());
+
+	// create every deque before the first worker starts stealing
+	_workers.reserve(workerCount);
+	for (uint32 it = 0; it < workerCount; it++)
+		_workers.emplace_back(&JobSystem::WorkerLoop, this, it + 1);
+
+#ifndef NDEBUG
+	MK_LOG(fmt::format("job system started with {} workers", workerCount));
+#endif
+}
+
+uint32 JobSystem::GetThreadIndex() const
+{
+	return tThreadIndex;
+}
+
+/**
+* ---------- job api ----------
+*/
+
+void JobSystem::Schedule(Job job, JobCounter* counter)
+{
+	if (counter)
+		counter->pending.fetch_add(1);
+
+	Push({ std::move(job), counter });
+}
+
+void JobSystem::ScheduleAfter(JobCounter& dependency, Job job, JobCounter* counter)
+{
+	if (counter)
+		counter->pending.fetch_add(1);
+
+	{
+		// the last job of dependency checks continuations under the same lock
+		std::lock_guard<std::mutex> lock(dependency._mutex);
+		if (dependency.pending.load() != 0)
+		{
+			dependency._continuations.push_back({ std::move(job), counter });
+			return;
+		}
+	}
+
+	Push({ std::move(job), counter });
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	uint32 threadIndex = GetThreadIndex();
+	bool   isHelping   = threadIndex != 0 || std::this_thread::get_id() == _ownerThreadId;
+	while (counter.pending.load() != 0)
+	{
+		if (isHelping && TryRunOne(threadIndex))
+			continue;
+
+		// the remaining jobs of counter run on other threads, sleep until one finishes it or new work is queued
+		std::unique_lock<std::mutex> lock(_wakeMutex);
+		_wakeCondition.wait(lock, [this, &counter, isHelping]() { return counter.pending.load() == 0 || (isHelping && _queuedTaskCount.load() > 0); });
+	}
+
+	// synchronize with the finishing job, so the counter can be destroyed right after
+	std::exception_ptr error = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(counter._mutex);
+		std::swap(error, counter._error);
+	}
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+void JobSystem::ScheduleBackground(Job job)
+{
+	{
+		std::lock_guard<std::mutex> lock(_backgroundQueue.mutex);
+		_backgroundQueue.tasks.push_back({ std::move(job), nullptr });
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_wakeMutex);
+		_queuedBackgroundCount.fetch_add(1);
+	}
+	_wakeCondition.notify_all(); // threads in Wait() ignore background jobs, so a single wake up could be lost on one of them
+}
+
+/**
+* ---------- private ----------
+*/
+
+void JobSystem::Push(Task task)
+{
+	{
+		WorkQueue& queue = *_queues[GetThreadIndex()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+
+	{
+		// taking the lock prevents losing the wake up between a worker's check and its wait
+		std::lock_guard<std::mutex> lock(_wakeMutex);
+		_queuedTaskCount.fetch_add(1);
+	}
+	_wakeCondition.notify_one();
+}
+
+bool JobSystem::TryRunOne(uint32 threadIndex)
+{
+	Task task;
+	bool isFound = false;
+
+	// 1. own deque, newest first (cache friendly)
+	{
+		WorkQueue& queue = *_queues[threadIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			isFound = true;
+		}
+	}
+
+	// 2. steal oldest task of other deques
+	uint32 queueCount = static_cast<uint32>(_queues.size());
+	for (uint32 it = 1; it < queueCount && !isFound; it++)
+	{
+		WorkQueue& victim = *_queues[(threadIndex + it) % queueCount];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			isFound = true;
+		}
+	}
+
+	if (!isFound)
+		return false;
+
+	_queuedTaskCount.fetch_sub(1);
+	Execute(task);
+	return true;
+}
+
+bool JobSystem::TryRunBackground()
+{
+	Task task;
+	{
+		std::lock_guard<std::mutex> lock(_backgroundQueue.mutex);
+		if (_backgroundQueue.tasks.empty())
+			return false;
+
+		task = std::move(_backgroundQueue.tasks.front());
+		_backgroundQueue.tasks.pop_front();
+	}
+
+	_queuedBackgroundCount.fetch_sub(1);
+	Execute(task);
+	return true;
+}
+
+void JobSystem::Execute(Task& task)
+{
+	std::exception_ptr error = nullptr;
+	try
+	{
+		task.job();
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+
+	if (task.counter)
+		Finish(task.counter, error);
+	else if (error)
+		MK_LOG("unhandled exception in a job without counter");
+}
+
+void JobSystem::Finish(JobCounter* counter, std::exception_ptr error)
+{
+	std::vector<JobCounter::Continuation> continuations;
+	bool isCompleted = false;
+	{
+		std::lock_guard<std::mutex> lock(counter->_mutex);
+		if (error && !counter->_error)
+			counter->_error = error;
+
+		isCompleted = counter->pending.fetch_sub(1) == 1;
+		if (isCompleted)
+			continuations.swap(counter->_continuations);
+	}
+
+	if (isCompleted)
+	{
+		// taking the lock orders the completion with a waiter's check, so it can't go to sleep right after missing it
+		{
+			std::lock_guard<std::mutex> lock(_wakeMutex);
+		}
+		_wakeCondition.notify_all();
+	}
+
+	// counter may be destroyed from here, only the moved continuations are touched
+	for (auto& continuation : continuations)
+		Push({ std::move(continuation.job), continuation.counter });
+}
+
+void JobSystem::WorkerLoop(uint32 threadIndex)
+{
+	tThreadIndex = threadIndex;
+
+	while (true)
+	{
+		if (TryRunOne(threadIndex) || TryRunBackground())
+			continue;
+
+		std::unique_lock<std::mutex> lock(_wakeMutex);
+		_wakeCondition.wait(lock, [this]() { return _isStopping || _queuedTaskCount.load() > 0 || _queuedBackgroundCount.load() > 0; });
+		if (_isStopping)
+			return;
+	}
+}
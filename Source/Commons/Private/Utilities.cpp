@@ -139,6 +139,30 @@ namespace mk
 			MK_THROW("failed to find supported tiling format!");
 		}
 
+		/* check whether given format supports features in given tiling */
+		bool IsFormatFeatureSupported(VkPhysicalDevice physicalDevice, VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features)
+		{
+			VkFormatProperties properties;
+			vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+
+			VkFormatFeatureFlags supportedFeatures = (tiling == VK_IMAGE_TILING_LINEAR) ? properties.linearTilingFeatures : properties.optimalTilingFeatures;
+			return (supportedFeatures & features) == features;
+		}
+
+		/* find hdr color format, falling back to higher precision formats when the preferred one is not supported */
+		VkFormat FindHDRColorFormat(VkPhysicalDevice physicalDevice, EHDRColorFormat preferredFormat, VkFormatFeatureFlags features)
+		{
+			// ordered from the smallest to the biggest bytes per pixel
+			const std::vector<VkFormat> hdrFormats = {
+				VK_FORMAT_B10G11R11_UFLOAT_PACK32,
+				VK_FORMAT_R16G16B16A16_SFLOAT,
+				VK_FORMAT_R32G32B32A32_SFLOAT
+			};
+
+			std::vector<VkFormat> candidates(hdrFormats.begin() + preferredFormat, hdrFormats.end());
+			return FindSupportedFormat(physicalDevice, candidates, VK_IMAGE_TILING_OPTIMAL, features);
+		}
+
 		/* find depth format */
 		VkFormat FindDepthFormat(VkPhysicalDevice physicalDevice)
 		{
@@ -214,6 +238,63 @@ namespace mk
 			}
 		}
 
+		/* attain precise synchronization2 stage flags for given layout */
+		VkPipelineStageFlags2 GetPipelineStageFlags2(VkImageLayout layout)
+		{
+			switch (layout)
+			{
+			case VK_IMAGE_LAYOUT_UNDEFINED:
+			case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:                  // ordered by semaphores
+				return VK_PIPELINE_STAGE_2_NONE;
+			case VK_IMAGE_LAYOUT_PREINITIALIZED:
+				return VK_PIPELINE_STAGE_2_HOST_BIT;
+			case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+			case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+				return VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+			case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+				return VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+			case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL:
+			case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+				return VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+			case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL:
+			case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+				return VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+			case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+				return VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+			default:
+				return VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;           // general layout may be used by anything
+			}
+		}
+
+		/* attain precise synchronization2 access flags for given layout */
+		VkAccessFlags2 GetAccessFlags2(VkImageLayout layout)
+		{
+			switch (layout)
+			{
+			case VK_IMAGE_LAYOUT_UNDEFINED:
+			case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+				return VK_ACCESS_2_NONE;
+			case VK_IMAGE_LAYOUT_PREINITIALIZED:
+				return VK_ACCESS_2_HOST_WRITE_BIT;
+			case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+				return VK_ACCESS_2_TRANSFER_WRITE_BIT;
+			case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+				return VK_ACCESS_2_TRANSFER_READ_BIT;
+			case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+				return VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+			case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL:
+			case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+				return VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL:
+			case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+				return VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+			case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+				return VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+			default:
+				return VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+			}
+		}
+
 		/* transition image layout */
 		void TransitionImageLayout(
 			VkCommandBuffer commandBuffer,
@@ -223,47 +304,29 @@ namespace mk
 		)
 		{
 			/**
-			* vkCmdPipelineBarrier specification
-			* 1. command buffer
-			* 2. source stage mask - pipeline stage at which the operations occur that should happen before the barrier
-			* 3. destination stage mask - pipeline stage at which the operations occur that should happen after the barrier
-			* 4. dependency flags - specify how to handle the barrier in terms of memory dependencies
-			* 5. memory barrier count, memory barriers - reference to memory barriers
-			* 6. buffer memory barrier count, buffer memory barriers - reference to buffer memory barriers
-			* 7. image memory barrier count, image memory barriers - reference to image memory barriers
+			* vkCmdPipelineBarrier2 with a single image barrier
+			* - source scope : commands that used the image in old layout (only their writes need to be made available)
+			* - destination scope : commands that use the image in new layout
+			* Prefer BarrierBatch when several images are transitioned at the same point, it records them with one call.
 			*/
-			VkPipelineStageFlags sourceStage;
-			VkPipelineStageFlags destinationStage;
-
-			VkImageMemoryBarrier barrier{};
-			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-			barrier.oldLayout = oldLayout;
-			barrier.newLayout = newLayout;
-
-			sourceStage = GetPipelineStageFlags(oldLayout);
-			destinationStage = GetPipelineStageFlags(newLayout);
-			barrier.srcAccessMask = GetAccessFlags(oldLayout);
-			barrier.dstAccessMask = GetAccessFlags(newLayout);
-
+			VkImageMemoryBarrier2 barrier{};
+			barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+			barrier.srcStageMask        = GetPipelineStageFlags2(oldLayout);
+			barrier.srcAccessMask       = GetAccessFlags2(oldLayout) & WRITE_ACCESS_MASK;
+			barrier.dstStageMask        = GetPipelineStageFlags2(newLayout);
+			barrier.dstAccessMask       = GetAccessFlags2(newLayout);
+			barrier.oldLayout           = oldLayout;
+			barrier.newLayout           = newLayout;
 			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;           // no tranfer on any queue, so ignored
 			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;           // no tranfer on any queue, so ignored
-			barrier.image = image;                                           // specify image to transition layout
-
-			// specify subresource range.
-			barrier.subresourceRange.aspectMask = subresourceRange.aspectMask;
-			barrier.subresourceRange.baseMipLevel = subresourceRange.baseMipLevel;
-			barrier.subresourceRange.levelCount = subresourceRange.levelCount;
-			barrier.subresourceRange.baseArrayLayer = subresourceRange.baseArrayLayer;
-			barrier.subresourceRange.layerCount = subresourceRange.layerCount;
-
-			vkCmdPipelineBarrier(
-				commandBuffer,
-				sourceStage, destinationStage,
-				0,
-				0, nullptr,
-				0, nullptr,
-				1, &barrier
-			);
+			barrier.image               = image;                             // specify image to transition layout
+			barrier.subresourceRange    = subresourceRange;
+
+			VkDependencyInfo dependencyInfo{};
+			dependencyInfo.sType                   = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+			dependencyInfo.imageMemoryBarrierCount = 1;
+			dependencyInfo.pImageMemoryBarriers    = &barrier;
+			vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
 		}
 
 		void TransitionImageLayoutVerbose(
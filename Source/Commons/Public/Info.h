@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include <span>
 #include "Global.h"
 #include "Conversion.h"
 #include "Types.h"
@@ -36,7 +37,7 @@ namespace mk
 	                                      		 bool isExclusive
 											  );
 		/* vulkan frame buffer create info */
-		VkFramebufferCreateInfo               GetFramebufferCreateInfo(VkRenderPass renderPass, const std::array<VkImageView, 2>& attachments ,VkExtent2D extent);
+		VkFramebufferCreateInfo               GetFramebufferCreateInfo(VkRenderPass renderPass, std::span<const VkImageView> attachments, VkExtent2D extent);
 		/* vulkan render pass create info */
 		VkRenderPassCreateInfo                GetRenderPassCreateInfo(
 			const std::vector<VkAttachmentDescription>& attachments, 
@@ -127,5 +128,8 @@ namespace mk
 												 VkBufferUsageFlags usage,
 												 VkSharingMode sharingMode
 											   );
+
+		/* semaphore submit info for vkQueueSubmit2, value is used by timeline semaphores only */
+		VkSemaphoreSubmitInfo                  GetSemaphoreSubmitInfo(VkSemaphore semaphore, VkPipelineStageFlags2 stageMask, uint64 value = 0);
 	};
 }
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <memory>
+#include <exception>
+
+#include "Types.h"
+
+/**
+* [JobCounter struct]
+* - Responsibility :
+*    - count unfinished jobs of a group, so that callers can wait for them or chain continuations after them.
+* - Note :
+*    - the first exception thrown by a job of the group is rethrown by JobSystem::Wait().
+*    - a counter must outlive every job attached to it, waiting on it guarantees that.
+*/
+struct JobCounter
+{
+	std::atomic<uint32> pending{ 0 };
+
+private:
+	friend class JobSystem;
+
+	struct Continuation
+	{
+		std::function<void()> job;
+		JobCounter*           counter;
+	};
+
+	std::mutex                _mutex;         // guards continuations and error
+	std::vector<Continuation> _continuations; // scheduled when pending drops to zero
+	std::exception_ptr        _error = nullptr;
+};
+
+/**
+* [JobSystem class]
+* - Responsibility :
+*    - run small tasks on a fixed pool of worker threads shared by every engine subsystem.
+*    - provide dependency counters and parallel-for on top of plain tasks.
+* - Note :
+*    - every worker owns a deque. The owner pushes and pops at the back, idle threads steal from the front of other deques.
+*    - the thread which created the job system (render thread) owns deque 0 and helps executing jobs while it waits.
+*      A waiting thread sleeps when there is nothing to help with, and wakes when a job is queued or its counter completes.
+*    - other threads outside the pool (shader watcher, ...) may schedule and wait, but never run jobs. Thread index 0 selects
+*      per-thread resources like command pools, which they would share with the render thread. Asynchronous engine work
+*      is scheduled as jobs instead of spawning threads, so it runs on workers.
+*    - jobs must not block on anything but JobSystem::Wait(), otherwise workers starve.
+*    - long running work (e.g. pipeline optimize-link) goes through ScheduleBackground(). Only idle workers take it,
+*      so a frame waiting on its own jobs never picks it up. Workers finish every queued job before they stop.
+*/
+class JobSystem
+{
+public:
+	using Job = std::function<void()>;
+
+public:
+	JobSystem();
+	~JobSystem();
+	void InitJobSystem(uint32 workerCount = 0); // 0 means hardware concurrency - 1, because the waiting thread runs jobs as well
+
+	/* getters */
+	uint32 GetWorkerCount() const { return static_cast<uint32>(_workers.size()); }
+	uint32 GetThreadCount() const { return GetWorkerCount() + 1; } // workers plus threads outside the pool
+	uint32 GetThreadIndex() const;                                   // 0 for threads outside the pool, 1..N for workers
+
+	/* job api */
+	void Schedule(Job job, JobCounter* counter = nullptr);
+	void ScheduleAfter(JobCounter& dependency, Job job, JobCounter* counter = nullptr); // run job once dependency reaches zero
+	void Wait(JobCounter& counter);                                                    // execute other jobs until counter reaches zero
+	void ScheduleBackground(Job job);                                                  // lowest priority, run by workers when no other job is queued
+
+	/* split [0, count) into ranges of grainSize and call func(begin, end) for each of them, blocks until every range is done */
+	template<typename Func>
+	void ParallelFor(uint32 count, uint32 grainSize, Func&& func)
+	{
+		if (count == 0)
+			return;
+
+		grainSize = std::max(1u, grainSize);
+
+		JobCounter counter;
+		for (uint32 begin = 0; begin < count; begin += grainSize)
+		{
+			uint32 end = std::min(begin + grainSize, count);
+			Schedule([&func, begin, end]() { func(begin, end); }, &counter);
+		}
+		Wait(counter);
+	}
+
+private:
+	struct Task
+	{
+		Job         job;
+		JobCounter* counter = nullptr;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex       mutex;
+		std::deque<Task> tasks;
+	};
+
+	void Push(Task task);
+	bool TryRunOne(uint32 threadIndex); // pop own deque first, then steal
+	bool TryRunBackground();            // workers only, after TryRunOne() found nothing
+	void Execute(Task& task);
+	void Finish(JobCounter* counter, std::exception_ptr error);
+	void WorkerLoop(uint32 threadIndex);
+
+private:
+	std::vector<std::unique_ptr<WorkQueue>> _queues;  // [0] is shared by threads outside the pool
+	std::vector<std::thread>                _workers;
+	std::thread::id                         _ownerThreadId; // only this one runs jobs of deque 0 among threads outside the pool
+	WorkQueue                               _backgroundQueue; // first in first out
+
+	/* sleeping workers */
+	std::atomic<bool>       _isStopping{ false };
+	std::atomic<int32>      _queuedTaskCount{ 0 }; // signed, a stealer may decrement before the pusher increments
+	std::atomic<int32>      _queuedBackgroundCount{ 0 };
+	std::mutex              _wakeMutex;
+	std::condition_variable _wakeCondition;
+};
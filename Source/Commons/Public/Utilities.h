@@ -14,6 +14,16 @@ namespace mk
 		std::vector<char> ReadFile(const std::string& filename);
 	}
 
+	namespace hash
+	{
+		/* mix a value into seed (boost::hash_combine with 64-bit golden ratio) */
+		template<typename T>
+		void Combine(uint64& seed, const T& value)
+		{
+			seed ^= static_cast<uint64>(std::hash<T>()(value)) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+		}
+	}
+
 	namespace vk
 	{
 		/* a utility to find a suitable memory type*/
@@ -61,6 +71,12 @@ namespace mk
 		/* find supported device format */
 		VkFormat FindSupportedFormat(VkPhysicalDevice physicalDevice, const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
+		/* check whether given format supports features in given tiling */
+		bool IsFormatFeatureSupported(VkPhysicalDevice physicalDevice, VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features);
+
+		/* find hdr color format, falling back to higher precision formats when the preferred one is not supported */
+		VkFormat FindHDRColorFormat(VkPhysicalDevice physicalDevice, EHDRColorFormat preferredFormat, VkFormatFeatureFlags features);
+
 		/* find depth format */
 		VkFormat FindDepthFormat(VkPhysicalDevice physicalDevice);
 
@@ -73,6 +89,20 @@ namespace mk
 		/* attain suitable access flags for given layout */
 		VkAccessFlags GetAccessFlags(VkImageLayout layout);
 
+		/* write accesses of synchronization2, only these have to be made available by the source scope of a barrier */
+		constexpr VkAccessFlags2 WRITE_ACCESS_MASK =
+			VK_ACCESS_2_HOST_WRITE_BIT |
+			VK_ACCESS_2_TRANSFER_WRITE_BIT |
+			VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+			VK_ACCESS_2_SHADER_WRITE_BIT |
+			VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+		/* attain precise synchronization2 stage and access flags of the commands using an image in given layout */
+		VkPipelineStageFlags2 GetPipelineStageFlags2(VkImageLayout layout);
+		VkAccessFlags2 GetAccessFlags2(VkImageLayout layout);
+
 		/* transition image layout */
 		void TransitionImageLayout(
 			VkCommandBuffer commandBuffer,
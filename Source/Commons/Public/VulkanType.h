@@ -85,6 +85,24 @@ struct VkPushConstantRaster
 #endif
 	float     lightIntensity;
 	LightType lightType;
+	uint32    materialBufferIndex; // bindless storage buffer holding material records
+	uint32    materialIndex;       // material record of current draw
+};
+
+// post pass push constant, maps swapchain uv to the rendered region of offscreen color (dynamic resolution)
+struct VkPushConstantPost
+{
+	glm::vec2 uvScale; // render extent / offscreen image extent
+	glm::vec2 uvMax;   // half a texel inside the rendered region, bilinear taps don't reach stale texels
+};
+
+// bindless material record (std430, matches MaterialData in fragment.hlsl)
+struct MaterialData
+{
+	uint32 diffuseTexture;  // index into bindless texture array
+	uint32 specularTexture;
+	uint32 normalTexture;
+	uint32 padding;
 };
 
 // ray push constant
@@ -115,6 +133,19 @@ enum EFragmentShaderBinding
 	TEXTURE = 1,
 };
 
+enum EHDRColorFormat
+{
+	HDR_R11G11B10_UFLOAT = 0, // VK_FORMAT_B10G11R11_UFLOAT_PACK32 (4 bytes per pixel, no alpha)
+	HDR_R16G16B16A16_SFLOAT,  // VK_FORMAT_R16G16B16A16_SFLOAT (8 bytes per pixel)
+	HDR_R32G32B32A32_SFLOAT,  // VK_FORMAT_R32G32B32A32_SFLOAT (16 bytes per pixel)
+};
+
+enum ERenderPassIndex
+{
+	OFFSCREEN_PASS = 0,
+	POST_PASS      = 1,
+};
+
 enum VkRtxDescriptorBinding 
 {
 	TLAS = 2,
@@ -1,4 +1,6 @@
 #include "OBJModel.h"
+#include "Global.h"
+#include "JobSystem.h"
 
 OBJModel::OBJModel(MKDevice& mkDeviceRef) : _mkDeviceRef(mkDeviceRef)
 {
@@ -20,17 +22,31 @@ void OBJModel::LoadModel(const std::string& modelPath, const std::vector<Texture
 	// path field initialize
 	_modelPath = modelPath;
 
-	// build texture , order of paths is : { diffuse, specular, normal }
-	int it = 0;
+	// create textures, order of paths is : { diffuse, specular, normal }
 	textures.resize(textureParams.size());
-	for (const auto& metadata : textureParams)
+	for (size_t it = 0; it < textureParams.size(); it++)
 	{
-		std::unique_ptr<Texture> texture = std::make_unique<Texture>();
-		texture->BuildTextureFromExternal(_mkDeviceRef, metadata.first, metadata.second);
-		textures[it] = std::move(texture); // move ownership of texture in this for-loop to textures vector
-		it++;
+		textures[it] = std::make_unique<Texture>();
+		textures[it]->texturePath = textureParams[it].second;
 	}
 
+	// decode images and parse the obj file in parallel, neither of them touches the device
+	JobCounter loadCounter;
+	for (auto& texture : textures)
+		GJobSystem->Schedule([texturePtr = texture.get()]() { texturePtr->DecodeTextureImage(); }, &loadCounter);
+	GJobSystem->Schedule([this]() { ParseOBJFile(); }, &loadCounter);
+	GJobSystem->Wait(loadCounter);
+
+	// upload on the calling thread, the graphics queue is not externally synchronized
+	for (size_t it = 0; it < textures.size(); it++)
+	{
+		textures[it]->CreateTextureImage(textureParams[it].first);
+		textures[it]->CreateTextureImageView(_mkDeviceRef);
+	}
+}
+
+void OBJModel::ParseOBJFile()
+{
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
 	std::vector<tinyobj::material_t> materials;
@@ -17,14 +17,23 @@ void Texture::BuildTextureFromExternal(MKDevice& device, const std::string& name
     CreateTextureImageView(device);
 }
 
-void Texture::CreateTextureImage(const std::string& name)
+void Texture::DecodeTextureImage()
 {
-    int texWidth, texHeight, texChannels;
-    stbi_uc* pixels        = stbi_load(texturePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    VkDeviceSize imageSize = static_cast<VkDeviceSize>(texWidth * texHeight * 4);
+    int texChannels;
+    pixels = stbi_load(texturePath.c_str(), &pixelWidth, &pixelHeight, &texChannels, STBI_rgb_alpha);
 
     if (!pixels)
         MK_THROW("failed to load texture image!");
+}
+
+void Texture::CreateTextureImage(const std::string& name)
+{
+    if (!pixels)
+        DecodeTextureImage();
+
+    int texWidth           = pixelWidth;
+    int texHeight          = pixelHeight;
+    VkDeviceSize imageSize = static_cast<VkDeviceSize>(texWidth * texHeight * 4);
 
     // same manner as vertex buffer creation
     VkBufferAllocated stagingBuffer;
@@ -42,6 +51,7 @@ void Texture::CreateTextureImage(const std::string& name)
 
     // free after copying pixel data to staging buffer
     stbi_image_free(pixels);
+    pixels = nullptr;
 
     GAllocator->CreateImage(
         &image,
@@ -33,6 +33,9 @@ public:
 	void RotateY(float deg);
 	void RotateZ(float deg);
 
+private:
+	void ParseOBJFile(); // fills vertices and indices, runs on a job system worker
+
 private:
 	std::string _modelPath;
 
@@ -17,12 +17,18 @@ struct Texture
 	/* texture api */
 	void BuildTextureFromExternal(MKDevice& device, const std::string& name, const std::string& path);
 	void BuildGenericTexture();
-	void CreateTextureImage(const std::string& name);
+	void DecodeTextureImage();                        // cpu only, safe to run on a job system worker
+	void CreateTextureImage(const std::string& name); // decodes first unless DecodeTextureImage() was called, then uploads
 	void CreateTextureImageView(MKDevice& device);
 	void DestroyTexture(MKDevice& device);
 	
 	/* member field */
 	std::string texturePath;
+
+	/* decoded pixels, released once uploaded */
+	stbi_uc* pixels      = nullptr;
+	int32    pixelWidth  = 0;
+	int32    pixelHeight = 0;
 	
 	VkImageAllocated  image;
 	VkImageView       imageView;
@@ -8,6 +8,10 @@ struct UniformBufferObject
 	/* (model x view x projection) transformation matrix in HLSL */
 	alignas (16)XMMATRIX mvpMat = XMMatrixIdentity(); // initialize to identity matrix
 	alignas (16)XMMATRIX viewInverseMat = XMMatrixIdentity(); // initialize to identity matrix
+
+	/* unjittered transformations of this and the previous frame, their difference is the motion vector (temporal aa) */
+	alignas (16)XMMATRIX currentMvpMat  = XMMatrixIdentity();
+	alignas (16)XMMATRIX previousMvpMat = XMMatrixIdentity();
 #else
 	/* transformation matrix in GLSL */
 	alignas (16)glm::mat4 modelMat;
@@ -2,10 +2,16 @@
 #include "CommandService.h"
 #include "DescriptorManager.h"
 #include "Allocator.h"
+#include "PipelineCache.h"
+#include "PipelineRegistry.h"
+#include "JobSystem.h"
 
 MKCommandService* GCommandService = nullptr;
 MKDescriptorManager* GDescriptorManager = nullptr;
 Allocator* GAllocator = nullptr;
+MKPipelineCache* GPipelineCache = nullptr;
+MKPipelineRegistry* GPipelineRegistry = nullptr;
+JobSystem* GJobSystem = nullptr;
 
 class MKGlobal
 {
@@ -15,6 +21,9 @@ public:
 		GCommandService    = new MKCommandService(); // command service will be deleted in MKDevice destructor
 		GDescriptorManager = new MKDescriptorManager(); // descriptor manager will be deleted in MKDevice destructor
 		GAllocator         = new Allocator();
+		GPipelineCache     = new MKPipelineCache(); // pipeline cache will be saved and deleted in MKDevice destructor
+		GPipelineRegistry  = new MKPipelineRegistry(); // pipeline registry will be deleted in MKDevice destructor
+		GJobSystem         = new JobSystem(); // job system will be deleted in Renderer destructor
 	}
 
 	~MKGlobal()
@@ -2,4 +2,7 @@
 
 extern class MKCommandService*     GCommandService;
 extern class MKDescriptorManager*  GDescriptorManager;
-extern class Allocator*            GAllocator;
\ No newline at end of file
+extern class Allocator*            GAllocator;
+extern class MKPipelineCache*      GPipelineCache;
+extern class MKPipelineRegistry*   GPipelineRegistry;
+extern class JobSystem*            GJobSystem;
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include <cstdlib>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "ShaderHotReloader.h"
+
+ShaderHotReloader::ShaderHotReloader()
+{
+}
+
+ShaderHotReloader::~ShaderHotReloader()
+{
+	Stop();
+}
+
+void ShaderHotReloader::Start(const std::string& hlslDirectory, const std::string& spirvDirectory, const std::string& dxcPath)
+{
+	if (_isRunning)
+		return;
+
+	_hlslDirectory  = hlslDirectory;
+	_spirvDirectory = spirvDirectory;
+	_dxcPath        = dxcPath;
+	_isRunning      = true;
+	_watchThread    = std::thread(&ShaderHotReloader::WatchLoop, this);
+
+#ifndef NDEBUG
+	MK_LOG(fmt::format("shader hot reload is watching {}", _hlslDirectory));
+#endif
+}
+
+void ShaderHotReloader::Stop()
+{
+	_isRunning = false;
+	if (_watchThread.joinable())
+		_watchThread.join();
+}
+
+std::vector<std::string> ShaderHotReloader::ConsumeReloadedShaders()
+{
+	std::lock_guard<std::mutex> lock(_reloadedMutex);
+
+	std::vector<std::string> reloadedShaders;
+	reloadedShaders.swap(_reloadedShaders);
+
+	return reloadedShaders;
+}
+
+/*
+-----------	PRIVATE ------------
+*/
+
+void ShaderHotReloader::WatchLoop()
+{
+#ifdef __linux__
+	int inotifyFd = inotify_init1(IN_NONBLOCK);
+	if (inotifyFd < 0 || inotify_add_watch(inotifyFd, _hlslDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		MK_LOG(fmt::format("failed to watch {}, shader hot reload disabled", _hlslDirectory));
+		if (inotifyFd >= 0)
+			close(inotifyFd);
+		return;
+	}
+
+	alignas(inotify_event) char buffer[4096];
+	while (_isRunning)
+	{
+		// wake up periodically to observe Stop()
+		pollfd pollFd{ inotifyFd, POLLIN, 0 };
+		if (poll(&pollFd, 1, 200) <= 0)
+			continue;
+
+		// editors often write a file several times, so collect a batch of events first
+		std::set<std::string> changedFiles;
+		ssize_t length = 0;
+		while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+		{
+			for (char* ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(ptr)->len)
+			{
+				auto* event = reinterpret_cast<inotify_event*>(ptr);
+				if (event->len > 0)
+					changedFiles.insert(event->name);
+			}
+		}
+
+		for (const auto& fileName : changedFiles)
+		{
+			std::filesystem::path hlslPath = std::filesystem::path(_hlslDirectory) / fileName;
+			if (hlslPath.extension() == ".hlsl")
+				CompileShader(hlslPath);
+		}
+	}
+
+	close(inotifyFd);
+#else
+	// no native watcher, compare last write time of every hlsl file
+	std::unordered_map<std::string, std::filesystem::file_time_type> writeTimes;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(_hlslDirectory, error))
+		writeTimes[entry.path().string()] = entry.last_write_time(error);
+
+	while (_isRunning)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+		for (const auto& entry : std::filesystem::directory_iterator(_hlslDirectory, error))
+		{
+			if (entry.path().extension() != ".hlsl")
+				continue;
+
+			auto writeTime = entry.last_write_time(error);
+			auto& knownTime = writeTimes[entry.path().string()];
+			if (knownTime != writeTime)
+			{
+				knownTime = writeTime;
+				CompileShader(entry.path());
+			}
+		}
+	}
+#endif
+}
+
+void ShaderHotReloader::CompileShader(const std::filesystem::path& hlslPath)
+{
+	std::string shaderModel = GetShaderModel(hlslPath);
+	if (shaderModel.empty())
+		return; // included file or unknown stage
+
+	std::string spirvPath = (std::filesystem::path(_spirvDirectory) / hlslPath.stem()).string() + ".spv";
+	std::string command   = fmt::format("\"{}\" -spirv -T {} -E main \"{}\" -Fo \"{}\"", _dxcPath, shaderModel, hlslPath.string(), spirvPath);
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	if (std::system(command.c_str()) != 0)
+	{
+		MK_LOG(fmt::format("failed to recompile {}, keeping previous shader", hlslPath.filename().string()));
+		return;
+	}
+	float elapsedTime = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+	MK_LOG(fmt::format("recompiled {} in {:.1f} ms", hlslPath.filename().string(), elapsedTime));
+
+	std::lock_guard<std::mutex> lock(_reloadedMutex);
+	if (std::find(_reloadedShaders.begin(), _reloadedShaders.end(), spirvPath) == _reloadedShaders.end())
+		_reloadedShaders.push_back(spirvPath);
+}
+
+std::string ShaderHotReloader::GetShaderModel(const std::filesystem::path& hlslPath) const
+{
+	std::string stem = hlslPath.stem().string();
+	auto endsWith = [&stem](const std::string& suffix) {
+		return stem.size() >= suffix.size() && stem.compare(stem.size() - suffix.size(), suffix.size(), suffix) == 0;
+	};
+
+	if (endsWith("vertex"))
+		return "vs_6_0";
+	if (endsWith("fragment"))
+		return "ps_6_0";
+	if (endsWith("compute"))
+		return "cs_6_0";
+
+	return "";
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <filesystem>
+#include <chrono>
+
+#include "Utilities.h"
+
+/**
+* [ShaderHotReloader class]
+* - Responsibility :
+*    - watch HLSL source directory and recompile changed shaders to SPIR-V with DXC on a background thread.
+*    - hand the recompiled SPIR-V paths to the render thread, which rebuilds the affected pipelines.
+* - Note :
+*    - uses inotify on linux and polls file timestamps on other platforms.
+*    - shader model follows the CMake DXC step : *vertex.hlsl -> vs_6_0, *fragment.hlsl -> ps_6_0, *compute.hlsl -> cs_6_0.
+*/
+class ShaderHotReloader
+{
+public:
+	ShaderHotReloader();
+	~ShaderHotReloader();
+
+	void Start(const std::string& hlslDirectory, const std::string& spirvDirectory, const std::string& dxcPath = "dxc");
+	void Stop();
+
+	/* returns SPIR-V paths recompiled since the last call */
+	std::vector<std::string> ConsumeReloadedShaders();
+
+private:
+	void WatchLoop();
+	void CompileShader(const std::filesystem::path& hlslPath);
+	std::string GetShaderModel(const std::filesystem::path& hlslPath) const;
+
+private:
+	std::string              _hlslDirectory;
+	std::string              _spirvDirectory;
+	std::string              _dxcPath;
+
+	std::thread              _watchThread;
+	std::atomic<bool>        _isRunning{ false };
+
+	std::vector<std::string> _reloadedShaders;
+	std::mutex               _reloadedMutex;
+};
@@ -0,0 +1,136 @@
+#include "BarrierBatch.h"
+
+namespace
+{
+	bool IsSameSubresourceRange(const VkImageSubresourceRange& lhs, const VkImageSubresourceRange& rhs)
+	{
+		return lhs.aspectMask == rhs.aspectMask &&
+			lhs.baseMipLevel == rhs.baseMipLevel && lhs.levelCount == rhs.levelCount &&
+			lhs.baseArrayLayer == rhs.baseArrayLayer && lhs.layerCount == rhs.layerCount;
+	}
+}
+
+BarrierBatch::BarrierBatch() {}
+BarrierBatch::~BarrierBatch() {}
+
+/*
+----------- Barrier api -----------
+*/
+void BarrierBatch::AddImageBarrier(const VkImageMemoryBarrier2& barrier)
+{
+	/**
+	* fold a chained transition into the pending barrier of the same subresources
+	* - nothing is recorded between the two barriers, so the intermediate layout is never used.
+	* - the folded barrier waits for both source scopes and makes both destination scopes wait.
+	*/
+	for (auto& pending : _vkImageBarriers)
+	{
+		if (pending.image != barrier.image || !IsSameSubresourceRange(pending.subresourceRange, barrier.subresourceRange))
+			continue;
+
+		if (pending.newLayout == barrier.oldLayout)
+		{
+			pending.srcStageMask  |= barrier.srcStageMask;
+			pending.srcAccessMask |= barrier.srcAccessMask;
+			pending.dstStageMask  |= barrier.dstStageMask;
+			pending.dstAccessMask |= barrier.dstAccessMask;
+			pending.newLayout      = barrier.newLayout;
+			_statistics.foldedBarrierCount++;
+			return;
+		}
+	}
+
+	_vkImageBarriers.push_back(barrier);
+}
+
+void BarrierBatch::AddImageBarrier(
+	VkImage image,
+	const VkImageSubresourceRange& subresourceRange,
+	VkImageLayout oldLayout, VkImageLayout newLayout,
+	VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+	VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess
+)
+{
+	VkImageMemoryBarrier2 barrier{};
+	barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	barrier.srcStageMask        = srcStage;
+	barrier.srcAccessMask       = srcAccess;
+	barrier.dstStageMask        = dstStage;
+	barrier.dstAccessMask       = dstAccess;
+	barrier.oldLayout           = oldLayout;
+	barrier.newLayout           = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image               = image;
+	barrier.subresourceRange    = subresourceRange;
+
+	AddImageBarrier(barrier);
+}
+
+void BarrierBatch::AddImageTransition(VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout oldLayout, VkImageLayout newLayout)
+{
+	// wait only for the stages that used the old layout, instead of the whole pipeline
+	AddImageBarrier(
+		image,
+		subresourceRange,
+		oldLayout, newLayout,
+		mk::vk::GetPipelineStageFlags2(oldLayout), mk::vk::GetAccessFlags2(oldLayout) & mk::vk::WRITE_ACCESS_MASK,
+		mk::vk::GetPipelineStageFlags2(newLayout), mk::vk::GetAccessFlags2(newLayout)
+	);
+}
+
+void BarrierBatch::AddBufferBarrier(
+	VkBuffer buffer,
+	VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+	VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess,
+	VkDeviceSize offset, VkDeviceSize size
+)
+{
+	for (auto& pending : _vkBufferBarriers)
+	{
+		if (pending.buffer != buffer || pending.offset != offset || pending.size != size)
+			continue;
+
+		pending.srcStageMask  |= srcStage;
+		pending.srcAccessMask |= srcAccess;
+		pending.dstStageMask  |= dstStage;
+		pending.dstAccessMask |= dstAccess;
+		_statistics.foldedBarrierCount++;
+		return;
+	}
+
+	VkBufferMemoryBarrier2 barrier{};
+	barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+	barrier.srcStageMask        = srcStage;
+	barrier.srcAccessMask       = srcAccess;
+	barrier.dstStageMask        = dstStage;
+	barrier.dstAccessMask       = dstAccess;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer              = buffer;
+	barrier.offset              = offset;
+	barrier.size                = size;
+	_vkBufferBarriers.push_back(barrier);
+}
+
+void BarrierBatch::Flush(VkCommandBuffer commandBuffer)
+{
+	if (IsEmpty())
+		return;
+
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32>(_vkBufferBarriers.size());
+	dependencyInfo.pBufferMemoryBarriers    = _vkBufferBarriers.data();
+	dependencyInfo.imageMemoryBarrierCount  = static_cast<uint32>(_vkImageBarriers.size());
+	dependencyInfo.pImageMemoryBarriers     = _vkImageBarriers.data();
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+	_statistics.flushCount++;
+	_statistics.imageBarrierCount  += _vkImageBarriers.size();
+	_statistics.bufferBarrierCount += _vkBufferBarriers.size();
+
+	// keep capacity, batches are refilled every frame
+	_vkImageBarriers.clear();
+	_vkBufferBarriers.clear();
+}
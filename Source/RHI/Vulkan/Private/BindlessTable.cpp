@@ -0,0 +1,204 @@
+#include "BindlessTable.h"
+
+MKBindlessTable::MKBindlessTable()
+{
+}
+
+MKBindlessTable::~MKBindlessTable()
+{
+	if (_mkDevicePtr == nullptr)
+		return; // never initialized (descriptor indexing not supported)
+
+	// descriptor set is freed with its pool (or lives in GDescriptorManager's descriptor buffer)
+	if (_vkDescriptorPool != VK_NULL_HANDLE)
+		vkDestroyDescriptorPool(_mkDevicePtr->GetDevice(), _vkDescriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(_mkDevicePtr->GetDevice(), _vkSetLayout, nullptr);
+
+#ifndef NDEBUG
+	MK_LOG("bindless descriptor table destroyed");
+#endif
+}
+
+void MKBindlessTable::InitBindlessTable(MKDevice* mkDevicePtr, uint32 maxTextures, uint32 maxStorageBuffers)
+{
+	_mkDevicePtr = mkDevicePtr;
+
+	const auto& support = _mkDevicePtr->GetDescriptorIndexingSupport();
+	if (!support.isSupported)
+		MK_THROW("descriptor indexing is not supported, bindless table can't be created");
+
+	_isDescriptorBuffer = GDescriptorManager->IsDescriptorBufferEnabled();
+
+	// descriptor buffer sets are not update-after-bind, so regular per stage limits apply
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(_mkDevicePtr->GetPhysicalDevice(), &deviceProperties);
+	const VkPhysicalDeviceLimits& limits = deviceProperties.limits;
+	_textureSlots.capacity       = _isDescriptorBuffer ? std::min(maxTextures, limits.maxPerStageDescriptorSampledImages)
+	                                                   : std::min(maxTextures, support.maxUpdateAfterBindSampledImages);
+	_storageBufferSlots.capacity = _isDescriptorBuffer ? std::min(maxStorageBuffers, limits.maxPerStageDescriptorStorageBuffers)
+	                                                   : std::min(maxStorageBuffers, support.maxUpdateAfterBindStorageBuffers);
+
+	// 1. layout with two runtime sized arrays, every slot may stay unwritten
+	std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+	bindings[TEXTURES].binding                = TEXTURES;
+	bindings[TEXTURES].descriptorType         = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	bindings[TEXTURES].descriptorCount        = _textureSlots.capacity;
+	bindings[TEXTURES].stageFlags             = VK_SHADER_STAGE_ALL;
+	bindings[STORAGE_BUFFERS].binding         = STORAGE_BUFFERS;
+	bindings[STORAGE_BUFFERS].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[STORAGE_BUFFERS].descriptorCount = _storageBufferSlots.capacity;
+	bindings[STORAGE_BUFFERS].stageFlags      = VK_SHADER_STAGE_ALL;
+
+	// descriptor buffer memory may always be written while in use, update-after-bind flags are not allowed there
+	const VkDescriptorBindingFlags bindingFlag = _isDescriptorBuffer ?
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT :
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+		VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+		VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+	std::array<VkDescriptorBindingFlags, 2> bindingFlags = { bindingFlag, bindingFlag };
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount  = static_cast<uint32>(bindingFlags.size());
+	bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext        = &bindingFlagsInfo;
+	layoutInfo.flags        = _isDescriptorBuffer ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutInfo.bindingCount = static_cast<uint32>(bindings.size());
+	layoutInfo.pBindings    = bindings.data();
+
+	MK_CHECK(vkCreateDescriptorSetLayout(_mkDevicePtr->GetDevice(), &layoutInfo, nullptr, &_vkSetLayout));
+
+	if (_isDescriptorBuffer)
+	{
+		// 2. sub-allocate the set from the shared descriptor buffer, no pool needed
+		_descriptorSet = GDescriptorManager->AllocateDescriptorBufferSet(_vkSetLayout);
+	}
+	else
+	{
+		CreateDescriptorPoolSet();
+	}
+
+#ifndef NDEBUG
+	MK_LOG(fmt::format("bindless descriptor table created : {} textures, {} storage buffers", _textureSlots.capacity, _storageBufferSlots.capacity));
+#endif
+}
+
+void MKBindlessTable::CreateDescriptorPoolSet()
+{
+	// 2. dedicated update-after-bind pool holding the only set
+	std::array<VkDescriptorPoolSize, 2> poolSizes = {{
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,  _textureSlots.capacity },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _storageBufferSlots.capacity }
+	}};
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets       = 1;
+	poolInfo.poolSizeCount = static_cast<uint32>(poolSizes.size());
+	poolInfo.pPoolSizes    = poolSizes.data();
+
+	MK_CHECK(vkCreateDescriptorPool(_mkDevicePtr->GetDevice(), &poolInfo, nullptr, &_vkDescriptorPool));
+
+	// 3. allocate global descriptor set
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool     = _vkDescriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts        = &_vkSetLayout;
+
+	MK_CHECK(vkAllocateDescriptorSets(_mkDevicePtr->GetDevice(), &allocInfo, &_descriptorSet.descriptorSet));
+	_descriptorSet.layout = _vkSetLayout;
+}
+
+/*
+----------- Registration api -----------
+*/
+uint32 MKBindlessTable::RegisterTexture(VkImageView imageView, VkImageLayout imageLayout)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	uint32 index = AllocateSlot(_textureSlots, "texture");
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageView   = imageView;
+	imageInfo.imageLayout = imageLayout;
+	imageInfo.sampler     = VK_NULL_HANDLE;
+
+	VkWriteDescriptorSet write{};
+	write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet          = _descriptorSet.descriptorSet;
+	write.dstBinding      = TEXTURES;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	write.pImageInfo      = &imageInfo;
+
+	WriteDescriptor(write);
+
+	return index;
+}
+
+uint32 MKBindlessTable::RegisterStorageBuffer(VkBuffer buffer, VkDeviceSize range, VkDeviceSize offset)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	uint32 index = AllocateSlot(_storageBufferSlots, "storage buffer");
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = offset;
+	bufferInfo.range  = range;
+
+	VkWriteDescriptorSet write{};
+	write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet          = _descriptorSet.descriptorSet;
+	write.dstBinding      = STORAGE_BUFFERS;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo     = &bufferInfo;
+
+	WriteDescriptor(write);
+
+	return index;
+}
+
+void MKBindlessTable::ReleaseTexture(uint32 index)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_textureSlots.freeSlots.push_back(index); // partially bound, so the stale descriptor can stay until the slot is rewritten
+}
+
+void MKBindlessTable::ReleaseStorageBuffer(uint32 index)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_storageBufferSlots.freeSlots.push_back(index);
+}
+
+/*
+----------- Helpers -----------
+*/
+uint32 MKBindlessTable::AllocateSlot(SlotAllocator& slots, const char* resourceName)
+{
+	if (!slots.freeSlots.empty())
+	{
+		uint32 index = slots.freeSlots.back();
+		slots.freeSlots.pop_back();
+		return index;
+	}
+
+	if (slots.next >= slots.capacity)
+		MK_THROW(fmt::format("bindless table is out of {} slots (capacity {})", resourceName, slots.capacity));
+
+	return slots.next++;
+}
+
+void MKBindlessTable::WriteDescriptor(const VkWriteDescriptorSet& write)
+{
+	if (_isDescriptorBuffer)
+		GDescriptorManager->WriteDescriptorBuffer(_descriptorSet, write);
+	else
+		vkUpdateDescriptorSets(_mkDevicePtr->GetDevice(), 1, &write, 0, nullptr);
+}
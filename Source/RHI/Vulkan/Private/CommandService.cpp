@@ -1,4 +1,8 @@
+#include <assert.h>
+
 #include "CommandService.h"
+#include "Global.h"
+#include "JobSystem.h"
 
 MKCommandService::MKCommandService() 
 {
@@ -8,6 +12,12 @@ MKCommandService::MKCommandService()
 MKCommandService::~MKCommandService()
 {
 	vkDestroyCommandPool(_mkDevicePtr->GetDevice(), _vkCommandPool, nullptr);
+	vkDestroySemaphore(_mkDevicePtr->GetDevice(), _vkFrameTimeline, nullptr);
+	vkDestroySemaphore(_mkDevicePtr->GetDevice(), _vkUploadTimeline, nullptr);
+
+	// secondary command buffers are freed with their pools
+	for (auto& threadPool : _threadCommandPools)
+		vkDestroyCommandPool(_mkDevicePtr->GetDevice(), threadPool.pool, nullptr);
 
 #ifndef NDEBUG
 	MK_LOG("command pool destroyed");
@@ -24,38 +34,68 @@ void MKCommandService::InitCommandService(MKDevice* mkDevicePtr)
 	*/
 	CreateCommandPool(&_vkCommandPool, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT); 
 	CreateCommandBuffers();
+
+	// timeline semaphores replace per frame fences and queue idles of single time commands
+	_vkFrameTimeline  = CreateTimelineSemaphore();
+	_vkUploadTimeline = CreateTimelineSemaphore();
 }
 
 void MKCommandService::SubmitCommandBufferToQueue(
 	uint32 currentFrame, 
-	VkSemaphore waitSemaphores[], 
-	VkPipelineStageFlags waitStages[], 
-	VkSemaphore signalSemaphores[], 
-	VkQueue loadedQueue, 
+	const std::vector<VkSemaphoreSubmitInfo>& waitSemaphores,
+	const std::vector<VkSemaphoreSubmitInfo>& signalSemaphores,
+	VkQueue loadedQueue
+)
+{
+	// the frame slot is free again once the timeline reaches this value
+	_frameSlotValues[currentFrame] = ++_frameTimelineValue;
+
+	std::vector<VkSemaphoreSubmitInfo> signals = signalSemaphores;
+	signals.push_back(mk::vkinfo::GetSemaphoreSubmitInfo(_vkFrameTimeline, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, _frameTimelineValue));
+
+	Submit(loadedQueue, { _vkDrawCommandBuffers[currentFrame] }, waitSemaphores, signals);
+}
+
+void MKCommandService::Submit(
+	VkQueue queue,
+	const std::vector<VkCommandBuffer>& commandBuffers,
+	const std::vector<VkSemaphoreSubmitInfo>& waitSemaphores,
+	const std::vector<VkSemaphoreSubmitInfo>& signalSemaphores,
 	VkFence fence
 )
 {
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	std::vector<VkCommandBufferSubmitInfo> commandBufferInfos(commandBuffers.size());
+	for (size_t it = 0; it < commandBuffers.size(); it++)
+	{
+		commandBufferInfos[it].sType         = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+		commandBufferInfos[it].commandBuffer = commandBuffers[it];
+		commandBufferInfos[it].deviceMask    = 0;
+	}
 
-	// specify which semaphores to wait on before execution begins and which semaphores to signal once execution finishes
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
-	// specify which command buffers to actually submit for execution
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &_vkDrawCommandBuffers[currentFrame];
-	// specify which semaphores to signal once the command buffer(s) have finished execution
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = signalSemaphores;
+	// wait stages are carried per semaphore, so any number of waits and signals can be mixed (binary and timeline)
+	VkSubmitInfo2 submitInfo{};
+	submitInfo.sType                    = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+	submitInfo.waitSemaphoreInfoCount   = static_cast<uint32>(waitSemaphores.size());
+	submitInfo.pWaitSemaphoreInfos      = waitSemaphores.data();
+	submitInfo.commandBufferInfoCount   = static_cast<uint32>(commandBufferInfos.size());
+	submitInfo.pCommandBufferInfos      = commandBufferInfos.data();
+	submitInfo.signalSemaphoreInfoCount = static_cast<uint32>(signalSemaphores.size());
+	submitInfo.pSignalSemaphoreInfos    = signalSemaphores.data();
 
-	// submit the command buffer to queueisResized
-	MK_CHECK(vkQueueSubmit(loadedQueue, 1, &submitInfo, /*optional fence*/ fence));
+	MK_CHECK(vkQueueSubmit2(queue, 1, &submitInfo, fence));
 }
 
 void MKCommandService::ResetCommandBuffer(uint32 currentFrame)
 {
 	MK_CHECK(vkResetCommandBuffer(_vkDrawCommandBuffers[currentFrame], 0));
+
+	// recycle every secondary command buffer of this frame at once
+	for (uint32 it = 0; it < _recordingThreadCount; it++)
+	{
+		ThreadCommandPool& threadPool = GetThreadCommandPool(currentFrame, it);
+		MK_CHECK(vkResetCommandPool(_mkDevicePtr->GetDevice(), threadPool.pool, 0));
+		threadPool.usedCount = 0;
+	}
 }
 
 void MKCommandService::ExecuteCommands(std::queue<VoidLambda>& commandQueue)
@@ -122,14 +162,15 @@ void MKCommandService::EndSingleTimeCommands(VkCommandBuffer& commandBuffer, VkC
 {
 	MK_CHECK(vkEndCommandBuffer(commandBuffer));
 
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-
-	MK_CHECK(vkQueueSubmit(_mkDevicePtr->GetGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE));
-	// Alternatively, a fence could be used to wait for the command buffer to complete.
-	MK_CHECK(vkQueueWaitIdle(_mkDevicePtr->GetGraphicsQueue()));
+	// only wait for this submission instead of idling the whole queue, frames in flight keep running
+	uint64 uploadValue = ++_uploadTimelineValue;
+	Submit(
+		_mkDevicePtr->GetGraphicsQueue(),
+		{ commandBuffer },
+		{},
+		{ mk::vkinfo::GetSemaphoreSubmitInfo(_vkUploadTimeline, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, uploadValue) }
+	);
+	WaitTimelineSemaphore(_vkUploadTimeline, uploadValue);
 
 	// free the command buffer right away.
 	if(commandPool == VK_NULL_HANDLE)
@@ -139,4 +180,122 @@ void MKCommandService::EndSingleTimeCommands(VkCommandBuffer& commandBuffer, VkC
 		vkFreeCommandBuffers(_mkDevicePtr->GetDevice(), commandPool, 1, &commandBuffer);
 		vkDestroyCommandPool(_mkDevicePtr->GetDevice(), commandPool, nullptr);
 	}
+}
+
+/**
+* ---------- frame pacing ----------
+*/
+
+void MKCommandService::SetFramesInFlight(uint32 count)
+{
+	// slots above the new count simply stop being used, WaitForFrame() still honors their last values
+	_framesInFlight = std::clamp(count, 1u, static_cast<uint32>(MAX_FRAMES_IN_FLIGHT));
+
+#ifndef NDEBUG
+	MK_LOG(fmt::format("frames in flight : {}", _framesInFlight));
+#endif
+}
+
+void MKCommandService::WaitForFrame(uint32 currentFrame)
+{
+	// the slot's own previous frame must be done, and the frame count limit holds even right after the count changed
+	uint64 latencyValue = _frameTimelineValue >= _framesInFlight ? _frameTimelineValue + 1 - _framesInFlight : 0;
+	uint64 waitValue    = std::max(_frameSlotValues[currentFrame], latencyValue);
+
+	if (waitValue > 0)
+		WaitTimelineSemaphore(_vkFrameTimeline, waitValue);
+}
+
+VkSemaphore MKCommandService::CreateTimelineSemaphore(uint64 initialValue)
+{
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue  = initialValue;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+	MK_CHECK(vkCreateSemaphore(_mkDevicePtr->GetDevice(), &semaphoreInfo, nullptr, &semaphore));
+	return semaphore;
+}
+
+void MKCommandService::WaitTimelineSemaphore(VkSemaphore semaphore, uint64 value)
+{
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores    = &semaphore;
+	waitInfo.pValues        = &value;
+
+	MK_CHECK(vkWaitSemaphores(_mkDevicePtr->GetDevice(), &waitInfo, UINT64_MAX));
+}
+
+void MKCommandService::InitRecordingThreads()
+{
+	assert(_threadCommandPools.empty());
+
+	// one pool per job system thread, so a job only touches the pool of the thread running it
+	_recordingThreadCount = GJobSystem->GetThreadCount();
+	_threadCommandPools.resize(MAX_FRAMES_IN_FLIGHT * _recordingThreadCount);
+
+	// transient pools are reset as a whole every frame instead of per command buffer
+	for (auto& threadPool : _threadCommandPools)
+		CreateCommandPool(&threadPool.pool, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+#ifndef NDEBUG
+	MK_LOG(fmt::format("command pools created for {} recording threads", _recordingThreadCount));
+#endif
+}
+
+void MKCommandService::RecordSecondaryCommandBuffers(
+	uint32 currentFrame,
+	const VkCommandBufferInheritanceInfo& inheritanceInfo,
+	uint32 taskCount,
+	const RecordTask& recordTask,
+	std::vector<VkCommandBuffer>& outCommandBuffers
+)
+{
+	assert(_recordingThreadCount == GJobSystem->GetThreadCount());
+	outCommandBuffers.resize(taskCount);
+
+	// jobs throw through the job system, the first error is rethrown here after every task has finished
+	GJobSystem->ParallelFor(taskCount, 1, [&](uint32 begin, uint32 end) {
+		ThreadCommandPool& threadPool = GetThreadCommandPool(currentFrame, GJobSystem->GetThreadIndex());
+		for (uint32 taskIndex = begin; taskIndex < end; taskIndex++)
+		{
+			VkCommandBuffer commandBuffer = AcquireSecondaryCommandBuffer(threadPool);
+
+			VkCommandBufferBeginInfo beginInfo{};
+			beginInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+			MK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+			recordTask(commandBuffer, taskIndex);
+			MK_CHECK(vkEndCommandBuffer(commandBuffer));
+
+			outCommandBuffers[taskIndex] = commandBuffer;
+		}
+	});
+}
+
+VkCommandBuffer MKCommandService::AcquireSecondaryCommandBuffer(ThreadCommandPool& threadPool)
+{
+	if (threadPool.usedCount == threadPool.secondaryCommandBuffers.size())
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool        = threadPool.pool;
+		allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		MK_CHECK(vkAllocateCommandBuffers(_mkDevicePtr->GetDevice(), &allocInfo, &commandBuffer));
+		threadPool.secondaryCommandBuffers.push_back(commandBuffer);
+	}
+
+	return threadPool.secondaryCommandBuffers[threadPool.usedCount++];
 }
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include "ComputePipeline.h"
+
+/*
+-----------	PUBLIC ------------
+*/
+MKComputePipeline::MKComputePipeline(MKDevice& mkDeviceRef)
+	:
+	_mkDeviceRef(mkDeviceRef)
+{
+}
+
+MKComputePipeline::~MKComputePipeline()
+{
+	// destroy pipeline layout (pipeline instances are destroyed by pipeline registry)
+	vkDestroyPipelineLayout(_mkDeviceRef.GetDevice(), _vkPipelineLayout, nullptr);
+
+#ifndef NDEBUG
+	MK_LOG("compute pipeline layout destroyed");
+#endif
+}
+
+void MKComputePipeline::SetShader(const char* path, std::string entryPoint)
+{
+	auto shaderModuleEntry = GPipelineRegistry->AcquireShaderModule(path, VK_SHADER_STAGE_COMPUTE_BIT); // shared with other pipelines using the same shader
+
+	_vkShaderModule   = shaderModuleEntry.shaderModule;
+	_shaderPath       = path;
+	_entryPoint       = entryPoint;
+	_shaderGeneration = shaderModuleEntry.generation;
+	_reflection       = shaderModuleEntry.reflection;
+}
+
+void MKComputePipeline::SetDescriptorSetLayout(uint32 set, VkDescriptorSetLayout layout)
+{
+	_vkExternalSetLayouts[set] = layout;
+}
+
+void MKComputePipeline::InitializePipelineLayout()
+{
+	if (_vkShaderModule == VK_NULL_HANDLE)
+		MK_THROW("compute shader has to be set before initializing pipeline layout");
+
+	CreatePipelineLayout();
+}
+
+VkPipeline MKComputePipeline::GetPipeline()
+{
+	if (_pipelineEntry == nullptr)
+	{
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage  = mk::vkinfo::GetPipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, _vkShaderModule, _entryPoint);
+		pipelineInfo.layout = _vkPipelineLayout;
+
+		// set layouts were created for descriptor buffers, so the pipeline has to match them
+		if (GDescriptorManager->IsDescriptorBufferEnabled())
+			pipelineInfo.flags |= VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+
+		_pipelineEntry = GPipelineRegistry->AcquireComputePipeline(GetStateKey(), pipelineInfo);
+	}
+
+	return _pipelineEntry->pipeline.load();
+}
+
+ComputeStateKey MKComputePipeline::GetStateKey() const
+{
+	// pipeline layout is derived from the shader, so the shader identity and layout contents describe the whole state
+	return ComputeStateKey{ _shaderPath, _entryPoint, _shaderGeneration, _layoutHash }; // a recreated layout may reuse the handle of a destroyed one
+}
+
+bool MKComputePipeline::RefreshShaderModule()
+{
+	auto shaderModuleEntry = GPipelineRegistry->AcquireShaderModule(_shaderPath, VK_SHADER_STAGE_COMPUTE_BIT);
+	if (shaderModuleEntry.generation == _shaderGeneration)
+		return false;
+
+	// current state is kept until the new pipeline is built, so a broken shader leaves the previous pipeline in use
+	auto previousShaderModule      = _vkShaderModule;
+	auto previousReflection        = _reflection;
+	auto previousSetLayouts        = _vkSetLayouts;
+	auto previousPushConstantRange = _vkPushConstantRange;
+	auto previousPipelineLayout    = _vkPipelineLayout;
+	auto previousLayoutHash        = _layoutHash;
+	auto previousPipelineEntry     = _pipelineEntry;
+
+	_vkShaderModule   = shaderModuleEntry.shaderModule;
+	_shaderGeneration = shaderModuleEntry.generation;
+	_reflection       = shaderModuleEntry.reflection; // bindings and push constant block may have changed with the shader
+	_vkPipelineLayout = VK_NULL_HANDLE;
+	try
+	{
+		_vkPushConstantRange = { 0, 0, 0 };
+		CreatePipelineLayout();
+		_pipelineEntry = nullptr;
+		GetPipeline();
+	}
+	catch (const std::exception& e)
+	{
+		MK_LOG(fmt::format("failed to rebuild compute pipeline : {}", e.what()));
+
+		vkDestroyPipelineLayout(_mkDeviceRef.GetDevice(), _vkPipelineLayout, nullptr);
+		_vkShaderModule      = previousShaderModule; // generation stays, so the broken module isn't retried until the next reload
+		_reflection          = previousReflection;
+		_vkSetLayouts        = previousSetLayouts;
+		_vkPushConstantRange = previousPushConstantRange;
+		_vkPipelineLayout    = previousPipelineLayout;
+		_layoutHash          = previousLayoutHash;
+		_pipelineEntry       = previousPipelineEntry;
+		return false;
+	}
+
+	// pipelines in the registry don't reference their layout after creation, and no command buffer is recording at reload
+	vkDestroyPipelineLayout(_mkDeviceRef.GetDevice(), previousPipelineLayout, nullptr);
+	return true;
+}
+
+/*
+-----------	PRIVATE ------------
+*/
+void MKComputePipeline::CreatePipelineLayout()
+{
+	CreateReflectedLayouts(_reflection);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount         = static_cast<uint32>(_vkSetLayouts.size());
+	pipelineLayoutInfo.pSetLayouts            = _vkSetLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = _vkPushConstantRange.size > 0 ? 1 : 0;
+	pipelineLayoutInfo.pPushConstantRanges    = _vkPushConstantRange.size > 0 ? &_vkPushConstantRange : nullptr;
+	MK_CHECK(vkCreatePipelineLayout(_mkDeviceRef.GetDevice(), &pipelineLayoutInfo, nullptr, &_vkPipelineLayout));
+}
+
+void MKComputePipeline::CreateReflectedLayouts(const mk::spirv::ShaderReflection& reflection)
+{
+	std::map<uint32, std::vector<VkDescriptorSetLayoutBinding>> reflectedBindings; // set -> bindings
+	for (const auto& reflected : reflection.bindings)
+	{
+		VkDescriptorSetLayoutBinding layoutBinding{};
+		layoutBinding.binding            = reflected.binding;
+		layoutBinding.descriptorType     = reflected.descriptorType;
+		layoutBinding.descriptorCount    = reflected.descriptorCount;
+		layoutBinding.stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT;
+		layoutBinding.pImmutableSamplers = nullptr;
+		reflectedBindings[reflected.set].push_back(layoutBinding);
+	}
+
+	uint32 setCount = 0;
+	if (!reflectedBindings.empty())
+		setCount = std::max(setCount, reflectedBindings.rbegin()->first + 1);
+	if (!_vkExternalSetLayouts.empty())
+		setCount = std::max(setCount, _vkExternalSetLayouts.rbegin()->first + 1);
+
+	// set indices must be contiguous in pipeline layout, so unused sets get an empty layout
+	_vkSetLayouts.clear();
+	_layoutHash = 0;
+	mk::hash::Combine(_layoutHash, setCount);
+	for (uint32 set = 0; set < setCount; set++)
+	{
+		// reflected sets are described by their bindings, external layouts are owned by and outlive their owners
+		auto externalIt = _vkExternalSetLayouts.find(set);
+		if (externalIt != _vkExternalSetLayouts.end())
+		{
+			_vkSetLayouts.push_back(externalIt->second);
+			mk::hash::Combine(_layoutHash, reinterpret_cast<uint64>(externalIt->second));
+			mk::hash::Combine(_layoutHash, set);
+			continue;
+		}
+		_vkSetLayouts.push_back(GDescriptorManager->AcquireDescriptorSetLayout(reflectedBindings[set]));
+		for (const auto& layoutBinding : reflectedBindings[set])
+		{
+			mk::hash::Combine(_layoutHash, layoutBinding.binding);
+			mk::hash::Combine(_layoutHash, static_cast<uint32>(layoutBinding.descriptorType));
+			mk::hash::Combine(_layoutHash, layoutBinding.descriptorCount);
+		}
+		mk::hash::Combine(_layoutHash, set); // separates the bindings of consecutive sets
+	}
+
+	if (reflection.pushConstantSize > 0)
+		_vkPushConstantRange = { VK_SHADER_STAGE_COMPUTE_BIT, 0, reflection.pushConstantSize };
+	mk::hash::Combine(_layoutHash, _vkPushConstantRange.size);
+
+#ifndef NDEBUG
+	MK_LOG(fmt::format("compute pipeline layout reflected : {} descriptor sets, {} bytes of push constant", _vkSetLayouts.size(), _vkPushConstantRange.size));
+#endif
+}
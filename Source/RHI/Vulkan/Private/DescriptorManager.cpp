@@ -11,11 +11,28 @@ MKDescriptorManager::MKDescriptorManager()
 MKDescriptorManager::~MKDescriptorManager()
 {
     // destroy descriptor pools
-    for(auto& pool : _vkDescriptorPoolReady)
-        vkDestroyDescriptorPool(_mkDevicePtr->GetDevice(), pool, nullptr);
+    DestroyPoolList(_persistentPools);
+    for (auto& frameAllocator : _frameAllocators)
+        DestroyPoolList(frameAllocator.pools);
 
-    for (auto& pool : _vkDescriptorPoolFull)
-        vkDestroyDescriptorPool(_mkDevicePtr->GetDevice(), pool, nullptr);
+    // destroy shared descriptor set layouts
+    for (auto& [key, layout] : _vkSetLayoutCache)
+        vkDestroyDescriptorSetLayout(_mkDevicePtr->GetDevice(), layout, nullptr);
+
+    // destroy descriptor update templates
+    for (auto& [key, updateTemplate] : _updateTemplateCache)
+    {
+        if (updateTemplate.vkTemplate != VK_NULL_HANDLE)
+            vkDestroyDescriptorUpdateTemplate(_mkDevicePtr->GetDevice(), updateTemplate.vkTemplate, nullptr);
+    }
+
+    // destroy descriptor buffer
+    if (_vkDescriptorBuffer != VK_NULL_HANDLE)
+    {
+        vkUnmapMemory(_mkDevicePtr->GetDevice(), _vkDescriptorBufferMemory);
+        vkDestroyBuffer(_mkDevicePtr->GetDevice(), _vkDescriptorBuffer, nullptr);
+        vkFreeMemory(_mkDevicePtr->GetDevice(), _vkDescriptorBufferMemory, nullptr);
+    }
 
 #ifndef NDEBUG
     MK_LOG("combined image sampler destroyed");
@@ -27,93 +44,172 @@ MKDescriptorManager::~MKDescriptorManager()
 #endif
 }
 
-void MKDescriptorManager::InitDescriptorManager(MKDevice* mkDevicePtr)
+void MKDescriptorManager::InitDescriptorManager(MKDevice* mkDevicePtr, bool preferDescriptorBuffer)
 {
     // initialize device pointer and swapchain extent
 	_mkDevicePtr = mkDevicePtr;
+
+    // backend is fixed for the lifetime of the manager, because layouts and pipelines are created for one of them
+    _isDescriptorBufferEnabled = preferDescriptorBuffer && _mkDevicePtr->GetDescriptorBufferSupport().isSupported;
+
+#ifndef NDEBUG
+    MK_LOG(fmt::format("descriptor backend : {}", _isDescriptorBufferEnabled ? "descriptor buffer" : "descriptor pool"));
+#endif
 }
 
 
 void MKDescriptorManager::AllocateDescriptorSet(std::vector<VkDescriptorSet>& descriptorSets, VkDescriptorSetLayout layout)
 {
     std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, layout);
-    VkDescriptorPool poolInUse = GetDescriptorPool();
-
-    // specify a single descriptor set allocation info
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool     = poolInUse;
-    allocInfo.descriptorSetCount = static_cast<uint32>(MAX_FRAMES_IN_FLIGHT);
-    allocInfo.pSetLayouts        = layouts.data();
-    allocInfo.pNext              = nullptr;
-    
     descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-    VkResult res = vkAllocateDescriptorSets(_mkDevicePtr->GetDevice(), &allocInfo, descriptorSets.data());
-    
-    if (res != VK_SUCCESS)
-    {
-        _vkDescriptorPoolFull.push_back(poolInUse); // push back the full descriptor pool
 
-        poolInUse = GetDescriptorPool(); // get new descriptor pool
-        allocInfo.descriptorPool = poolInUse; // assign new descriptor pool to allocation info
+    AllocateFromPoolList(_persistentPools, layouts.data(), static_cast<uint32>(MAX_FRAMES_IN_FLIGHT), descriptorSets.data());
+}
 
-        MK_CHECK(vkAllocateDescriptorSets(_mkDevicePtr->GetDevice(), &allocInfo, descriptorSets.data()));
+VkDescriptorPool MKDescriptorManager::CreateDescriptorPool(uint32 setCount)
+{
+    // compute descriptor counts of this pool from the ratios, never accumulate them across pools
+    std::array<VkDescriptorPoolSize, 8> poolSizes{};
+    uint32 poolSizeCount = 0;
+    for (const auto& poolSizeRatio : _poolSizeRatios)
+    {
+        assert(poolSizeCount < poolSizes.size());
+        poolSizes[poolSizeCount].type            = poolSizeRatio.type;
+        poolSizes[poolSizeCount].descriptorCount = std::max(1u, static_cast<uint32>(poolSizeRatio.ratio * setCount));
+        poolSizeCount++;
     }
 
-    _vkDescriptorPoolReady.push_back(poolInUse); // push back the in-use descriptor pool
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets       = setCount;
+    poolInfo.poolSizeCount = poolSizeCount;
+    poolInfo.pPoolSizes    = poolSizes.data();
+
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    MK_CHECK(vkCreateDescriptorPool(_mkDevicePtr->GetDevice(), &poolInfo, nullptr, &descriptorPool));
+
+    return descriptorPool;
 }
 
-VkDescriptorPool MKDescriptorManager::GetDescriptorPool()
+void MKDescriptorManager::ResetDescriptorPool()
 {
-	VkDescriptorPool newPool = VK_NULL_HANDLE;
+    ResetPoolList(_persistentPools);
+}
 
-    if (!_vkDescriptorPoolReady.empty())
+/**
+* ---------- transient api ----------
+*/
+
+MKDescriptorManager::DescriptorSetHandle MKDescriptorManager::AllocateTransientDescriptorSet(uint32 frameIndex, VkDescriptorSetLayout layout)
+{
+    FrameDescriptorAllocator& frameAllocator = _frameAllocators[frameIndex];
+
+    DescriptorSetHandle descriptorSet{};
+    descriptorSet.layout = layout;
+
+    if (_isDescriptorBufferEnabled)
     {
-        newPool = _vkDescriptorPoolReady.back();
-        _vkDescriptorPoolReady.pop_back();
+        // reserve this frame's range of descriptor buffer on first use, then bump allocate inside it
+        if (frameAllocator.bufferEnd == 0)
+        {
+            if (_vkDescriptorBuffer == VK_NULL_HANDLE)
+                CreateDescriptorBuffer(_descriptorBufferSize);
+
+            frameAllocator.bufferBegin = SubAllocateDescriptorBuffer(_descriptorBufferHead, _descriptorBufferSize, _transientRegionSize);
+            frameAllocator.bufferHead  = frameAllocator.bufferBegin;
+            frameAllocator.bufferEnd   = frameAllocator.bufferBegin + _transientRegionSize;
+        }
+
+        VkDeviceSize layoutSize = 0;
+        _mkDevicePtr->GetDescriptorBufferSupport().pfnGetDescriptorSetLayoutSize(_mkDevicePtr->GetDevice(), layout, &layoutSize);
+        descriptorSet.bufferOffset = SubAllocateDescriptorBuffer(frameAllocator.bufferHead, frameAllocator.bufferEnd, layoutSize);
+        return descriptorSet;
     }
-    else
-    {
-        newPool = CreateDescriptorPool(_setsPerPool); // create new descriptor pool and assign it to in-use pool
 
-        if (_setsPerPool < 1024)
-            _setsPerPool = _setsPerPool * 1.5; // gradually increase the number of sets per pool
-        else
-            _setsPerPool = 1024; // if it exceeds 1024, fix it to 1024
+    AllocateFromPoolList(frameAllocator.pools, &layout, 1, &descriptorSet.descriptorSet);
+    return descriptorSet;
+}
+
+void MKDescriptorManager::ResetFrameDescriptorPools(uint32 frameIndex)
+{
+    // GPU finished the frame, so every transient set of it can be dropped at once
+    FrameDescriptorAllocator& frameAllocator = _frameAllocators[frameIndex];
+    frameAllocator.bufferHead = frameAllocator.bufferBegin;
+    ResetPoolList(frameAllocator.pools);
+}
+
+/**
+* ---------- descriptor pool lists ----------
+*/
+
+VkDescriptorPool MKDescriptorManager::GetDescriptorPool(DescriptorPoolList& poolList)
+{
+    if (!poolList.ready.empty())
+    {
+        VkDescriptorPool pool = poolList.ready.back();
+        poolList.ready.pop_back();
+        return pool;
     }
 
+    VkDescriptorPool newPool = CreateDescriptorPool(poolList.setsPerPool);
+    poolList.setsPerPool = std::min(static_cast<uint32>(poolList.setsPerPool * 1.5f), 1024u); // gradually increase the number of sets per pool
+
     return newPool;
 }
 
-VkDescriptorPool MKDescriptorManager::CreateDescriptorPool(uint32 setCount)
+void MKDescriptorManager::AllocateFromPoolList(DescriptorPoolList& poolList, const VkDescriptorSetLayout* pLayouts, uint32 setCount, VkDescriptorSet* pDescriptorSets)
 {
-    for (auto& poolSize : _vkDescriptorPoolSizes)
-        poolSize.descriptorCount = poolSize.descriptorCount * setCount;
+    VkDescriptorPool poolInUse = GetDescriptorPool(poolList);
 
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.maxSets       = setCount;
-    poolInfo.poolSizeCount = static_cast<uint32>(_vkDescriptorPoolSizes.size());
-    poolInfo.pPoolSizes    = _vkDescriptorPoolSizes.data();
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool     = poolInUse;
+    allocInfo.descriptorSetCount = setCount;
+    allocInfo.pSetLayouts        = pLayouts;
+    allocInfo.pNext              = nullptr;
 
-    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
-    MK_CHECK(vkCreateDescriptorPool(_mkDevicePtr->GetDevice(), &poolInfo, nullptr, &descriptorPool));
+    VkResult res = vkAllocateDescriptorSets(_mkDevicePtr->GetDevice(), &allocInfo, pDescriptorSets);
+    if (res == VK_ERROR_OUT_OF_POOL_MEMORY || res == VK_ERROR_FRAGMENTED_POOL)
+    {
+        poolList.full.push_back(poolInUse); // retire the full pool until next reset
 
-    return descriptorPool;
+        poolInUse = GetDescriptorPool(poolList);
+        allocInfo.descriptorPool = poolInUse;
+
+        MK_CHECK(vkAllocateDescriptorSets(_mkDevicePtr->GetDevice(), &allocInfo, pDescriptorSets));
+    }
+    else
+    {
+        MK_CHECK(res);
+    }
+
+    poolList.ready.push_back(poolInUse); // the pool may still have space for the next allocation
 }
 
-void MKDescriptorManager::ResetDescriptorPool()
+void MKDescriptorManager::ResetPoolList(DescriptorPoolList& poolList)
 {
-    for(auto pool : _vkDescriptorPoolReady)
+    for (auto pool : poolList.ready)
         vkResetDescriptorPool(_mkDevicePtr->GetDevice(), pool, 0);
 
-    for (auto pool : _vkDescriptorPoolReady)
+    for (auto pool : poolList.full)
     {
         vkResetDescriptorPool(_mkDevicePtr->GetDevice(), pool, 0);
-        _vkDescriptorPoolReady.push_back(pool);
+        poolList.ready.push_back(pool);
     }
 
-    _vkDescriptorPoolFull.clear();
+    poolList.full.clear();
+}
+
+void MKDescriptorManager::DestroyPoolList(DescriptorPoolList& poolList)
+{
+    for (auto pool : poolList.ready)
+        vkDestroyDescriptorPool(_mkDevicePtr->GetDevice(), pool, nullptr);
+
+    for (auto pool : poolList.full)
+        vkDestroyDescriptorPool(_mkDevicePtr->GetDevice(), pool, nullptr);
+
+    poolList.ready.clear();
+    poolList.full.clear();
 }
 
 void MKDescriptorManager::AddDescriptorSetLayoutBinding(VkDescriptorType descriptorType, VkShaderStageFlags shaderStageFlags, uint32_t binding, uint32_t descriptorCount)
@@ -133,6 +229,7 @@ void MKDescriptorManager::CreateDescriptorSetLayout(VkDescriptorSetLayout& layou
     // specify descriptor set layout creation info
     VkDescriptorSetLayoutCreateInfo layoutInfo = {};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.flags = _isDescriptorBufferEnabled ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0;
     layoutInfo.bindingCount = static_cast<uint32>(_vkWaitingBindings.size());
     layoutInfo.pBindings = _vkWaitingBindings.data();
 
@@ -143,133 +240,463 @@ void MKDescriptorManager::CreateDescriptorSetLayout(VkDescriptorSetLayout& layou
     _vkWaitingBindings.clear();
 }
 
-void MKDescriptorManager::WriteBufferToDescriptorSet(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range, uint32 dstBinding, VkDescriptorType descriptorType)
+VkDescriptorSetLayout MKDescriptorManager::AcquireDescriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings)
 {
-    // To keep memory of buffer info, store it in the deque temporarily
-    std::shared_ptr<VkDescriptorBufferInfo> bufferInfo = std::make_shared<VkDescriptorBufferInfo>();
-    bufferInfo->buffer = buffer;
-    bufferInfo->offset = offset;
-    bufferInfo->range = range;
-    _vkWaitingBufferInfos.insert(bufferInfo);
+    // the same bindings in any declaration order produce the same layout
+    std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding& lhs, const VkDescriptorSetLayoutBinding& rhs) {
+        return lhs.binding < rhs.binding;
+    });
+
+    // pipelines reflect their layouts on build workers, so lookup and insertion happen under one lock
+    SetLayoutKey key{ std::move(bindings) };
+    std::lock_guard<std::mutex> lock(_setLayoutMutex);
+    auto it = _vkSetLayoutCache.find(key);
+    if (it != _vkSetLayoutCache.end())
+        return it->second;
 
-	VkWriteDescriptorSet descriptorWrite = {};
-	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet = VK_NULL_HANDLE; // specify dst set when update descriptor set
-	descriptorWrite.dstBinding = dstBinding;
-	descriptorWrite.dstArrayElement = 0;
-	descriptorWrite.descriptorType = descriptorType;
-	descriptorWrite.descriptorCount = 1;
-	descriptorWrite.pBufferInfo = bufferInfo.get();
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.flags = _isDescriptorBufferEnabled ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0;
+    layoutInfo.bindingCount = static_cast<uint32>(key.bindings.size());
+    layoutInfo.pBindings = key.bindings.data();
 
-	_vkWaitingWrites.push_back(descriptorWrite);
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    MK_CHECK(vkCreateDescriptorSetLayout(_mkDevicePtr->GetDevice(), &layoutInfo, nullptr, &layout));
+    _vkSetLayoutCache.emplace(std::move(key), layout);
+
+    return layout;
 }
 
-void MKDescriptorManager::WriteImageToDescriptorSet(VkImageView imageView, VkImageLayout imageLayout, uint32 dstBinding, VkDescriptorType descriptorType)
+void MKDescriptorManager::WriteBufferToDescriptorSet(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range, uint32 dstBinding, VkDescriptorType descriptorType)
 {
-    // To keep memory of image info, store it in the deque temporarily
-    std::shared_ptr<VkDescriptorImageInfo> imageInfo = std::make_shared<VkDescriptorImageInfo>();
-    imageInfo->imageView = imageView;
-    imageInfo->imageLayout = imageLayout;
-    _vkWaitingImageInfos.insert(imageInfo);
+    // infos are copied into the arena, so callers don't have to keep them alive until flush
+    uint32 infoOffset = static_cast<uint32>(_vkWaitingBufferInfos.size());
+    _vkWaitingBufferInfos.push_back({ buffer, offset, range });
+
+    PushWrite(dstBinding, descriptorType, 1, infoOffset);
+}
 
-	VkWriteDescriptorSet descriptorWrite = {};
-	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet = VK_NULL_HANDLE; // specify dst set when update descriptor set
-	descriptorWrite.dstBinding = dstBinding;
-	descriptorWrite.dstArrayElement = 0;
-	descriptorWrite.descriptorType = descriptorType;
-	descriptorWrite.descriptorCount = 1;
-	descriptorWrite.pImageInfo = imageInfo.get();
+void MKDescriptorManager::WriteImageToDescriptorSet(VkImageView imageView, VkImageLayout imageLayout, uint32 dstBinding, VkDescriptorType descriptorType)
+{
+    uint32 infoOffset = static_cast<uint32>(_vkWaitingImageInfos.size());
+    _vkWaitingImageInfos.push_back({ VK_NULL_HANDLE, imageView, imageLayout });
 
-	_vkWaitingWrites.push_back(descriptorWrite);
+    PushWrite(dstBinding, descriptorType, 1, infoOffset);
 }
 
 void MKDescriptorManager::WriteImageArrayToDescriptorSet(VkDescriptorImageInfo* imageInfosPtr, uint32 sizeOfArray, uint32 dstBinding, VkDescriptorType descriptorType)
 {
-    VkWriteDescriptorSet descriptorWrite = {};
-    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet = VK_NULL_HANDLE; // specify dst set when update descriptor set
-    descriptorWrite.dstBinding = dstBinding;
-    descriptorWrite.dstArrayElement = 0;
-    descriptorWrite.descriptorType = descriptorType;
-    descriptorWrite.descriptorCount = sizeOfArray;
-    descriptorWrite.pImageInfo = imageInfosPtr;
+    uint32 infoOffset = static_cast<uint32>(_vkWaitingImageInfos.size());
+    _vkWaitingImageInfos.insert(_vkWaitingImageInfos.end(), imageInfosPtr, imageInfosPtr + sizeOfArray);
 
-    _vkWaitingWrites.push_back(descriptorWrite);
+    PushWrite(dstBinding, descriptorType, sizeOfArray, infoOffset);
 }
 
 void MKDescriptorManager::WriteSamplerToDescriptorSet(VkSampler sampler, uint32 dstBinding, VkDescriptorType descriptorType)
 {
-    std::shared_ptr<VkDescriptorImageInfo> imageInfo = std::make_shared<VkDescriptorImageInfo>();
-    imageInfo->sampler = sampler;
-    _vkWaitingImageInfos.insert(imageInfo);
-
-    VkWriteDescriptorSet descriptorWrite = {};
-    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet = VK_NULL_HANDLE; // specify dst set when update descriptor set
-    descriptorWrite.dstBinding = dstBinding;
-    descriptorWrite.dstArrayElement = 0;
-    descriptorWrite.descriptorType = descriptorType;
-    descriptorWrite.descriptorCount = 1;
-    descriptorWrite.pImageInfo = imageInfo.get();
+    uint32 infoOffset = static_cast<uint32>(_vkWaitingImageInfos.size());
+    _vkWaitingImageInfos.push_back({ sampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED });
 
-    _vkWaitingWrites.push_back(descriptorWrite);
+    PushWrite(dstBinding, descriptorType, 1, infoOffset);
 }
 
 void MKDescriptorManager::WriteCombinedImageSamplerToDescriptorSet(VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout, uint32 dstBinding)
 {
-    std::shared_ptr<VkDescriptorImageInfo> imageInfo = std::make_shared<VkDescriptorImageInfo>();
-    imageInfo->imageView = imageView;
-    imageInfo->sampler = sampler;
-    imageInfo->imageLayout = imageLayout;
-    _vkWaitingImageInfos.insert(imageInfo); // increment ref count
+    uint32 infoOffset = static_cast<uint32>(_vkWaitingImageInfos.size());
+    _vkWaitingImageInfos.push_back({ sampler, imageView, imageLayout });
 
-    VkWriteDescriptorSet descriptorWrite = {};
-    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet = VK_NULL_HANDLE; // specify dst set when update descriptor set
-    descriptorWrite.dstBinding = dstBinding;
-    descriptorWrite.dstArrayElement = 0;
-    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrite.descriptorCount = 1;
-    descriptorWrite.pImageInfo = imageInfo.get();
-
-    _vkWaitingWrites.push_back(descriptorWrite);
+    PushWrite(dstBinding, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, infoOffset);
 }
 
 void MKDescriptorManager::WriteAccelerationStructureToDescriptorSet(const VkAccelerationStructureKHR* as, uint32 dstBinding) 
 {
-    std::shared_ptr<VkWriteDescriptorSetAccelerationStructureKHR> descriptorAsInfo = std::make_shared<VkWriteDescriptorSetAccelerationStructureKHR>(VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR);
-    descriptorAsInfo->accelerationStructureCount = 1;
-    descriptorAsInfo->pAccelerationStructures = as;
-    descriptorAsInfo->pNext = nullptr;
-    _vkWaitingAsWrites.insert(descriptorAsInfo);
+    VkWriteDescriptorSetAccelerationStructureKHR descriptorAsInfo{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR };
+    descriptorAsInfo.accelerationStructureCount = 1;
+    descriptorAsInfo.pAccelerationStructures = as; // acceleration structure handle is owned by caller
+    descriptorAsInfo.pNext = nullptr;
 
-    VkWriteDescriptorSet descriptorWrite = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
-    descriptorWrite.dstSet = VK_NULL_HANDLE; // specify dst set when update descriptor set
-    descriptorWrite.dstBinding = dstBinding;
-    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
-    descriptorWrite.descriptorCount = 1;
-    descriptorWrite.pNext = descriptorAsInfo.get();
+    uint32 infoOffset = static_cast<uint32>(_vkWaitingAsWrites.size());
+    _vkWaitingAsWrites.push_back(descriptorAsInfo);
 
-    _vkWaitingWrites.push_back(descriptorWrite);
+    PushWrite(dstBinding, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 1, infoOffset);
 }
 
 void MKDescriptorManager::UpdateDescriptorSet(VkDescriptorSet descriptorSet)
 {
-    for(auto& write : _vkWaitingWrites)
-		write.dstSet = descriptorSet;
+    StageDescriptorSet(descriptorSet);
+    FlushDescriptorWrites();
+}
+
+/**
+* ---------- batched update api ----------
+*/
+
+void MKDescriptorManager::StageDescriptorSet(VkDescriptorSet descriptorSet)
+{
+    DescriptorSetHandle handle{};
+    handle.descriptorSet = descriptorSet;
+    StageDescriptorSet(handle);
+}
+
+void MKDescriptorManager::StageDescriptorSet(const DescriptorSetHandle& descriptorSet)
+{
+    for (size_t it = _stagedWriteCount; it < _waitingWrites.size(); it++)
+        _waitingWrites[it].target = descriptorSet;
+
+    _stagedWriteCount = _waitingWrites.size();
+}
+
+void MKDescriptorManager::FlushDescriptorWrites()
+{
+    if (_stagedWriteCount != _waitingWrites.size())
+        MK_THROW("descriptor writes must be staged to a descriptor set before flush");
 
-    // update descriptor sets with waiting writes.
-    vkUpdateDescriptorSets(
-		_mkDevicePtr->GetDevice(),
-		static_cast<uint32>(_vkWaitingWrites.size()),
-		_vkWaitingWrites.data(),
-		0,
-		nullptr
-	);
+    if (_isDescriptorBufferEnabled)
+    {
+        for (const auto& pendingWrite : _waitingWrites)
+            WriteDescriptorBuffer(pendingWrite.target, ResolveWrite(pendingWrite));
+    }
+    else if (!_waitingWrites.empty())
+    {
+        // one driver call for every staged set
+        _vkResolvedWrites.clear();
+        for (const auto& pendingWrite : _waitingWrites)
+            _vkResolvedWrites.push_back(ResolveWrite(pendingWrite));
+
+        vkUpdateDescriptorSets(
+            _mkDevicePtr->GetDevice(),
+            static_cast<uint32>(_vkResolvedWrites.size()),
+            _vkResolvedWrites.data(),
+            0,
+            nullptr
+        );
+    }
 
-    // clear waiting writes and related buffer/image infos after updating descriptor set
+    // recycle the arena, clear() keeps the capacity for the next batch
     _vkWaitingBufferInfos.clear();
     _vkWaitingImageInfos.clear();
-	_vkWaitingWrites.clear();
-}
\ No newline at end of file
+    _vkWaitingAsWrites.clear();
+    _waitingWrites.clear();
+    _stagedWriteCount = 0;
+}
+
+void MKDescriptorManager::PushWrite(uint32 dstBinding, VkDescriptorType descriptorType, uint32 descriptorCount, uint32 infoOffset)
+{
+    PendingWrite pendingWrite{};
+    pendingWrite.write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    pendingWrite.write.dstSet          = VK_NULL_HANDLE; // specify dst set when stage descriptor set
+    pendingWrite.write.dstBinding      = dstBinding;
+    pendingWrite.write.dstArrayElement = 0;
+    pendingWrite.write.descriptorType  = descriptorType;
+    pendingWrite.write.descriptorCount = descriptorCount;
+    pendingWrite.infoOffset            = infoOffset;
+
+    _waitingWrites.push_back(pendingWrite);
+}
+
+VkWriteDescriptorSet MKDescriptorManager::ResolveWrite(const PendingWrite& pendingWrite) const
+{
+    VkWriteDescriptorSet write = pendingWrite.write;
+    write.dstSet = pendingWrite.target.descriptorSet;
+
+    switch (write.descriptorType)
+    {
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+        write.pBufferInfo = &_vkWaitingBufferInfos[pendingWrite.infoOffset];
+        break;
+    case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR:
+        write.pNext = &_vkWaitingAsWrites[pendingWrite.infoOffset];
+        break;
+    default:
+        write.pImageInfo = &_vkWaitingImageInfos[pendingWrite.infoOffset];
+        break;
+    }
+
+    return write;
+}
+
+/**
+* ---------- descriptor update template api ----------
+*/
+
+const MKDescriptorManager::DescriptorUpdateTemplate* MKDescriptorManager::AcquireDescriptorUpdateTemplate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorUpdateTemplateEntry>& entries)
+{
+    UpdateTemplateKey key{ layout, entries };
+    auto it = _updateTemplateCache.find(key);
+    if (it != _updateTemplateCache.end())
+        return &it->second;
+
+    DescriptorUpdateTemplate updateTemplate{};
+    updateTemplate.layout  = layout;
+    updateTemplate.entries = entries;
+
+    // descriptor buffer sets are not VkDescriptorSet, so the template is expanded by the manager there
+    if (!_isDescriptorBufferEnabled)
+    {
+        VkDescriptorUpdateTemplateCreateInfo templateInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO };
+        templateInfo.descriptorUpdateEntryCount = static_cast<uint32>(entries.size());
+        templateInfo.pDescriptorUpdateEntries   = entries.data();
+        templateInfo.templateType               = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+        templateInfo.descriptorSetLayout        = layout;
+
+        MK_CHECK(vkCreateDescriptorUpdateTemplate(_mkDevicePtr->GetDevice(), &templateInfo, nullptr, &updateTemplate.vkTemplate));
+    }
+
+    return &_updateTemplateCache.emplace(std::move(key), std::move(updateTemplate)).first->second;
+}
+
+void MKDescriptorManager::UpdateDescriptorSetWithTemplate(const DescriptorSetHandle& descriptorSet, const DescriptorUpdateTemplate* updateTemplate, const void* pData)
+{
+    if (!_isDescriptorBufferEnabled)
+    {
+        vkUpdateDescriptorSetWithTemplate(_mkDevicePtr->GetDevice(), descriptorSet.descriptorSet, updateTemplate->vkTemplate, pData);
+        return;
+    }
+
+    // expand every entry element into a single descriptor write, infos are read in place from pData
+    const uint8* data = static_cast<const uint8*>(pData);
+    for (const auto& entry : updateTemplate->entries)
+    {
+        for (uint32 it = 0; it < entry.descriptorCount; it++)
+        {
+            const void* info = data + entry.offset + it * entry.stride;
+
+            VkWriteDescriptorSet write{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+            write.dstBinding      = entry.dstBinding;
+            write.dstArrayElement = entry.dstArrayElement + it;
+            write.descriptorCount = 1;
+            write.descriptorType  = entry.descriptorType;
+            write.pImageInfo      = static_cast<const VkDescriptorImageInfo*>(info);
+            write.pBufferInfo     = static_cast<const VkDescriptorBufferInfo*>(info);
+
+            WriteDescriptorBuffer(descriptorSet, write);
+        }
+    }
+}
+
+/**
+* ---------- backend independent api ----------
+*/
+
+void MKDescriptorManager::AllocateDescriptorSet(std::vector<DescriptorSetHandle>& descriptorSets, VkDescriptorSetLayout layout)
+{
+    descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+
+    if (_isDescriptorBufferEnabled)
+    {
+        for (auto& descriptorSet : descriptorSets)
+            descriptorSet = AllocateDescriptorBufferSet(layout);
+        return;
+    }
+
+    std::vector<VkDescriptorSet> vkDescriptorSets;
+    AllocateDescriptorSet(vkDescriptorSets, layout);
+    for (size_t it = 0; it < descriptorSets.size(); it++)
+    {
+        descriptorSets[it].descriptorSet = vkDescriptorSets[it];
+        descriptorSets[it].layout        = layout;
+    }
+}
+
+MKDescriptorManager::DescriptorSetHandle MKDescriptorManager::AllocateDescriptorBufferSet(VkDescriptorSetLayout layout)
+{
+    assert(_isDescriptorBufferEnabled);
+
+    // descriptor buffer is created on first use, when allocator and device are ready
+    if (_vkDescriptorBuffer == VK_NULL_HANDLE)
+        CreateDescriptorBuffer(_descriptorBufferSize);
+
+    VkDeviceSize layoutSize = 0;
+    _mkDevicePtr->GetDescriptorBufferSupport().pfnGetDescriptorSetLayoutSize(_mkDevicePtr->GetDevice(), layout, &layoutSize);
+
+    DescriptorSetHandle descriptorSet{};
+    descriptorSet.bufferOffset = SubAllocateDescriptorBuffer(_descriptorBufferHead, _descriptorBufferSize, layoutSize);
+    descriptorSet.layout       = layout;
+    return descriptorSet;
+}
+
+void MKDescriptorManager::UpdateDescriptorSet(const DescriptorSetHandle& descriptorSet)
+{
+    // descriptor buffer backend writes straight into mapped memory on flush, no vkUpdateDescriptorSets involved
+    StageDescriptorSet(descriptorSet);
+    FlushDescriptorWrites();
+}
+
+void MKDescriptorManager::BindDescriptorBuffers(VkCommandBuffer commandBuffer)
+{
+    if (!_isDescriptorBufferEnabled || _vkDescriptorBuffer == VK_NULL_HANDLE)
+        return;
+
+    VkDescriptorBufferBindingInfoEXT bindingInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT };
+    bindingInfo.address = _descriptorBufferAddress;
+    bindingInfo.usage   = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT;
+
+    _mkDevicePtr->GetDescriptorBufferSupport().pfnCmdBindDescriptorBuffers(commandBuffer, 1, &bindingInfo);
+}
+
+void MKDescriptorManager::BindDescriptorSet(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32 setIndex, const DescriptorSetHandle& descriptorSet)
+{
+    if (!_isDescriptorBufferEnabled)
+    {
+        vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, setIndex, 1, &descriptorSet.descriptorSet, 0, nullptr);
+        return;
+    }
+
+    // every set lives in the single bound descriptor buffer (index 0)
+    uint32 bufferIndex = 0;
+    _mkDevicePtr->GetDescriptorBufferSupport().pfnCmdSetDescriptorBufferOffsets(
+        commandBuffer,
+        bindPoint,
+        pipelineLayout,
+        setIndex,
+        1,
+        &bufferIndex,
+        &descriptorSet.bufferOffset
+    );
+}
+
+void MKDescriptorManager::WriteDescriptorBuffer(const DescriptorSetHandle& descriptorSet, const VkWriteDescriptorSet& write)
+{
+    const auto& support = _mkDevicePtr->GetDescriptorBufferSupport();
+
+    // arrays of combined image samplers may have to be split into image and sampler arrays, which is not handled here
+    if (write.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER && write.descriptorCount > 1 && !support.properties.combinedImageSamplerDescriptorSingleArray)
+        MK_THROW("arrays of combined image samplers are not supported by descriptor buffer backend on this device");
+
+    VkDeviceSize bindingOffset = 0;
+    support.pfnGetDescriptorSetLayoutBindingOffset(_mkDevicePtr->GetDevice(), descriptorSet.layout, write.dstBinding, &bindingOffset);
+    VkDeviceSize descriptorSize = GetDescriptorSize(write.descriptorType);
+
+    for (uint32 it = 0; it < write.descriptorCount; it++)
+    {
+        VkDescriptorGetInfoEXT getInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT };
+        getInfo.type = write.descriptorType;
+
+        VkDescriptorAddressInfoEXT addressInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT };
+        switch (write.descriptorType)
+        {
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+            getInfo.data.pSampler = &write.pImageInfo[it].sampler;
+            break;
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            getInfo.data.pCombinedImageSampler = &write.pImageInfo[it];
+            break;
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+            getInfo.data.pSampledImage = &write.pImageInfo[it];
+            break;
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+            getInfo.data.pStorageImage = &write.pImageInfo[it];
+            break;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+        {
+            // buffers are referenced by device address, so the range must be explicit
+            const VkDescriptorBufferInfo& bufferInfo = write.pBufferInfo[it];
+            if (bufferInfo.range == VK_WHOLE_SIZE)
+                MK_THROW("descriptor buffer backend requires an explicit buffer range");
+
+            addressInfo.address = _mkDevicePtr->GetBufferDeviceAddress(bufferInfo.buffer) + bufferInfo.offset;
+            addressInfo.range   = bufferInfo.range;
+            addressInfo.format  = VK_FORMAT_UNDEFINED;
+            if (write.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+                getInfo.data.pUniformBuffer = &addressInfo;
+            else
+                getInfo.data.pStorageBuffer = &addressInfo;
+            break;
+        }
+        default:
+            MK_THROW(fmt::format("{} is not supported by descriptor buffer backend", string_VkDescriptorType(write.descriptorType)));
+        }
+
+        uint8* dst = _descriptorBufferMapped + descriptorSet.bufferOffset + bindingOffset + (write.dstArrayElement + it) * descriptorSize;
+        support.pfnGetDescriptor(_mkDevicePtr->GetDevice(), &getInfo, descriptorSize, dst);
+    }
+}
+
+/**
+* ---------- private ----------
+*/
+
+void MKDescriptorManager::CreateDescriptorBuffer(VkDeviceSize size)
+{
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size        = size;
+    bufferInfo.usage       = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    MK_CHECK(vkCreateBuffer(_mkDevicePtr->GetDevice(), &bufferInfo, nullptr, &_vkDescriptorBuffer));
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(_mkDevicePtr->GetDevice(), _vkDescriptorBuffer, &memoryRequirements);
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(_mkDevicePtr->GetPhysicalDevice(), &memoryProperties);
+
+    // prefer device local memory visible to host (resizable BAR), because GPU reads descriptors on every draw
+    uint32 memoryTypeIndex = UINT32_MAX;
+    const std::array<VkMemoryPropertyFlags, 2> candidates = {
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    };
+    for (auto properties : candidates)
+    {
+        for (uint32 it = 0; it < memoryProperties.memoryTypeCount && memoryTypeIndex == UINT32_MAX; it++)
+        {
+            if ((memoryRequirements.memoryTypeBits & (1 << it)) && (memoryProperties.memoryTypes[it].propertyFlags & properties) == properties)
+                memoryTypeIndex = it;
+        }
+    }
+    if (memoryTypeIndex == UINT32_MAX)
+        MK_THROW("failed to find host visible memory for descriptor buffer");
+
+    VkMemoryAllocateFlagsInfo allocateFlagsInfo{};
+    allocateFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+    allocateFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext           = &allocateFlagsInfo;
+    allocInfo.allocationSize  = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    MK_CHECK(vkAllocateMemory(_mkDevicePtr->GetDevice(), &allocInfo, nullptr, &_vkDescriptorBufferMemory));
+    MK_CHECK(vkBindBufferMemory(_mkDevicePtr->GetDevice(), _vkDescriptorBuffer, _vkDescriptorBufferMemory, 0));
+    MK_CHECK(vkMapMemory(_mkDevicePtr->GetDevice(), _vkDescriptorBufferMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&_descriptorBufferMapped)));
+
+    _descriptorBufferAddress = _mkDevicePtr->GetBufferDeviceAddress(_vkDescriptorBuffer);
+
+#ifndef NDEBUG
+    MK_LOG(fmt::format("descriptor buffer created ({} bytes, memory type {})", size, memoryTypeIndex));
+#endif
+}
+
+VkDeviceSize MKDescriptorManager::SubAllocateDescriptorBuffer(VkDeviceSize& head, VkDeviceSize end, VkDeviceSize size)
+{
+    // sets must start at an aligned offset
+    VkDeviceSize alignment = _mkDevicePtr->GetDescriptorBufferSupport().properties.descriptorBufferOffsetAlignment;
+    VkDeviceSize offset    = (head + alignment - 1) & ~(alignment - 1);
+    if (offset + size > end)
+        MK_THROW(fmt::format("descriptor buffer range is out of memory ({} of {} bytes used)", head, end));
+
+    head = offset + size;
+    return offset;
+}
+
+VkDeviceSize MKDescriptorManager::GetDescriptorSize(VkDescriptorType descriptorType) const
+{
+    const auto& properties = _mkDevicePtr->GetDescriptorBufferSupport().properties;
+    switch (descriptorType)
+    {
+    case VK_DESCRIPTOR_TYPE_SAMPLER:                return properties.samplerDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: return properties.combinedImageSamplerDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:          return properties.sampledImageDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:          return properties.storageImageDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:         return properties.uniformBufferDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:         return properties.storageBufferDescriptorSize;
+    default:                                        return 0;
+    }
+}
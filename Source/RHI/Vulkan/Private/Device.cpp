@@ -1,5 +1,9 @@
+#include <cstring>
+
 #include "Device.h"
 #include "CommandService.h"
+#include "PipelineCache.h"
+#include "PipelineRegistry.h"
 
 MKDevice::MKDevice(MKWindow& windowRef,const MKInstance& instanceRef)
 	: _mkWindowRef(windowRef), _mkInstanceRef(instanceRef)
@@ -20,6 +24,9 @@ MKDevice::MKDevice(MKWindow& windowRef,const MKInstance& instanceRef)
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	// enable required extensions and the optional ones the device supports
+	SelectOptionalDeviceExtensions();
+
 	// specify device properties
 	VkPhysicalDeviceProperties2 deviceProperties2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
 	deviceProperties2.pNext = nullptr;
@@ -29,10 +36,56 @@ MKDevice::MKDevice(MKWindow& windowRef,const MKInstance& instanceRef)
 	VkPhysicalDeviceFeatures2 deviceFeatures2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
 	VkPhysicalDeviceBufferDeviceAddressFeatures bufferDeviceAddressFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES };
 	VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR };
+	VkPhysicalDeviceExtendedDynamicState3FeaturesEXT extendedDynamicState3Features{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT };
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT graphicsPipelineLibraryFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT };
+	VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES };
+	VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES };
+	VkPhysicalDeviceDescriptorBufferFeaturesEXT descriptorBufferFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT };
+	VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES };
+	VkPhysicalDeviceSynchronization2Features synchronization2Features{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES };
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR };
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR };
 
 	deviceFeatures2.pNext = &bufferDeviceAddressFeatures; 
 	bufferDeviceAddressFeatures.pNext = &dynamicRenderingFeatures;
-	dynamicRenderingFeatures.pNext = nullptr;
+	dynamicRenderingFeatures.pNext = &timelineSemaphoreFeatures;
+	timelineSemaphoreFeatures.pNext = &synchronization2Features;
+	synchronization2Features.pNext = nullptr;
+
+	// extension feature structs can only be chained when the extension is enabled
+	void** pNextTail = &synchronization2Features.pNext;
+	void** pPropertiesTail = &deviceProperties2.pNext;
+	if (IsExtensionEnabled(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME))
+	{
+		*pNextTail = &extendedDynamicState3Features;
+		pNextTail  = &extendedDynamicState3Features.pNext;
+	}
+	if (IsExtensionEnabled(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME))
+	{
+		*pNextTail = &graphicsPipelineLibraryFeatures;
+		pNextTail  = &graphicsPipelineLibraryFeatures.pNext;
+	}
+	if (IsExtensionEnabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+	{
+		*pNextTail = &descriptorIndexingFeatures;
+		pNextTail  = &descriptorIndexingFeatures.pNext;
+		*pPropertiesTail = &descriptorIndexingProperties;
+		pPropertiesTail  = &descriptorIndexingProperties.pNext;
+	}
+	if (IsExtensionEnabled(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME))
+	{
+		*pNextTail = &descriptorBufferFeatures;
+		pNextTail  = &descriptorBufferFeatures.pNext;
+		*pPropertiesTail = &_descriptorBufferSupport.properties;
+		pPropertiesTail  = &_descriptorBufferSupport.properties.pNext;
+	}
+	if (IsExtensionEnabled(VK_KHR_PRESENT_ID_EXTENSION_NAME) && IsExtensionEnabled(VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+	{
+		*pNextTail = &presentIdFeatures;
+		pNextTail  = &presentIdFeatures.pNext;
+		*pNextTail = &presentWaitFeatures;
+		pNextTail  = &presentWaitFeatures.pNext;
+	}
 
 	vkGetPhysicalDeviceProperties2(_vkPhysicalDevice, &deviceProperties2); // initialize device properties with raytracing properties
 	vkGetPhysicalDeviceFeatures2(_vkPhysicalDevice, &deviceFeatures2);
@@ -41,18 +94,77 @@ MKDevice::MKDevice(MKWindow& windowRef,const MKInstance& instanceRef)
 	deviceFeatures2.features.samplerAnisotropy = VK_TRUE;
 	bufferDeviceAddressFeatures.bufferDeviceAddress = VK_TRUE;
 	dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+	timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE; // frame pacing and upload tracking
+	synchronization2Features.synchronization2 = VK_TRUE;   // vkQueueSubmit2
+	descriptorBufferFeatures.descriptorBufferCaptureReplay = VK_FALSE; // only needed by capture tools, may cost performance
+
+	// compute post writes the swapchain and graph images through RWTexture2D<float4> without a declared format
+	_isStorageImageWriteWithoutFormatSupported = deviceFeatures2.features.shaderStorageImageWriteWithoutFormat == VK_TRUE;
+	if (_isStorageImageWriteWithoutFormatSupported)
+		deviceFeatures2.features.shaderStorageImageWriteWithoutFormat = VK_TRUE;
+
+	// extended dynamic state 1 and 2 are core in Vulkan 1.3, state 3 is used only when every state we set is supported
+	_dynamicStateSupport.extendedDynamicState  = deviceProperties2.properties.apiVersion >= VK_API_VERSION_1_3;
+	_dynamicStateSupport.extendedDynamicState2 = deviceProperties2.properties.apiVersion >= VK_API_VERSION_1_3;
+	_dynamicStateSupport.extendedDynamicState3 =
+		IsExtensionEnabled(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME) &&
+		extendedDynamicState3Features.extendedDynamicState3PolygonMode &&
+		extendedDynamicState3Features.extendedDynamicState3ColorBlendEnable &&
+		extendedDynamicState3Features.extendedDynamicState3ColorBlendEquation &&
+		extendedDynamicState3Features.extendedDynamicState3ColorWriteMask;
+
+	// graphics pipeline library requires VK_KHR_pipeline_library as well
+	_isGraphicsPipelineLibrarySupported =
+		IsExtensionEnabled(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+		IsExtensionEnabled(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+		graphicsPipelineLibraryFeatures.graphicsPipelineLibrary;
+
+	// bindless textures and buffers need runtime sized arrays which are partially bound and updatable after bind
+	_descriptorIndexingSupport.isSupported =
+		IsExtensionEnabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) &&
+		descriptorIndexingFeatures.runtimeDescriptorArray &&
+		descriptorIndexingFeatures.descriptorBindingPartiallyBound &&
+		descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending &&
+		descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+		descriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind;
+
+	// bindless bindings are visible to every stage, so the per stage limits bound them as well as the per set limits
+	_descriptorIndexingSupport.maxUpdateAfterBindSampledImages  = std::min(
+		descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages, descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages);
+	_descriptorIndexingSupport.maxUpdateAfterBindStorageBuffers = std::min(
+		descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers, descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers);
+
+	// descriptor buffer relies on buffer device address which is always enabled
+	_descriptorBufferSupport.isSupported = IsExtensionEnabled(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME) && descriptorBufferFeatures.descriptorBuffer;
+	_descriptorBufferSupport.properties.pNext = nullptr; // chain pointed to stack structs
+
+	// present wait identifies presents by the id attached with VK_KHR_present_id
+	_presentWaitSupport.isSupported =
+		IsExtensionEnabled(VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+		IsExtensionEnabled(VK_KHR_PRESENT_WAIT_EXTENSION_NAME) &&
+		presentIdFeatures.presentId &&
+		presentWaitFeatures.presentWait;
 
 	// specify device creation info
-	VkDeviceCreateInfo deviceCreateInfo = mk::vkinfo::GetDeviceCreateInfo(queueCreateInfos, deviceFeatures2, deviceExtensions);
+	VkDeviceCreateInfo deviceCreateInfo = mk::vkinfo::GetDeviceCreateInfo(queueCreateInfos, deviceFeatures2, _enabledDeviceExtensions);
 	MK_CHECK(vkCreateDevice(_vkPhysicalDevice, &deviceCreateInfo, nullptr, &_vkLogicalDevice));
 
 	// retrieve queue handles from logical device
 	vkGetDeviceQueue(_vkLogicalDevice, indices.graphicsFamily.value(), 0, &_vkGraphicsQueue);
 	vkGetDeviceQueue(_vkLogicalDevice, indices.presentFamily.value(), 0, &_vkPresentQueue);
 
+	// load extension commands
+	LoadExtendedDynamicState3FunctionPointers();
+	LoadDescriptorBufferFunctionPointers();
+	LoadPresentWaitFunctionPointers();
+
 	// initialize command service
 	GCommandService->InitCommandService(this);
 
+	// initialize device-wide pipeline cache (loaded from disk if a valid blob exists)
+	GPipelineCache->InitPipelineCache(this);
+	GPipelineRegistry->InitPipelineRegistry(this);
+
 	// initialize VMA allocator
 	VmaAllocatorCreateInfo allocatorInfo = {};
 	allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_3;
@@ -71,11 +183,20 @@ MKDevice::~MKDevice()
 	// command service shoule be deleted before destroying logical device.
 	delete GCommandService; 
 
+	// registered pipelines and shader modules are released before the cache is saved.
+	delete GPipelineRegistry;
+
+	// persist compiled pipelines for the next run, then destroy the cache before logical device.
+	GPipelineCache->SavePipelineCache();
+	delete GPipelineCache;
+
 	vkDestroySurfaceKHR(_mkInstanceRef.GetVkInstance(), _vkSurface, nullptr);
 	vkDestroyDevice(_vkLogicalDevice, nullptr);
 
 #ifndef NDEBUG
 	MK_LOG("global command service instance destroyed");
+	MK_LOG("global pipeline registry instance destroyed");
+	MK_LOG("global pipeline cache instance destroyed");
 	MK_LOG("surface extension destroyed");
 	MK_LOG("logical device destroyed");
 #endif
@@ -119,11 +240,15 @@ int MKDevice::RateDeviceSuitability(VkPhysicalDevice device)
 	VkPhysicalDeviceFeatures2 deviceFeatures2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
 	VkPhysicalDeviceBufferDeviceAddressFeatures bufferDeviceAddressFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES };
 	VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR };
+	VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES };
+	VkPhysicalDeviceSynchronization2Features synchronization2Features{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES };
 
 	// features pNext chain
 	deviceFeatures2.pNext = &bufferDeviceAddressFeatures; // attach buffer device address features to device features
 	bufferDeviceAddressFeatures.pNext = &dynamicRenderingFeatures;
-	dynamicRenderingFeatures.pNext = nullptr;
+	dynamicRenderingFeatures.pNext = &timelineSemaphoreFeatures;
+	timelineSemaphoreFeatures.pNext = &synchronization2Features;
+	synchronization2Features.pNext = nullptr;
 
 	vkGetPhysicalDeviceProperties2(device, &deviceProperties2);
 	vkGetPhysicalDeviceFeatures2(device, &deviceFeatures2);
@@ -147,7 +272,9 @@ int MKDevice::RateDeviceSuitability(VkPhysicalDevice device)
 		details.presentModes.empty() ||
 		!deviceFeatures2.features.samplerAnisotropy ||
 		bufferDeviceAddressFeatures.bufferDeviceAddress != VK_TRUE ||
-		dynamicRenderingFeatures.dynamicRendering != VK_TRUE
+		dynamicRenderingFeatures.dynamicRendering != VK_TRUE ||
+		timelineSemaphoreFeatures.timelineSemaphore != VK_TRUE ||
+		synchronization2Features.synchronization2 != VK_TRUE
 	)
 		score = 0;
 
@@ -225,6 +352,97 @@ void MKDevice::SetDynamicRenderingKHRFunctionPointers()
 #endif
 }
 
+void MKDevice::LoadExtendedDynamicState3FunctionPointers()
+{
+	if (!_dynamicStateSupport.extendedDynamicState3)
+		return;
+
+	_dynamicStateSupport.pfnCmdSetPolygonMode        = reinterpret_cast<PFN_vkCmdSetPolygonModeEXT>(vkGetDeviceProcAddr(_vkLogicalDevice, "vkCmdSetPolygonModeEXT"));
+	_dynamicStateSupport.pfnCmdSetColorBlendEnable   = reinterpret_cast<PFN_vkCmdSetColorBlendEnableEXT>(vkGetDeviceProcAddr(_vkLogicalDevice, "vkCmdSetColorBlendEnableEXT"));
+	_dynamicStateSupport.pfnCmdSetColorBlendEquation = reinterpret_cast<PFN_vkCmdSetColorBlendEquationEXT>(vkGetDeviceProcAddr(_vkLogicalDevice, "vkCmdSetColorBlendEquationEXT"));
+	_dynamicStateSupport.pfnCmdSetColorWriteMask     = reinterpret_cast<PFN_vkCmdSetColorWriteMaskEXT>(vkGetDeviceProcAddr(_vkLogicalDevice, "vkCmdSetColorWriteMaskEXT"));
+
+	// fall back to baked states if any of the commands is missing
+	if (!_dynamicStateSupport.pfnCmdSetPolygonMode || !_dynamicStateSupport.pfnCmdSetColorBlendEnable ||
+		!_dynamicStateSupport.pfnCmdSetColorBlendEquation || !_dynamicStateSupport.pfnCmdSetColorWriteMask)
+	{
+		MK_LOG("failed to load VK_EXT_extended_dynamic_state3 commands, blend and polygon states stay baked into pipelines");
+		_dynamicStateSupport.extendedDynamicState3 = false;
+	}
+}
+
+void MKDevice::LoadDescriptorBufferFunctionPointers()
+{
+	if (!_descriptorBufferSupport.isSupported)
+		return;
+
+	_descriptorBufferSupport.pfnGetDescriptorSetLayoutSize          = reinterpret_cast<PFN_vkGetDescriptorSetLayoutSizeEXT>(vkGetDeviceProcAddr(_vkLogicalDevice, "vkGetDescriptorSetLayoutSizeEXT"));
+	_descriptorBufferSupport.pfnGetDescriptorSetLayoutBindingOffset = reinterpret_cast<PFN_vkGetDescriptorSetLayoutBindingOffsetEXT>(vkGetDeviceProcAddr(_vkLogicalDevice, "vkGetDescriptorSetLayoutBindingOffsetEXT"));
+	_descriptorBufferSupport.pfnGetDescriptor                       = reinterpret_cast<PFN_vkGetDescriptorEXT>(vkGetDeviceProcAddr(_vkLogicalDevice, "vkGetDescriptorEXT"));
+	_descriptorBufferSupport.pfnCmdBindDescriptorBuffers            = reinterpret_cast<PFN_vkCmdBindDescriptorBuffersEXT>(vkGetDeviceProcAddr(_vkLogicalDevice, "vkCmdBindDescriptorBuffersEXT"));
+	_descriptorBufferSupport.pfnCmdSetDescriptorBufferOffsets       = reinterpret_cast<PFN_vkCmdSetDescriptorBufferOffsetsEXT>(vkGetDeviceProcAddr(_vkLogicalDevice, "vkCmdSetDescriptorBufferOffsetsEXT"));
+
+	// fall back to descriptor pools if any of the commands is missing
+	if (!_descriptorBufferSupport.pfnGetDescriptorSetLayoutSize || !_descriptorBufferSupport.pfnGetDescriptorSetLayoutBindingOffset ||
+		!_descriptorBufferSupport.pfnGetDescriptor || !_descriptorBufferSupport.pfnCmdBindDescriptorBuffers ||
+		!_descriptorBufferSupport.pfnCmdSetDescriptorBufferOffsets)
+	{
+		MK_LOG("failed to load VK_EXT_descriptor_buffer commands, descriptors stay in descriptor pools");
+		_descriptorBufferSupport.isSupported = false;
+	}
+}
+
+void MKDevice::LoadPresentWaitFunctionPointers()
+{
+	if (!_presentWaitSupport.isSupported)
+		return;
+
+	_presentWaitSupport.pfnWaitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(_vkLogicalDevice, "vkWaitForPresentKHR"));
+
+	if (!_presentWaitSupport.pfnWaitForPresent)
+	{
+		MK_LOG("failed to load VK_KHR_present_wait commands, low latency mode can't pace to the display");
+		_presentWaitSupport.isSupported = false;
+	}
+}
+
+void MKDevice::SelectOptionalDeviceExtensions()
+{
+	uint32 availableExtensionCount;
+	vkEnumerateDeviceExtensionProperties(_vkPhysicalDevice, nullptr, &availableExtensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(availableExtensionCount);
+	vkEnumerateDeviceExtensionProperties(_vkPhysicalDevice, nullptr, &availableExtensionCount, availableExtensions.data());
+
+	_enabledDeviceExtensions = deviceExtensions;
+	for (const char* optionalExtension : optionalDeviceExtensions)
+	{
+		for (const auto& extension : availableExtensions)
+		{
+			if (strcmp(extension.extensionName, optionalExtension) == 0)
+			{
+				_enabledDeviceExtensions.push_back(optionalExtension);
+				break;
+			}
+		}
+	}
+
+#ifndef NDEBUG
+	for (const char* extension : _enabledDeviceExtensions)
+		MK_LOG(fmt::format("device extension enabled : {}", extension));
+#endif
+}
+
+bool MKDevice::IsExtensionEnabled(const char* extensionName) const
+{
+	for (const char* extension : _enabledDeviceExtensions)
+	{
+		if (strcmp(extension, extensionName) == 0)
+			return true;
+	}
+
+	return false;
+}
+
 bool MKDevice::IsDeviceExtensionSupported(VkPhysicalDevice device)
 {
 	uint32 availableExtensionCount;
@@ -246,8 +464,20 @@ void MKDevice::CreateWindowSurface()
 	MK_CHECK(glfwCreateWindowSurface(_mkInstanceRef.GetVkInstance(), _mkWindowRef.GetWindow(), nullptr, &_vkSurface));
 }
 
-VkSurfaceFormatKHR MKDevice::ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
+VkSurfaceFormatKHR MKDevice::ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats, bool isStorageRequired)
 {
+	// storage images are written without sRGB encoding, so a UNORM format is picked and the shader encodes sRGB itself
+	if (isStorageRequired)
+	{
+		for (const auto& availableFormat : availableFormats)
+		{
+			bool isUnorm = availableFormat.format == VK_FORMAT_B8G8R8A8_UNORM || availableFormat.format == VK_FORMAT_R8G8B8A8_UNORM;
+			if (isUnorm && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR &&
+				mk::vk::IsFormatFeatureSupported(_vkPhysicalDevice, availableFormat.format, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT))
+				return availableFormat;
+		}
+	}
+
 	for (const auto& availableFormat : availableFormats) 
 	{
 		// target format		: VK_FORMAT_B8G8R8A8_SRGB (32 bits per pixel)
@@ -259,8 +489,13 @@ VkSurfaceFormatKHR MKDevice::ChooseSwapSurfaceFormat(const std::vector<VkSurface
 	return availableFormats[0];
 }
 
-VkPresentModeKHR MKDevice::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
+VkPresentModeKHR MKDevice::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, bool isLowLatency)
 {
+	// with present wait the cpu is paced to the display, so fifo queues at most one frame and never renders frames that are thrown away.
+	// without it, mailbox is the lowest latency mode that does not tear.
+	if (isLowLatency && _presentWaitSupport.isSupported)
+		return VK_PRESENT_MODE_FIFO_KHR;
+
 	for (const auto& availablePresentMode : availablePresentModes)
 	{
 		// target present mode			: VK_PRESENT_MODE_MAILBOX_KHR (triple buffering)
@@ -1,4 +1,7 @@
+#include <assert.h>
+
 #include "Pipeline.h" 
+#include "JobSystem.h"
 
 /*
 -----------	PUBLIC ------------
@@ -17,40 +20,38 @@ MKPipeline::~MKPipeline()
 	{
 		vkDestroySemaphore(_mkDeviceRef.GetDevice(), _renderingResources[i].renderFinishedSema, nullptr);
 		vkDestroySemaphore(_mkDeviceRef.GetDevice(), _renderingResources[i].imageAvailableSema, nullptr);
-		vkDestroyFence(_mkDeviceRef.GetDevice(), _renderingResources[i].inFlightFence, nullptr);
 	}
 
-	// destroy pipeline and pipeline layout
-	vkDestroyPipeline(_mkDeviceRef.GetDevice(), _vkPipelineInstance, nullptr);
+	// destroy pipeline layout (pipeline instances are destroyed by pipeline registry)
+	if (_pendingPipelineEntry.valid())
+		_pendingPipelineEntry.wait();
+	GPipelineRegistry->WaitForBackgroundCompiles(); // optimize-link may still reference the layout
 	vkDestroyPipelineLayout(_mkDeviceRef.GetDevice(), _vkPipelineLayout, nullptr);
 
 #ifndef NDEBUG
 	MK_LOG("sync objects destroyed");
-	MK_LOG("graphics pipeline and its layout destroyed");
+	MK_LOG("graphics pipeline layout destroyed");
 #endif
 }
 
 void MKPipeline::AddShader(const char* path, std::string entryPoint, VkShaderStageFlagBits stageBit)
 {
-	auto shaderCode = mk::file::ReadFile(path);
-
-	VkShaderModule shaderModule = mk::vk::CreateShaderModule(_mkDeviceRef.GetDevice(), shaderCode); // create shader module, should be destroyed after creating a pipeline.
+	auto shaderModuleEntry = GPipelineRegistry->AcquireShaderModule(path, stageBit); // shared with other pipelines using the same shader
+	MergeReflection(shaderModuleEntry.reflection);
 
 	ShaderDesc shaderDesc;
-	shaderDesc.shaderModule = shaderModule;
+	shaderDesc.shaderModule = shaderModuleEntry.shaderModule;
 	shaderDesc.entryPoint = entryPoint;
 	shaderDesc.stage = stageBit;
+	shaderDesc.path = path;
+	shaderDesc.generation = shaderModuleEntry.generation;
 
-	_waitShaders.push_back(shaderDesc);
+	_shaders.push_back(shaderDesc);
 }
 
 void MKPipeline::InitializePipelineLayout()
 {
-	for (auto& shader : _waitShaders)
-	{
-		VkPipelineShaderStageCreateInfo shaderStageInfo = mk::vkinfo::GetPipelineShaderStageCreateInfo(shader.stage, shader.shaderModule, shader.entryPoint);
-		shaderStages.push_back(shaderStageInfo);
-	}
+	UpdateShaderStages();
 
 	// vertex description
 	vertexInput = mk::vkinfo::GetPipelineVertexInputStateCreateInfo<3>(bindingDesc, attribDesc);
@@ -69,7 +70,7 @@ void MKPipeline::InitializePipelineLayout()
 	// rasterizer
 	rasterizer = mk::vkinfo::GetPipelineRasterizationStateCreateInfo();
 
-	// TODO : multisampling
+	// single sample by default, EnableMultiSampling() for multisampled attachments
 	multisampling = mk::vkinfo::GetPipelineMultisampleStateCreateInfo();
 
 	// depth and stencil testing (TODO : implement stencil buffer operation for shadow volume)
@@ -78,44 +79,295 @@ void MKPipeline::InitializePipelineLayout()
 	// TODO : color blending
 	colorBlendAttachment = mk::vkinfo::GetPipelineColorBlendAttachmentState();
 
-	// TODO : color blending state
+	// color blending state (attachment count follows the render target, see TakeBuildSnapshot())
 	colorBlending = mk::vkinfo::GetPipelineColorBlendStateCreateInfo(colorBlendAttachment);
 
 	// create pipeline layout
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	pipelineLayoutInfo.pNext = nullptr;
+	if (pipelineLayoutInfo.setLayoutCount == 0 && pipelineLayoutInfo.pushConstantRangeCount == 0)
+		CreateReflectedLayouts(); // explicitly added layouts take precedence over reflection
 
 	// create pipeline layout
 	MK_CHECK(vkCreatePipelineLayout(_mkDeviceRef.GetDevice(), &pipelineLayoutInfo, nullptr, &_vkPipelineLayout));
+	_layoutHash = HashPipelineLayout();
+}
+
+VkPipeline MKPipeline::GetPipeline()
+{
+	// swap in the asynchronously rebuilt pipeline once it is ready
+	if (_pendingPipelineEntry.valid() && _pendingPipelineEntry.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		AdoptPendingPipeline();
+
+	// a permutation is compiled on first use after its state has changed
+	if (_pipelineEntry == nullptr)
+		BuildPipeline(_pRenderPass);
+
+	return _pipelineEntry->pipeline.load(); // may be swapped to the optimized pipeline in background
 }
 
 void MKPipeline::BuildPipeline(VkRenderPass* pRenderPass)
+{
+	_pRenderPass = pRenderPass;
+	_pipelineEntry = CompileSnapshot(*TakeBuildSnapshot());
+}
+
+void MKPipeline::RebuildPipelineAsync()
+{
+	// only one rebuild in flight, the render thread doesn't wait for it. A later request is launched once it completes.
+	if (_pendingPipelineEntry.valid())
+	{
+		_isRebuildQueued = true;
+		return;
+	}
+
+	/**
+	* compile as a background job
+	* - a pool worker has its own deque and command pool, so library jobs it runs while waiting never record into the render thread's pool.
+	* - jobs are copied into std::function, so the snapshot and the promise are shared.
+	*/
+	auto promise = std::make_shared<std::promise<const MKPipelineRegistry::PipelineEntry*>>();
+	std::shared_ptr<BuildSnapshot> snapshot = TakeBuildSnapshot();
+
+	_pendingGeneration    = _stateGeneration;
+	_pendingPipelineEntry = promise->get_future();
+	GJobSystem->ScheduleBackground([promise, snapshot]() {
+		try
+		{
+			promise->set_value(CompileSnapshot(*snapshot));
+		}
+		catch (...)
+		{
+			promise->set_exception(std::current_exception());
+		}
+	});
+}
+
+bool MKPipeline::RefreshShaderModules()
+{
+	// a rebuild in flight compiles its own snapshot, so shader stages can change under it
+	bool isChanged = false;
+	for (auto& shader : _shaders)
+	{
+		auto shaderModuleEntry = GPipelineRegistry->AcquireShaderModule(shader.path, shader.stage);
+		if (shaderModuleEntry.generation != shader.generation)
+		{
+			shader.shaderModule = shaderModuleEntry.shaderModule;
+			shader.generation   = shaderModuleEntry.generation;
+			isChanged = true;
+		}
+	}
+
+	if (isChanged)
+	{
+		UpdateShaderStages();
+		RebuildPipelineAsync();
+	}
+
+	return isChanged;
+}
+
+void MKPipeline::AdoptPendingPipeline()
+{
+	try
+	{
+		auto pipelineEntry = _pendingPipelineEntry.get();
+
+		// state was invalidated after the rebuild was launched, so the result was built from stale state
+		if (_pendingGeneration == _stateGeneration)
+			_pipelineEntry = pipelineEntry;
+	}
+	catch (const std::exception& e)
+	{
+		MK_LOG(fmt::format("failed to rebuild pipeline, keeping previous one : {}", e.what()));
+	}
+
+	if (_isRebuildQueued)
+	{
+		_isRebuildQueued = false;
+		RebuildPipelineAsync();
+	}
+}
+
+std::unique_ptr<MKPipeline::BuildSnapshot> MKPipeline::TakeBuildSnapshot() const
+{
+	auto snapshot = std::make_unique<BuildSnapshot>();
+	snapshot->key     = GetStateKey();
+	snapshot->shaders = _shaders;
+	for (const auto& shader : snapshot->shaders)
+		snapshot->shaderStages.push_back(mk::vkinfo::GetPipelineShaderStageCreateInfo(shader.stage, shader.shaderModule, shader.entryPoint));
+
+	snapshot->vertexBindings.assign(vertexInput.pVertexBindingDescriptions, vertexInput.pVertexBindingDescriptions + vertexInput.vertexBindingDescriptionCount);
+	snapshot->vertexAttributes.assign(vertexInput.pVertexAttributeDescriptions, vertexInput.pVertexAttributeDescriptions + vertexInput.vertexAttributeDescriptionCount);
+	snapshot->vertexInput = vertexInput;
+	snapshot->vertexInput.pVertexBindingDescriptions   = snapshot->vertexBindings.data();
+	snapshot->vertexInput.pVertexAttributeDescriptions = snapshot->vertexAttributes.data();
+
+	snapshot->inputAssembly = inputAssembly;
+	snapshot->viewportState = viewportState;
+	snapshot->rasterizer    = rasterizer;
+	snapshot->multisampling = multisampling;
+	snapshot->depthStencil  = depthStencil;
+
+	// dynamic states may have been added after layout initialization
+	snapshot->dynamicStates = dynamicStates;
+	snapshot->dynamicState  = mk::vkinfo::GetPipelineDynamicStateCreateInfo(snapshot->dynamicStates);
+
+	// a blend state per color attachment (e.g. scene color and motion vectors), all of them share colorBlendAttachment
+	snapshot->colorBlendAttachments.assign(GetColorAttachmentCount(), colorBlendAttachment);
+	snapshot->colorBlending = colorBlending;
+	snapshot->colorBlending.attachmentCount = static_cast<uint32>(snapshot->colorBlendAttachments.size());
+	snapshot->colorBlending.pAttachments    = snapshot->colorBlendAttachments.data();
+
+	if (renderingInfo.pColorAttachmentFormats != nullptr)
+		snapshot->colorAttachmentFormats.assign(renderingInfo.pColorAttachmentFormats, renderingInfo.pColorAttachmentFormats + renderingInfo.colorAttachmentCount);
+	snapshot->renderingInfo = renderingInfo;
+	snapshot->renderingInfo.pColorAttachmentFormats = snapshot->colorAttachmentFormats.data();
+
+	snapshot->pipelineLayout = _vkPipelineLayout;
+	snapshot->hasRenderPass  = _pRenderPass != nullptr;
+	snapshot->renderPass     = snapshot->hasRenderPass ? *_pRenderPass : VK_NULL_HANDLE;
+
+	return snapshot;
+}
+
+const MKPipelineRegistry::PipelineEntry* MKPipeline::CompileSnapshot(BuildSnapshot& snapshot)
 {
 	// specify graphics pipeline
 	VkGraphicsPipelineCreateInfo pipelineInfo = mk::vkinfo::GetGraphicsPipelineCreateInfo(
-		shaderStages,
-		&vertexInput,
-		&inputAssembly,
-		&viewportState,
-		&rasterizer,
-		&multisampling,
-		&depthStencil,
-		&colorBlending,
-		&dynamicState,
-		&_vkPipelineLayout,
-		pRenderPass,
-		&renderingInfo
+		snapshot.shaderStages,
+		&snapshot.vertexInput,
+		&snapshot.inputAssembly,
+		&snapshot.viewportState,
+		&snapshot.rasterizer,
+		&snapshot.multisampling,
+		&snapshot.depthStencil,
+		&snapshot.colorBlending,
+		&snapshot.dynamicState,
+		&snapshot.pipelineLayout,
+		snapshot.hasRenderPass ? &snapshot.renderPass : nullptr,
+		&snapshot.renderingInfo
 	);
 
-	// create pipeline instance
-	MK_CHECK(vkCreateGraphicsPipelines(_mkDeviceRef.GetDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_vkPipelineInstance));
+	// set layouts were created for descriptor buffers, so the pipeline has to match them
+	if (GDescriptorManager->IsDescriptorBufferEnabled())
+		pipelineInfo.flags |= VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+
+	// reuse the pipeline of identical state, or compile (fast-link) it through device-wide pipeline cache
+	return GPipelineRegistry->AcquirePipeline(snapshot.key, pipelineInfo);
+}
+
+PipelineStateKey MKPipeline::GetStateKey() const
+{
+	PipelineStateKey key{};
+
+	// dynamic states and render target are shared by every part
+	uint64 common = 0;
+	for (auto state : dynamicStates)
+		mk::hash::Combine(common, static_cast<uint32>(state));
+	// render pass handles may be recycled, so a render pass is identified by the attachment formats of its rendering info
+	mk::hash::Combine(common, _pRenderPass != nullptr);
+	mk::hash::Combine(common, GetColorAttachmentCount());
+	for (uint32 it = 0; it < GetColorAttachmentCount() && renderingInfo.pColorAttachmentFormats != nullptr; it++)
+		mk::hash::Combine(common, static_cast<uint32>(renderingInfo.pColorAttachmentFormats[it]));
+	mk::hash::Combine(common, static_cast<uint32>(renderingInfo.depthAttachmentFormat));
+	mk::hash::Combine(common, static_cast<uint32>(renderingInfo.stencilAttachmentFormat));
+
+	// 1. vertex input interface
+	key.vertexInput = common;
+	for (uint32 it = 0; it < vertexInput.vertexBindingDescriptionCount; it++)
+	{
+		mk::hash::Combine(key.vertexInput, vertexInput.pVertexBindingDescriptions[it].binding);
+		mk::hash::Combine(key.vertexInput, vertexInput.pVertexBindingDescriptions[it].stride);
+		mk::hash::Combine(key.vertexInput, static_cast<uint32>(vertexInput.pVertexBindingDescriptions[it].inputRate));
+	}
+	for (uint32 it = 0; it < vertexInput.vertexAttributeDescriptionCount; it++)
+	{
+		mk::hash::Combine(key.vertexInput, vertexInput.pVertexAttributeDescriptions[it].location);
+		mk::hash::Combine(key.vertexInput, static_cast<uint32>(vertexInput.pVertexAttributeDescriptions[it].format));
+		mk::hash::Combine(key.vertexInput, vertexInput.pVertexAttributeDescriptions[it].offset);
+	}
+	mk::hash::Combine(key.vertexInput, static_cast<uint32>(inputAssembly.topology));
+	mk::hash::Combine(key.vertexInput, inputAssembly.primitiveRestartEnable);
 
-	// destroy shader modules after creating a pipeline.
-	for (auto& shader : _waitShaders)
+	// 2. pre-rasterization shaders (dynamic states are excluded so that their variants share a pipeline)
+	key.preRasterization = common;
+	for (const auto& shader : _shaders)
 	{
-		vkDestroyShaderModule(_mkDeviceRef.GetDevice(), shader.shaderModule, nullptr);
-		shader.shaderModule = VK_NULL_HANDLE;
+		if (shader.stage == VK_SHADER_STAGE_FRAGMENT_BIT)
+			continue;
+		mk::hash::Combine(key.preRasterization, shader.path);
+		mk::hash::Combine(key.preRasterization, shader.entryPoint);
+		mk::hash::Combine(key.preRasterization, shader.generation);
+		mk::hash::Combine(key.preRasterization, static_cast<uint32>(shader.stage));
 	}
+	mk::hash::Combine(key.preRasterization, rasterizer.depthClampEnable);
+	mk::hash::Combine(key.preRasterization, rasterizer.rasterizerDiscardEnable);
+	mk::hash::Combine(key.preRasterization, rasterizer.lineWidth);
+	if (!IsDynamicState(VK_DYNAMIC_STATE_POLYGON_MODE_EXT))
+		mk::hash::Combine(key.preRasterization, static_cast<uint32>(rasterizer.polygonMode));
+	if (!IsDynamicState(VK_DYNAMIC_STATE_CULL_MODE))
+		mk::hash::Combine(key.preRasterization, rasterizer.cullMode);
+	if (!IsDynamicState(VK_DYNAMIC_STATE_FRONT_FACE))
+		mk::hash::Combine(key.preRasterization, static_cast<uint32>(rasterizer.frontFace));
+	if (!IsDynamicState(VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE))
+		mk::hash::Combine(key.preRasterization, rasterizer.depthBiasEnable);
+	mk::hash::Combine(key.preRasterization, _layoutHash);
+
+	// 3. fragment shader
+	key.fragmentShader = common;
+	for (const auto& shader : _shaders)
+	{
+		if (shader.stage != VK_SHADER_STAGE_FRAGMENT_BIT)
+			continue;
+		mk::hash::Combine(key.fragmentShader, shader.path);
+		mk::hash::Combine(key.fragmentShader, shader.entryPoint);
+		mk::hash::Combine(key.fragmentShader, shader.generation);
+	}
+	if (!IsDynamicState(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE))
+		mk::hash::Combine(key.fragmentShader, depthStencil.depthTestEnable);
+	if (!IsDynamicState(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE))
+		mk::hash::Combine(key.fragmentShader, depthStencil.depthWriteEnable);
+	if (!IsDynamicState(VK_DYNAMIC_STATE_DEPTH_COMPARE_OP))
+		mk::hash::Combine(key.fragmentShader, static_cast<uint32>(depthStencil.depthCompareOp));
+	mk::hash::Combine(key.fragmentShader, depthStencil.depthBoundsTestEnable);
+	mk::hash::Combine(key.fragmentShader, depthStencil.stencilTestEnable);
+	mk::hash::Combine(key.fragmentShader, _layoutHash);
+
+	// 4. fragment output interface (multisampling is consumed by both fragment parts)
+	key.fragmentOutput = common;
+	if (!IsDynamicState(VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT))
+		mk::hash::Combine(key.fragmentOutput, colorBlendAttachment.blendEnable);
+	if (!IsDynamicState(VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT))
+	{
+		mk::hash::Combine(key.fragmentOutput, static_cast<uint32>(colorBlendAttachment.srcColorBlendFactor));
+		mk::hash::Combine(key.fragmentOutput, static_cast<uint32>(colorBlendAttachment.dstColorBlendFactor));
+		mk::hash::Combine(key.fragmentOutput, static_cast<uint32>(colorBlendAttachment.colorBlendOp));
+		mk::hash::Combine(key.fragmentOutput, static_cast<uint32>(colorBlendAttachment.srcAlphaBlendFactor));
+		mk::hash::Combine(key.fragmentOutput, static_cast<uint32>(colorBlendAttachment.dstAlphaBlendFactor));
+		mk::hash::Combine(key.fragmentOutput, static_cast<uint32>(colorBlendAttachment.alphaBlendOp));
+	}
+	if (!IsDynamicState(VK_DYNAMIC_STATE_COLOR_WRITE_MASK_EXT))
+		mk::hash::Combine(key.fragmentOutput, colorBlendAttachment.colorWriteMask);
+	mk::hash::Combine(key.fragmentOutput, colorBlending.logicOpEnable);
+	mk::hash::Combine(key.fragmentOutput, static_cast<uint32>(colorBlending.logicOp));
+
+	uint64 multisample = 0;
+	mk::hash::Combine(multisample, static_cast<uint32>(multisampling.rasterizationSamples));
+	mk::hash::Combine(multisample, multisampling.sampleShadingEnable);
+	mk::hash::Combine(multisample, multisampling.minSampleShading);
+	mk::hash::Combine(multisample, multisampling.alphaToCoverageEnable);
+	mk::hash::Combine(multisample, multisampling.alphaToOneEnable);
+	mk::hash::Combine(key.fragmentShader, multisample);
+	mk::hash::Combine(key.fragmentOutput, multisample);
+
+	// full state
+	key.state = key.vertexInput;
+	mk::hash::Combine(key.state, key.preRasterization);
+	mk::hash::Combine(key.state, key.fragmentShader);
+	mk::hash::Combine(key.state, key.fragmentOutput);
+
+	return key;
 }
 
 void MKPipeline::AddDescriptorSetLayouts(std::vector<VkDescriptorSetLayout>& layouts)
@@ -130,6 +382,20 @@ void MKPipeline::AddPushConstantRanges(std::vector<VkPushConstantRange>& pushCon
 	pipelineLayoutInfo.pPushConstantRanges = pushConstants.data();
 }
 
+void MKPipeline::SetDescriptorCount(uint32 set, uint32 binding, uint32 count)
+{
+	auto setIt = _reflectedBindings.find(set);
+	if (setIt == _reflectedBindings.end() || setIt->second.find(binding) == setIt->second.end())
+		MK_THROW(fmt::format("no shader declares descriptor (set {}, binding {})", set, binding));
+
+	setIt->second[binding].descriptorCount = count;
+}
+
+void MKPipeline::SetDescriptorSetLayout(uint32 set, VkDescriptorSetLayout layout)
+{
+	_vkExternalSetLayouts[set] = layout;
+}
+
 void MKPipeline::SetRenderingInfo(
 	uint32 colorAttachmentCount, 
 	VkFormat* pColorAttachmentFormats, 
@@ -137,8 +403,10 @@ void MKPipeline::SetRenderingInfo(
 	VkFormat stencilAttachmentFormat
 )
 {
+	Invalidate();
+	_colorAttachmentFormats.assign(pColorAttachmentFormats, pColorAttachmentFormats + colorAttachmentCount); // caller's array may not outlive hot reloads
 	renderingInfo.colorAttachmentCount = colorAttachmentCount;
-	renderingInfo.pColorAttachmentFormats = pColorAttachmentFormats;
+	renderingInfo.pColorAttachmentFormats = _colorAttachmentFormats.data();
 	renderingInfo.depthAttachmentFormat = depthAttachmentFormat;
 	renderingInfo.stencilAttachmentFormat = stencilAttachmentFormat;
 	renderingInfo.pNext = nullptr;
@@ -146,22 +414,26 @@ void MKPipeline::SetRenderingInfo(
 
 void MKPipeline::SetInputTopology(VkPrimitiveTopology topology)
 {
+	Invalidate();
 	inputAssembly.topology = topology;
 }
 
 void MKPipeline::SetPolygonMode(VkPolygonMode mode)
 {
+	Invalidate();
 	rasterizer.polygonMode = mode;
 }
 
 void MKPipeline::SetCullMode(VkCullModeFlags cullMode, VkFrontFace frontFace)
 {
+	Invalidate();
 	rasterizer.cullMode  = cullMode;
 	rasterizer.frontFace = frontFace;
 }
 
 void MKPipeline::DisableMultiSampling()
 {
+	Invalidate();
 	multisampling.sampleShadingEnable   = VK_FALSE;
 	multisampling.rasterizationSamples  = VK_SAMPLE_COUNT_1_BIT;
 	multisampling.minSampleShading      = 1.0f;
@@ -170,14 +442,28 @@ void MKPipeline::DisableMultiSampling()
 	multisampling.alphaToOneEnable      = VK_FALSE;
 }
 
+void MKPipeline::EnableMultiSampling(VkSampleCountFlagBits samples)
+{
+	// the fragment shader runs once per pixel and its result covers every sample, only edges get extra coverage samples
+	Invalidate();
+	multisampling.sampleShadingEnable   = VK_FALSE;
+	multisampling.rasterizationSamples  = samples;
+	multisampling.minSampleShading      = 1.0f;
+	multisampling.pSampleMask           = nullptr;
+	multisampling.alphaToCoverageEnable = VK_FALSE;
+	multisampling.alphaToOneEnable      = VK_FALSE;
+}
+
 void MKPipeline::DisableColorBlending()
 {
+	Invalidate();
 	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 	colorBlendAttachment.blendEnable = VK_FALSE;
 }
 
 void MKPipeline::EnableBlendingAdditive()
 {
+	Invalidate();
 	colorBlendAttachment.blendEnable         = VK_TRUE;
 	colorBlendAttachment.colorWriteMask      = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
@@ -190,6 +476,7 @@ void MKPipeline::EnableBlendingAdditive()
 
 void MKPipeline::EnableBlendingAlpha()
 {
+	Invalidate();
 	colorBlendAttachment.blendEnable         = VK_TRUE;
 	colorBlendAttachment.colorWriteMask      = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
@@ -202,6 +489,7 @@ void MKPipeline::EnableBlendingAlpha()
 
 void MKPipeline::DisableDepthTest()
 {
+	Invalidate();
 	depthStencil.depthTestEnable       = VK_FALSE;
 	depthStencil.depthWriteEnable      = VK_FALSE;
 	depthStencil.depthCompareOp        = VK_COMPARE_OP_NEVER;
@@ -215,6 +503,7 @@ void MKPipeline::DisableDepthTest()
 
 void MKPipeline::EnableDepthTest(bool depthWriteEnable, VkCompareOp op)
 {
+	Invalidate();
 	depthStencil.depthTestEnable       = VK_TRUE;
 	depthStencil.depthWriteEnable      = depthWriteEnable;
 	depthStencil.depthCompareOp        = op;
@@ -228,14 +517,241 @@ void MKPipeline::EnableDepthTest(bool depthWriteEnable, VkCompareOp op)
 
 void MKPipeline::RemoveVertexInput()
 {
+	Invalidate();
 	vertexInput = {}; // assign empty struct
 	vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 }
 
+void MKPipeline::EnableExtendedDynamicState()
+{
+	const auto& support = _mkDeviceRef.GetDynamicStateSupport();
+
+	std::vector<VkDynamicState> candidates;
+	if (support.extendedDynamicState)
+	{
+		candidates.insert(candidates.end(), {
+			VK_DYNAMIC_STATE_CULL_MODE,
+			VK_DYNAMIC_STATE_FRONT_FACE,
+			VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE,
+			VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE,
+			VK_DYNAMIC_STATE_DEPTH_COMPARE_OP
+		});
+	}
+	if (support.extendedDynamicState2)
+	{
+		candidates.push_back(VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE);
+	}
+	if (support.extendedDynamicState3)
+	{
+		candidates.insert(candidates.end(), {
+			VK_DYNAMIC_STATE_POLYGON_MODE_EXT,
+			VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT,
+			VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT,
+			VK_DYNAMIC_STATE_COLOR_WRITE_MASK_EXT
+		});
+	}
+
+	for (auto state : candidates)
+	{
+		if (!IsDynamicState(state))
+			dynamicStates.push_back(state);
+	}
+
+	Invalidate();
+}
+
+void MKPipeline::ApplyDynamicStates(VkCommandBuffer commandBuffer) const
+{
+	const auto& support = _mkDeviceRef.GetDynamicStateSupport();
+
+	// extended dynamic state
+	if (IsDynamicState(VK_DYNAMIC_STATE_CULL_MODE))
+		vkCmdSetCullMode(commandBuffer, rasterizer.cullMode);
+	if (IsDynamicState(VK_DYNAMIC_STATE_FRONT_FACE))
+		vkCmdSetFrontFace(commandBuffer, rasterizer.frontFace);
+	if (IsDynamicState(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE))
+		vkCmdSetDepthTestEnable(commandBuffer, depthStencil.depthTestEnable);
+	if (IsDynamicState(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE))
+		vkCmdSetDepthWriteEnable(commandBuffer, depthStencil.depthWriteEnable);
+	if (IsDynamicState(VK_DYNAMIC_STATE_DEPTH_COMPARE_OP))
+		vkCmdSetDepthCompareOp(commandBuffer, depthStencil.depthCompareOp);
+
+	// extended dynamic state 2
+	if (IsDynamicState(VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE))
+		vkCmdSetDepthBiasEnable(commandBuffer, rasterizer.depthBiasEnable);
+
+	// extended dynamic state 3 (every color attachment gets the same state)
+	uint32 attachmentCount = GetColorAttachmentCount();
+	assert(attachmentCount <= MAX_COLOR_ATTACHMENTS);
+	if (IsDynamicState(VK_DYNAMIC_STATE_POLYGON_MODE_EXT))
+		support.pfnCmdSetPolygonMode(commandBuffer, rasterizer.polygonMode);
+	if (IsDynamicState(VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT))
+	{
+		std::array<VkBool32, MAX_COLOR_ATTACHMENTS> blendEnables;
+		blendEnables.fill(colorBlendAttachment.blendEnable);
+		support.pfnCmdSetColorBlendEnable(commandBuffer, 0, attachmentCount, blendEnables.data());
+	}
+	if (IsDynamicState(VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT))
+	{
+		VkColorBlendEquationEXT equation{};
+		equation.srcColorBlendFactor = colorBlendAttachment.srcColorBlendFactor;
+		equation.dstColorBlendFactor = colorBlendAttachment.dstColorBlendFactor;
+		equation.colorBlendOp        = colorBlendAttachment.colorBlendOp;
+		equation.srcAlphaBlendFactor = colorBlendAttachment.srcAlphaBlendFactor;
+		equation.dstAlphaBlendFactor = colorBlendAttachment.dstAlphaBlendFactor;
+		equation.alphaBlendOp        = colorBlendAttachment.alphaBlendOp;
+
+		std::array<VkColorBlendEquationEXT, MAX_COLOR_ATTACHMENTS> equations;
+		equations.fill(equation);
+		support.pfnCmdSetColorBlendEquation(commandBuffer, 0, attachmentCount, equations.data());
+	}
+	if (IsDynamicState(VK_DYNAMIC_STATE_COLOR_WRITE_MASK_EXT))
+	{
+		std::array<VkColorComponentFlags, MAX_COLOR_ATTACHMENTS> writeMasks;
+		writeMasks.fill(colorBlendAttachment.colorWriteMask);
+		support.pfnCmdSetColorWriteMask(commandBuffer, 0, attachmentCount, writeMasks.data());
+	}
+}
+
+bool MKPipeline::IsDynamicState(VkDynamicState state) const
+{
+	return std::find(dynamicStates.begin(), dynamicStates.end(), state) != dynamicStates.end();
+}
+
 /*
 -----------	PRIVATE ------------
 */
 
+uint32 MKPipeline::GetColorAttachmentCount() const
+{
+	// subpasses of the legacy render passes have a single color attachment
+	return (_pRenderPass != nullptr) ? 1 : renderingInfo.colorAttachmentCount;
+}
+
+void MKPipeline::UpdateShaderStages()
+{
+	shaderStages.clear();
+	for (auto& shader : _shaders)
+	{
+		VkPipelineShaderStageCreateInfo shaderStageInfo = mk::vkinfo::GetPipelineShaderStageCreateInfo(shader.stage, shader.shaderModule, shader.entryPoint);
+		shaderStages.push_back(shaderStageInfo);
+	}
+}
+
+void MKPipeline::MergeReflection(const mk::spirv::ShaderReflection& reflection)
+{
+	// a resource used by several stages becomes a single binding visible to all of them
+	for (const auto& reflected : reflection.bindings)
+	{
+		auto& bindings = _reflectedBindings[reflected.set];
+		auto  bindingIt = bindings.find(reflected.binding);
+		if (bindingIt == bindings.end())
+		{
+			VkDescriptorSetLayoutBinding layoutBinding{};
+			layoutBinding.binding            = reflected.binding;
+			layoutBinding.descriptorType     = reflected.descriptorType;
+			layoutBinding.descriptorCount    = reflected.descriptorCount;
+			layoutBinding.stageFlags         = reflection.stage;
+			layoutBinding.pImmutableSamplers = nullptr;
+			bindings[reflected.binding] = layoutBinding;
+			continue;
+		}
+
+		if (bindingIt->second.descriptorType != reflected.descriptorType)
+			MK_THROW(fmt::format("descriptor type mismatch between stages at (set {}, binding {})", reflected.set, reflected.binding));
+
+		bindingIt->second.stageFlags     |= reflection.stage;
+		bindingIt->second.descriptorCount = std::max(bindingIt->second.descriptorCount, reflected.descriptorCount);
+	}
+
+	// all stages share one push constant range sized by the largest block
+	if (reflection.pushConstantSize > 0)
+	{
+		_vkPushConstantRange.stageFlags |= reflection.stage;
+		_vkPushConstantRange.size        = std::max(_vkPushConstantRange.size, reflection.pushConstantSize);
+	}
+}
+
+uint64 MKPipeline::HashPipelineLayout() const
+{
+	uint64 hash = 0;
+	mk::hash::Combine(hash, pipelineLayoutInfo.setLayoutCount);
+
+	// reflected sets are described by their bindings, external and explicitly added layouts are owned by and outlive their owners
+	bool isReflected = pipelineLayoutInfo.pSetLayouts == _vkSetLayouts.data();
+	for (uint32 set = 0; set < pipelineLayoutInfo.setLayoutCount; set++)
+	{
+		auto setIt = _reflectedBindings.find(set);
+		if (!isReflected || _vkExternalSetLayouts.find(set) != _vkExternalSetLayouts.end())
+		{
+			mk::hash::Combine(hash, reinterpret_cast<uint64>(pipelineLayoutInfo.pSetLayouts[set]));
+		}
+		else if (setIt != _reflectedBindings.end())
+		{
+			for (const auto& [binding, layoutBinding] : setIt->second)
+			{
+				mk::hash::Combine(hash, layoutBinding.binding);
+				mk::hash::Combine(hash, static_cast<uint32>(layoutBinding.descriptorType));
+				mk::hash::Combine(hash, layoutBinding.descriptorCount);
+				mk::hash::Combine(hash, layoutBinding.stageFlags);
+			}
+		}
+		mk::hash::Combine(hash, set); // separates the bindings of consecutive sets
+	}
+
+	for (uint32 it = 0; it < pipelineLayoutInfo.pushConstantRangeCount; it++)
+	{
+		mk::hash::Combine(hash, pipelineLayoutInfo.pPushConstantRanges[it].stageFlags);
+		mk::hash::Combine(hash, pipelineLayoutInfo.pPushConstantRanges[it].offset);
+		mk::hash::Combine(hash, pipelineLayoutInfo.pPushConstantRanges[it].size);
+	}
+
+	return hash;
+}
+
+void MKPipeline::CreateReflectedLayouts()
+{
+	_vkSetLayouts.clear();
+	uint32 setCount = 0;
+	if (!_reflectedBindings.empty())
+		setCount = std::max(setCount, _reflectedBindings.rbegin()->first + 1);
+	if (!_vkExternalSetLayouts.empty())
+		setCount = std::max(setCount, _vkExternalSetLayouts.rbegin()->first + 1);
+
+	// set indices must be contiguous in pipeline layout, so unused sets get an empty layout
+	for (uint32 set = 0; set < setCount; set++)
+	{
+		auto externalIt = _vkExternalSetLayouts.find(set);
+		if (externalIt != _vkExternalSetLayouts.end())
+		{
+			_vkSetLayouts.push_back(externalIt->second); // reflected bindings of this set are described by the external layout
+			continue;
+		}
+
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+		auto setIt = _reflectedBindings.find(set);
+		if (setIt != _reflectedBindings.end())
+		{
+			for (const auto& [binding, layoutBinding] : setIt->second)
+				bindings.push_back(layoutBinding);
+		}
+		_vkSetLayouts.push_back(GDescriptorManager->AcquireDescriptorSetLayout(bindings));
+	}
+
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32>(_vkSetLayouts.size());
+	pipelineLayoutInfo.pSetLayouts    = _vkSetLayouts.data();
+
+	if (_vkPushConstantRange.size > 0)
+	{
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges    = &_vkPushConstantRange;
+	}
+
+#ifndef NDEBUG
+	MK_LOG(fmt::format("pipeline layout reflected : {} descriptor sets, {} bytes of push constant", _vkSetLayouts.size(), _vkPushConstantRange.size));
+#endif
+}
+
 void MKPipeline::CreateRenderingResources()
 {
 	_renderingResources.resize(MAX_FRAMES_IN_FLIGHT);
@@ -243,14 +759,9 @@ void MKPipeline::CreateRenderingResources()
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	VkFenceCreateInfo fenceInfo{};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; // create fence as signaled state for the very first frame.
-
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) 
 	{
 		MK_CHECK(vkCreateSemaphore(_mkDeviceRef.GetDevice(), &semaphoreInfo, nullptr, &_renderingResources[i].imageAvailableSema));
 		MK_CHECK(vkCreateSemaphore(_mkDeviceRef.GetDevice(), &semaphoreInfo, nullptr, &_renderingResources[i].renderFinishedSema));
-		MK_CHECK(vkCreateFence(_mkDeviceRef.GetDevice(), &fenceInfo, nullptr, &_renderingResources[i].inFlightFence));
 	}
 }
\ No newline at end of file
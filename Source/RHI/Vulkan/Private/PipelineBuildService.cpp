@@ -0,0 +1,47 @@
+#include "PipelineBuildService.h"
+#include "JobSystem.h"
+
+MKPipelineBuildService::MKPipelineBuildService()
+{
+}
+
+MKPipelineBuildService::~MKPipelineBuildService()
+{
+}
+
+uint32 MKPipelineBuildService::RequestBuild(MKPipeline& pipeline, VkRenderPass* pRenderPass)
+{
+	BuildRequest request{};
+	request.pipeline    = &pipeline;
+	request.pRenderPass = pRenderPass;
+	_requests.push_back(request);
+
+	return static_cast<uint32>(_requests.size() - 1);
+}
+
+void MKPipelineBuildService::BuildAll()
+{
+	uint32 pendingCount = static_cast<uint32>(_requests.size()) - _builtCount;
+	if (pendingCount == 0)
+		return;
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	// failed requests are not retried, so they count as built even when a compile throws
+	uint32 firstRequest = _builtCount;
+	_builtCount = static_cast<uint32>(_requests.size());
+
+	// one job per pipeline, library parts compiled inside are scheduled on the same workers
+	GJobSystem->ParallelFor(pendingCount, 1, [this, firstRequest](uint32 begin, uint32 end) {
+		for (uint32 it = begin; it < end; it++)
+		{
+			auto& request = _requests[firstRequest + it];
+			request.pipeline->BuildPipeline(request.pRenderPass);
+		}
+	});
+
+#ifndef NDEBUG
+	float elapsedTime = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+	MK_LOG(fmt::format("{} pipelines compiled on {} threads in {:.2f} ms", pendingCount, GJobSystem->GetThreadCount(), elapsedTime));
+#endif
+}
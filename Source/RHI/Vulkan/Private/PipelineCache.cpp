@@ -0,0 +1,108 @@
+#include <cstring>
+#include <filesystem>
+
+#include "PipelineCache.h"
+
+MKPipelineCache::MKPipelineCache()
+{
+}
+
+MKPipelineCache::~MKPipelineCache()
+{
+	vkDestroyPipelineCache(_mkDevicePtr->GetDevice(), _vkPipelineCache, nullptr);
+
+#ifndef NDEBUG
+	MK_LOG("pipeline cache destroyed");
+#endif
+}
+
+void MKPipelineCache::InitPipelineCache(MKDevice* mkDevicePtr, const std::string& cachePath)
+{
+	_mkDevicePtr = mkDevicePtr;
+	_cachePath   = cachePath;
+	vkGetPhysicalDeviceProperties(_mkDevicePtr->GetPhysicalDevice(), &_vkDeviceProperties);
+
+	// read previous cache blob if it exists
+	std::vector<char> cacheData;
+	std::ifstream file(_cachePath, std::ios::ate | std::ios::binary);
+	if (file.is_open())
+	{
+		size_t fileSize = static_cast<size_t>(file.tellg());
+		cacheData.resize(fileSize);
+		file.seekg(0);
+		file.read(cacheData.data(), fileSize);
+		file.close();
+	}
+
+	// discard a blob from other driver or device, the driver would reject it anyway.
+	if (!cacheData.empty() && !IsCacheHeaderValid(cacheData))
+	{
+		MK_LOG("pipeline cache on disk does not match current device, starting with an empty cache");
+		cacheData.clear();
+	}
+
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = cacheData.size();
+	cacheInfo.pInitialData    = cacheData.empty() ? nullptr : cacheData.data();
+
+	MK_CHECK(vkCreatePipelineCache(_mkDevicePtr->GetDevice(), &cacheInfo, nullptr, &_vkPipelineCache));
+
+#ifndef NDEBUG
+	MK_LOG(fmt::format("pipeline cache created with {} bytes of initial data", cacheData.size()));
+#endif
+}
+
+void MKPipelineCache::SavePipelineCache()
+{
+	size_t dataSize = 0;
+	MK_CHECK(vkGetPipelineCacheData(_mkDevicePtr->GetDevice(), _vkPipelineCache, &dataSize, nullptr));
+
+	std::vector<char> cacheData(dataSize);
+	MK_CHECK(vkGetPipelineCacheData(_mkDevicePtr->GetDevice(), _vkPipelineCache, &dataSize, cacheData.data()));
+
+	// write to temporary file first so that a crash while writing never leaves a broken cache behind
+	std::string tempPath = _cachePath + ".tmp";
+	std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		MK_LOG("failed to open pipeline cache file for writing");
+		return;
+	}
+	file.write(cacheData.data(), dataSize);
+	file.close();
+	if (file.fail())
+	{
+		MK_LOG("failed to write pipeline cache file, keeping the previous cache");
+		return;
+	}
+
+	// rename replaces an existing cache in one step, so the previous cache stays intact until the new one is in place
+	std::error_code errorCode;
+	std::filesystem::rename(tempPath, _cachePath, errorCode);
+	if (errorCode)
+	{
+		MK_LOG(fmt::format("failed to replace pipeline cache file : {}", errorCode.message()));
+		std::filesystem::remove(tempPath, errorCode);
+		return;
+	}
+
+#ifndef NDEBUG
+	MK_LOG(fmt::format("pipeline cache saved ({} bytes)", dataSize));
+#endif
+}
+
+bool MKPipelineCache::IsCacheHeaderValid(const std::vector<char>& cacheData) const
+{
+	if (cacheData.size() < sizeof(VkPipelineCacheHeaderVersionOne))
+		return false;
+
+	VkPipelineCacheHeaderVersionOne header{};
+	memcpy(&header, cacheData.data(), sizeof(VkPipelineCacheHeaderVersionOne));
+
+	return header.headerSize >= sizeof(VkPipelineCacheHeaderVersionOne) &&
+		header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		header.vendorID == _vkDeviceProperties.vendorID &&
+		header.deviceID == _vkDeviceProperties.deviceID &&
+		memcmp(header.pipelineCacheUUID, _vkDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
@@ -0,0 +1,363 @@
+#include "PipelineRegistry.h"
+#include "PipelineCache.h"
+#include "CommandService.h"
+#include "JobSystem.h"
+
+MKPipelineRegistry::MKPipelineRegistry()
+{
+}
+
+MKPipelineRegistry::~MKPipelineRegistry()
+{
+	// queued optimize jobs skip linking from now on, wait for the ones touching the pipelines
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_isStopping = true;
+		_idleCondition.wait(lock, [this]() { return _pendingOptimizeCount == 0; });
+	}
+
+	for (auto& [key, entry] : _pipelines)
+	{
+		if (entry.fastLinkedPipeline != VK_NULL_HANDLE && entry.fastLinkedPipeline != entry.pipeline.load())
+			vkDestroyPipeline(_mkDevicePtr->GetDevice(), entry.fastLinkedPipeline, nullptr);
+		vkDestroyPipeline(_mkDevicePtr->GetDevice(), entry.pipeline.load(), nullptr);
+	}
+
+	for (auto& [key, entry] : _computePipelines)
+		vkDestroyPipeline(_mkDevicePtr->GetDevice(), entry.pipeline.load(), nullptr);
+
+	for (auto pipeline : _retiringPipelines)
+		vkDestroyPipeline(_mkDevicePtr->GetDevice(), pipeline, nullptr);
+
+	for (auto& retiredPipeline : _retiredPipelines)
+		vkDestroyPipeline(_mkDevicePtr->GetDevice(), retiredPipeline.pipeline, nullptr);
+
+	for (auto& [key, library] : _libraries)
+		vkDestroyPipeline(_mkDevicePtr->GetDevice(), library, nullptr);
+
+	for (auto& [path, shaderModuleEntry] : _shaderModules)
+		vkDestroyShaderModule(_mkDevicePtr->GetDevice(), shaderModuleEntry.shaderModule, nullptr);
+
+	for (auto shaderModule : _retiredShaderModules)
+		vkDestroyShaderModule(_mkDevicePtr->GetDevice(), shaderModule, nullptr);
+
+#ifndef NDEBUG
+	MK_LOG(fmt::format("pipeline registry destroyed {} pipelines, {} libraries and {} shader modules", _pipelines.size() + _computePipelines.size(), _libraries.size(), _shaderModules.size()));
+#endif
+}
+
+void MKPipelineRegistry::InitPipelineRegistry(MKDevice* mkDevicePtr)
+{
+	_mkDevicePtr      = mkDevicePtr;
+	_isLibraryEnabled = _mkDevicePtr->IsGraphicsPipelineLibrarySupported();
+}
+
+MKPipelineRegistry::ShaderModuleEntry MKPipelineRegistry::AcquireShaderModule(const std::string& path, VkShaderStageFlagBits stage)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto it = _shaderModules.find(path);
+	if (it != _shaderModules.end())
+		return it->second;
+
+	auto shaderCode = mk::file::ReadFile(path);
+	ShaderModuleEntry entry{};
+	entry.shaderModule = mk::vk::CreateShaderModule(_mkDevicePtr->GetDevice(), shaderCode);
+	entry.reflection   = mk::spirv::ReflectShader(shaderCode, stage);
+	_shaderModules[path] = entry;
+
+	return entry;
+}
+
+bool MKPipelineRegistry::ReloadShaderModule(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// pipelines and hot reloader may spell the same file differently
+	auto normalPath = std::filesystem::path(path).lexically_normal();
+	for (auto& [registeredPath, entry] : _shaderModules)
+	{
+		if (std::filesystem::path(registeredPath).lexically_normal() != normalPath)
+			continue;
+
+		auto shaderCode = mk::file::ReadFile(registeredPath);
+		auto reflection = mk::spirv::ReflectShader(shaderCode, entry.reflection.stage); // descriptor interface changes need a restart
+
+		_retiredShaderModules.push_back(entry.shaderModule);
+		entry.shaderModule = mk::vk::CreateShaderModule(_mkDevicePtr->GetDevice(), shaderCode);
+		entry.reflection   = reflection;
+		entry.generation++;
+
+#ifndef NDEBUG
+		MK_LOG(fmt::format("shader module {} reloaded (generation {})", registeredPath, entry.generation));
+#endif
+		return true;
+	}
+
+	return false;
+}
+
+const MKPipelineRegistry::PipelineEntry* MKPipelineRegistry::AcquirePipeline(const PipelineStateKey& key, const VkGraphicsPipelineCreateInfo& info)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto it = _pipelines.find(key);
+		if (it != _pipelines.end() && it->second.pipeline.load() != VK_NULL_HANDLE)
+			return &it->second;
+	}
+
+	// compile without holding the lock, then publish
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	std::array<VkPipeline, 4> libraries{};
+	if (_isLibraryEnabled)
+	{
+		const std::array<LibraryKey, 4> libraryKeys = { {
+			{ key.vertexInput,      VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT },
+			{ key.preRasterization, VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT },
+			{ key.fragmentShader,   VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT },
+			{ key.fragmentOutput,   VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT },
+		} };
+
+		// fast-link cached parts, so a new material only compiles the parts nobody has built yet.
+		// missing parts are compiled side by side on the job system, this thread runs jobs while it waits for them.
+		JobCounter libraryCounter;
+		for (uint32 it = 0; it < libraryKeys.size(); it++)
+		{
+			libraries[it] = FindLibrary(libraryKeys[it]);
+			if (libraries[it] == VK_NULL_HANDLE)
+				GJobSystem->Schedule([this, &libraries, &libraryKeys, &info, it]() { libraries[it] = AcquireLibrary(libraryKeys[it], info); }, &libraryCounter);
+		}
+		GJobSystem->Wait(libraryCounter);
+
+		pipeline = LinkLibraries(libraries, info.layout, info.flags & VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT, false);
+	}
+	else
+	{
+		MK_CHECK(vkCreateGraphicsPipelines(_mkDevicePtr->GetDevice(), GPipelineCache->GetPipelineCache(), 1, &info, nullptr, &pipeline));
+	}
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	PipelineEntry& entry = _pipelines[key];
+	if (entry.pipeline.load() != VK_NULL_HANDLE)
+	{
+		// another thread compiled the same state first, keep its pipeline
+		vkDestroyPipeline(_mkDevicePtr->GetDevice(), pipeline, nullptr);
+		return &entry;
+	}
+
+	entry.pipeline.store(pipeline);
+	entry.fastLinkedPipeline = pipeline;
+	entry.isOptimized.store(!_isLibraryEnabled);
+
+	if (_isLibraryEnabled)
+	{
+		// optimize-link takes long, background jobs keep it away from threads waiting on frame work
+		OptimizeRequest request{ &entry, libraries, info.layout, info.flags & VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT };
+		_pendingOptimizeCount++;
+		lock.unlock();
+		GJobSystem->ScheduleBackground([this, request]() { OptimizePipeline(request); });
+	}
+
+#ifndef NDEBUG
+	MK_LOG(fmt::format("pipeline permutation {:016x} {}", key.state, _isLibraryEnabled ? "fast-linked" : "compiled"));
+#endif
+
+	return &entry;
+}
+
+const MKPipelineRegistry::PipelineEntry* MKPipelineRegistry::AcquireComputePipeline(const ComputeStateKey& key, const VkComputePipelineCreateInfo& info)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto it = _computePipelines.find(key);
+		if (it != _computePipelines.end() && it->second.pipeline.load() != VK_NULL_HANDLE)
+			return &it->second;
+	}
+
+	// compile without holding the lock, then publish
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	MK_CHECK(vkCreateComputePipelines(_mkDevicePtr->GetDevice(), GPipelineCache->GetPipelineCache(), 1, &info, nullptr, &pipeline));
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	PipelineEntry& entry = _computePipelines[key];
+	if (entry.pipeline.load() != VK_NULL_HANDLE)
+	{
+		// another thread compiled the same state first, keep its pipeline
+		vkDestroyPipeline(_mkDevicePtr->GetDevice(), pipeline, nullptr);
+		return &entry;
+	}
+
+	entry.pipeline.store(pipeline);
+	entry.fastLinkedPipeline = pipeline;
+	entry.isOptimized.store(true);
+
+#ifndef NDEBUG
+	MK_LOG(fmt::format("compute pipeline permutation {} ({}, generation {}) compiled", key.shaderPath, key.entryPoint, key.generation));
+#endif
+
+	return &entry;
+}
+
+void MKPipelineRegistry::WaitForBackgroundCompiles()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_idleCondition.wait(lock, [this]() { return _pendingOptimizeCount == 0; });
+}
+
+void MKPipelineRegistry::DestroyRetiredPipelines()
+{
+	// frames submitted so far may have drawn with a replaced pipeline, frames recorded from now on read the optimized one
+	uint64 submittedValue = GCommandService->GetFrameTimelineValue();
+	uint64 completedValue = 0;
+	MK_CHECK(vkGetSemaphoreCounterValue(_mkDevicePtr->GetDevice(), GCommandService->GetFrameTimeline(), &completedValue));
+
+	std::vector<VkPipeline> destroyedPipelines;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (auto pipeline : _retiringPipelines)
+			_retiredPipelines.push_back({ pipeline, submittedValue });
+		_retiringPipelines.clear();
+
+		while (!_retiredPipelines.empty() && _retiredPipelines.front().frameTimelineValue <= completedValue)
+		{
+			destroyedPipelines.push_back(_retiredPipelines.front().pipeline);
+			_retiredPipelines.pop_front();
+		}
+	}
+
+	for (auto pipeline : destroyedPipelines)
+		vkDestroyPipeline(_mkDevicePtr->GetDevice(), pipeline, nullptr);
+}
+
+/*
+-----------	PRIVATE ------------
+*/
+
+VkPipeline MKPipelineRegistry::FindLibrary(const LibraryKey& libraryKey)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _libraries.find(libraryKey);
+	return (it != _libraries.end()) ? it->second : VK_NULL_HANDLE;
+}
+
+VkPipeline MKPipelineRegistry::AcquireLibrary(const LibraryKey& libraryKey, const VkGraphicsPipelineCreateInfo& info)
+{
+	const VkGraphicsPipelineLibraryFlagsEXT part = libraryKey.part;
+
+	VkPipeline cachedLibrary = FindLibrary(libraryKey);
+	if (cachedLibrary != VK_NULL_HANDLE)
+		return cachedLibrary;
+
+	// keep only the states which belong to the requested part
+	std::vector<VkPipelineShaderStageCreateInfo> stages;
+	VkGraphicsPipelineCreateInfo libraryInfo{};
+	libraryInfo.sType          = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	libraryInfo.flags          = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT | (info.flags & VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT); // every part must agree on descriptor buffer usage
+	libraryInfo.pDynamicState  = info.pDynamicState;
+	libraryInfo.renderPass     = info.renderPass;
+	libraryInfo.subpass        = info.subpass;
+
+	switch (part)
+	{
+	case VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT:
+		libraryInfo.pVertexInputState   = info.pVertexInputState;
+		libraryInfo.pInputAssemblyState = info.pInputAssemblyState;
+		break;
+	case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT:
+		for (uint32 it = 0; it < info.stageCount; it++)
+		{
+			if (info.pStages[it].stage != VK_SHADER_STAGE_FRAGMENT_BIT)
+				stages.push_back(info.pStages[it]);
+		}
+		libraryInfo.pViewportState      = info.pViewportState;
+		libraryInfo.pRasterizationState = info.pRasterizationState;
+		libraryInfo.layout              = info.layout;
+		break;
+	case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT:
+		for (uint32 it = 0; it < info.stageCount; it++)
+		{
+			if (info.pStages[it].stage == VK_SHADER_STAGE_FRAGMENT_BIT)
+				stages.push_back(info.pStages[it]);
+		}
+		libraryInfo.pDepthStencilState = info.pDepthStencilState;
+		libraryInfo.pMultisampleState  = info.pMultisampleState;
+		libraryInfo.layout             = info.layout;
+		break;
+	case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT:
+		libraryInfo.pColorBlendState  = info.pColorBlendState;
+		libraryInfo.pMultisampleState = info.pMultisampleState;
+		break;
+	}
+	libraryInfo.stageCount = static_cast<uint32>(stages.size());
+	libraryInfo.pStages    = stages.empty() ? nullptr : stages.data();
+
+	// rendering info of dynamic rendering is chained behind library info
+	VkGraphicsPipelineLibraryCreateInfoEXT libraryPartInfo{ VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT };
+	libraryPartInfo.flags = part;
+	libraryPartInfo.pNext = const_cast<void*>(info.pNext);
+	libraryInfo.pNext     = &libraryPartInfo;
+
+	VkPipeline library = VK_NULL_HANDLE;
+	MK_CHECK(vkCreateGraphicsPipelines(_mkDevicePtr->GetDevice(), GPipelineCache->GetPipelineCache(), 1, &libraryInfo, nullptr, &library));
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto [it, isInserted] = _libraries.emplace(libraryKey, library);
+	if (!isInserted)
+		vkDestroyPipeline(_mkDevicePtr->GetDevice(), library, nullptr);
+
+	return it->second;
+}
+
+VkPipeline MKPipelineRegistry::LinkLibraries(const std::array<VkPipeline, 4>& libraries, VkPipelineLayout layout, VkPipelineCreateFlags flags, bool isOptimized)
+{
+	VkPipelineLibraryCreateInfoKHR linkInfo{ VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR };
+	linkInfo.libraryCount = static_cast<uint32>(libraries.size());
+	linkInfo.pLibraries   = libraries.data();
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{ VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+	pipelineInfo.pNext  = &linkInfo;
+	pipelineInfo.layout = layout;
+	pipelineInfo.flags  = flags | (isOptimized ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0); // fast-link skips link time optimization
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	MK_CHECK(vkCreateGraphicsPipelines(_mkDevicePtr->GetDevice(), GPipelineCache->GetPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline));
+
+	return pipeline;
+}
+
+void MKPipelineRegistry::OptimizePipeline(const OptimizeRequest& request)
+{
+	bool isStopping = false;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		isStopping = _isStopping;
+	}
+
+	// swap in optimized pipeline, the fast-linked one is retired until command buffers in flight are done with it
+	VkPipeline replacedPipeline = VK_NULL_HANDLE;
+	try
+	{
+		if (!isStopping)
+		{
+			VkPipeline optimizedPipeline = LinkLibraries(request.libraries, request.layout, request.flags, true);
+			request.entry->pipeline.store(optimizedPipeline);
+			request.entry->isOptimized.store(true);
+			replacedPipeline = request.entry->fastLinkedPipeline;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		MK_LOG(fmt::format("optimize-link failed, keeping fast-linked pipeline : {}", e.what()));
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (replacedPipeline != VK_NULL_HANDLE)
+		{
+			_retiringPipelines.push_back(replacedPipeline);
+			request.entry->fastLinkedPipeline = VK_NULL_HANDLE;
+		}
+		_pendingOptimizeCount--;
+	}
+	_idleCondition.notify_all();
+}
@@ -0,0 +1,507 @@
+#include <assert.h>
+#include <algorithm>
+#include <map>
+
+#include "RenderGraph.h"
+
+namespace
+{
+	struct UsageInfo
+	{
+		VkImageLayout         layout;
+		VkPipelineStageFlags2 stage;
+		VkAccessFlags2        access;
+		VkImageUsageFlags     imageUsage;
+	};
+
+	constexpr VkImageUsageFlags attachmentUsageMask =
+		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+	UsageInfo GetUsageInfo(ERenderGraphUsage usage)
+	{
+		constexpr VkPipelineStageFlags2 fragmentTests = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+
+		switch (usage)
+		{
+		case ERenderGraphUsage::COLOR_ATTACHMENT:
+			return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT };
+		case ERenderGraphUsage::DEPTH_ATTACHMENT:
+			return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, fragmentTests, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+		case ERenderGraphUsage::DEPTH_READ_ONLY:
+			return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, fragmentTests, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+		case ERenderGraphUsage::SAMPLED_FRAGMENT:
+			return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_USAGE_SAMPLED_BIT };
+		case ERenderGraphUsage::SAMPLED_COMPUTE:
+			return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_USAGE_SAMPLED_BIT };
+		case ERenderGraphUsage::STORAGE_READ_COMPUTE:
+			return { VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_USAGE_STORAGE_BIT };
+		case ERenderGraphUsage::STORAGE_WRITE_COMPUTE:
+			return { VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_USAGE_STORAGE_BIT };
+		case ERenderGraphUsage::TRANSFER_SRC:
+			return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_USAGE_TRANSFER_SRC_BIT };
+		case ERenderGraphUsage::TRANSFER_DST:
+			return { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_USAGE_TRANSFER_DST_BIT };
+		default:
+			MK_THROW("unknown render graph usage");
+		}
+	}
+}
+
+/**
+* ---------- pass builder ----------
+*/
+
+MKRenderGraph::PassBuilder& MKRenderGraph::PassBuilder::Read(ResourceHandle resource, ERenderGraphUsage usage)
+{
+	auto& accesses = _graph._passes[_passIndex].accesses;
+	assert(std::none_of(accesses.begin(), accesses.end(), [resource](const ResourceAccess& access) { return access.resource == resource; })); // a pass can't be split by a barrier
+	accesses.push_back({ resource, usage, false });
+	return *this;
+}
+
+MKRenderGraph::PassBuilder& MKRenderGraph::PassBuilder::Write(ResourceHandle resource, ERenderGraphUsage usage)
+{
+	auto& accesses = _graph._passes[_passIndex].accesses;
+	assert(std::none_of(accesses.begin(), accesses.end(), [resource](const ResourceAccess& access) { return access.resource == resource; }));
+	accesses.push_back({ resource, usage, true });
+	return *this;
+}
+
+MKRenderGraph::PassBuilder& MKRenderGraph::PassBuilder::SetSideEffect()
+{
+	_graph._passes[_passIndex].hasSideEffect = true;
+	return *this;
+}
+
+/**
+* ---------- render graph ----------
+*/
+
+MKRenderGraph::MKRenderGraph(MKDevice& mkDeviceRef)
+	: _mkDeviceRef(mkDeviceRef)
+{
+}
+
+MKRenderGraph::~MKRenderGraph()
+{
+	Reset();
+}
+
+VkImageLayout MKRenderGraph::GetUsageLayout(ERenderGraphUsage usage)
+{
+	return GetUsageInfo(usage).layout;
+}
+
+MKRenderGraph::ResourceHandle MKRenderGraph::CreateImage(const RenderGraphImageDesc& desc)
+{
+	assert(!_isCompiled);
+
+	Resource resource{};
+	resource.desc = desc;
+	_resources.push_back(resource);
+
+	return static_cast<ResourceHandle>(_resources.size() - 1);
+}
+
+MKRenderGraph::ResourceHandle MKRenderGraph::ImportImage(const RenderGraphImageDesc& desc, const RenderGraphImportState& initialState, const RenderGraphImportState& finalState)
+{
+	assert(!_isCompiled);
+
+	Resource resource{};
+	resource.desc         = desc;
+	resource.isImported   = true;
+	resource.initialState = initialState;
+	resource.finalState   = finalState;
+	_resources.push_back(resource);
+
+	return static_cast<ResourceHandle>(_resources.size() - 1);
+}
+
+MKRenderGraph::PassBuilder MKRenderGraph::AddPass(const std::string& name, ExecuteFunc execute)
+{
+	assert(!_isCompiled);
+
+	Pass pass{};
+	pass.name    = name;
+	pass.execute = std::move(execute);
+	_passes.push_back(std::move(pass));
+
+	return PassBuilder(*this, static_cast<uint32>(_passes.size() - 1));
+}
+
+void MKRenderGraph::Compile()
+{
+	assert(!_isCompiled);
+
+	CullPasses();
+	CreateTransientImages();
+	DeriveBarriers();
+	_isCompiled = true;
+
+#ifndef NDEBUG
+	uint32 activePassCount = static_cast<uint32>(std::count_if(_passes.begin(), _passes.end(), [](const Pass& pass) { return !pass.isCulled; }));
+	MK_LOG(fmt::format(
+		"render graph compiled : {} of {} passes, {} barriers, {} bytes of transient memory on {} blocks",
+		activePassCount, _passes.size(), _barrierCount, _transientAllocator.GetCommittedMemorySize(), _transientAllocator.GetBlockCount()
+	));
+#endif
+}
+
+void MKRenderGraph::SetImportedImage(ResourceHandle resource, VkImage image, VkImageView imageView)
+{
+	assert(_resources[resource].isImported);
+
+	_resources[resource].image     = image;
+	_resources[resource].imageView = imageView;
+}
+
+void MKRenderGraph::Execute(VkCommandBuffer commandBuffer)
+{
+	assert(_isCompiled);
+
+	auto flushBarriers = [&](const std::vector<uint32>& barrierIndices) {
+		for (uint32 barrierIndex : barrierIndices)
+		{
+			const CompiledBarrier& compiled = _barriers[barrierIndex];
+			assert(_resources[compiled.resource].image != VK_NULL_HANDLE); // imported image of this frame was not set
+
+			VkImageMemoryBarrier2 barrier = compiled.barrier;
+			barrier.image = _resources[compiled.resource].image;
+			_barrierBatch.AddImageBarrier(barrier);
+		}
+		_barrierBatch.Flush(commandBuffer);
+	};
+
+	for (const auto& pass : _passes)
+	{
+		if (pass.isCulled)
+			continue;
+
+		flushBarriers(pass.barrierIndices);
+		pass.execute(commandBuffer);
+	}
+
+	flushBarriers(_finalBarrierIndices);
+}
+
+void MKRenderGraph::Reset()
+{
+	for (auto& resource : _resources)
+	{
+		if (!resource.isImported && resource.imageView != VK_NULL_HANDLE)
+			vkDestroyImageView(_mkDeviceRef.GetDevice(), resource.imageView, nullptr);
+	}
+
+	// destroy aliased images and free their memory blocks
+	_transientAllocator.Reset();
+
+	_passes.clear();
+	_resources.clear();
+	_barriers.clear();
+	_finalBarrierIndices.clear();
+	_barrierCount = 0;
+	_isCompiled   = false;
+}
+
+/**
+* ---------- compile steps ----------
+*/
+
+void MKRenderGraph::CullPasses()
+{
+	/**
+	* reference counting from the outputs (imported images with a final layout)
+	* - a resource is needed while any surviving pass reads it or it is an output.
+	* - a pass survives while any of its writes is needed, or when it has side effects.
+	*/
+	for (auto& resource : _resources)
+		resource.refCount = resource.finalState.layout != VK_IMAGE_LAYOUT_UNDEFINED ? 1 : 0;
+
+	for (auto& pass : _passes)
+	{
+		pass.isCulled = false;
+		pass.refCount = 0;
+		for (const auto& access : pass.accesses)
+		{
+			if (access.isWrite)
+				pass.refCount++;
+			else
+				_resources[access.resource].refCount++;
+		}
+	}
+
+	std::vector<ResourceHandle> unreferenced;
+	auto cullPass = [&](Pass& pass) {
+		pass.isCulled = true;
+		for (const auto& access : pass.accesses)
+		{
+			if (!access.isWrite && --_resources[access.resource].refCount == 0)
+				unreferenced.push_back(access.resource);
+		}
+	};
+
+	// seed unread resources before any pass is culled, so that a resource is queued once, when its count reaches zero
+	for (ResourceHandle it = 0; it < _resources.size(); it++)
+	{
+		if (_resources[it].refCount == 0)
+			unreferenced.push_back(it);
+	}
+	for (auto& pass : _passes)
+	{
+		if (pass.refCount == 0 && !pass.hasSideEffect)
+			cullPass(pass);
+	}
+
+	while (!unreferenced.empty())
+	{
+		ResourceHandle resource = unreferenced.back();
+		unreferenced.pop_back();
+
+		// writers of an unread resource lose one reason to exist
+		for (auto& pass : _passes)
+		{
+			if (pass.isCulled)
+				continue;
+
+			for (const auto& access : pass.accesses)
+			{
+				if (access.resource == resource && access.isWrite && --pass.refCount == 0 && !pass.hasSideEffect)
+				{
+					cullPass(pass);
+					break;
+				}
+			}
+		}
+	}
+
+#ifndef NDEBUG
+	for (const auto& pass : _passes)
+	{
+		if (pass.isCulled)
+			MK_LOG(fmt::format("render graph culled pass '{}'", pass.name));
+	}
+#endif
+}
+
+void MKRenderGraph::CreateTransientImages()
+{
+	// lifetime and usage of each transient image over surviving passes
+	std::vector<uint32>            firstPass(_resources.size(), UINT32_MAX);
+	std::vector<uint32>            lastPass(_resources.size(), 0);
+	std::vector<VkImageUsageFlags> usages(_resources.size(), 0);
+	std::vector<uint32>            userCounts(_resources.size(), 0);
+
+	for (uint32 passIndex = 0; passIndex < _passes.size(); passIndex++)
+	{
+		if (_passes[passIndex].isCulled)
+			continue;
+
+		for (const auto& access : _passes[passIndex].accesses)
+		{
+			firstPass[access.resource]   = std::min(firstPass[access.resource], passIndex);
+			lastPass[access.resource]    = std::max(lastPass[access.resource], passIndex);
+			usages[access.resource]     |= GetUsageInfo(access.usage).imageUsage;
+			userCounts[access.resource] += 1;
+		}
+	}
+
+	bool hasTransientImage = false;
+	for (ResourceHandle it = 0; it < _resources.size(); it++)
+	{
+		Resource& resource = _resources[it];
+		if (resource.isImported || userCounts[it] == 0)
+			continue;
+
+		// an attachment living in a single pass is never stored, so it may be backed by lazily allocated memory
+		VkImageUsageFlags usage = usages[it] | resource.desc.extraUsage;
+		if (userCounts[it] == 1 && (usage & ~attachmentUsageMask) == 0)
+			usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+		resource.transientHandle = _transientAllocator.RequestImage({
+			resource.desc.width, resource.desc.height,
+			resource.desc.format,
+			usage,
+			firstPass[it],
+			lastPass[it],
+			resource.desc.name,
+			resource.desc.samples
+		});
+		hasTransientImage = true;
+	}
+
+	if (!hasTransientImage)
+		return;
+
+	// images with disjoint lifetimes share memory blocks
+	_transientAllocator.Build();
+
+	for (auto& resource : _resources)
+	{
+		if (resource.transientHandle == UINT32_MAX)
+			continue;
+
+		resource.image = _transientAllocator.GetImage(resource.transientHandle).image;
+		mk::vk::CreateImageView(
+			_mkDeviceRef.GetDevice(),
+			resource.image,
+			resource.imageView,
+			VK_IMAGE_VIEW_TYPE_2D,
+			resource.desc.format,
+			resource.desc.aspect,
+			1, // mip levels
+			1  // layer count
+		);
+	}
+}
+
+void MKRenderGraph::DeriveBarriers()
+{
+	struct ResourceState
+	{
+		VkImageLayout         layout;
+		VkPipelineStageFlags2 writeStage;     // stages of the last write (or layout transition)
+		VkAccessFlags2        writeAccess;    // write accesses not made available yet
+		VkPipelineStageFlags2 readStages;     // stages reading since the last write, a later write must wait for them
+		VkPipelineStageFlags2 visibleStages;  // stages the last write is visible to
+		VkAccessFlags2        visibleAccess;
+		bool                  isFirstUse;
+	};
+
+	/**
+	* accesses of every image placed on a memory block during the whole frame
+	* - the first use of a transient image waits for them, which covers images aliasing the block earlier in this frame
+	*   and the previous frame in flight that still works on the same memory.
+	*/
+	struct BlockState
+	{
+		VkPipelineStageFlags2 stages      = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2        writeAccess = VK_ACCESS_2_NONE;
+	};
+
+	std::vector<ResourceState> states(_resources.size());
+	for (ResourceHandle it = 0; it < _resources.size(); it++)
+	{
+		const Resource& resource = _resources[it];
+		states[it] = {
+			resource.isImported ? resource.initialState.layout : VK_IMAGE_LAYOUT_UNDEFINED,
+			resource.isImported ? resource.initialState.stage : VK_PIPELINE_STAGE_2_NONE,
+			resource.isImported ? resource.initialState.access : VK_ACCESS_2_NONE,
+			VK_PIPELINE_STAGE_2_NONE,
+			VK_PIPELINE_STAGE_2_NONE,
+			VK_ACCESS_2_NONE,
+			true
+		};
+	}
+	std::map<uint32, BlockState> blockStates;
+	for (const auto& pass : _passes)
+	{
+		if (pass.isCulled)
+			continue;
+
+		for (const auto& access : pass.accesses)
+		{
+			uint32 transientHandle = _resources[access.resource].transientHandle;
+			if (transientHandle == UINT32_MAX)
+				continue;
+
+			UsageInfo   usageInfo  = GetUsageInfo(access.usage);
+			BlockState& blockState = blockStates[_transientAllocator.GetBlockIndex(transientHandle)];
+			blockState.stages      |= usageInfo.stage;
+			blockState.writeAccess |= usageInfo.access & mk::vk::WRITE_ACCESS_MASK;
+		}
+	}
+
+	auto addBarrier = [&](ResourceHandle resource, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkImageLayout oldLayout, const UsageInfo& dst) {
+		VkImageMemoryBarrier2 barrier{};
+		barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		barrier.srcStageMask        = srcStage;
+		barrier.srcAccessMask       = srcAccess;
+		barrier.dstStageMask        = dst.stage;
+		barrier.dstAccessMask       = dst.access;
+		barrier.oldLayout           = oldLayout;
+		barrier.newLayout           = dst.layout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image               = _resources[resource].image; // imported images are patched in Execute()
+		barrier.subresourceRange    = { _resources[resource].desc.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+
+		_barriers.push_back({ resource, barrier });
+		return static_cast<uint32>(_barriers.size() - 1);
+	};
+
+	for (auto& pass : _passes)
+	{
+		if (pass.isCulled)
+			continue;
+
+		for (const auto& access : pass.accesses)
+		{
+			const Resource& resource = _resources[access.resource];
+			ResourceState&  state    = states[access.resource];
+			UsageInfo       dst      = GetUsageInfo(access.usage);
+
+			// a transient image inherits the hazards of every image using its memory
+			if (state.isFirstUse && resource.transientHandle != UINT32_MAX)
+			{
+				const BlockState& blockState = blockStates[_transientAllocator.GetBlockIndex(resource.transientHandle)];
+				state.writeStage  = blockState.stages;
+				state.writeAccess = blockState.writeAccess;
+			}
+
+			bool isLayoutChanged = state.layout != dst.layout;
+			if (access.isWrite || isLayoutChanged)
+			{
+				// write after write/read, or a layout transition which is a write as well
+				VkPipelineStageFlags2 srcStage = state.writeStage | state.readStages;
+				if (isLayoutChanged || srcStage != VK_PIPELINE_STAGE_2_NONE)
+					pass.barrierIndices.push_back(addBarrier(access.resource, srcStage, state.writeAccess, state.layout, dst));
+
+				state.layout        = dst.layout;
+				state.writeStage    = dst.stage;
+				state.writeAccess   = access.isWrite ? (dst.access & mk::vk::WRITE_ACCESS_MASK) : VK_ACCESS_2_NONE;
+				state.readStages    = access.isWrite ? VK_PIPELINE_STAGE_2_NONE : dst.stage;
+				state.visibleStages = dst.stage;
+				state.visibleAccess = dst.access;
+			}
+			else
+			{
+				// read after write needs the write to be visible to this stage, read after read in the same layout needs nothing
+				bool isVisible = (dst.stage & ~state.visibleStages) == 0 && (dst.access & ~state.visibleAccess) == 0;
+				if (!isVisible && state.writeStage != VK_PIPELINE_STAGE_2_NONE)
+				{
+					pass.barrierIndices.push_back(addBarrier(access.resource, state.writeStage, state.writeAccess, state.layout, dst));
+					state.visibleStages |= dst.stage;
+					state.visibleAccess |= dst.access;
+				}
+				state.readStages |= dst.stage;
+			}
+			state.isFirstUse = false;
+		}
+	}
+
+	/**
+	* outputs are handed over in their final state
+	* - a final stage of none is for users synchronizing with a semaphore (e.g. present), only the layout is transitioned.
+	* - otherwise the barrier makes the last write visible to the final stage, so the next frame on the same queue
+	*   (e.g. temporal history) chains its own barrier after it by importing the image with that stage.
+	*/
+	for (ResourceHandle it = 0; it < _resources.size(); it++)
+	{
+		const Resource&      resource = _resources[it];
+		const ResourceState& state    = states[it];
+		if (resource.finalState.layout == VK_IMAGE_LAYOUT_UNDEFINED)
+			continue;
+
+		UsageInfo finalState{ resource.finalState.layout, resource.finalState.stage, resource.finalState.access, 0 };
+		bool isVisible = (finalState.stage & ~state.visibleStages) == 0 && (finalState.access & ~state.visibleAccess) == 0;
+		if (state.layout == finalState.layout && (finalState.stage == VK_PIPELINE_STAGE_2_NONE || isVisible))
+			continue;
+
+		// a layout transition waits for reads as well, making a write visible only waits for the write
+		VkPipelineStageFlags2 srcStage = state.layout != finalState.layout ? state.writeStage | state.readStages : state.writeStage;
+		_finalBarrierIndices.push_back(addBarrier(it, srcStage, state.writeAccess, state.layout, finalState));
+	}
+
+	_barrierCount = static_cast<uint32>(_barriers.size());
+}
@@ -6,7 +6,9 @@ namespace mk
 	{
 		void CreateDefaultRenderPass(VkDevice device, VkFormat colorAttachmentFormat, VkFormat depthAttachmentFormat, VkRenderPass* renderPassPtr)
 		{
-			std::vector<VkAttachmentDescription> attachments(2);
+			// depth attachment is optional, a pass drawing only a fullscreen triangle doesn't need one
+			bool hasDepth = depthAttachmentFormat != VK_FORMAT_UNDEFINED;
+			std::vector<VkAttachmentDescription> attachments(hasDepth ? 2 : 1);
 			// Color attachment
 			attachments[0].format = colorAttachmentFormat;
 			attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
@@ -14,11 +16,14 @@ namespace mk
 			attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
 
 			// Depth attachment
-			attachments[1].format = depthAttachmentFormat;
-			attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-			attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-			attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-			attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+			if (hasDepth)
+			{
+				attachments[1].format = depthAttachmentFormat;
+				attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+				attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+				attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+				attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+			}
 
 			VkAttachmentReference colorAttachmentRef{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
 			VkAttachmentReference depthAttachmentRef{1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
@@ -27,16 +32,21 @@ namespace mk
 			subpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
 			subpassDependencies[0].dstSubpass = 0;
 			subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-			subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 			subpassDependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-			subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 			subpassDependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+			if (hasDepth)
+			{
+				subpassDependencies[0].dstStageMask  |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+				subpassDependencies[0].dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			}
 
 			VkSubpassDescription subpassDescription{};
 			subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 			subpassDescription.colorAttachmentCount = 1;
 			subpassDescription.pColorAttachments = &colorAttachmentRef;
-			subpassDescription.pDepthStencilAttachment = &depthAttachmentRef;
+			subpassDescription.pDepthStencilAttachment = hasDepth ? &depthAttachmentRef : nullptr;
 
 			VkRenderPassCreateInfo renderPassInfo{ VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
 			renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
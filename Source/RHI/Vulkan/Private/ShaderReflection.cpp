@@ -0,0 +1,308 @@
+#include <cstring>
+
+#include "ShaderReflection.h"
+
+namespace mk
+{
+	namespace spirv
+	{
+		// SPIR-V enumerants used by the reflection (see SPIR-V specification, section 3)
+		enum ESpirvOp : uint16
+		{
+			OP_DECORATE                    = 71,
+			OP_MEMBER_DECORATE             = 72,
+			OP_TYPE_INT                    = 21,
+			OP_TYPE_FLOAT                  = 22,
+			OP_TYPE_VECTOR                 = 23,
+			OP_TYPE_MATRIX                 = 24,
+			OP_TYPE_IMAGE                  = 25,
+			OP_TYPE_SAMPLER                = 26,
+			OP_TYPE_SAMPLED_IMAGE          = 27,
+			OP_TYPE_ARRAY                  = 28,
+			OP_TYPE_RUNTIME_ARRAY          = 29,
+			OP_TYPE_STRUCT                 = 30,
+			OP_TYPE_POINTER                = 32,
+			OP_CONSTANT                    = 43,
+			OP_VARIABLE                    = 59,
+			OP_TYPE_ACCELERATION_STRUCTURE = 5341,
+		};
+
+		enum ESpirvDecoration : uint32
+		{
+			DECORATION_BLOCK          = 2,
+			DECORATION_BUFFER_BLOCK   = 3,
+			DECORATION_ARRAY_STRIDE   = 6,
+			DECORATION_MATRIX_STRIDE  = 7,
+			DECORATION_BINDING        = 33,
+			DECORATION_DESCRIPTOR_SET = 34,
+			DECORATION_OFFSET         = 35,
+		};
+
+		enum ESpirvStorageClass : uint32
+		{
+			STORAGE_UNIFORM_CONSTANT = 0,
+			STORAGE_UNIFORM          = 2,
+			STORAGE_PUSH_CONSTANT    = 9,
+			STORAGE_STORAGE_BUFFER   = 12,
+		};
+
+		struct SpirvId
+		{
+			uint16              opcode = 0;
+			std::vector<uint32> operands;       // operands following the result id
+			uint32              set = UINT32_MAX;
+			uint32              binding = UINT32_MAX;
+			uint32              arrayStride = 0;
+			bool                isBlock = false;
+			bool                isBufferBlock = false;
+			std::vector<uint32> memberOffsets;
+			std::vector<uint32> memberMatrixStrides;
+		};
+
+		// SPIR-V universal limits (see SPIR-V specification, section 2.17)
+		constexpr uint32 MAX_ID_BOUND      = 0x3FFFFF;
+		constexpr uint32 MAX_STRUCT_MEMBER = 16383;
+
+		/* ids and operands are read from the binary, so every access is checked against what was actually declared */
+		static const SpirvId& GetId(const std::vector<SpirvId>& ids, uint32 id)
+		{
+			if (id >= ids.size())
+				MK_THROW(fmt::format("SPIR-V id {} is out of id bound {}, failed to reflect shader", id, ids.size()));
+			return ids[id];
+		}
+
+		static uint32 GetOperand(const SpirvId& id, uint32 index)
+		{
+			if (index >= id.operands.size())
+				MK_THROW(fmt::format("SPIR-V instruction (opcode {}) has no operand {}, failed to reflect shader", id.opcode, index));
+			return id.operands[index];
+		}
+
+		static uint32 GetTypeSize(const std::vector<SpirvId>& ids, uint32 typeId, uint32 matrixStride = 0)
+		{
+			const SpirvId& type = GetId(ids, typeId);
+			switch (type.opcode)
+			{
+			case OP_TYPE_INT:
+			case OP_TYPE_FLOAT:
+				return GetOperand(type, 0) / 8;
+			case OP_TYPE_VECTOR:
+				return GetTypeSize(ids, GetOperand(type, 0)) * GetOperand(type, 1);
+			case OP_TYPE_MATRIX:
+				return (matrixStride != 0 ? matrixStride : GetTypeSize(ids, GetOperand(type, 0))) * GetOperand(type, 1);
+			case OP_TYPE_ARRAY:
+			{
+				const SpirvId& lengthConstant = GetId(ids, GetOperand(type, 1)); // { result type, value }
+				uint32 length = lengthConstant.operands.size() > 1 ? lengthConstant.operands[1] : 1;
+				uint32 stride = type.arrayStride != 0 ? type.arrayStride : GetTypeSize(ids, GetOperand(type, 0), matrixStride);
+				return stride * length;
+			}
+			case OP_TYPE_STRUCT:
+			{
+				uint32 size = 0;
+				for (uint32 member = 0; member < type.operands.size(); member++)
+				{
+					uint32 offset = member < type.memberOffsets.size() ? type.memberOffsets[member] : size;
+					uint32 stride = member < type.memberMatrixStrides.size() ? type.memberMatrixStrides[member] : 0;
+					size = std::max(size, offset + GetTypeSize(ids, type.operands[member], stride));
+				}
+				return size;
+			}
+			default:
+				return 0;
+			}
+		}
+
+		ShaderReflection ReflectShader(const std::vector<char>& code, VkShaderStageFlagBits stage)
+		{
+			ShaderReflection reflection{};
+			reflection.stage = stage;
+
+			const uint32 wordCount = static_cast<uint32>(code.size() / sizeof(uint32));
+			std::vector<uint32> words(wordCount);
+			memcpy(words.data(), code.data(), wordCount * sizeof(uint32));
+
+			if (wordCount < 5 || words[0] != 0x07230203)
+				MK_THROW("invalid SPIR-V binary, failed to reflect shader");
+
+			// header word 3 is the id bound, every result id is below it
+			const uint32 idBound = words[3];
+			if (idBound > MAX_ID_BOUND)
+				MK_THROW(fmt::format("SPIR-V id bound {} exceeds the limit {}, failed to reflect shader", idBound, MAX_ID_BOUND));
+
+			// 1. collect result ids and their decorations
+			std::vector<SpirvId> ids(idBound);
+			std::vector<uint32> variables;
+			for (uint32 offset = 5; offset < wordCount;)
+			{
+				uint16 opcode = static_cast<uint16>(words[offset] & 0xFFFF);
+				uint16 length = static_cast<uint16>(words[offset] >> 16);
+				if (length == 0 || offset + length > wordCount)
+					MK_THROW(fmt::format("SPIR-V instruction (opcode {}) at word {} has word count {}, but {} words remain, failed to reflect shader", opcode, offset, length, wordCount - offset));
+
+				const uint32* operands = words.data() + offset + 1;
+				auto requireLength = [&](uint16 minLength) {
+					if (length < minLength)
+						MK_THROW(fmt::format("SPIR-V instruction (opcode {}) at word {} has word count {}, expected at least {}, failed to reflect shader", opcode, offset, length, minLength));
+				};
+				auto getTarget = [&](uint32 id) -> SpirvId& {
+					if (id >= idBound)
+						MK_THROW(fmt::format("SPIR-V instruction (opcode {}) at word {} uses id {} out of id bound {}, failed to reflect shader", opcode, offset, id, idBound));
+					return ids[id];
+				};
+
+				switch (opcode)
+				{
+				case OP_DECORATE:
+				{
+					requireLength(3);
+					SpirvId& target = getTarget(operands[0]);
+					if (operands[1] == DECORATION_DESCRIPTOR_SET || operands[1] == DECORATION_BINDING || operands[1] == DECORATION_ARRAY_STRIDE)
+						requireLength(4); // decorations with a literal
+					if (operands[1] == DECORATION_DESCRIPTOR_SET) target.set = operands[2];
+					if (operands[1] == DECORATION_BINDING)        target.binding = operands[2];
+					if (operands[1] == DECORATION_ARRAY_STRIDE)   target.arrayStride = operands[2];
+					if (operands[1] == DECORATION_BLOCK)          target.isBlock = true;
+					if (operands[1] == DECORATION_BUFFER_BLOCK)   target.isBufferBlock = true;
+					break;
+				}
+				case OP_MEMBER_DECORATE:
+				{
+					requireLength(4);
+					SpirvId& target = getTarget(operands[0]);
+					uint32 member = operands[1];
+					if (member >= MAX_STRUCT_MEMBER)
+						MK_THROW(fmt::format("SPIR-V member decoration at word {} uses member {} beyond the limit {}, failed to reflect shader", offset, member, MAX_STRUCT_MEMBER));
+					if (operands[2] == DECORATION_OFFSET || operands[2] == DECORATION_MATRIX_STRIDE)
+						requireLength(5); // decorations with a literal
+					if (operands[2] == DECORATION_OFFSET)
+					{
+						target.memberOffsets.resize(std::max<size_t>(target.memberOffsets.size(), member + 1), 0);
+						target.memberOffsets[member] = operands[3];
+					}
+					if (operands[2] == DECORATION_MATRIX_STRIDE)
+					{
+						target.memberMatrixStrides.resize(std::max<size_t>(target.memberMatrixStrides.size(), member + 1), 0);
+						target.memberMatrixStrides[member] = operands[3];
+					}
+					break;
+				}
+				case OP_TYPE_INT:
+				case OP_TYPE_FLOAT:
+				case OP_TYPE_VECTOR:
+				case OP_TYPE_MATRIX:
+				case OP_TYPE_IMAGE:
+				case OP_TYPE_SAMPLER:
+				case OP_TYPE_SAMPLED_IMAGE:
+				case OP_TYPE_ARRAY:
+				case OP_TYPE_RUNTIME_ARRAY:
+				case OP_TYPE_STRUCT:
+				case OP_TYPE_POINTER:
+				case OP_TYPE_ACCELERATION_STRUCTURE:
+				{
+					requireLength(2);
+					SpirvId& result = getTarget(operands[0]);
+					result.opcode = opcode;
+					result.operands.assign(operands + 1, operands + length - 1);
+					break;
+				}
+				case OP_CONSTANT:
+				case OP_VARIABLE:
+				{
+					// result type comes first, keep it as the first operand
+					requireLength(opcode == OP_VARIABLE ? 4 : 3); // a variable has a storage class
+					SpirvId& result = getTarget(operands[1]);
+					result.opcode = opcode;
+					result.operands.assign({ operands[0] });
+					result.operands.insert(result.operands.end(), operands + 2, operands + length - 1);
+					if (opcode == OP_VARIABLE)
+						variables.push_back(operands[1]);
+					break;
+				}
+				}
+
+				offset += length;
+			}
+
+			// 2. map variables to descriptor types
+			for (uint32 variableId : variables)
+			{
+				const SpirvId& variable = ids[variableId];
+				const SpirvId& pointer  = GetId(ids, GetOperand(variable, 0));
+				uint32 storageClass = GetOperand(variable, 1);
+				uint32 typeId       = GetOperand(pointer, 1);
+
+				if (storageClass == STORAGE_PUSH_CONSTANT)
+				{
+					reflection.pushConstantSize = std::max(reflection.pushConstantSize, GetTypeSize(ids, typeId));
+					continue;
+				}
+
+				if (variable.set == UINT32_MAX || variable.binding == UINT32_MAX)
+					continue;
+
+				// unwrap arrays of resources
+				uint32 descriptorCount = 1;
+				while (GetId(ids, typeId).opcode == OP_TYPE_ARRAY || ids[typeId].opcode == OP_TYPE_RUNTIME_ARRAY)
+				{
+					if (ids[typeId].opcode == OP_TYPE_ARRAY)
+						descriptorCount *= GetOperand(GetId(ids, GetOperand(ids[typeId], 1)), 1);
+					typeId = GetOperand(ids[typeId], 0);
+				}
+
+				const SpirvId& type = GetId(ids, typeId);
+				VkDescriptorType descriptorType = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+				if (storageClass == STORAGE_UNIFORM_CONSTANT)
+				{
+					if (type.opcode == OP_TYPE_SAMPLER)
+						descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+					else if (type.opcode == OP_TYPE_SAMPLED_IMAGE)
+						descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+					else if (type.opcode == OP_TYPE_ACCELERATION_STRUCTURE)
+						descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+					else if (type.opcode == OP_TYPE_IMAGE)
+					{
+						uint32 dim = GetOperand(type, 1), sampled = GetOperand(type, 5);
+						if (dim == 5)      // Buffer
+							descriptorType = (sampled == 2) ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+						else if (dim == 6) // SubpassData
+							descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+						else
+							descriptorType = (sampled == 2) ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+					}
+				}
+				else if (storageClass == STORAGE_UNIFORM)
+				{
+					descriptorType = type.isBufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				}
+				else if (storageClass == STORAGE_STORAGE_BUFFER)
+				{
+					descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				}
+
+				if (descriptorType == VK_DESCRIPTOR_TYPE_MAX_ENUM)
+					continue;
+
+				// merge separate image and sampler declared on the same binding
+				auto existing = std::find_if(reflection.bindings.begin(), reflection.bindings.end(), [&variable](const ReflectedBinding& binding) {
+					return binding.set == variable.set && binding.binding == variable.binding;
+				});
+				if (existing != reflection.bindings.end())
+				{
+					bool isImageSamplerPair =
+						(existing->descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE && descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER) ||
+						(existing->descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER && descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE);
+					if (!isImageSamplerPair)
+						MK_THROW(fmt::format("descriptor (set {}, binding {}) is declared twice with different types", variable.set, variable.binding));
+
+					existing->descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+					continue;
+				}
+
+				reflection.bindings.push_back({ variable.set, variable.binding, descriptorType, descriptorCount });
+			}
+
+			return reflection;
+		}
+	}
+}
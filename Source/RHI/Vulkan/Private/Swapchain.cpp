@@ -14,9 +14,6 @@ MKSwapchain::MKSwapchain(MKDevice& deviceRef)
 
 	// create image views mapped to teh swapchain images.
 	CreateSwapchainImageViews();
-
-	// create depth resources
-	CreateDepthResources();
 }
 
 MKSwapchain::~MKSwapchain()
@@ -34,8 +31,6 @@ MKSwapchain::~MKSwapchain()
 
 void MKSwapchain::DestroySwapchainResources()
 {
-    DestroyDepthResources();
-
 	// destroy image views
 	for (auto imageView : _vkSwapchainImageViews)
 		vkDestroyImageView(_mkDeviceRef.GetDevice(), imageView, nullptr);
@@ -44,17 +39,12 @@ void MKSwapchain::DestroySwapchainResources()
 	vkDestroySwapchainKHR(_mkDeviceRef.GetDevice(), _vkSwapchain, nullptr);
 }
 
-void MKSwapchain::DestroyDepthResources()
-{
-	vmaDestroyImage(_mkDeviceRef.GetVmaAllocator(), _vkDepthImage.image, _vkDepthImage.allocation);
-	vkDestroyImageView(_mkDeviceRef.GetDevice(), _vkDepthImageView, nullptr);
-}
-
 void MKSwapchain::CreateSwapchain()
 {
 	MKDevice::SwapChainSupportDetails supportDetails = _mkDeviceRef.QuerySwapChainSupport(_mkDeviceRef.GetPhysicalDevice());
-	VkSurfaceFormatKHR surfaceFormat                 = _mkDeviceRef.ChooseSwapSurfaceFormat(supportDetails.formats);
-	VkPresentModeKHR presentMode                     = _mkDeviceRef.ChooseSwapPresentMode(supportDetails.presentModes);
+	bool isStorageImage                              = _isStorageImageRequested && (supportDetails.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_STORAGE_BIT);
+	VkSurfaceFormatKHR surfaceFormat                 = _mkDeviceRef.ChooseSwapSurfaceFormat(supportDetails.formats, isStorageImage);
+	VkPresentModeKHR presentMode                     = _mkDeviceRef.ChooseSwapPresentMode(supportDetails.presentModes, _isLowLatencyMode);
 	VkExtent2D actualExtent                          = _mkDeviceRef.ChooseSwapExtent(supportDetails.capabilities);
 
 	uint32 imageCount = supportDetails.capabilities.minImageCount + 1;	// It is recommended to request at least one more image than the minimum
@@ -77,6 +67,11 @@ void MKSwapchain::CreateSwapchain()
 		isExclusive
 	);
 
+	// sRGB formats rarely support storage, so ChooseSwapSurfaceFormat() may have fallen back to a format without it
+	_isStorageImageEnabled = isStorageImage && mk::vk::IsFormatFeatureSupported(_mkDeviceRef.GetPhysicalDevice(), surfaceFormat.format, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
+	if (_isStorageImageEnabled)
+		swapchainCreateInfo.imageUsage |= VK_IMAGE_USAGE_STORAGE_BIT;
+
 	// create swapchain
 	MK_CHECK(vkCreateSwapchainKHR(_mkDeviceRef.GetDevice(), &swapchainCreateInfo, nullptr, &_vkSwapchain));
 
@@ -85,9 +80,10 @@ void MKSwapchain::CreateSwapchain()
 	_vkSwapchainImages.resize(imageCount);
 	vkGetSwapchainImagesKHR(_mkDeviceRef.GetDevice(), _vkSwapchain, &imageCount, _vkSwapchainImages.data());
 
-	// store swapchain format and extent
+	// store swapchain format, extent and present mode
 	_vkSwapchainImageFormat = surfaceFormat.format;
 	_vkSwapchainExtent = actualExtent;
+	_vkPresentMode = presentMode;
 }
 
 void MKSwapchain::CreateSwapchainImageViews()
@@ -106,35 +102,3 @@ void MKSwapchain::CreateSwapchainImageViews()
 		);
 	}
 }
-
-void MKSwapchain::CreateDepthResources()
-{
-	// find depth format first
-	_vkDepthFormat = mk::vk::FindDepthFormat(_mkDeviceRef.GetPhysicalDevice());
-
-
-	// create depth image
-	mk::vk::CreateImage(
-		_mkDeviceRef.GetVmaAllocator(),
-		_vkDepthImage,
-		_vkSwapchainExtent.width,
-		_vkSwapchainExtent.height,
-		_vkDepthFormat,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-		VMA_MEMORY_USAGE_AUTO,
-		VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT
-	);
-
-	// create depth image view
-	mk::vk::CreateImageView(
-		_mkDeviceRef.GetDevice(),
-		_vkDepthImage.image,
-		_vkDepthImageView,
-		VK_IMAGE_VIEW_TYPE_2D,
-		_vkDepthFormat,
-		VK_IMAGE_ASPECT_DEPTH_BIT, // set DEPTH aspect flags
-		1
-	);
-}
-
@@ -0,0 +1,191 @@
+#include <assert.h>
+
+#include "TransientAllocator.h"
+#include "Allocator.h"
+#include "Global.h"
+
+TransientAllocator::TransientAllocator() {}
+TransientAllocator::~TransientAllocator() {}
+
+VkDeviceSize TransientAllocator::GetCommittedMemorySize() const
+{
+	VkDeviceSize committedSize = 0;
+	for (const auto& block : _blocks)
+		committedSize += block.memoryRequirements.size;
+
+	return committedSize;
+}
+
+/*
+----------- Transient resource api -----------
+*/
+uint32 TransientAllocator::RequestImage(const TransientImageDesc& desc)
+{
+	assert(desc.firstPass <= desc.lastPass);
+
+	TransientRequest request{};
+	request.desc = desc;
+	request.blockIndex = UINT32_MAX;
+	_requests.push_back(request);
+
+	return static_cast<uint32>(_requests.size() - 1);
+}
+
+void TransientAllocator::Build()
+{
+	VmaAllocator vmaAllocator = GAllocator->GetVmaAllocator();
+	VmaAllocatorInfo allocatorInfo{};
+	vmaGetAllocatorInfo(vmaAllocator, &allocatorInfo);
+
+	bool isLazySupported = IsLazilyAllocatedMemorySupported();
+
+	// 1. create image handles without memory to query memory requirements
+	for (auto& request : _requests)
+	{
+		if (request.imageAllocated.image != VK_NULL_HANDLE)
+			continue; // already built
+
+		VkImageCreateInfo imageInfo = mk::vkinfo::GetImageCreateInfo(
+			request.desc.width,
+			request.desc.height,
+			request.desc.format,
+			VK_IMAGE_TILING_OPTIMAL,
+			request.desc.usage
+		);
+		imageInfo.samples = request.desc.samples;
+
+		MK_CHECK(vkCreateImage(allocatorInfo.device, &imageInfo, nullptr, &request.imageAllocated.image));
+		vkGetImageMemoryRequirements(allocatorInfo.device, request.imageAllocated.image, &request.memoryRequirements);
+
+		request.imageAllocated.format = request.desc.format;
+		request.imageAllocated.name   = request.desc.name;
+	}
+
+	/**
+	* 2. assign requests to memory blocks (greedy interval packing)
+	* - visit the biggest request first so that a block is sized by its first occupant in most cases.
+	* - a request can join a block when none of the block occupants is alive in the same passes.
+	* - lazily allocated blocks only accept transient attachments, because the memory can't be sampled or stored.
+	*/
+	std::vector<uint32> order;
+	for (uint32 it = 0; it < _requests.size(); it++)
+	{
+		if (_requests[it].blockIndex == UINT32_MAX)
+			order.push_back(it);
+	}
+	std::sort(order.begin(), order.end(), [this](uint32 lhs, uint32 rhs) {
+		return _requests[lhs].memoryRequirements.size > _requests[rhs].memoryRequirements.size;
+	});
+
+	for (uint32 requestIndex : order)
+	{
+		auto& request = _requests[requestIndex];
+		bool isLazy = isLazySupported && (request.desc.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+
+		for (uint32 blockIndex = 0; blockIndex < _blocks.size(); blockIndex++)
+		{
+			auto& block = _blocks[blockIndex];
+			if (block.allocation != VK_NULL_HANDLE || block.isLazy != isLazy)
+				continue;
+			if ((block.memoryRequirements.memoryTypeBits & request.memoryRequirements.memoryTypeBits) == 0)
+				continue;
+			if (IsLifetimeOverlapped(block, request.desc))
+				continue;
+
+			block.memoryRequirements.size            = std::max(block.memoryRequirements.size, request.memoryRequirements.size);
+			block.memoryRequirements.alignment       = std::max(block.memoryRequirements.alignment, request.memoryRequirements.alignment);
+			block.memoryRequirements.memoryTypeBits &= request.memoryRequirements.memoryTypeBits;
+			block.requestIndices.push_back(requestIndex);
+			request.blockIndex = blockIndex;
+			break;
+		}
+
+		if (request.blockIndex == UINT32_MAX)
+		{
+			TransientBlock newBlock{};
+			newBlock.memoryRequirements = request.memoryRequirements;
+			newBlock.isLazy = isLazy;
+			newBlock.requestIndices.push_back(requestIndex);
+			_blocks.push_back(newBlock);
+			request.blockIndex = static_cast<uint32>(_blocks.size() - 1);
+		}
+	}
+
+	// 3. allocate memory for each new block and bind every occupant at offset zero
+	for (auto& block : _blocks)
+	{
+		if (block.allocation != VK_NULL_HANDLE)
+			continue;
+
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = block.isLazy ? VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED : VMA_MEMORY_USAGE_GPU_ONLY;
+		allocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+
+		MK_CHECK(vmaAllocateMemory(vmaAllocator, &block.memoryRequirements, &allocInfo, &block.allocation, &block.allocationInfo));
+
+		for (uint32 requestIndex : block.requestIndices)
+		{
+			auto& request = _requests[requestIndex];
+			MK_CHECK(vmaBindImageMemory(vmaAllocator, block.allocation, request.imageAllocated.image));
+			request.imageAllocated.allocation     = block.allocation;
+			request.imageAllocated.allocationInfo = block.allocationInfo;
+		}
+	}
+
+#ifndef NDEBUG
+	MK_LOG(fmt::format("transient allocator placed {} images on {} blocks ({} bytes)", _requests.size(), _blocks.size(), GetCommittedMemorySize()));
+#endif
+}
+
+void TransientAllocator::Reset()
+{
+	if (_requests.empty())
+		return;
+
+	VmaAllocator vmaAllocator = GAllocator->GetVmaAllocator();
+	VmaAllocatorInfo allocatorInfo{};
+	vmaGetAllocatorInfo(vmaAllocator, &allocatorInfo);
+
+	// destroy aliased images first, then release the memory they shared
+	for (auto& request : _requests)
+		vkDestroyImage(allocatorInfo.device, request.imageAllocated.image, nullptr);
+
+	for (auto& block : _blocks)
+		vmaFreeMemory(vmaAllocator, block.allocation);
+
+	_requests.clear();
+	_blocks.clear();
+
+#ifndef NDEBUG
+	MK_LOG("transient images destroyed and their memory blocks freed");
+#endif
+}
+
+/*
+----------- Helpers -----------
+*/
+bool TransientAllocator::IsLifetimeOverlapped(const TransientBlock& block, const TransientImageDesc& desc) const
+{
+	for (uint32 requestIndex : block.requestIndices)
+	{
+		const auto& occupant = _requests[requestIndex].desc;
+		if (occupant.firstPass <= desc.lastPass && desc.firstPass <= occupant.lastPass)
+			return true;
+	}
+
+	return false;
+}
+
+bool TransientAllocator::IsLazilyAllocatedMemorySupported() const
+{
+	const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+	vmaGetMemoryProperties(GAllocator->GetVmaAllocator(), &memoryProperties);
+
+	for (uint32 it = 0; it < memoryProperties->memoryTypeCount; it++)
+	{
+		if (memoryProperties->memoryTypes[it].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+			return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "Utilities.h"
+
+/**
+* [BarrierBatch class]
+* - Responsibility :
+*    - collect synchronization2 image and buffer barriers and record them with a single vkCmdPipelineBarrier2 call.
+*    - derive precise stage and access masks from image layouts for plain layout transitions.
+* - Note :
+*    - barriers of one flush execute together, so a second transition of the same subresources is folded into the pending one (old -> new).
+*    - flush right before the first command that depends on the collected barriers, so that earlier work is not serialized.
+*/
+class BarrierBatch
+{
+public:
+	struct Statistics
+	{
+		uint64 flushCount         = 0; // vkCmdPipelineBarrier2 calls
+		uint64 imageBarrierCount  = 0; // recorded image barriers
+		uint64 bufferBarrierCount = 0; // recorded buffer barriers
+		uint64 foldedBarrierCount = 0; // barriers merged into a pending one instead of being recorded
+	};
+
+public:
+	BarrierBatch();
+	~BarrierBatch();
+
+	/* getters */
+	bool              IsEmpty()       const { return _vkImageBarriers.empty() && _vkBufferBarriers.empty(); }
+	const Statistics& GetStatistics() const { return _statistics; }
+
+	/* barrier api */
+	void AddImageBarrier(const VkImageMemoryBarrier2& barrier);
+	void AddImageBarrier(
+		VkImage image,
+		const VkImageSubresourceRange& subresourceRange,
+		VkImageLayout oldLayout, VkImageLayout newLayout,
+		VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+		VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess
+	);
+	void AddImageTransition(VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout oldLayout, VkImageLayout newLayout); // masks derived from layouts
+	void AddBufferBarrier(
+		VkBuffer buffer,
+		VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+		VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess,
+		VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE
+	);
+	void Flush(VkCommandBuffer commandBuffer);
+	void ResetStatistics() { _statistics = {}; }
+
+private:
+	std::vector<VkImageMemoryBarrier2>  _vkImageBarriers;
+	std::vector<VkBufferMemoryBarrier2> _vkBufferBarriers;
+	Statistics                          _statistics;
+};
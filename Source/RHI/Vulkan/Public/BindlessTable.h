@@ -0,0 +1,69 @@
+#pragma once
+
+#include <mutex>
+
+#include "Utilities.h"
+#include "Global.h"
+#include "Device.h"
+#include "DescriptorManager.h"
+
+/**
+* [MKBindlessTable class]
+* - Responsibility :
+*    - own a single global descriptor set holding every texture and storage buffer of the scene.
+*    - hand out stable indices that shaders use to fetch a resource from the runtime sized arrays.
+* - Note :
+*    - requires descriptor indexing (see MKDevice::GetDescriptorIndexingSupport()).
+*    - bindings are partially bound and updatable after bind, so resources can be registered while the set is bound by frames in flight.
+*    - with descriptor buffer backend the set lives in GDescriptorManager's buffer and writes go straight to mapped memory.
+*    - a released slot may be reused right away, callers must make sure no frame in flight still reads it.
+*/
+class MKBindlessTable
+{
+public:
+	enum EBinding : uint32
+	{
+		TEXTURES        = 0, // Texture2D gTextures[]
+		STORAGE_BUFFERS = 1, // StructuredBuffer<T> gBuffers[]
+	};
+
+public:
+	MKBindlessTable();
+	~MKBindlessTable();
+	void InitBindlessTable(MKDevice* mkDevicePtr, uint32 maxTextures = 4096, uint32 maxStorageBuffers = 1024); // capacities are clamped to device limits
+
+	/* getters */
+	VkDescriptorSetLayout                             GetDescriptorSetLayout() const { return _vkSetLayout; }
+	const MKDescriptorManager::DescriptorSetHandle&   GetDescriptorSet()       const { return _descriptorSet; }
+
+	/* registration api (returns index into the bindless array) */
+	uint32 RegisterTexture(VkImageView imageView, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	uint32 RegisterStorageBuffer(VkBuffer buffer, VkDeviceSize range, VkDeviceSize offset = 0); // explicit range, descriptor buffers can't resolve VK_WHOLE_SIZE
+	void   ReleaseTexture(uint32 index);
+	void   ReleaseStorageBuffer(uint32 index);
+
+private:
+	struct SlotAllocator
+	{
+		uint32              capacity = 0;
+		uint32              next     = 0;
+		std::vector<uint32> freeSlots;
+	};
+
+	void   CreateDescriptorPoolSet(); // pool backend only
+	uint32 AllocateSlot(SlotAllocator& slots, const char* resourceName);
+	void   WriteDescriptor(const VkWriteDescriptorSet& write);
+
+private:
+	VkDescriptorSetLayout _vkSetLayout      = VK_NULL_HANDLE;
+	VkDescriptorPool      _vkDescriptorPool = VK_NULL_HANDLE; // pool backend only
+	MKDescriptorManager::DescriptorSetHandle _descriptorSet{};
+	bool                  _isDescriptorBuffer = false;
+
+	SlotAllocator _textureSlots;
+	SlotAllocator _storageBufferSlots;
+	std::mutex    _mutex; // loaders may register resources from worker threads
+
+private:
+	MKDevice* _mkDevicePtr = nullptr;
+};
@@ -1,12 +1,31 @@
 #pragma once
 
+#include <functional>
+#include <array>
+
 #include "Utilities.h"
 #include "Device.h"
 
-constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+constexpr int MAX_FRAMES_IN_FLIGHT     = 3; // upper bound, per frame resources are allocated for this many frames
+constexpr int DEFAULT_FRAMES_IN_FLIGHT = 2; // frames actually in flight, adjustable at runtime up to MAX_FRAMES_IN_FLIGHT
 
+/**
+* [MKCommandService class]
+* - Responsibility :
+*    - own the primary command buffer of every frame in flight and submit it.
+*    - pace frames and single time uploads with timeline semaphores instead of fences and queue idles.
+*    - own one command pool per job system thread and frame in flight, so secondary command buffers can be recorded in parallel.
+* - Note :
+*    - command pools are externally synchronized, each recording job only touches the pool of the thread running it.
+*    - recording must be started from a single thread outside the job system, since those threads share pool 0.
+*    - secondary command buffers of a frame are recycled in bulk by ResetCommandBuffer() once WaitForFrame() has returned.
+*    - frame timeline value N means the N-th submitted frame has finished, each frame slot remembers the value it signals.
+*/
 class MKCommandService
 {
+public:
+	using RecordTask = std::function<void(VkCommandBuffer commandBuffer, uint32 taskIndex)>;
+
 public:
 	MKCommandService();
 	~MKCommandService();
@@ -18,13 +37,18 @@ public:
 	/* supported service */
 	void CreateCommandPool(VkCommandPool* commandPoolPtr, VkCommandPoolCreateFlags commandFlag);
 	void InitCommandService(MKDevice* mkDeviceRef);                               // initialize command service in Device creation stage
-	void SubmitCommandBufferToQueue(                                              // submit command buffer to queue
-			uint32 currentFrame, 												  
-			VkSemaphore waitSemaphores[],										  
-			VkPipelineStageFlags waitStages[],									  
-			VkSemaphore signalSemaphores[],										  
-			VkQueue loadedQueue, 												  
-			VkFence fence = nullptr												  
+	void SubmitCommandBufferToQueue(                                              // submit frame command buffer, signals the frame timeline in addition to signalSemaphores
+			uint32 currentFrame,
+			const std::vector<VkSemaphoreSubmitInfo>& waitSemaphores,
+			const std::vector<VkSemaphoreSubmitInfo>& signalSemaphores,
+			VkQueue loadedQueue
+		 );
+	void Submit(                                                                  // generic vkQueueSubmit2 with any number of waits and signals
+			VkQueue queue,
+			const std::vector<VkCommandBuffer>& commandBuffers,
+			const std::vector<VkSemaphoreSubmitInfo>& waitSemaphores,
+			const std::vector<VkSemaphoreSubmitInfo>& signalSemaphores,
+			VkFence fence = VK_NULL_HANDLE
 		 );
 	void ResetCommandBuffer(uint32 currentFrame); // reset command buffer for reuse
 	void ExecuteCommands(std::queue<VoidLambda>& enqueuedCommands);
@@ -32,6 +56,33 @@ public:
 	void EndSingleTimeCommands(VkCommandBuffer& commandBuffer, VkCommandPool commandPool = VK_NULL_HANDLE);    // end single time command buffer and destroy the buffer right away
 	void CreateCommandBuffers();
 
+	/* frame pacing */
+	void        SetFramesInFlight(uint32 count);                   // clamped to [1, MAX_FRAMES_IN_FLIGHT], safe to change between frames
+	uint32      GetFramesInFlight() const { return _framesInFlight; }
+	uint32      GetNextFrameIndex(uint32 currentFrame) const { return (currentFrame + 1) % _framesInFlight; }
+	void        WaitForFrame(uint32 currentFrame);                 // block until the slot can be reused and at most framesInFlight - 1 frames are pending
+	VkSemaphore GetFrameTimeline() const { return _vkFrameTimeline; }
+	uint64      GetFrameTimelineValue() const { return _frameTimelineValue; } // value signaled by the last submitted frame
+
+	/* upload tracking */
+	VkSemaphore GetUploadTimeline() const { return _vkUploadTimeline; }
+	uint64      GetUploadTimelineValue() const { return _uploadTimelineValue; } // value signaled by the last single time submission
+
+	/* timeline semaphore helpers */
+	VkSemaphore CreateTimelineSemaphore(uint64 initialValue = 0);
+	void        WaitTimelineSemaphore(VkSemaphore semaphore, uint64 value); // block the host until the semaphore reaches value
+
+	/* multi-threaded recording */
+	void   InitRecordingThreads();                       // call after GJobSystem is initialized
+	uint32 GetRecordingThreadCount() const { return _recordingThreadCount; }
+	void   RecordSecondaryCommandBuffers(                // record tasks as jobs, results keep task order for vkCmdExecuteCommands
+			uint32 currentFrame,
+			const VkCommandBufferInheritanceInfo& inheritanceInfo,
+			uint32 taskCount,
+			const RecordTask& recordTask,
+			std::vector<VkCommandBuffer>& outCommandBuffers
+		 );
+
 public:
 	/* template implementations */
 	template<typename Func>
@@ -43,8 +94,33 @@ public:
 		EndSingleTimeCommands(commandBuffer);
 	}
 
+private:
+	struct ThreadCommandPool
+	{
+		VkCommandPool                pool      = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> secondaryCommandBuffers;     // allocated on demand, reused after pool reset
+		uint32                       usedCount = 0;
+	};
+
+	VkCommandBuffer    AcquireSecondaryCommandBuffer(ThreadCommandPool& threadPool);
+	ThreadCommandPool& GetThreadCommandPool(uint32 currentFrame, uint32 threadIndex) { return _threadCommandPools[currentFrame * _recordingThreadCount + threadIndex]; }
+
 private:
 	MKDevice*						_mkDevicePtr = nullptr;
 	VkCommandPool					_vkCommandPool = VK_NULL_HANDLE;
 	std::vector<VkCommandBuffer>	_vkDrawCommandBuffers = std::vector<VkCommandBuffer>();
+
+	/* frame timeline */
+	VkSemaphore										_vkFrameTimeline = VK_NULL_HANDLE;
+	uint64											_frameTimelineValue = 0;
+	std::array<uint64, MAX_FRAMES_IN_FLIGHT>		_frameSlotValues{};               // timeline value each slot signaled last
+	uint32											_framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+
+	/* upload timeline */
+	VkSemaphore										_vkUploadTimeline = VK_NULL_HANDLE;
+	uint64											_uploadTimelineValue = 0;
+
+	/* per thread, per frame command pools (frame major) */
+	std::vector<ThreadCommandPool>	_threadCommandPools;
+	uint32							_recordingThreadCount = 0;
 };
\ No newline at end of file
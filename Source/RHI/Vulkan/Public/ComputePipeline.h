@@ -0,0 +1,69 @@
+#pragma once
+
+#include <map>
+
+// internal
+#include "Utilities.h"
+#include "Global.h"
+
+// RHI
+#include "Device.h"
+#include "DescriptorManager.h"
+#include "PipelineCache.h"
+#include "PipelineRegistry.h"
+
+/**
+* [MKComputePipeline class]
+* - Responsibility :
+*    - build a compute pipeline from a single compute shader, its pipeline layout is reflected from SPIR-V.
+*    - share VkPipeline, VkShaderModule and set layouts with graphics pipelines through GPipelineRegistry and GDescriptorManager.
+* - Note :
+*    - the workgroup size is declared in the shader ([numthreads]), so pass the same size to GetGroupCount() on host side.
+*    - a hot reloaded module is picked up by RefreshShaderModule(). Compute pipelines are small, so they are rebuilt in place.
+*    - the reloaded shader is reflected again and its pipeline layout rebuilt. Set layouts may change with it,
+*      so owners re-acquire descriptor update templates from GetDescriptorSetLayout() after a refresh.
+*/
+class MKComputePipeline
+{
+public:
+	MKComputePipeline(MKDevice& mkDeviceRef);
+	~MKComputePipeline();
+
+	/* getters */
+	VkPipelineLayout      GetPipelineLayout()                const { return _vkPipelineLayout; }
+	VkPipeline            GetPipeline();                     // compiles current state lazily if it has not been built yet
+	VkDescriptorSetLayout GetDescriptorSetLayout(uint32 set) const { return _vkSetLayouts[set]; } // valid after InitializePipelineLayout()
+	ComputeStateKey       GetStateKey()                      const;
+	static uint32         GetGroupCount(uint32 size, uint32 groupSize) { return (size + groupSize - 1) / groupSize; }
+
+	/* api */
+	void SetShader(const char* path, std::string entryPoint);
+	void SetDescriptorSetLayout(uint32 set, VkDescriptorSetLayout layout); // use an externally owned layout for a whole set (e.g. bindless table)
+	void InitializePipelineLayout();                                       // derives set layouts and push constant range from shader reflection
+	bool RefreshShaderModule();                                            // pick up hot reloaded shader module, returns true if it changed
+
+private:
+	void CreatePipelineLayout(); // set layouts, push constant range and pipeline layout of current reflection
+	void CreateReflectedLayouts(const mk::spirv::ShaderReflection& reflection);
+
+private:
+	/* pipeline instance (owned by GPipelineRegistry) */
+	const MKPipelineRegistry::PipelineEntry* _pipelineEntry = nullptr;
+	VkPipelineLayout                         _vkPipelineLayout = VK_NULL_HANDLE;
+
+	/* compute shader (module is owned by GPipelineRegistry) */
+	VkShaderModule _vkShaderModule = VK_NULL_HANDLE;
+	std::string    _shaderPath;
+	std::string    _entryPoint;
+	uint32         _shaderGeneration = 0;
+	mk::spirv::ShaderReflection _reflection;
+
+	/* reflected pipeline layout (set layouts are owned by GDescriptorManager) */
+	std::map<uint32, VkDescriptorSetLayout> _vkExternalSetLayouts; // set -> layout not owned by this pipeline
+	std::vector<VkDescriptorSetLayout>      _vkSetLayouts;
+	VkPushConstantRange                     _vkPushConstantRange{ 0, 0, 0 };
+	uint64                                  _layoutHash = 0; // contents of the pipeline layout, part of the state key
+
+private:
+	MKDevice& _mkDeviceRef;
+};
@@ -2,30 +2,83 @@
 
 // external
 #include <chrono> // for updating uniform buffer object state
+#include <mutex>
 
 // internal
 #include "Utilities.h"
 #include "UniformBuffer.h"
 #include "CommandService.h"
 
+/**
+* [MKDescriptorManager class]
+* - Responsibility :
+*    - create and cache descriptor set layouts, allocate descriptor sets and write descriptors into them.
+* - Note :
+*    - two backends are provided. VK_EXT_descriptor_buffer is used when the device supports it, otherwise sets are allocated from growing descriptor pools.
+*    - with descriptor buffer, every set is a range of one host visible buffer. Writes go straight to mapped memory and binding only sets an offset.
+*    - DescriptorSetHandle hides the backend, so callers allocate, update and bind the same way on both paths.
+*    - transient sets are allocated from per frame pools (or a per frame range of descriptor buffer) and released in bulk by ResetFrameDescriptorPools().
+*    - write infos are copied into an arena that keeps its capacity between flushes. Stage several sets and flush them with one vkUpdateDescriptorSets call.
+*    - AcquireDescriptorSetLayout() may be called from pipeline build workers, the other apis belong to the render thread.
+*/
 class MKDescriptorManager
 {
+public:
+	struct DescriptorSetHandle
+	{
+		VkDescriptorSet       descriptorSet = VK_NULL_HANDLE; // pool backend
+		VkDeviceSize          bufferOffset  = 0;              // descriptor buffer backend, offset of the set in descriptor buffer
+		VkDescriptorSetLayout layout        = VK_NULL_HANDLE; // descriptor buffer backend, resolves binding offsets
+	};
+
+	struct DescriptorUpdateTemplate
+	{
+		VkDescriptorUpdateTemplate                  vkTemplate = VK_NULL_HANDLE; // pool backend only
+		VkDescriptorSetLayout                       layout     = VK_NULL_HANDLE;
+		std::vector<VkDescriptorUpdateTemplateEntry> entries;                    // descriptor buffer backend expands entries into writes
+	};
+
 public:
 	MKDescriptorManager();
 	~MKDescriptorManager();
-	void InitDescriptorManager(MKDevice* mkDevicePtr);
+	void InitDescriptorManager(MKDevice* mkDevicePtr, bool preferDescriptorBuffer = true);
+
+	/* backend */
+	bool IsDescriptorBufferEnabled() const { return _isDescriptorBufferEnabled; }
 
 	/* commands - transition image layout with pipeline barrier (when VK_SHARING_MODE_EXCLUSIVE) */
 	void TransitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
 	void CopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height); 
 
 	/* descriptor manager api */
-	VkDescriptorPool       GetDescriptorPool();
-	VkDescriptorPool       CreateDescriptorPool(uint32 setCount);
+	VkDescriptorPool       GetDescriptorPool() { return GetDescriptorPool(_persistentPools); }
+	VkDescriptorPool       CreateDescriptorPool(uint32 setCount); // descriptor counts are derived from _poolSizeRatios for every pool
 	void                   AddDescriptorSetLayoutBinding(VkDescriptorType descriptorType, VkShaderStageFlags shaderStageFlags, uint32_t binding, uint32_t descriptorCount);
 	void                   CreateDescriptorSetLayout(VkDescriptorSetLayout& layout);
+	VkDescriptorSetLayout  AcquireDescriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings); // deduplicated, owned by descriptor manager
 	void                   AllocateDescriptorSet(std::vector<VkDescriptorSet>& descriptorSets, VkDescriptorSetLayout layout);
-	void                   ResetDescriptorPool();
+	void                   ResetDescriptorPool(); // release every persistent set
+
+	/* transient api (sets live until the frame slot is reused) */
+	DescriptorSetHandle    AllocateTransientDescriptorSet(uint32 frameIndex, VkDescriptorSetLayout layout);
+	void                   ResetFrameDescriptorPools(uint32 frameIndex); // call once the frame's fence has signaled
+
+	/* backend independent api */
+	void                   AllocateDescriptorSet(std::vector<DescriptorSetHandle>& descriptorSets, VkDescriptorSetLayout layout); // one set per frame in flight
+	DescriptorSetHandle    AllocateDescriptorBufferSet(VkDescriptorSetLayout layout);                                               // descriptor buffer backend only
+	void                   UpdateDescriptorSet(const DescriptorSetHandle& descriptorSet);
+	void                   BindDescriptorBuffers(VkCommandBuffer commandBuffer); // once per command buffer before binding sets, no-op on pool backend
+	void                   BindDescriptorSet(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32 setIndex, const DescriptorSetHandle& descriptorSet);
+	void                   WriteDescriptorBuffer(const DescriptorSetHandle& descriptorSet, const VkWriteDescriptorSet& write); // write descriptors into mapped descriptor buffer
+
+	/* batched update api */
+	void                   StageDescriptorSet(VkDescriptorSet descriptorSet);             // assign writes recorded since the last stage to the set
+	void                   StageDescriptorSet(const DescriptorSetHandle& descriptorSet);
+	void                   FlushDescriptorWrites();                                      // apply every staged write at once and recycle the arena
+
+	/* descriptor update template api */
+	const DescriptorUpdateTemplate* AcquireDescriptorUpdateTemplate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorUpdateTemplateEntry>& entries); // deduplicated, owned by descriptor manager
+	void                   UpdateDescriptorSetWithTemplate(const DescriptorSetHandle& descriptorSet, const DescriptorUpdateTemplate* updateTemplate, const void* pData);
 	
 	/* write api */
 	void                   WriteBufferToDescriptorSet(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range, uint32 dstBinding, VkDescriptorType descriptorType);
@@ -34,36 +87,164 @@ public:
 	void                   WriteSamplerToDescriptorSet(VkSampler sampler, uint32 dstBinding, VkDescriptorType descriptorType);
 	void                   WriteAccelerationStructureToDescriptorSet(const VkAccelerationStructureKHR* as, uint32 dstBinding);
 	void                   WriteCombinedImageSamplerToDescriptorSet(VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout, uint32 dstBinding);
-	void                   UpdateDescriptorSet(VkDescriptorSet descriptorSet);
+	void                   UpdateDescriptorSet(VkDescriptorSet descriptorSet); // stage and flush
 
 private:
+	struct PoolSizeRatio
+	{
+		VkDescriptorType type;
+		float            ratio; // descriptors per set
+	};
+
+	struct DescriptorPoolList
+	{
+		std::vector<VkDescriptorPool> ready;              // pools which may still have space
+		std::vector<VkDescriptorPool> full;               // pools which failed an allocation, reusable after reset
+		uint32                        setsPerPool = 100;  // grows by 1.5x for every new pool, up to 1024
+	};
+
+	struct FrameDescriptorAllocator
+	{
+		DescriptorPoolList pools;           // pool backend
+		VkDeviceSize       bufferBegin = 0; // descriptor buffer backend, frame range reserved on first use
+		VkDeviceSize       bufferHead  = 0;
+		VkDeviceSize       bufferEnd   = 0;
+	};
+
+	/* binding list of a shared set layout, compared in full so that a hash collision can't return another layout */
+	struct SetLayoutKey
+	{
+		std::vector<VkDescriptorSetLayoutBinding> bindings; // sorted by binding
+
+		bool operator==(const SetLayoutKey& other) const
+		{
+			return std::equal(bindings.begin(), bindings.end(), other.bindings.begin(), other.bindings.end(),
+				[](const VkDescriptorSetLayoutBinding& lhs, const VkDescriptorSetLayoutBinding& rhs) {
+					return lhs.binding == rhs.binding && lhs.descriptorType == rhs.descriptorType && lhs.descriptorCount == rhs.descriptorCount &&
+						lhs.stageFlags == rhs.stageFlags && lhs.pImmutableSamplers == rhs.pImmutableSamplers;
+				});
+		}
+	};
+
+	struct SetLayoutKeyHash
+	{
+		std::size_t operator()(const SetLayoutKey& key) const
+		{
+			uint64 hash = 0;
+			for (const auto& binding : key.bindings)
+			{
+				mk::hash::Combine(hash, binding.binding);
+				mk::hash::Combine(hash, static_cast<uint32>(binding.descriptorType));
+				mk::hash::Combine(hash, binding.descriptorCount);
+				mk::hash::Combine(hash, binding.stageFlags);
+			}
+			return static_cast<std::size_t>(hash);
+		}
+	};
+
+	/* layout and entry list of a shared update template, compared in full since a mismatched entry would read the caller's struct wrong */
+	struct UpdateTemplateKey
+	{
+		VkDescriptorSetLayout                        layout;
+		std::vector<VkDescriptorUpdateTemplateEntry> entries;
+
+		bool operator==(const UpdateTemplateKey& other) const
+		{
+			return layout == other.layout && std::equal(entries.begin(), entries.end(), other.entries.begin(), other.entries.end(),
+				[](const VkDescriptorUpdateTemplateEntry& lhs, const VkDescriptorUpdateTemplateEntry& rhs) {
+					return lhs.dstBinding == rhs.dstBinding && lhs.dstArrayElement == rhs.dstArrayElement && lhs.descriptorCount == rhs.descriptorCount &&
+						lhs.descriptorType == rhs.descriptorType && lhs.offset == rhs.offset && lhs.stride == rhs.stride;
+				});
+		}
+	};
+
+	struct UpdateTemplateKeyHash
+	{
+		std::size_t operator()(const UpdateTemplateKey& key) const
+		{
+			uint64 hash = 0;
+			mk::hash::Combine(hash, key.layout);
+			for (const auto& entry : key.entries)
+			{
+				mk::hash::Combine(hash, entry.dstBinding);
+				mk::hash::Combine(hash, entry.dstArrayElement);
+				mk::hash::Combine(hash, entry.descriptorCount);
+				mk::hash::Combine(hash, static_cast<uint32>(entry.descriptorType));
+				mk::hash::Combine(hash, entry.offset);
+				mk::hash::Combine(hash, entry.stride);
+			}
+			return static_cast<std::size_t>(hash);
+		}
+	};
+
+	struct PendingWrite
+	{
+		VkWriteDescriptorSet write;      // info pointers are resolved on flush, because the arena may grow while recording
+		uint32               infoOffset; // first info of this write in the arena matching its descriptor type
+		DescriptorSetHandle  target;     // assigned by StageDescriptorSet()
+	};
+
+	/* descriptor pool lists */
+	VkDescriptorPool GetDescriptorPool(DescriptorPoolList& poolList);
+	void             AllocateFromPoolList(DescriptorPoolList& poolList, const VkDescriptorSetLayout* pLayouts, uint32 setCount, VkDescriptorSet* pDescriptorSets);
+	void             ResetPoolList(DescriptorPoolList& poolList);
+	void             DestroyPoolList(DescriptorPoolList& poolList);
+
+	/* batched update */
+	void                 PushWrite(uint32 dstBinding, VkDescriptorType descriptorType, uint32 descriptorCount, uint32 infoOffset);
+	VkWriteDescriptorSet ResolveWrite(const PendingWrite& pendingWrite) const;
+
 	/* create depth buffer resources */
 	bool HasStencilComponent(VkFormat format) { return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT; }
 
+	/* descriptor buffer backend */
+	void         CreateDescriptorBuffer(VkDeviceSize size);
+	VkDeviceSize SubAllocateDescriptorBuffer(VkDeviceSize& head, VkDeviceSize end, VkDeviceSize size); // returns aligned offset
+	VkDeviceSize GetDescriptorSize(VkDescriptorType descriptorType) const;
+
 
 private:
-	/* descriptor pool sizes */
-	std::vector<VkDescriptorPoolSize> _vkDescriptorPoolSizes = {
-		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,MAX_FRAMES_IN_FLIGHT},
-		{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, MAX_FRAMES_IN_FLIGHT * 10},
-		{VK_DESCRIPTOR_TYPE_SAMPLER, MAX_FRAMES_IN_FLIGHT * 2}
+	/* descriptor pool size classes, scaled by the set count of each pool */
+	std::vector<PoolSizeRatio> _poolSizeRatios = {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         1.0f },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,          5.0f },
+		{ VK_DESCRIPTOR_TYPE_SAMPLER,                1.0f },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         1.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          1.0f }
 	};
 
 	/* waiting layout bindings */
 	std::vector<VkDescriptorSetLayoutBinding>                   _vkWaitingBindings    = std::vector<VkDescriptorSetLayoutBinding>();
 	
-	/* descriptor info shared pointers */
-	std::unordered_set<std::shared_ptr<VkDescriptorBufferInfo>> _vkWaitingBufferInfos = std::unordered_set<std::shared_ptr<VkDescriptorBufferInfo>>();
-	std::unordered_set<std::shared_ptr<VkDescriptorImageInfo>>  _vkWaitingImageInfos  = std::unordered_set<std::shared_ptr<VkDescriptorImageInfo>>();
-	
-	std::unordered_set<std::shared_ptr<VkWriteDescriptorSetAccelerationStructureKHR>> _vkWaitingAsWrites = std::unordered_set<std::shared_ptr<VkWriteDescriptorSetAccelerationStructureKHR>>();
-	std::vector<VkWriteDescriptorSet>                           _vkWaitingWrites = std::vector<VkWriteDescriptorSet>();
+	/* descriptor info arena (cleared on flush without releasing capacity, so steady state writes don't allocate) */
+	std::vector<VkDescriptorBufferInfo>                       _vkWaitingBufferInfos;
+	std::vector<VkDescriptorImageInfo>                        _vkWaitingImageInfos;
+	std::vector<VkWriteDescriptorSetAccelerationStructureKHR> _vkWaitingAsWrites;
+	std::vector<PendingWrite>                                 _waitingWrites;
+	size_t                                                    _stagedWriteCount = 0;
+	std::vector<VkWriteDescriptorSet>                         _vkResolvedWrites; // scratch for vkUpdateDescriptorSets
+
+	/* descriptor update templates shared by identical entry lists */
+	std::unordered_map<UpdateTemplateKey, DescriptorUpdateTemplate, UpdateTemplateKeyHash> _updateTemplateCache;
+
+	/* descriptor set layouts shared by identical binding lists */
+	std::unordered_map<SetLayoutKey, VkDescriptorSetLayout, SetLayoutKeyHash> _vkSetLayoutCache;
+	std::mutex                                        _setLayoutMutex; // guards _vkSetLayoutCache
 
-	std::vector<VkDescriptorPool> _vkDescriptorPoolReady; // available descriptor pool
-	std::vector<VkDescriptorPool> _vkDescriptorPoolFull;  // full descriptor pool 
+	/* persistent sets and per frame transient sets */
+	DescriptorPoolList                    _persistentPools;
+	std::vector<FrameDescriptorAllocator> _frameAllocators = std::vector<FrameDescriptorAllocator>(MAX_FRAMES_IN_FLIGHT);
 
-	/* max set count per pool */
-	uint32 _setsPerPool = 100; // default is 100, max is 4092
+	/* descriptor buffer (sets are sub-allocated linearly and live until the manager is destroyed) */
+	bool            _isDescriptorBufferEnabled = false;
+	VkBuffer        _vkDescriptorBuffer        = VK_NULL_HANDLE;
+	VkDeviceMemory  _vkDescriptorBufferMemory  = VK_NULL_HANDLE;
+	VkDeviceAddress _descriptorBufferAddress   = 0;
+	uint8*          _descriptorBufferMapped    = nullptr;
+	VkDeviceSize    _descriptorBufferSize      = 4 * 1024 * 1024; // 4MB
+	VkDeviceSize    _descriptorBufferHead      = 0;
+	VkDeviceSize    _transientRegionSize       = 256 * 1024;      // 256KB reserved per frame in flight
 
 private:
 	MKDevice* _mkDevicePtr = nullptr;
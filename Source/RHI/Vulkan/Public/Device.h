@@ -30,6 +30,47 @@ public:
 		}
 	};
 
+	struct DynamicStateSupport
+	{
+		bool extendedDynamicState  = false; // cull mode, front face, depth test/write/compare op (core in Vulkan 1.3)
+		bool extendedDynamicState2 = false; // depth bias enable, rasterizer discard, primitive restart (core in Vulkan 1.3)
+		bool extendedDynamicState3 = false; // polygon mode, color blend enable/equation, color write mask (VK_EXT_extended_dynamic_state3)
+
+		/* VK_EXT_extended_dynamic_state3 function pointers, nullptr when the extension is not enabled */
+		PFN_vkCmdSetPolygonModeEXT        pfnCmdSetPolygonMode        = nullptr;
+		PFN_vkCmdSetColorBlendEnableEXT   pfnCmdSetColorBlendEnable   = nullptr;
+		PFN_vkCmdSetColorBlendEquationEXT pfnCmdSetColorBlendEquation = nullptr;
+		PFN_vkCmdSetColorWriteMaskEXT     pfnCmdSetColorWriteMask     = nullptr;
+	};
+
+	struct DescriptorIndexingSupport
+	{
+		bool   isSupported = false; // partially bound, update-after-bind runtime arrays of sampled images and storage buffers
+		uint32 maxUpdateAfterBindSampledImages  = 0; // minimum of per set and per stage limits
+		uint32 maxUpdateAfterBindStorageBuffers = 0;
+	};
+
+	struct DescriptorBufferSupport
+	{
+		bool isSupported = false; // VK_EXT_descriptor_buffer
+		VkPhysicalDeviceDescriptorBufferPropertiesEXT properties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT }; // descriptor sizes and offset alignment
+
+		/* VK_EXT_descriptor_buffer function pointers, nullptr when the extension is not enabled */
+		PFN_vkGetDescriptorSetLayoutSizeEXT          pfnGetDescriptorSetLayoutSize          = nullptr;
+		PFN_vkGetDescriptorSetLayoutBindingOffsetEXT pfnGetDescriptorSetLayoutBindingOffset = nullptr;
+		PFN_vkGetDescriptorEXT                       pfnGetDescriptor                       = nullptr;
+		PFN_vkCmdBindDescriptorBuffersEXT            pfnCmdBindDescriptorBuffers            = nullptr;
+		PFN_vkCmdSetDescriptorBufferOffsetsEXT       pfnCmdSetDescriptorBufferOffsets       = nullptr;
+	};
+
+	struct PresentWaitSupport
+	{
+		bool isSupported = false; // VK_KHR_present_id and VK_KHR_present_wait
+
+		/* VK_KHR_present_wait function pointer, nullptr when the extension is not enabled */
+		PFN_vkWaitForPresentKHR pfnWaitForPresent = nullptr;
+	};
+
 	struct SwapChainSupportDetails
 	{
 		VkSurfaceCapabilitiesKHR			capabilities;	// basic surface capabilities (min/max number of images in swap chain, min/max width and height of images)
@@ -49,6 +90,12 @@ public:
 	inline VkQueue			 GetPresentQueue()	  const { return _vkPresentQueue; }
 	inline MKWindow&         GetWindowRef()		  const { return _mkWindowRef; }
 	inline VmaAllocator      GetVmaAllocator()    const { return _vmaAllocator; }
+	inline const DynamicStateSupport& GetDynamicStateSupport() const { return _dynamicStateSupport; }
+	inline bool              IsGraphicsPipelineLibrarySupported() const { return _isGraphicsPipelineLibrarySupported; }
+	inline bool              IsStorageImageWriteWithoutFormatEnabled() const { return _isStorageImageWriteWithoutFormatSupported; } // required by compute post
+	inline const DescriptorIndexingSupport& GetDescriptorIndexingSupport() const { return _descriptorIndexingSupport; }
+	inline const DescriptorBufferSupport&   GetDescriptorBufferSupport()   const { return _descriptorBufferSupport; }
+	inline const PresentWaitSupport&        GetPresentWaitSupport()        const { return _presentWaitSupport; }
 
 	/* setters of extension function proxy address */
 	void SetDynamicRenderingKHRFunctionPointers();
@@ -60,6 +107,7 @@ public:
 	inline void              SetFrameBufferResized(bool isResized) { _mkWindowRef.framebufferResized = isResized; }
 
 	/* support checkers */
+	bool                     IsExtensionEnabled(const char* extensionName) const;
 	SwapChainSupportDetails  QuerySwapChainSupport(VkPhysicalDevice device);
 	QueueFamilyIndices		 FindQueueFamilies(VkPhysicalDevice device);
 
@@ -70,14 +118,18 @@ public:
 	* Belows are related to swapchain creation. 
 	* I located these functions in Device class for consistency vecause one of them requires window refernce.
 	*/
-	VkSurfaceFormatKHR  ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-	VkPresentModeKHR	ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+	VkSurfaceFormatKHR  ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats, bool isStorageRequired = false);
+	VkPresentModeKHR	ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, bool isLowLatency = false);
 	VkExtent2D			ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
 private:
 	void  PickPhysicalDevice();
 	int	  RateDeviceSuitability(VkPhysicalDevice device);
 	bool  IsDeviceExtensionSupported(VkPhysicalDevice device);
+	void  SelectOptionalDeviceExtensions();
+	void  LoadExtendedDynamicState3FunctionPointers();
+	void  LoadDescriptorBufferFunctionPointers();
+	void  LoadPresentWaitFunctionPointers();
 	void  CreateWindowSurface();
 
 private:
@@ -88,6 +140,15 @@ private:
 	VkQueue			  _vkPresentQueue;
 	VmaAllocator      _vmaAllocator; 
 
+	/* required extensions plus supported optional extensions */
+	std::vector<const char*> _enabledDeviceExtensions;
+	DynamicStateSupport      _dynamicStateSupport;
+	bool                     _isGraphicsPipelineLibrarySupported = false;
+	bool                     _isStorageImageWriteWithoutFormatSupported = false; // enabled at device creation when supported
+	DescriptorIndexingSupport _descriptorIndexingSupport;
+	DescriptorBufferSupport  _descriptorBufferSupport;
+	PresentWaitSupport       _presentWaitSupport;
+
 	/* physical device raytracing pipeline properties */
 	VkPhysicalDeviceRayTracingPipelinePropertiesKHR _rayTracingProperties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR };
 private:
@@ -105,5 +166,16 @@ public:
 	//	VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME, // macro from VK_KHR_deferred_host_operations extension
 	};
 
+	// enabled only when the physical device supports them
+	const std::vector<const char*> optionalDeviceExtensions = {
+		VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME,  // macro from VK_EXT_extended_dynamic_state3 extension
+		VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME,          // macro from VK_KHR_pipeline_library extension
+		VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME, // macro from VK_EXT_graphics_pipeline_library extension
+		VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,       // macro from VK_EXT_descriptor_indexing extension (core in Vulkan 1.2)
+		VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME,         // macro from VK_EXT_descriptor_buffer extension
+		VK_KHR_PRESENT_ID_EXTENSION_NAME,                // macro from VK_KHR_present_id extension
+		VK_KHR_PRESENT_WAIT_EXTENSION_NAME               // macro from VK_KHR_present_wait extension
+	};
+
 	bool enableDynamicRendering = true;
 };
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <future>
+#include <map>
+
 // internal
 #include "Utilities.h"
 #include "Global.h"
@@ -12,6 +15,8 @@
 #include "Device.h"
 #include "Swapchain.h"
 #include "DescriptorManager.h"
+#include "PipelineCache.h"
+#include "PipelineRegistry.h"
 
 class MKPipeline
 {
@@ -21,13 +26,14 @@ public:
         VkShaderModule        shaderModule;
         VkShaderStageFlagBits stage;
         std::string           entryPoint;
+        std::string           path;       // shader module identity for state hashing
+        uint32                generation; // shader module version, increased by hot reload
     };
 
     struct RenderingResource
     {
         VkSemaphore       imageAvailableSema = VK_NULL_HANDLE;
-        VkSemaphore       renderFinishedSema = VK_NULL_HANDLE;
-        VkFence           inFlightFence      = VK_NULL_HANDLE;
+        VkSemaphore       renderFinishedSema = VK_NULL_HANDLE; // frame completion is tracked by the frame timeline of GCommandService
     };
 
     MKPipeline(MKDevice& mkDeviceRef);
@@ -36,7 +42,9 @@ public:
     /* getters */
     RenderingResource& GetRenderingResource(uint32 index) { return _renderingResources[index]; }
     VkPipelineLayout   GetPipelineLayout() const { return _vkPipelineLayout; }
-    VkPipeline         GetPipeline() const { return _vkPipelineInstance; }
+    VkPipeline         GetPipeline(); // compiles current state lazily if it has not been built yet
+    PipelineStateKey   GetStateKey() const;
+    VkDescriptorSetLayout GetDescriptorSetLayout(uint32 set) const { return _vkSetLayouts[set]; } // valid after InitializePipelineLayout()
     
     /**
     * API 
@@ -44,7 +52,9 @@ public:
     void AddShader(const char* path, std::string entryPoint, VkShaderStageFlagBits stageBit);
     void AddDescriptorSetLayouts(std::vector<VkDescriptorSetLayout>& layouts);
     void AddPushConstantRanges(std::vector<VkPushConstantRange>& pushConstants);
-    void InitializePipelineLayout();
+    void SetDescriptorCount(uint32 set, uint32 binding, uint32 count); // override array size that reflection can't know (runtime sized arrays)
+    void SetDescriptorSetLayout(uint32 set, VkDescriptorSetLayout layout); // use an externally owned layout for a whole set (e.g. bindless table)
+    void InitializePipelineLayout(); // derives set layouts and push constant range from shader reflection unless they were added explicitly
 
     /* pipeline state modifier */
     void SetRenderingInfo(
@@ -57,6 +67,7 @@ public:
     void SetPolygonMode(VkPolygonMode mode);
     void SetCullMode(VkCullModeFlags cullMode, VkFrontFace frontFace);
     void DisableMultiSampling();
+    void EnableMultiSampling(VkSampleCountFlagBits samples); // has to match the sample count of bound attachments
     void DisableColorBlending();
     void EnableBlendingAdditive();
     void EnableBlendingAlpha();
@@ -64,14 +75,70 @@ public:
     void EnableDepthTest(bool depthWriteEnable, VkCompareOp op);
     void RemoveVertexInput();
 
+    /**
+    * extended dynamic state
+    * - moves supported states out of the pipeline so that variants differing only in these states share one VkPipeline.
+    * - ApplyDynamicStates() must be recorded after binding the pipeline and after each state change.
+    */
+    void EnableExtendedDynamicState();
+    void ApplyDynamicStates(VkCommandBuffer commandBuffer) const;
+    bool IsDynamicState(VkDynamicState state) const;
+
     /* finialize pipeline and compile */
-    void BuildPipeline(VkRenderPass* pRenderPass = nullptr);
+    void BuildPipeline(VkRenderPass* pRenderPass = nullptr); // returns cached pipeline from GPipelineRegistry if the same state was built before
+    void RebuildPipelineAsync();                             // compile current state as a GJobSystem background job, the previous pipeline is bound until it is ready
+    bool RefreshShaderModules();                             // pick up hot reloaded shader modules and rebuild asynchronously if any changed
+    void Invalidate() { _pipelineEntry = nullptr; _stateGeneration++; } // call after modifying public pipeline states directly
 
 private:
+    /**
+    * copy of every state a pipeline is created from
+    * - taken on the calling thread, so an asynchronous build never reads states the render thread may be changing.
+    * - create infos point into the snapshot itself, so it stays on the heap and is never copied.
+    */
+    struct BuildSnapshot
+    {
+        PipelineStateKey                                 key;
+        std::vector<ShaderDesc>                          shaders;        // entry point names of shader stages
+        std::vector<VkPipelineShaderStageCreateInfo>     shaderStages;
+        std::vector<VkVertexInputBindingDescription>     vertexBindings;
+        std::vector<VkVertexInputAttributeDescription>   vertexAttributes;
+        std::vector<VkDynamicState>                      dynamicStates;
+        std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments; // colorBlendAttachment per color attachment
+        std::vector<VkFormat>                            colorAttachmentFormats;
+
+        VkPipelineRenderingCreateInfoKHR       renderingInfo;
+        VkPipelineVertexInputStateCreateInfo   vertexInput;
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly;
+        VkPipelineViewportStateCreateInfo      viewportState;
+        VkPipelineDynamicStateCreateInfo       dynamicState;
+        VkPipelineRasterizationStateCreateInfo rasterizer;
+        VkPipelineMultisampleStateCreateInfo   multisampling;
+        VkPipelineDepthStencilStateCreateInfo  depthStencil;
+        VkPipelineColorBlendStateCreateInfo    colorBlending;
+        VkPipelineLayout                       pipelineLayout = VK_NULL_HANDLE;
+        VkRenderPass                           renderPass     = VK_NULL_HANDLE;
+        bool                                   hasRenderPass  = false;
+    };
+
     /* create rendering resources */
     void CreateRenderingResources();
 
+    /* compile current state through pipeline registry */
+    std::unique_ptr<BuildSnapshot>                  TakeBuildSnapshot() const;
+    static const MKPipelineRegistry::PipelineEntry* CompileSnapshot(BuildSnapshot& snapshot); // safe on any thread
+    void                                            AdoptPendingPipeline();
+    void                                            UpdateShaderStages();
+    uint32                                   GetColorAttachmentCount() const; // of the render target the pipeline is built for
+
+    /* merge shader interface into pipeline layout */
+    void MergeReflection(const mk::spirv::ShaderReflection& reflection);
+    void CreateReflectedLayouts();
+    uint64 HashPipelineLayout() const; // of set layout bindings and push constant ranges, handles may be recycled
+
 public:
+    static constexpr uint32 MAX_COLOR_ATTACHMENTS = 8; // guaranteed minimum of maxColorAttachments
+
     /* pipeline states */
     std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
     std::vector<VkDynamicState>                  dynamicStates{ VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
@@ -87,7 +154,7 @@ public:
     VkPipelineRasterizationStateCreateInfo rasterizer;
     VkPipelineMultisampleStateCreateInfo   multisampling;
     VkPipelineDepthStencilStateCreateInfo  depthStencil;
-    VkPipelineColorBlendAttachmentState    colorBlendAttachment;
+    VkPipelineColorBlendAttachmentState    colorBlendAttachment; // shared by every color attachment
     VkPipelineColorBlendStateCreateInfo    colorBlending;
     VkPipelineLayoutCreateInfo             pipelineLayoutInfo{ // initialize with default values
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
@@ -100,15 +167,28 @@ public:
     };
 
 private:
-    /* pipeline instance */
-	VkPipeline	      _vkPipelineInstance;
+    /* pipeline instance (owned by GPipelineRegistry) */
+	const MKPipelineRegistry::PipelineEntry* _pipelineEntry = nullptr;
+	std::future<const MKPipelineRegistry::PipelineEntry*> _pendingPipelineEntry; // asynchronous rebuild after shader reload
+	uint64            _stateGeneration   = 0;     // increased by Invalidate(), a rebuild launched at an older generation is discarded
+	uint64            _pendingGeneration = 0;     // state generation the pending rebuild was launched at
+	bool              _isRebuildQueued   = false; // a reload arrived while a rebuild was in flight
 	VkPipelineLayout  _vkPipelineLayout;
+	uint64            _layoutHash = 0; // content of _vkPipelineLayout, part of the state key
+	std::vector<VkFormat> _colorAttachmentFormats; // pointed by renderingInfo
+	VkRenderPass*     _pRenderPass = nullptr;
 
     /* rendering resources */
     std::vector<RenderingResource> _renderingResources;
 
-    /* shader stages waiting initialization */
-    std::vector<ShaderDesc> _waitShaders;
+    /* shader stages (modules are owned by GPipelineRegistry) */
+    std::vector<ShaderDesc> _shaders;
+
+    /* reflected pipeline layout (set layouts are owned by GDescriptorManager) */
+    std::map<uint32, std::map<uint32, VkDescriptorSetLayoutBinding>> _reflectedBindings; // set -> binding -> layout binding
+    std::map<uint32, VkDescriptorSetLayout> _vkExternalSetLayouts;  // set -> layout not owned by this pipeline
+    std::vector<VkDescriptorSetLayout> _vkSetLayouts;
+    VkPushConstantRange                _vkPushConstantRange{ 0, 0, 0 };
 
 private:
 	MKDevice&     _mkDeviceRef;
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+
+#include "Utilities.h"
+#include "Pipeline.h"
+
+/**
+* [MKPipelineBuildService class]
+* - Responsibility :
+*    - collect pipelines whose states are fully described and compile them concurrently on GJobSystem workers.
+*    - every job compiles into the device-wide GPipelineCache, which is internally synchronized.
+* - Note :
+*    - a pipeline must not be modified between RequestBuild() and the end of BuildAll().
+*    - the calling thread compiles as well while it waits, the first compile error is rethrown once every request is done.
+*/
+class MKPipelineBuildService
+{
+private:
+	struct BuildRequest
+	{
+		MKPipeline*   pipeline;
+		VkRenderPass* pRenderPass;
+	};
+
+public:
+	MKPipelineBuildService();
+	~MKPipelineBuildService();
+
+	/* getters */
+	VkPipeline GetPipeline(uint32 handle) const { return _requests[handle].pipeline->GetPipeline(); }
+
+	/* build service api */
+	uint32 RequestBuild(MKPipeline& pipeline, VkRenderPass* pRenderPass = nullptr); // returns a handle which is valid after BuildAll()
+	void   BuildAll();                                                              // blocks until every requested pipeline is compiled
+
+private:
+	std::vector<BuildRequest> _requests;
+	uint32                    _builtCount = 0;
+};
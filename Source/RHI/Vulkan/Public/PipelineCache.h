@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Utilities.h"
+#include "Device.h"
+
+/**
+* [MKPipelineCache class]
+* - Responsibility :
+*    - own a single device-wide VkPipelineCache shared by every MKPipeline.
+*    - load cache blob from disk at startup and save it back at shutdown.
+* - Note :
+*    - a blob is only reused when its header matches the current device (vendor id, device id and pipeline cache uuid).
+*/
+class MKPipelineCache
+{
+public:
+	MKPipelineCache();
+	~MKPipelineCache();
+	void InitPipelineCache(MKDevice* mkDevicePtr, const std::string& cachePath = "pipeline_cache.bin"); // initialize pipeline cache in Device creation stage
+
+	/* getter */
+	VkPipelineCache GetPipelineCache() const { return _vkPipelineCache; }
+
+	/* persistence */
+	void SavePipelineCache();
+
+private:
+	bool IsCacheHeaderValid(const std::vector<char>& cacheData) const;
+
+private:
+	MKDevice*                  _mkDevicePtr = nullptr;
+	VkPipelineCache            _vkPipelineCache = VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties _vkDeviceProperties;
+	std::string                _cachePath;
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <deque>
+
+#include "Utilities.h"
+#include "Device.h"
+#include "ShaderReflection.h"
+
+/* hashes of full pipeline state and of each graphics pipeline library part */
+struct PipelineStateKey
+{
+	uint64 state;
+	uint64 vertexInput;    // VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT
+	uint64 preRasterization; // VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT
+	uint64 fragmentShader; // VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT
+	uint64 fragmentOutput; // VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT
+
+	bool operator==(const PipelineStateKey& other) const
+	{
+		return state == other.state && vertexInput == other.vertexInput && preRasterization == other.preRasterization &&
+			fragmentShader == other.fragmentShader && fragmentOutput == other.fragmentOutput;
+	}
+};
+
+struct PipelineStateKeyHash
+{
+	std::size_t operator()(const PipelineStateKey& key) const { return static_cast<std::size_t>(key.state); } // equality compares every part
+};
+
+/* hash of a graphics pipeline library part, together with the part it was built for */
+struct LibraryKey
+{
+	uint64                            partHash;
+	VkGraphicsPipelineLibraryFlagsEXT part;
+
+	bool operator==(const LibraryKey& other) const { return partHash == other.partHash && part == other.part; }
+};
+
+struct LibraryKeyHash
+{
+	std::size_t operator()(const LibraryKey& key) const
+	{
+		uint64 hash = key.partHash;
+		mk::hash::Combine(hash, key.part);
+		return static_cast<std::size_t>(hash);
+	}
+};
+
+/* identity of a compute pipeline, kept in its own map so that it never collides with a graphics state */
+struct ComputeStateKey
+{
+	std::string shaderPath;
+	std::string entryPoint;
+	uint32      generation; // of the shader module
+	uint64      layout;     // contents of the pipeline layout
+
+	bool operator==(const ComputeStateKey& other) const
+	{
+		return shaderPath == other.shaderPath && entryPoint == other.entryPoint && generation == other.generation && layout == other.layout;
+	}
+};
+
+struct ComputeStateKeyHash
+{
+	std::size_t operator()(const ComputeStateKey& key) const
+	{
+		uint64 hash = 0;
+		mk::hash::Combine(hash, key.shaderPath);
+		mk::hash::Combine(hash, key.entryPoint);
+		mk::hash::Combine(hash, key.generation);
+		mk::hash::Combine(hash, key.layout);
+		return static_cast<std::size_t>(hash);
+	}
+};
+
+/**
+* [MKPipelineRegistry class]
+* - Responsibility :
+*    - own every VkPipeline and VkShaderModule created by MKPipeline and MKComputePipeline, keyed by state key and shader path.
+*    - return the cached pipeline for identical state instead of compiling it again.
+*    - with VK_EXT_graphics_pipeline_library, fast-link cached library parts on first request and optimize-link as GJobSystem background jobs.
+* - Note :
+*    - lookups are guarded by a mutex, but compilation runs outside of the lock so that MKPipelineBuildService workers don't serialize.
+*    - library parts missing from the cache are compiled concurrently as GJobSystem jobs, the requesting thread helps instead of compiling them one by one.
+*    - read the pipeline of an entry every frame, since an optimized pipeline replaces the fast-linked one when it is ready.
+*    - a replaced fast-linked pipeline is destroyed by DestroyRetiredPipelines() once the frames that may have drawn with it are complete.
+*    - other pipelines and shader modules live until the device is destroyed.
+*/
+class MKPipelineRegistry
+{
+public:
+	struct PipelineEntry
+	{
+		std::atomic<VkPipeline> pipeline{ VK_NULL_HANDLE };
+		std::atomic<bool>       isOptimized{ false };
+		VkPipeline              fastLinkedPipeline = VK_NULL_HANDLE; // handed to deferred destruction when the optimized pipeline is published
+	};
+
+	struct ShaderModuleEntry
+	{
+		VkShaderModule shaderModule = VK_NULL_HANDLE;
+		uint32         generation   = 0; // increased on every hot reload, part of the pipeline state hash
+		mk::spirv::ShaderReflection reflection;
+	};
+
+private:
+	struct OptimizeRequest
+	{
+		PipelineEntry*            entry;
+		std::array<VkPipeline, 4> libraries;
+		VkPipelineLayout          layout;
+		VkPipelineCreateFlags     flags; // flags carried from the original create info (descriptor buffer)
+	};
+
+	struct RetiredPipeline
+	{
+		VkPipeline pipeline;
+		uint64     frameTimelineValue; // destroyed once the frame timeline reaches it
+	};
+
+public:
+	MKPipelineRegistry();
+	~MKPipelineRegistry();
+	void InitPipelineRegistry(MKDevice* mkDevicePtr); // initialize pipeline registry in Device creation stage
+
+	/* getters */
+	uint32 GetPipelineCount()     { std::lock_guard<std::mutex> lock(_mutex); return static_cast<uint32>(_pipelines.size() + _computePipelines.size()); }
+	uint32 GetShaderModuleCount() { std::lock_guard<std::mutex> lock(_mutex); return static_cast<uint32>(_shaderModules.size()); }
+	bool   IsLibraryEnabled()     const { return _isLibraryEnabled; }
+
+	/* registry api */
+	ShaderModuleEntry    AcquireShaderModule(const std::string& path, VkShaderStageFlagBits stage);          // load, reflect and create shader module once per path
+	bool                 ReloadShaderModule(const std::string& path);                                        // recreate module from disk, returns false if no pipeline uses it
+	const PipelineEntry* AcquirePipeline(const PipelineStateKey& key, const VkGraphicsPipelineCreateInfo& info); // compile on first request of the state
+	const PipelineEntry* AcquireComputePipeline(const ComputeStateKey& key, const VkComputePipelineCreateInfo& info); // compute pipelines have no library parts
+	void                 WaitForBackgroundCompiles();                                                         // block until every queued optimize-link is done, before GJobSystem is destroyed
+	void                 DestroyRetiredPipelines();                                                           // once per frame on the render thread, before recording
+
+private:
+	/* graphics pipeline library */
+	VkPipeline FindLibrary(const LibraryKey& libraryKey);
+	VkPipeline AcquireLibrary(const LibraryKey& libraryKey, const VkGraphicsPipelineCreateInfo& info);
+	VkPipeline LinkLibraries(const std::array<VkPipeline, 4>& libraries, VkPipelineLayout layout, VkPipelineCreateFlags flags, bool isOptimized);
+	void       OptimizePipeline(const OptimizeRequest& request);
+
+private:
+	MKDevice*                                       _mkDevicePtr = nullptr;
+	std::unordered_map<PipelineStateKey, PipelineEntry, PipelineStateKeyHash> _pipelines; // node based, so entry addresses are stable
+	std::unordered_map<ComputeStateKey, PipelineEntry, ComputeStateKeyHash>   _computePipelines;
+	std::unordered_map<LibraryKey, VkPipeline, LibraryKeyHash>               _libraries;
+	std::unordered_map<std::string, ShaderModuleEntry> _shaderModules;
+	std::vector<VkShaderModule>                     _retiredShaderModules; // replaced by hot reload, pending compiles may still use them
+	std::vector<VkPipeline>                         _retiringPipelines;    // fast-linked pipelines replaced since the last DestroyRetiredPipelines()
+	std::deque<RetiredPipeline>                     _retiredPipelines;     // in frame timeline order
+	std::mutex                                      _mutex;
+
+	/* background optimize-link */
+	bool                                            _isLibraryEnabled = false;
+	std::condition_variable                         _idleCondition;
+	uint32                                          _pendingOptimizeCount = 0;
+	bool                                            _isStopping = false;
+};
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <functional>
+
+#include "Utilities.h"
+#include "Device.h"
+#include "TransientAllocator.h"
+#include "BarrierBatch.h"
+
+// how a pass touches an image, decides layout, pipeline stages and access masks of derived barriers
+enum class ERenderGraphUsage : uint8
+{
+	COLOR_ATTACHMENT = 0,  // color output of dynamic rendering
+	DEPTH_ATTACHMENT,      // depth test and depth write
+	DEPTH_READ_ONLY,       // depth test without write
+	SAMPLED_FRAGMENT,      // sampled in fragment shader
+	SAMPLED_COMPUTE,       // sampled in compute shader
+	STORAGE_READ_COMPUTE,  // storage image load in compute shader
+	STORAGE_WRITE_COMPUTE, // storage image store in compute shader
+	TRANSFER_SRC,
+	TRANSFER_DST,
+};
+
+// a description of an image owned or imported by the render graph
+struct RenderGraphImageDesc
+{
+	std::string        name;
+	uint32             width      = 0;
+	uint32             height     = 0;
+	VkFormat           format     = VK_FORMAT_UNDEFINED;
+	VkImageAspectFlags aspect     = VK_IMAGE_ASPECT_COLOR_BIT;
+	VkImageUsageFlags  extraUsage = 0; // usages not implied by passes (e.g. sampled outside the graph)
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT; // transient images only, multisampled attachments can't be sampled or stored
+};
+
+// state of an imported image before the first pass of the graph, or the state an output is handed over in after the last one
+struct RenderGraphImportState
+{
+	VkImageLayout         layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VkPipelineStageFlags2 stage  = VK_PIPELINE_STAGE_2_NONE;   // stages that touched the image before (e.g. semaphore wait stage of swapchain acquire), or use it after
+	VkAccessFlags2        access = VK_ACCESS_2_NONE;           // writes that have to be made visible, or accesses of the later user
+};
+
+/**
+* [MKRenderGraph class]
+* - Responsibility :
+*    - collect passes with their image reads and writes, and record them with derived vkCmdPipelineBarrier2 barriers.
+*    - cull passes whose results never reach an output of the graph.
+*    - own transient images and alias their memory by compiled pass lifetimes (TransientAllocator).
+* - Note :
+*    - passes execute in declaration order, so declare a producer before its consumers.
+*    - imported images with a final layout are graph outputs, every pass contributing to them survives culling.
+*    - the graph is compiled once per topology (e.g. on resize), imported images can be swapped every frame with SetImportedImage().
+*    - barriers before a pass are flushed by one vkCmdPipelineBarrier2 call. A read in an already visible layout emits nothing.
+*/
+class MKRenderGraph
+{
+public:
+	using ResourceHandle = uint32;
+	using ExecuteFunc    = std::function<void(VkCommandBuffer commandBuffer)>;
+
+	class PassBuilder
+	{
+	public:
+		PassBuilder& Read(ResourceHandle resource, ERenderGraphUsage usage);
+		PassBuilder& Write(ResourceHandle resource, ERenderGraphUsage usage);
+		PassBuilder& SetSideEffect(); // keep the pass even if nothing reads its writes
+
+	private:
+		friend class MKRenderGraph;
+		PassBuilder(MKRenderGraph& graph, uint32 passIndex) : _graph(graph), _passIndex(passIndex) {}
+
+		MKRenderGraph& _graph;
+		uint32         _passIndex;
+	};
+
+public:
+	MKRenderGraph(MKDevice& mkDeviceRef);
+	~MKRenderGraph();
+
+	/* getters */
+	VkImage      GetImage(ResourceHandle resource)     const { return _resources[resource].image; }
+	VkImageView  GetImageView(ResourceHandle resource) const { return _resources[resource].imageView; }
+	bool         IsPassCulled(uint32 passIndex)        const { return _passes[passIndex].isCulled; }
+	uint32       GetBarrierCount()                     const { return _barrierCount; }
+	VkDeviceSize GetTransientMemorySize()              const { return _transientAllocator.GetCommittedMemorySize(); }
+	const BarrierBatch::Statistics& GetBarrierStatistics() const { return _barrierBatch.GetStatistics(); } // accumulated over executions
+	static VkImageLayout GetUsageLayout(ERenderGraphUsage usage); // layout the image is in while a pass uses it (e.g. for VkRenderingAttachmentInfo)
+
+	/* graph declaration */
+	ResourceHandle CreateImage(const RenderGraphImageDesc& desc);
+	ResourceHandle ImportImage(const RenderGraphImageDesc& desc, const RenderGraphImportState& initialState, const RenderGraphImportState& finalState = {}); // final layout makes it an output, final stage none means later users wait on a semaphore
+	PassBuilder    AddPass(const std::string& name, ExecuteFunc execute);
+
+	/* compile and execute */
+	void Compile();                                                                      // cull passes, place transient images and derive barriers
+	void SetImportedImage(ResourceHandle resource, VkImage image, VkImageView imageView); // external image of this frame (e.g. acquired swapchain image)
+	void Execute(VkCommandBuffer commandBuffer);
+	void Reset();                                                                        // destroy transient images and forget every pass and resource
+
+private:
+	struct ResourceAccess
+	{
+		ResourceHandle    resource;
+		ERenderGraphUsage usage;
+		bool              isWrite;
+	};
+
+	struct Pass
+	{
+		std::string                 name;
+		ExecuteFunc                 execute;
+		std::vector<ResourceAccess> accesses;
+		bool                        hasSideEffect = false;
+		bool                        isCulled      = false;
+		uint32                      refCount      = 0;  // writes that are still needed, used by culling
+		std::vector<uint32>         barrierIndices;     // barriers flushed before this pass
+	};
+
+	struct Resource
+	{
+		RenderGraphImageDesc   desc;
+		bool                   isImported   = false;
+		RenderGraphImportState initialState;
+		RenderGraphImportState finalState;
+		VkImage                image        = VK_NULL_HANDLE;
+		VkImageView            imageView    = VK_NULL_HANDLE;  // owned by the graph for transient images
+		uint32                 transientHandle = UINT32_MAX;   // TransientAllocator request
+		uint32                 refCount     = 0;               // readers that survive culling
+	};
+
+	struct CompiledBarrier
+	{
+		ResourceHandle         resource;
+		VkImageMemoryBarrier2  barrier; // image is patched at execution for imported images
+	};
+
+	/* compile steps */
+	void CullPasses();
+	void CreateTransientImages();
+	void DeriveBarriers();
+
+private:
+	std::vector<Pass>            _passes;
+	std::vector<Resource>        _resources;
+	std::vector<CompiledBarrier> _barriers;
+	std::vector<uint32>          _finalBarrierIndices; // transitions of outputs to their final layout
+	BarrierBatch                 _barrierBatch;        // records barriers of a pass with one call in Execute()
+	uint32                       _barrierCount = 0;
+	bool                         _isCompiled   = false;
+
+	/* transient images are aliased by pass lifetime */
+	TransientAllocator           _transientAllocator;
+
+	MKDevice&                    _mkDeviceRef;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Utilities.h"
+
+namespace mk
+{
+	namespace spirv
+	{
+		/* a resource variable declared with DescriptorSet and Binding decorations */
+		struct ReflectedBinding
+		{
+			uint32           set;
+			uint32           binding;
+			VkDescriptorType descriptorType;
+			uint32           descriptorCount; // 1 for runtime sized arrays, override it on host side
+		};
+
+		/* descriptor and push constant interface of a single shader stage */
+		struct ShaderReflection
+		{
+			VkShaderStageFlagBits         stage;
+			std::vector<ReflectedBinding> bindings;
+			uint32                        pushConstantSize = 0; // 0 if the stage has no push constant block
+		};
+
+		/**
+		* reflect descriptor bindings and push constant block from SPIR-V binary
+		* - parses only the instructions needed for the interface (decorations, types, constants and variables).
+		* - a sampled image and a sampler sharing a binding are merged into a combined image sampler,
+		*   which is how DXC maps 'register(tN)' and 'register(sN)' without binding shifts.
+		*/
+		ShaderReflection ReflectShader(const std::vector<char>& code, VkShaderStageFlagBits stage);
+	}
+}
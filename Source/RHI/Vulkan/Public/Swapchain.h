@@ -19,19 +19,18 @@ public:
 	VkExtent2D     GetSwapchainExtent()	                    const { return _vkSwapchainExtent; }
 	VkImage        GetSwapchainImage(uint32 imageIndex)     const { return _vkSwapchainImages[imageIndex]; }
 	VkImageView    GetSwapchainImageView(uint32 imageIndex) const { return _vkSwapchainImageViews[imageIndex]; }
-	VkImage        GetDepthImage()                          const { return _vkDepthImage.image; }
-	VkImageView    GetDepthImageView()                      const { return _vkDepthImageView; }
-	VkFormat       GetDepthFormat()                         const { return _vkDepthFormat; }
 	size_t         GetImageViewCount()                      const { return _vkSwapchainImageViews.size(); }
+	VkPresentModeKHR GetPresentMode()                       const { return _vkPresentMode; }
+	bool           IsStorageImageEnabled()                  const { return _isStorageImageEnabled; } // images can be written by compute shaders
 
 	/* setters */
 	void DestroySwapchainResources();
-	void DestroyDepthResources();
+	void SetLowLatencyMode(bool enable) { _isLowLatencyMode = enable; } // takes effect on the next CreateSwapchain()
+	void RequestStorageImage(bool enable) { _isStorageImageRequested = enable; } // takes effect on the next CreateSwapchain()
 
 	/* api */
 	void CreateSwapchain();
 	void CreateSwapchainImageViews();
-	void CreateDepthResources();
 
 private:
 	VkSwapchainKHR				_vkSwapchain;
@@ -40,11 +39,10 @@ private:
 	std::vector<VkImage>		_vkSwapchainImages;
 	std::vector<VkImageView>	_vkSwapchainImageViews;
 	VkFormat					_vkSwapchainImageFormat;
-
-	/* depth image */
-	VkImageAllocated            _vkDepthImage;
-	VkImageView                 _vkDepthImageView;
-	VkFormat                    _vkDepthFormat;
+	VkPresentModeKHR			_vkPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+	bool						_isLowLatencyMode = false;
+	bool						_isStorageImageRequested = false;
+	bool						_isStorageImageEnabled = false;
 
 	/* extent */
 	VkExtent2D					_vkSwapchainExtent;
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vma/vk_mem_alloc.h>
+
+#include "VulkanType.h"
+#include "Info.h"
+#include "Macros.h"
+
+// a description of render target whose contents only live between two passes of a frame
+struct TransientImageDesc
+{
+	uint32            width;
+	uint32            height;
+	VkFormat          format;
+	VkImageUsageFlags usage;
+	uint32            firstPass; // index of the first pass that reads or writes the image
+	uint32            lastPass;  // index of the last pass that reads or writes the image
+	std::string       name = "UNDEFINED";
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT; // multisampled attachments resolved in their pass are good candidates for lazily allocated memory
+};
+
+/**
+* [TransientAllocator class]
+* - Responsibility :
+*    - place render targets with non-overlapping pass lifetimes on the same memory block.
+*    - back attachments created with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT by lazily allocated memory when the device exposes it.
+* - Note :
+*    - images returned by this allocator must be destroyed with Reset(), not with Allocator::DestroyImage().
+*    - contents of an aliased image are undefined at the first pass of its lifetime, so transition it from VK_IMAGE_LAYOUT_UNDEFINED.
+*/
+class TransientAllocator
+{
+private:
+	struct TransientRequest
+	{
+		TransientImageDesc   desc;
+		VkImageAllocated     imageAllocated;
+		VkMemoryRequirements memoryRequirements;
+		uint32               blockIndex;
+	};
+
+	struct TransientBlock
+	{
+		VkMemoryRequirements memoryRequirements;
+		bool                 isLazy;
+		std::vector<uint32>  requestIndices;
+		VmaAllocation        allocation = VK_NULL_HANDLE;
+		VmaAllocationInfo    allocationInfo;
+	};
+
+public:
+	TransientAllocator();
+	~TransientAllocator();
+
+	/* getters */
+	const VkImageAllocated& GetImage(uint32 handle)   const { return _requests[handle].imageAllocated; }
+	uint32                  GetBlockCount()          const { return static_cast<uint32>(_blocks.size()); }
+	uint32                  GetBlockIndex(uint32 handle) const { return _requests[handle].blockIndex; } // memory block shared with aliasing images
+	VkDeviceSize            GetCommittedMemorySize() const;
+
+	/* transient resource api */
+	uint32 RequestImage(const TransientImageDesc& desc);
+	void   Build();
+	void   Reset();
+
+private:
+	bool IsLifetimeOverlapped(const TransientBlock& block, const TransientImageDesc& desc) const;
+	bool IsLazilyAllocatedMemorySupported() const;
+
+private:
+	std::vector<TransientRequest> _requests;
+	std::vector<TransientBlock>   _blocks;
+};
@@ -27,7 +27,8 @@ FreeCamera::FreeCamera(MKDevice& mkDeviceRef, MKSwapchain& mkSwapchainRef)
 		0.1f,
 		10.0f
 	);
-	_projectionMat = XMMatrixTranspose(projectionMat);
+	_projectionMat           = XMMatrixTranspose(projectionMat);
+	_unjitteredProjectionMat = _projectionMat;
 #else
 	_viewMat = glm::lookAt(_cameraPosition, _focusPosition, _upDirection);
 
@@ -42,6 +43,7 @@ FreeCamera::FreeCamera(MKDevice& mkDeviceRef, MKSwapchain& mkSwapchainRef)
 		10.0f
 	);
 	_projectionMat[1][1] *= -1; // flip y coordinate
+	_unjitteredProjectionMat = _projectionMat;
 #endif
 }
 
@@ -124,4 +126,24 @@ void FreeCamera::UpdateViewTarget()
 #else
 	_viewMat = glm::lookAt(_cameraPosition, _focusPosition, _upDirection);
 #endif
-}
\ No newline at end of file
+}
+
+void FreeCamera::SetProjectionJitter(float x, float y)
+{
+	/**
+	* Sub-pixel jitter
+	* - clip position is offset by (x, y) * w, so the image shifts by (x, y) in NDC regardless of depth.
+	* - w comes from the third row of the view space position only, so only the terms of that row are modified.
+	*/
+#ifdef USE_HLSL
+	// stored transposed : z components of the first two rows are the view z terms of clip x and y
+	_projectionMat      = _unjitteredProjectionMat;
+	_projectionMat.r[0] = XMVectorAdd(_projectionMat.r[0], XMVectorSet(0.0f, 0.0f, x, 0.0f));
+	_projectionMat.r[1] = XMVectorAdd(_projectionMat.r[1], XMVectorSet(0.0f, 0.0f, y, 0.0f));
+#else
+	// w = -z_view for right handed projection, so the offset takes the sign of that term
+	_projectionMat        = _unjitteredProjectionMat;
+	_projectionMat[2][0] += x * _projectionMat[2][3];
+	_projectionMat[2][1] += y * _projectionMat[2][3];
+#endif
+}
@@ -16,12 +16,15 @@ public:
 	void UpdateCameraRotationVertical(float rotationSpeed);
 
 	void UpdateViewTarget();
+	void SetProjectionJitter(float x, float y); // sub-pixel offset of this frame in NDC (temporal aa), zero disables it
 #ifdef USE_HLSL
-	XMMATRIX GetViewMatrix()        const { return _viewMat; }
-	XMMATRIX GetProjectionMatrix()  const { return _projectionMat; }
+	XMMATRIX GetViewMatrix()                  const { return _viewMat; }
+	XMMATRIX GetProjectionMatrix()            const { return _projectionMat; }
+	XMMATRIX GetUnjitteredProjectionMatrix()  const { return _unjitteredProjectionMat; }
 #else
-	glm::mat4 GetViewMatrix()       const { return _viewMat; }
-	glm::mat4 GetProjectionMatrix() const { return _projectionMat; }
+	glm::mat4 GetViewMatrix()                 const { return _viewMat; }
+	glm::mat4 GetProjectionMatrix()           const { return _projectionMat; }
+	glm::mat4 GetUnjitteredProjectionMatrix() const { return _unjitteredProjectionMat; }
 #endif
 
 private:
@@ -39,6 +42,7 @@ private:
 	XMMATRIX _viewInverseMat   = XMMatrixIdentity();
 	XMMATRIX _viewMat          = XMMatrixIdentity();
 	XMMATRIX _projectionMat    = XMMatrixIdentity();
+	XMMATRIX _unjitteredProjectionMat = XMMatrixIdentity();
 #else
 	glm::vec3 _upDirection      = glm::vec3(0.0f, 0.0f, 1.0f);
 	glm::vec3 _forwardDirection = glm::vec3(-1.0f, 0.0f, 0.0f);
@@ -47,5 +51,6 @@ private:
 	glm::vec3 _focusPosition    = glm::vec3(0.0f, 0.0f, 0.0f);
 	glm::mat4 _viewMat          = glm::mat4(1.0f);
 	glm::mat4 _projectionMat    = glm::mat4(1.0f);
+	glm::mat4 _unjitteredProjectionMat = glm::mat4(1.0f);
 #endif
 };
\ No newline at end of file
@@ -0,0 +1,7 @@
+/// ------------------ BINDLESS FRAGMENT SHADER ------------------
+/// Same shading as fragment.hlsl, but every texture is fetched from the global bindless table (descriptor set 2)
+/// through the material record selected by push constant.
+/// Note that hot reload only tracks this file, save it to pick up edits of fragment.hlsl.
+
+#define BINDLESS
+#include "fragment.hlsl"
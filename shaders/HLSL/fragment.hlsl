@@ -20,6 +20,10 @@
 /// 5. Push constant binding
 ///     A push constant binding requires a '[[vk::push_constant]]' attribute in HLSL and The push constant struct should be defined in the shader file.
 ///     Also Note that you can only bind a single push constant per shader program.
+/// 
+/// 6. Bindless variant
+///     When 'BINDLESS' is defined (see bindless-fragment.hlsl), textures are fetched from the global bindless table in descriptor set 2.
+///     The material record selected by push constant holds the indices of its textures in that table.
 
 
 
@@ -30,12 +34,17 @@ struct PSInput
     float3 WorldNormal : NORMAL0;
     float3 ViewDir     : VIEW0;
     float2 TexCoord    : TEXCOORD0;
+    float4 CurrentClipPos  : POSITION1;
+    float4 PreviousClipPos : POSITION2;
 };
 
-//struct PSOutput
-//{
-//    float4 OutColor;
-//};
+#define MOTION_VECTOR_SCALE 32767.0f // uv offset in [-1, 1] -> R16G16_SINT, must match post-temporal-resolve-compute.hlsl
+
+struct PSOutput
+{
+    float4 OutColor : SV_Target0;
+    int2   Motion   : SV_Target1; // fixed point uv offset to the previous frame, discarded when no attachment is bound at location 1
+};
 
 struct PushConstantRaster 
 {
@@ -43,13 +52,31 @@ struct PushConstantRaster
     float3   LightPosition;
     float    LightIntensity;
     int      LightType;
+    uint     MaterialBufferIndex; // bindless storage buffer holding material records
+    uint     MaterialIndex;       // material record of current draw
 };
 
 [[vk::push_constant]]
 PushConstantRaster pc;
 
+#ifdef BINDLESS
+struct MaterialData
+{
+    uint DiffuseTexture;
+    uint SpecularTexture;
+    uint NormalTexture;
+    uint Padding;
+};
+
+[[vk::binding(0, 2)]]                                          // bindless sampled image array
+Texture2D gTextures[] : register(t0, space2);
+
+[[vk::binding(1, 2)]]                                          // bindless storage buffer array
+StructuredBuffer<MaterialData> gMaterialBuffers[] : register(t1, space2);
+#else
 [[vk::binding(1, 0)]]                   // sampled image descriptor binding
 Texture2DArray textures : register(t0); // binding array to register t0
+#endif
 
 [[vk::binding(0, 1)]]                     // sampler descriptor binding
 SamplerState samplerState : register(s0); // binding sampler to register s0
@@ -199,27 +226,44 @@ static float3 computeSpecularColor(float4 specularColor, float3 viewDir, float3
 
 
 // ------------------ MAIN FUNCTION ------------------
-float4 main(PSInput input) : SV_Target
+PSOutput main(PSInput input)
 {
+    float3 lightDirection = normalize(pc.LightPosition - input.WorldPos);
+
+#ifdef BINDLESS
+    // material index is uniform per draw, so no NonUniformResourceIndex is needed
+    MaterialData material = gMaterialBuffers[pc.MaterialBufferIndex][pc.MaterialIndex];
+
+    float3 normal = gTextures[material.NormalTexture].Sample(samplerState, input.TexCoord).xyz;
+    float4 diffuseColor = gTextures[material.DiffuseTexture].Sample(samplerState, input.TexCoord);
+    float4 specularColor = gTextures[material.SpecularTexture].Sample(samplerState, input.TexCoord);
+#else
     int diffuseIndex = 0;
     int specularIdx = 1;
     int normalIdx = 2;
 
-    float3 lightDirection = normalize(pc.LightPosition - input.WorldPos);
-
     // If normal map was given, use accurate normal from it.
     float3 normalCoord = float3(input.TexCoord, (float)normalIdx);
     float3 normal = textures.Sample(samplerState, normalCoord).xyz;
 
     float3 diffuseCoord = float3(input.TexCoord, (float)diffuseIndex);
     float4 diffuseColor = textures.Sample(samplerState, diffuseCoord);
-    float4 outColor = float4(computeDiffuseColor(diffuseColor, input.ViewDir, lightDirection, normal), 1.0f);
 
     // extract specular color
     float3 specularCoord = float3(input.TexCoord, (float)specularIdx);
     float4 specularColor = textures.Sample(samplerState, specularCoord);
+#endif
+
+    float4 outColor = float4(computeDiffuseColor(diffuseColor, input.ViewDir, lightDirection, normal), 1.0f);
 
     outColor += float4(computeSpecularColor(specularColor, input.ViewDir, lightDirection, normal), 1.0f);
 
-    return outColor;
+    // NDC -> uv is a scale by 0.5 on both axes in Vulkan, so the motion in uv is half of the NDC difference
+    float2 currentNDC  = input.CurrentClipPos.xy / input.CurrentClipPos.w;
+    float2 previousNDC = input.PreviousClipPos.xy / input.PreviousClipPos.w;
+
+    PSOutput output;
+    output.OutColor = outColor;
+    output.Motion   = int2(round(clamp((previousNDC - currentNDC) * 0.5f, -1.0f, 1.0f) * MOTION_VECTOR_SCALE));
+    return output;
 }
\ No newline at end of file
@@ -15,12 +15,16 @@ struct VSOutput
     [[vk::location(1)]] float3 WorldNormal : NORMAL0;
     [[vk::location(2)]] float3 ViewDir     : VIEW0;
     [[vk::location(3)]] float2 TexCoord    : TEXCOORD0;
+    [[vk::location(4)]] float4 CurrentClipPos  : POSITION1; // unjittered, for motion vectors
+    [[vk::location(5)]] float4 PreviousClipPos : POSITION2;
 };
 
 struct UBO
 {
     float4x4 mvpMat;
     float4x4 viewInverseMat;
+    float4x4 currentMvpMat;  // without sub-pixel jitter
+    float4x4 previousMvpMat; // unjittered mvp of the previous frame
 };
 
 struct PushConstantRaster 
@@ -29,6 +33,8 @@ struct PushConstantRaster
     float3   LightPosition;
     float    LightIntensity;
     int      LightType;
+    uint     MaterialBufferIndex;
+    uint     MaterialIndex;
 };
 
 [[vk::push_constant]]
@@ -59,6 +65,10 @@ VSOutput main(VSInput input, uint VertexIndex : SV_VertexID)
     output.WorldPos    = input.Position;
     output.WorldNormal = normalize(mul(input.Normal, (float3x3)pc.ModelMat)); // downcast model matrix to 3x3 matrix first. Then multiply with normal
     output.TexCoord    = input.TexCoord;
+
+    // jitter is left out, so that motion only holds the movement of the surface
+    output.CurrentClipPos  = mul(pos, ubo.currentMvpMat);
+    output.PreviousClipPos = mul(pos, ubo.previousMvpMat);
    
     return output;
 }
\ No newline at end of file